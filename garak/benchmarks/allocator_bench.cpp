@@ -0,0 +1,78 @@
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <asio/io_context.hpp>
+#include <asio/post.hpp>
+#include <asio/recycling_allocator.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace {
+/**
+ * @brief Run body as a handler, where asio's per-thread recycling cache
+ * is available
+ * */
+template <typename Body>
+void in_handler(Body body) {
+  asio::io_context ctx{1};
+  asio::post(ctx, body);
+  ctx.run();
+}
+
+/**
+ * @brief Allocate and free through asio's recycling allocator, which
+ * reuses the thread's last freed block
+ * */
+void BM_RecyclingAllocator(benchmark::State& state) {
+  const auto size = static_cast<std::size_t>(state.range(0));
+  in_handler([&] {
+    asio::recycling_allocator<std::byte> allocator;
+    for (auto _ : state) {
+      std::byte* p = allocator.allocate(size);
+      benchmark::DoNotOptimize(p);
+      allocator.deallocate(p, size);
+    }
+  });
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RecyclingAllocator)->Arg(64)->Arg(1024)->Arg(16384);
+
+/**
+ * @brief The same with std::allocator as the baseline
+ * */
+void BM_StdAllocator(benchmark::State& state) {
+  const auto size = static_cast<std::size_t>(state.range(0));
+  std::allocator<std::byte> allocator;
+  for (auto _ : state) {
+    std::byte* p = allocator.allocate(size);
+    benchmark::DoNotOptimize(p);
+    allocator.deallocate(p, size);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_StdAllocator)->Arg(64)->Arg(1024)->Arg(16384);
+
+/**
+ * @brief Post handlers carrying Size bytes of state, small ones reuse
+ * recycled operation memory, large ones fall back to the heap
+ * */
+template <std::size_t Size>
+void BM_PostCapture(benchmark::State& state) {
+  asio::io_context ctx{1};
+  std::array<std::uint8_t, Size> payload{};
+  std::uint64_t sum = 0;
+  for (auto _ : state) {
+    for (int i = 0; i < 64; ++i) {
+      asio::post(ctx, [&sum, payload] { sum += payload[0]; });
+    }
+    ctx.run();
+    ctx.restart();
+  }
+  benchmark::DoNotOptimize(sum);
+  state.SetItemsProcessed(state.iterations() * 64);
+}
+BENCHMARK_TEMPLATE(BM_PostCapture, 16);
+BENCHMARK_TEMPLATE(BM_PostCapture, 256);
+BENCHMARK_TEMPLATE(BM_PostCapture, 4096);
+}  // namespace
@@ -0,0 +1,111 @@
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <asio/co_spawn.hpp>
+#include <asio/detached.hpp>
+#include <asio/experimental/concurrent_channel.hpp>
+#include <asio/io_context.hpp>
+#include <asio/use_awaitable.hpp>
+#include <cstdint>
+#include <garak/channel.hpp>
+#include <thread>
+#include <vector>
+
+namespace {
+constexpr std::int64_t messages = 100000;
+
+/**
+ * @brief Send `messages` values split over `producers` threads, each on
+ * its own io_context, with send(channel, value) as their coroutine body
+ * */
+template <typename Send>
+std::vector<std::thread> start_producers(std::int64_t producers, Send send) {
+  std::vector<std::thread> threads;
+  for (std::int64_t p = 0; p < producers; ++p) {
+    threads.emplace_back([send, share = messages / producers] {
+      asio::io_context ctx;
+      asio::co_spawn(
+          ctx,
+          [send, share]() -> asio::awaitable<void> {
+            for (std::int64_t i = 0; i < share; ++i) {
+              co_await send(i);
+            }
+          },
+          asio::detached);
+      ctx.run();
+    });
+  }
+  return threads;
+}
+
+/**
+ * @brief garak channels, received in batches of up to 64
+ * */
+template <typename Channel>
+void BM_RingChannel(benchmark::State& state) {
+  const auto producers = state.range(0);
+  for (auto _ : state) {
+    asio::io_context ctx;
+    Channel channel{ctx.get_executor(), 1024};
+    auto threads = start_producers(producers, [&channel](std::int64_t i) {
+      return channel.async_send(i, asio::use_awaitable);
+    });
+    std::int64_t received = 0;
+    asio::co_spawn(
+        ctx,
+        [&]() -> asio::awaitable<void> {
+          std::array<std::int64_t, 64> batch{};
+          while (received < messages / producers * producers) {
+            received += static_cast<std::int64_t>(co_await channel
+                    .async_receive_some(batch, asio::use_awaitable));
+          }
+        },
+        asio::detached);
+    ctx.run();
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * messages);
+}
+BENCHMARK(BM_RingChannel<garak::spsc_channel<std::int64_t>>)
+    ->Arg(1)
+    ->UseRealTime();
+BENCHMARK(BM_RingChannel<garak::mpsc_channel<std::int64_t>>)
+    ->Arg(1)
+    ->Arg(4)
+    ->UseRealTime();
+
+/**
+ * @brief asio::experimental::concurrent_channel, the mutex guarded baseline
+ * */
+void BM_ConcurrentChannel(benchmark::State& state) {
+  using channel_type = asio::experimental::concurrent_channel<void(
+      asio::error_code, std::int64_t)>;
+  const auto producers = state.range(0);
+  for (auto _ : state) {
+    asio::io_context ctx;
+    channel_type channel{ctx, 1024};
+    auto threads = start_producers(producers, [&channel](std::int64_t i) {
+      return channel.async_send(asio::error_code{}, i, asio::use_awaitable);
+    });
+    std::int64_t received = 0;
+    asio::co_spawn(
+        ctx,
+        [&]() -> asio::awaitable<void> {
+          while (received < messages / producers * producers) {
+            benchmark::DoNotOptimize(
+                co_await channel.async_receive(asio::use_awaitable));
+            ++received;
+          }
+        },
+        asio::detached);
+    ctx.run();
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * messages);
+}
+BENCHMARK(BM_ConcurrentChannel)->Arg(1)->Arg(4)->UseRealTime();
+}  // namespace
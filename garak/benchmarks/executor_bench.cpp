@@ -0,0 +1,170 @@
+#include <benchmark/benchmark.h>
+
+#include <asio/dispatch.hpp>
+#include <asio/io_context.hpp>
+#include <asio/post.hpp>
+#include <asio/steady_timer.hpp>
+#include <asio/strand.hpp>
+#include <chrono>
+#include <cstdint>
+#include <garak/priority_lanes.hpp>
+#include <garak/watchdog.hpp>
+#include <vector>
+
+namespace {
+/**
+ * @brief Post a batch of handlers and run them
+ * */
+void BM_Post(benchmark::State& state) {
+  asio::io_context ctx{1};
+  const auto batch = state.range(0);
+  std::int64_t ran = 0;
+  for (auto _ : state) {
+    for (std::int64_t i = 0; i < batch; ++i) {
+      asio::post(ctx, [&ran] { ++ran; });
+    }
+    ctx.run();
+    ctx.restart();
+  }
+  benchmark::DoNotOptimize(ran);
+  state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK(BM_Post)->Arg(1)->Arg(1024);
+
+/**
+ * @brief BM_Post with a garak::watchdog running, watching the io_context
+ * when the second argument is 1; its thread is there either way, since a
+ * second thread alone takes glibc off its single threaded fast paths
+ * */
+void BM_PostWatched(benchmark::State& state) {
+  asio::io_context ctx{1};
+  garak::watchdog watchdog;
+  if (state.range(1) != 0) {
+    watchdog.watch(ctx);
+  }
+  const auto batch = state.range(0);
+  std::int64_t ran = 0;
+  for (auto _ : state) {
+    for (std::int64_t i = 0; i < batch; ++i) {
+      asio::post(ctx, [&ran] { ++ran; });
+    }
+    ctx.run();
+    ctx.restart();
+  }
+  benchmark::DoNotOptimize(ran);
+  state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK(BM_PostWatched)->Args({1024, 0})->Args({1024, 1});
+
+/**
+ * @brief Dispatch from inside a running handler, which runs inline
+ * */
+void BM_Dispatch(benchmark::State& state) {
+  asio::io_context ctx{1};
+  std::int64_t ran = 0;
+  asio::post(ctx, [&] {
+    for (auto _ : state) {
+      asio::dispatch(ctx, [&ran] { ++ran; });
+    }
+  });
+  ctx.run();
+  benchmark::DoNotOptimize(ran);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Dispatch);
+
+/**
+ * @brief Post a batch of handlers through a strand and run them
+ * */
+void BM_StrandPost(benchmark::State& state) {
+  asio::io_context ctx{1};
+  auto strand = asio::make_strand(ctx);
+  const auto batch = state.range(0);
+  std::int64_t ran = 0;
+  for (auto _ : state) {
+    for (std::int64_t i = 0; i < batch; ++i) {
+      asio::post(strand, [&ran] { ++ran; });
+    }
+    ctx.run();
+    ctx.restart();
+  }
+  benchmark::DoNotOptimize(ran);
+  state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK(BM_StrandPost)->Arg(1)->Arg(1024);
+
+/**
+ * @brief How long a control handler posted behind 1024 bulk handlers
+ * waits to run, posted straight to the io_context (0) or on the control
+ * lane of garak::priority_lanes with the bulk on the data lane (1); fixed
+ * iterations, as the prioritised wait is too short to time the run by
+ * */
+void BM_ControlBehindBulk(benchmark::State& state) {
+  asio::io_context ctx{1};
+  auto& lanes = garak::enable_priority_lanes(ctx);
+  const bool prioritised = state.range(0) != 0;
+  std::int64_t work = 0;
+  for (auto _ : state) {
+    for (int i = 0; i < 1024; ++i) {
+      auto bulk = [&work] {
+        for (int j = 0; j < 64; ++j) {
+          benchmark::DoNotOptimize(work += j);
+        }
+      };
+      if (prioritised) {
+        asio::post(lanes.get_executor(1), bulk);
+      } else {
+        asio::post(ctx, bulk);
+      }
+    }
+    const auto posted = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point ran;
+    if (prioritised) {
+      const auto control = lanes.get_executor(0);
+      asio::post(control, [&ran] { ran = std::chrono::steady_clock::now(); });
+    } else {
+      asio::post(ctx, [&ran] { ran = std::chrono::steady_clock::now(); });
+    }
+    ctx.run();
+    ctx.restart();
+    state.SetIterationTime(
+        std::chrono::duration<double>(ran - posted).count());
+  }
+}
+BENCHMARK(BM_ControlBehindBulk)
+    ->Arg(0)
+    ->Arg(1)
+    ->UseManualTime()
+    ->Iterations(2000);
+
+/**
+ * @brief Arm a batch of timers and cancel them all again
+ * */
+void BM_TimerInsertCancel(benchmark::State& state) {
+  asio::io_context ctx{1};
+  std::vector<asio::steady_timer> timers;
+  const auto batch = state.range(0);
+  for (std::int64_t i = 0; i < batch; ++i) {
+    timers.emplace_back(ctx);
+  }
+  std::int64_t cancelled = 0;
+  for (auto _ : state) {
+    for (auto& timer : timers) {
+      // Spread expiries so inserts don't all land at one end of the heap
+      timer.expires_after(std::chrono::hours(1) +
+                          std::chrono::microseconds(&timer - timers.data()));
+      timer.async_wait([&cancelled](const asio::error_code&) {
+        ++cancelled;
+      });
+    }
+    for (auto& timer : timers) {
+      timer.cancel();
+    }
+    ctx.run();
+    ctx.restart();
+  }
+  benchmark::DoNotOptimize(cancelled);
+  state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK(BM_TimerInsertCancel)->Arg(1)->Arg(1024);
+}  // namespace
@@ -0,0 +1,10 @@
+#include <benchmark/benchmark.h>
+
+/**
+ * @brief Runs the suite; JSON results are only written when asked for with
+ * --benchmark_out, as the bench target does into the build directory
+ *
+ * Two result files can be diffed with google benchmark's
+ * tools/compare.py benchmarks old.json new.json
+ * */
+BENCHMARK_MAIN();
@@ -0,0 +1,52 @@
+#include <benchmark/benchmark.h>
+
+#include <asio/ip/address_v4.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <garak/rate_limiter.hpp>
+#include <memory>
+#include <vector>
+
+namespace {
+std::unique_ptr<garak::rate_limiter> limiter;
+
+/**
+ * @brief Per client checks over 4096 addresses, from each benchmark
+ * thread, against a limiter with range(0) shards
+ * */
+void BM_RateLimiter(benchmark::State& state) {
+  if (state.thread_index() == 0) {
+    limiter = std::make_unique<garak::rate_limiter>(
+        garak::rate_limit{.per_second = 1e9, .burst = 1e9},
+        static_cast<std::size_t>(state.range(0)));
+  }
+  std::vector<asio::ip::address> clients;
+  for (std::uint32_t i = 0; i < 4096; ++i) {
+    clients.emplace_back(asio::ip::address_v4{
+        0x0a000000U + i * 7919U + static_cast<std::uint32_t>(
+                                      state.thread_index())});
+  }
+  std::size_t next = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        limiter->try_acquire(clients[next++ % clients.size()]));
+  }
+  state.SetItemsProcessed(state.iterations());
+  if (state.thread_index() == 0) {
+    limiter.reset();
+  }
+}
+BENCHMARK(BM_RateLimiter)->Arg(1)->Arg(16)->Threads(1)->Threads(4);
+
+/**
+ * @brief One token bucket, the cost of a check without the map and lock
+ * */
+void BM_TokenBucket(benchmark::State& state) {
+  garak::token_bucket bucket{{.per_second = 1e9, .burst = 1e9}};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(bucket.try_take());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TokenBucket);
+}  // namespace
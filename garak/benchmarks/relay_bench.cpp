@@ -0,0 +1,98 @@
+#include <benchmark/benchmark.h>
+
+#include <asio/io_context.hpp>
+#include <asio/ip/tcp.hpp>
+#include <asio/write.hpp>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <garak/relay.hpp>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+using tcp = asio::ip::tcp;
+
+std::pair<tcp::socket, tcp::socket> loopback_pair(asio::io_context& ctx) {
+  tcp::acceptor acceptor{ctx, {asio::ip::address_v4::loopback(), 0}};
+  tcp::socket client{ctx};
+  client.connect(acceptor.local_endpoint());
+  return {std::move(client), acceptor.accept()};
+}
+
+/**
+ * @brief A writer's socket relayed on its own thread to a socket a second
+ * thread drains
+ * */
+class relayed_connection {
+ public:
+  explicit relayed_connection(garak::relay_mode mode)
+      : left_(ctx_), a_(ctx_), b_(ctx_), right_(ctx_) {
+    std::tie(left_, a_) = loopback_pair(ctx_);
+    std::tie(b_, right_) = loopback_pair(ctx_);
+    garak::async_relay(a_, b_, mode,
+                       [](asio::error_code, garak::relay_stats) {});
+    relay_thread_ = std::thread{[this] { ctx_.run(); }};
+    drain_thread_ = std::thread{[this] { drain(); }};
+  }
+
+  relayed_connection(const relayed_connection&) = delete;
+  relayed_connection& operator=(const relayed_connection&) = delete;
+
+  ~relayed_connection() {
+    asio::error_code ignored;
+    left_.shutdown(tcp::socket::shutdown_send, ignored);
+    drain_thread_.join();
+    relay_thread_.join();
+  }
+
+  tcp::socket& writer() { return left_; }
+
+  void wait_for(std::uint64_t total) const {
+    while (received_.load(std::memory_order_acquire) < total) {
+      std::this_thread::yield();
+    }
+  }
+
+ private:
+  // Count until the relayed end, then end the other direction too
+  void drain() {
+    std::vector<char> buffer(256 * 1024);
+    asio::error_code ec;
+    while (!ec) {
+      const auto n = right_.read_some(asio::buffer(buffer), ec);
+      received_.fetch_add(n, std::memory_order_release);
+    }
+    right_.shutdown(tcp::socket::shutdown_send, ec);
+  }
+
+  asio::io_context ctx_{1};
+  tcp::socket left_;
+  tcp::socket a_;
+  tcp::socket b_;
+  tcp::socket right_;
+  std::atomic<std::uint64_t> received_{0};
+  std::thread relay_thread_;
+  std::thread drain_thread_;
+};
+
+/**
+ * @brief Stream through async_relay, counting the CPU time of every
+ * thread so the relay's own share shows
+ * */
+void BM_Relay(benchmark::State& state) {
+  const auto mode = state.range(0) == 0 ? garak::relay_mode::automatic
+                                        : garak::relay_mode::copy;
+  state.SetLabel(state.range(0) == 0 ? "splice" : "copy");
+  relayed_connection connection{mode};
+  std::vector<char> message(256 * 1024, 'x');
+  std::uint64_t sent = 0;
+  for (auto _ : state) {
+    sent += asio::write(connection.writer(), asio::buffer(message));
+  }
+  connection.wait_for(sent);
+  state.SetBytesProcessed(static_cast<std::int64_t>(sent));
+}
+BENCHMARK(BM_Relay)->Arg(0)->Arg(1)->MeasureProcessCPUTime()->UseRealTime();
+}  // namespace
@@ -0,0 +1,132 @@
+#include <benchmark/benchmark.h>
+
+#include <asio/io_context.hpp>
+#include <asio/ip/tcp.hpp>
+#include <asio/write.hpp>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <garak/send_file.hpp>
+#include <memory>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+using tcp = asio::ip::tcp;
+using file_ptr = std::unique_ptr<std::FILE, decltype(&std::fclose)>;
+
+/**
+ * @brief A loopback connection whose far end a thread drains and counts
+ * */
+class drained_connection {
+ public:
+  drained_connection()
+      : acceptor_(ctx_, tcp::endpoint{asio::ip::address_v4::loopback(), 0}),
+        client_(ctx_),
+        server_(ctx_) {
+    client_.connect(acceptor_.local_endpoint());
+    server_ = acceptor_.accept();
+    thread_ = std::thread{[this] { drain(); }};
+  }
+
+  drained_connection(const drained_connection&) = delete;
+  drained_connection& operator=(const drained_connection&) = delete;
+
+  ~drained_connection() {
+    asio::error_code ignored;
+    client_.shutdown(tcp::socket::shutdown_both, ignored);
+    thread_.join();
+  }
+
+  asio::io_context& context() { return ctx_; }
+  tcp::socket& client() { return client_; }
+
+  /**
+   * @brief Block until the drain thread has seen total bytes
+   * */
+  void wait_for(std::uint64_t total) const {
+    while (received_.load(std::memory_order_acquire) < total) {
+      std::this_thread::yield();
+    }
+  }
+
+ private:
+  void drain() {
+    std::vector<char> buffer(256 * 1024);
+    asio::error_code ec;
+    while (!ec) {
+      const auto n = server_.read_some(asio::buffer(buffer), ec);
+      received_.fetch_add(n, std::memory_order_release);
+    }
+  }
+
+  asio::io_context ctx_{1};
+  tcp::acceptor acceptor_;
+  tcp::socket client_;
+  tcp::socket server_;
+  std::atomic<std::uint64_t> received_{0};
+  std::thread thread_;
+};
+
+file_ptr filled_file(std::size_t size) {
+  file_ptr file{std::tmpfile(), &std::fclose};
+  const std::vector<char> bytes(size, 'x');
+  std::fwrite(bytes.data(), 1, bytes.size(), file.get());
+  std::fflush(file.get());
+  return file;
+}
+
+/**
+ * @brief Send a whole page cached file with async_send_file
+ * */
+void BM_SendFile(benchmark::State& state) {
+  const auto size = static_cast<std::size_t>(state.range(0));
+  const auto file = filled_file(size);
+  const int fd = fileno(file.get());
+  drained_connection connection;
+  std::uint64_t sent = 0;
+  for (auto _ : state) {
+    garak::async_send_file(connection.client(), fd, 0, size,
+                           [&](asio::error_code, std::size_t n) { sent += n; });
+    connection.context().restart();
+    connection.context().run();
+  }
+  connection.wait_for(sent);
+  state.SetBytesProcessed(static_cast<std::int64_t>(sent));
+}
+BENCHMARK(BM_SendFile)->Arg(64 * 1024)->Arg(1024 * 1024)->UseRealTime();
+
+/**
+ * @brief Send the same file by pread into a buffer and async_write, the
+ * copying loop async_send_file replaces
+ * */
+void BM_ReadAndWrite(benchmark::State& state) {
+  const auto size = static_cast<std::size_t>(state.range(0));
+  const auto file = filled_file(size);
+  const int fd = fileno(file.get());
+  drained_connection connection;
+  std::vector<char> buffer(64 * 1024);
+  std::uint64_t sent = 0;
+  for (auto _ : state) {
+    off_t offset = 0;
+    for (;;) {
+      const auto n = ::pread(fd, buffer.data(), buffer.size(), offset);
+      if (n <= 0) {
+        break;
+      }
+      offset += n;
+      const auto chunk =
+          asio::buffer(buffer.data(), static_cast<std::size_t>(n));
+      asio::async_write(connection.client(), chunk,
+                        [&](asio::error_code, std::size_t m) { sent += m; });
+      connection.context().restart();
+      connection.context().run();
+    }
+  }
+  connection.wait_for(sent);
+  state.SetBytesProcessed(static_cast<std::int64_t>(sent));
+}
+BENCHMARK(BM_ReadAndWrite)->Arg(64 * 1024)->Arg(1024 * 1024)->UseRealTime();
+}  // namespace
@@ -0,0 +1,123 @@
+#include <benchmark/benchmark.h>
+
+#include <asio/io_context.hpp>
+#include <asio/local/connect_pair.hpp>
+#include <asio/local/stream_protocol.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <garak/frame.hpp>
+#include <garak/shm.hpp>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace {
+using unix_socket = asio::local::stream_protocol::socket;
+
+/**
+ * @brief Bounce a frame between two sessions on one io_context until
+ * count round trips are done
+ * */
+template <typename Session>
+class ping_pong {
+ public:
+  ping_pong(Session& client, Session& server, std::size_t size)
+      : client_(client), server_(server), message_(size) {
+    serve();
+  }
+
+  void run(asio::io_context& ctx, std::int64_t count) {
+    remaining_ = count;
+    done_ = false;
+    ping();
+    while (!done_) {
+      ctx.run_one();
+    }
+  }
+
+ private:
+  void ping() {
+    client_.async_write_frame(asio::buffer(message_),
+                              [](asio::error_code, std::size_t) {});
+    client_.async_read_frame(
+        [this](asio::error_code ec, std::span<const std::byte>) {
+          if (!ec && --remaining_ > 0) {
+            ping();
+          } else {
+            done_ = true;
+          }
+        });
+  }
+
+  void serve() {
+    server_.async_read_frame(
+        [this](asio::error_code ec, std::span<const std::byte> frame) {
+          if (ec) {
+            return;
+          }
+          server_.async_write_frame(asio::buffer(frame.data(), frame.size()),
+                                    [this](asio::error_code e, std::size_t) {
+                                      if (!e) {
+                                        serve();
+                                      }
+                                    });
+        });
+  }
+
+  Session& client_;
+  Session& server_;
+  std::vector<std::byte> message_;
+  std::int64_t remaining_{0};
+  bool done_{false};
+};
+
+/**
+ * @brief Round trips over shared memory rings
+ * */
+void BM_ShmPingPong(benchmark::State& state) {
+  asio::io_context ctx{1};
+  unix_socket a{ctx};
+  unix_socket b{ctx};
+  asio::local::connect_pair(a, b);
+  std::optional<garak::shm_session> client;
+  std::optional<garak::shm_session> server;
+  garak::async_shm_connect(std::move(a), garak::shm_options{},
+                           [&](asio::error_code, garak::shm_session s) {
+                             client.emplace(std::move(s));
+                           });
+  garak::async_shm_accept(std::move(b),
+                          [&](asio::error_code, garak::shm_session s) {
+                            server.emplace(std::move(s));
+                          });
+  while (!client || !server) {
+    ctx.run_one();
+  }
+  ping_pong<garak::shm_session> bounce{
+      *client, *server, static_cast<std::size_t>(state.range(0))};
+  for (auto _ : state) {
+    bounce.run(ctx, 1000);
+  }
+  state.SetItemsProcessed(state.iterations() * 1000);
+}
+BENCHMARK(BM_ShmPingPong)->Arg(64)->Arg(4096)->UseRealTime();
+
+/**
+ * @brief The same over a unix socket with garak::framed_stream
+ * */
+void BM_UnixPingPong(benchmark::State& state) {
+  asio::io_context ctx{1};
+  unix_socket a{ctx};
+  unix_socket b{ctx};
+  asio::local::connect_pair(a, b);
+  garak::framed_stream<unix_socket> client{std::move(a)};
+  garak::framed_stream<unix_socket> server{std::move(b)};
+  ping_pong<garak::framed_stream<unix_socket>> bounce{
+      client, server, static_cast<std::size_t>(state.range(0))};
+  for (auto _ : state) {
+    bounce.run(ctx, 1000);
+  }
+  state.SetItemsProcessed(state.iterations() * 1000);
+}
+BENCHMARK(BM_UnixPingPong)->Arg(64)->Arg(4096)->UseRealTime();
+}  // namespace
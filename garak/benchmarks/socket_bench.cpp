@@ -0,0 +1,168 @@
+#include <benchmark/benchmark.h>
+
+#include <asio/as_tuple.hpp>
+#include <asio/co_spawn.hpp>
+#include <asio/detached.hpp>
+#include <asio/io_context.hpp>
+#include <asio/ip/tcp.hpp>
+#include <asio/read.hpp>
+#include <asio/read_until.hpp>
+#include <asio/use_awaitable.hpp>
+#include <asio/write.hpp>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+using tcp = asio::ip::tcp;
+
+/**
+ * @brief A loopback server on its own thread that either echoes what it
+ * reads or just counts it
+ * */
+class loopback_server {
+ public:
+  explicit loopback_server(bool echo)
+      : acceptor_(ctx_, tcp::endpoint{asio::ip::address_v4::loopback(), 0}),
+        client_(ctx_) {
+    client_.connect(acceptor_.local_endpoint());
+    client_.set_option(tcp::no_delay{true});
+    auto server = acceptor_.accept();
+    server.set_option(tcp::no_delay{true});
+    asio::co_spawn(ctx_, serve(std::move(server), echo), asio::detached);
+    thread_ = std::thread{[this] { ctx_.run(); }};
+  }
+
+  loopback_server(const loopback_server&) = delete;
+  loopback_server& operator=(const loopback_server&) = delete;
+
+  ~loopback_server() {
+    asio::error_code ignored;
+    client_.shutdown(tcp::socket::shutdown_both, ignored);
+    thread_.join();
+  }
+
+  tcp::socket& client() { return client_; }
+
+  [[nodiscard]] std::uint64_t received() const {
+    return received_.load(std::memory_order_acquire);
+  }
+
+ private:
+  asio::awaitable<void> serve(tcp::socket socket, bool echo) {
+    std::vector<char> buffer(64 * 1024);
+    for (;;) {
+      auto [ec, n] = co_await socket.async_read_some(
+          asio::buffer(buffer), asio::as_tuple(asio::use_awaitable));
+      if (ec) {
+        co_return;
+      }
+      if (echo) {
+        co_await asio::async_write(socket, asio::buffer(buffer.data(), n),
+                                   asio::as_tuple(asio::use_awaitable));
+      }
+      received_.fetch_add(n, std::memory_order_release);
+    }
+  }
+
+  asio::io_context ctx_{1};
+  tcp::acceptor acceptor_;
+  tcp::socket client_;
+  std::atomic<std::uint64_t> received_{0};
+  std::thread thread_;
+};
+
+/**
+ * @brief Round trip one message through an async echo server
+ * */
+void BM_EchoLatency(benchmark::State& state) {
+  loopback_server server{true};
+  std::vector<char> message(static_cast<std::size_t>(state.range(0)), 'x');
+  std::vector<char> reply(message.size());
+  for (auto _ : state) {
+    asio::write(server.client(), asio::buffer(message));
+    asio::read(server.client(), asio::buffer(reply));
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_EchoLatency)->Arg(64)->Arg(1024)->Arg(16384)->UseRealTime();
+
+/**
+ * @brief Stream messages to an async server that drains them
+ * */
+void BM_StreamThroughput(benchmark::State& state) {
+  loopback_server server{false};
+  std::vector<char> message(static_cast<std::size_t>(state.range(0)), 'x');
+  std::uint64_t sent = 0;
+  for (auto _ : state) {
+    sent += asio::write(server.client(), asio::buffer(message));
+  }
+  while (server.received() < sent) {
+    std::this_thread::yield();
+  }
+  state.SetBytesProcessed(static_cast<std::int64_t>(sent));
+}
+BENCHMARK(BM_StreamThroughput)
+    ->Arg(64)
+    ->Arg(1024)
+    ->Arg(16384)
+    ->Arg(65536)
+    ->UseRealTime();
+
+/**
+ * @brief A SyncReadStream endlessly serving the same lines, so read_until
+ * is measured without syscalls
+ * */
+class line_source {
+ public:
+  explicit line_source(std::size_t line_length)
+      : text_(std::string(line_length - 2, 'a') + "\r\n") {
+    // Fill whole reads, the way a busy socket would
+    while (text_.size() < 4096) {
+      text_ += text_;
+    }
+  }
+
+  template <typename MutableBufferSequence>
+  std::size_t read_some(const MutableBufferSequence& buffers,
+                        asio::error_code& ec) {
+    ec = {};
+    const std::size_t n = asio::buffer_copy(
+        buffers, asio::buffer(text_.data() + offset_, text_.size() - offset_),
+        4096);
+    offset_ = (offset_ + n) % text_.size();
+    return n;
+  }
+
+  template <typename MutableBufferSequence>
+  std::size_t read_some(const MutableBufferSequence& buffers) {
+    asio::error_code ec;
+    return read_some(buffers, ec);
+  }
+
+ private:
+  std::string text_;
+  std::size_t offset_{0};
+};
+
+/**
+ * @brief Scan for line ends with read_until over lines of the given length
+ * */
+void BM_ReadUntil(benchmark::State& state) {
+  const auto line_length = static_cast<std::size_t>(state.range(0));
+  line_source source{line_length};
+  std::string storage;
+  auto buffer = asio::dynamic_buffer(storage);
+  std::size_t bytes = 0;
+  for (auto _ : state) {
+    const std::size_t n = asio::read_until(source, buffer, "\r\n");
+    buffer.consume(n);
+    bytes += n;
+  }
+  state.SetBytesProcessed(static_cast<std::int64_t>(bytes));
+}
+BENCHMARK(BM_ReadUntil)->Arg(64)->Arg(1024)->Arg(16384);
+}  // namespace
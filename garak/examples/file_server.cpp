@@ -0,0 +1,145 @@
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <asio.hpp>
+#include <cstdlib>
+#include <garak/send_file.hpp>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+
+namespace {
+using tcp = asio::ip::tcp;
+
+/**
+ * @brief A read-only file descriptor, closed on destruction
+ * */
+class open_file {
+ public:
+  explicit open_file(const std::string& path)
+      : fd_(::open(path.c_str(), O_RDONLY | O_CLOEXEC)) {}
+  open_file(const open_file&) = delete;
+  open_file& operator=(const open_file&) = delete;
+  ~open_file() {
+    if (fd_ >= 0) {
+      ::close(fd_);
+    }
+  }
+
+  [[nodiscard]] int native_handle() const { return fd_; }
+
+  /**
+   * @brief Size of a regular file, or -1 for anything else
+   * */
+  [[nodiscard]] off_t size() const {
+    struct stat st {};
+    if (fd_ < 0 || ::fstat(fd_, &st) != 0 || !S_ISREG(st.st_mode)) {
+      return -1;
+    }
+    return st.st_size;
+  }
+
+ private:
+  int fd_;
+};
+
+/**
+ * @brief The path of a `GET <path> HTTP/1.x` request line, empty when the
+ * request is anything else or tries to leave the root
+ * */
+std::string requested_path(const std::string& request) {
+  std::istringstream line{request.substr(0, request.find("\r\n"))};
+  std::string method;
+  std::string path;
+  std::string version;
+  line >> method >> path >> version;
+  if (method != "GET" || path.empty() || path.front() != '/' ||
+      version.rfind("HTTP/1.", 0) != 0 ||
+      path.find("..") != std::string::npos) {
+    return {};
+  }
+  return path;
+}
+
+asio::awaitable<void> respond(tcp::socket& socket, const char* status) {
+  const std::string response = std::string{"HTTP/1.1 "} + status +
+                               "\r\nContent-Length: 0\r\n"
+                               "Connection: close\r\n\r\n";
+  co_await asio::async_write(socket, asio::buffer(response),
+                             asio::as_tuple(asio::use_awaitable));
+}
+
+/**
+ * @brief Serve one request, the file body going out with sendfile
+ * */
+asio::awaitable<void> serve(tcp::socket socket, const std::string& root) {
+  std::string request;
+  auto [ec, n] = co_await asio::async_read_until(
+      socket, asio::dynamic_buffer(request, 8192), "\r\n\r\n",
+      asio::as_tuple(asio::use_awaitable));
+  if (ec) {
+    co_return;
+  }
+  const auto path = requested_path(request);
+  if (path.empty()) {
+    co_await respond(socket, "400 Bad Request");
+    co_return;
+  }
+  const open_file file{root + path};
+  const auto size = file.size();
+  if (size < 0) {
+    co_await respond(socket, "404 Not Found");
+    co_return;
+  }
+
+  const std::string headers = "HTTP/1.1 200 OK\r\nContent-Length: " +
+                              std::to_string(size) +
+                              "\r\nConnection: close\r\n\r\n";
+  std::tie(ec, n) = co_await asio::async_write(
+      socket, asio::buffer(headers), asio::as_tuple(asio::use_awaitable));
+  if (!ec) {
+    std::tie(ec, n) = co_await garak::async_send_file(
+        socket, file, 0, static_cast<std::size_t>(size),
+        asio::as_tuple(asio::use_awaitable));
+  }
+  if (ec) {
+    std::cerr << path << ": " << ec.message() << '\n';
+  }
+  socket.shutdown(tcp::socket::shutdown_send, ec);
+}
+
+asio::awaitable<void> accept(tcp::acceptor& acceptor, std::string root) {
+  for (;;) {
+    auto socket = co_await acceptor.async_accept(asio::use_awaitable);
+    asio::co_spawn(acceptor.get_executor(), serve(std::move(socket), root),
+                   asio::detached);
+  }
+}
+}  // namespace
+
+/**
+ * @brief A static file server whose bodies never pass through user space
+ *
+ * garak_file_server.bin <root directory> [port]
+ * */
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    std::cerr << "usage: " << argv[0] << " <root directory> [port]\n";
+    return 1;
+  }
+  const std::string root = argv[1];
+  const auto port =
+      static_cast<unsigned short>(argc > 2 ? std::atoi(argv[2]) : 8080);
+
+  asio::io_context ctx{1};
+  tcp::acceptor acceptor{ctx, {asio::ip::address_v4::any(), port}};
+  asio::co_spawn(ctx, accept(acceptor, root), asio::detached);
+  asio::signal_set signals{ctx, SIGINT, SIGTERM};
+  signals.async_wait([&](asio::error_code, int) { ctx.stop(); });
+  std::cout << "serving " << root << " on port "
+            << acceptor.local_endpoint().port() << '\n';
+  ctx.run();
+  return 0;
+}
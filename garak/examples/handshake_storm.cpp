@@ -0,0 +1,234 @@
+#include <openssl/evp.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+
+#include <algorithm>
+#include <array>
+#include <asio.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <garak/tls_stream.hpp>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+namespace {
+using tcp = asio::ip::tcp;
+using tls_socket = garak::tls_stream<tcp::socket>;
+using clock_type = std::chrono::steady_clock;
+
+constexpr std::size_t echo_connections = 16;
+constexpr std::size_t echo_size = 64;
+
+/**
+ * @brief A server context with a fresh RSA-2048 self-signed certificate
+ * and resumption turned off, so every handshake is a full one
+ * */
+void configure_server(asio::ssl::context& ctx) {
+  std::unique_ptr<EVP_PKEY, decltype(&EVP_PKEY_free)> key{EVP_RSA_gen(2048),
+                                                          &EVP_PKEY_free};
+  std::unique_ptr<X509, decltype(&X509_free)> cert{X509_new(), &X509_free};
+  if (!key || !cert) {
+    throw std::runtime_error("failed to allocate certificate");
+  }
+  ASN1_INTEGER_set(X509_get_serialNumber(cert.get()), 1);
+  X509_gmtime_adj(X509_getm_notBefore(cert.get()), 0);
+  X509_gmtime_adj(X509_getm_notAfter(cert.get()), 60L * 60L);
+  X509_set_pubkey(cert.get(), key.get());
+  X509_set_issuer_name(cert.get(), X509_get_subject_name(cert.get()));
+  if (X509_sign(cert.get(), key.get(), EVP_sha256()) == 0 ||
+      SSL_CTX_use_certificate(ctx.native_handle(), cert.get()) != 1 ||
+      SSL_CTX_use_PrivateKey(ctx.native_handle(), key.get()) != 1) {
+    throw std::runtime_error("failed to install certificate");
+  }
+  SSL_CTX_set_options(ctx.native_handle(), SSL_OP_NO_TICKET);
+  SSL_CTX_set_session_cache_mode(ctx.native_handle(), SSL_SESS_CACHE_OFF);
+}
+
+/**
+ * @brief Echo server on one io thread, handshakes optionally offloaded
+ * */
+asio::awaitable<void> serve(tls_socket stream) {
+  auto [ec] = co_await stream.async_handshake(
+      asio::ssl::stream_base::server, asio::as_tuple(asio::use_awaitable));
+  std::array<char, 1024> buffer{};
+  while (!ec) {
+    std::size_t n = 0;
+    std::tie(ec, n) = co_await stream.async_read_some(
+        asio::buffer(buffer), asio::as_tuple(asio::use_awaitable));
+    if (!ec) {
+      std::tie(ec, n) = co_await asio::async_write(
+          stream, asio::buffer(buffer.data(), n),
+          asio::as_tuple(asio::use_awaitable));
+    }
+  }
+}
+
+asio::awaitable<void> accept(tcp::acceptor& acceptor, asio::ssl::context& tls,
+                             asio::thread_pool* offload) {
+  for (;;) {
+    auto socket = co_await acceptor.async_accept(asio::use_awaitable);
+    tls_socket stream{std::move(socket), tls};
+    if (offload != nullptr) {
+      stream.offload_handshake(offload->get_executor());
+    }
+    asio::co_spawn(acceptor.get_executor(), serve(std::move(stream)),
+                   asio::detached);
+  }
+}
+
+asio::awaitable<tls_socket> connect(tcp::endpoint server,
+                                    asio::ssl::context& tls) {
+  tls_socket stream{co_await asio::this_coro::executor, tls};
+  co_await stream.lowest_layer().async_connect(server, asio::use_awaitable);
+  stream.lowest_layer().set_option(tcp::no_delay{true});
+  co_await stream.async_handshake(asio::ssl::stream_base::client,
+                                  asio::use_awaitable);
+  co_return stream;
+}
+
+/**
+ * @brief Ping an established connection back to back, recording each
+ * round trip
+ * */
+asio::awaitable<void> ping(tcp::endpoint server, asio::ssl::context& tls,
+                           const std::atomic<bool>& running,
+                           std::vector<clock_type::duration>& latencies) {
+  auto stream = co_await connect(server, tls);
+  std::array<char, echo_size> request{};
+  std::array<char, echo_size> reply{};
+  while (running) {
+    const auto start = clock_type::now();
+    co_await asio::async_write(stream, asio::buffer(request),
+                               asio::use_awaitable);
+    co_await asio::async_read(stream, asio::buffer(reply),
+                              asio::use_awaitable);
+    latencies.push_back(clock_type::now() - start);
+  }
+}
+
+/**
+ * @brief Connect, handshake and drop, over and over
+ * */
+asio::awaitable<void> storm(tcp::endpoint server, asio::ssl::context& tls,
+                            const std::atomic<bool>& running,
+                            std::atomic<std::size_t>& handshakes) {
+  while (running) {
+    try {
+      auto stream = co_await connect(server, tls);
+      ++handshakes;
+    } catch (const std::exception&) {
+      // Backlog overflow, just go again
+    }
+  }
+}
+
+struct result {
+  clock_type::duration p50{};
+  clock_type::duration p99{};
+  clock_type::duration max{};
+  std::size_t pings{0};
+  std::size_t handshakes{0};
+};
+
+result run(bool offloaded, std::size_t stormers,
+           std::chrono::seconds duration) {
+  asio::ssl::context server_tls{asio::ssl::context::tls_server};
+  configure_server(server_tls);
+  asio::ssl::context client_tls{asio::ssl::context::tls_client};
+  client_tls.set_verify_mode(asio::ssl::verify_none);
+
+  asio::io_context server_ctx{1};
+  asio::thread_pool offload{2};
+  tcp::acceptor acceptor{server_ctx, {asio::ip::address_v4::loopback(), 0}};
+  asio::co_spawn(server_ctx,
+                 accept(acceptor, server_tls, offloaded ? &offload : nullptr),
+                 asio::detached);
+  const auto endpoint = acceptor.local_endpoint();
+
+  // Separate client contexts, so client side handshakes don't delay pings
+  asio::io_context ping_ctx{1};
+  asio::io_context storm_ctx;
+  std::atomic<bool> running{true};
+  std::atomic<std::size_t> handshakes{0};
+  std::list<std::vector<clock_type::duration>> latencies;
+  for (std::size_t i = 0; i < echo_connections; ++i) {
+    auto& recorded = latencies.emplace_back();
+    asio::co_spawn(ping_ctx, ping(endpoint, client_tls, running, recorded),
+                   asio::detached);
+  }
+  for (std::size_t i = 0; i < stormers; ++i) {
+    asio::co_spawn(storm_ctx, storm(endpoint, client_tls, running, handshakes),
+                   asio::detached);
+  }
+
+  std::thread server_thread{[&] { server_ctx.run(); }};
+  std::thread ping_thread{[&] { ping_ctx.run(); }};
+  std::vector<std::thread> storm_threads;
+  for (int i = 0; i < 2; ++i) {
+    storm_threads.emplace_back([&] { storm_ctx.run(); });
+  }
+  std::this_thread::sleep_for(duration);
+  running = false;
+  ping_ctx.stop();
+  storm_ctx.stop();
+  ping_thread.join();
+  for (auto& t : storm_threads) {
+    t.join();
+  }
+  server_ctx.stop();
+  server_thread.join();
+  offload.join();
+
+  std::vector<clock_type::duration> all;
+  for (const auto& l : latencies) {
+    all.insert(all.end(), l.begin(), l.end());
+  }
+  std::sort(all.begin(), all.end());
+  result r;
+  r.pings = all.size();
+  r.handshakes = handshakes;
+  if (!all.empty()) {
+    r.p50 = all[all.size() / 2];
+    r.p99 = all[all.size() * 99 / 100];
+    r.max = all.back();
+  }
+  return r;
+}
+
+std::string micros(clock_type::duration d) {
+  return std::to_string(
+             std::chrono::duration_cast<std::chrono::microseconds>(d).count()) +
+         "us";
+}
+}  // namespace
+
+/**
+ * @brief Echo latency of established TLS connections while a reconnect
+ * storm hammers the same single-threaded server, with the server's
+ * handshakes run inline and then offloaded to a thread pool
+ *
+ * garak_handshake_storm.bin [seconds per mode] [storming clients]
+ * */
+int main(int argc, char** argv) {
+  const std::chrono::seconds duration{argc > 1 ? std::atoi(argv[1]) : 3};
+  const std::size_t stormers =
+      argc > 2 ? static_cast<std::size_t>(std::atoi(argv[2])) : 8;
+
+  std::cout << echo_connections << " echo connections, " << stormers
+            << " storming clients, " << duration.count() << "s per mode\n";
+  for (const bool offloaded : {false, true}) {
+    const auto r = run(offloaded, stormers, duration);
+    std::cout << (offloaded ? "offloaded" : "inline   ")
+              << "  p50 " << micros(r.p50) << "  p99 " << micros(r.p99)
+              << "  max " << micros(r.max) << "  pings " << r.pings
+              << "  handshakes " << r.handshakes << '\n';
+  }
+  return 0;
+}
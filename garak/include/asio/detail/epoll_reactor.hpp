@@ -33,6 +33,9 @@
 #include "asio/detail/wait_op.hpp"
 #include "asio/execution_context.hpp"
 
+#include <vector>
+#include <sys/epoll.h>
+
 #if defined(ASIO_HAS_TIMERFD)
 # include <sys/timerfd.h>
 #endif // defined(ASIO_HAS_TIMERFD)
@@ -194,10 +197,23 @@ public:
   // Interrupt the select loop.
   ASIO_DECL void interrupt();
 
+  // Set the maximum number of events returned by one epoll_wait call. Must
+  // not be called while the reactor is being run.
+  ASIO_DECL void set_event_batch_size(std::size_t size);
+
+  // Get the maximum number of events returned by one epoll_wait call.
+  std::size_t event_batch_size() const
+  {
+    return events_.size();
+  }
+
 private:
   // The hint to pass to epoll_create to size its data structures.
   enum { epoll_size = 20000 };
 
+  // The default number of events returned by one epoll_wait call.
+  enum { default_event_batch_size = 128 };
+
   // Create the epoll file descriptor. Throws an exception if the descriptor
   // cannot be created.
   ASIO_DECL static int do_epoll_create();
@@ -252,6 +268,9 @@ private:
   // Whether the service has been shut down.
   bool shutdown_;
 
+  // Buffer receiving the events from each epoll_wait call.
+  std::vector<epoll_event> events_;
+
   // Mutex to protect access to the registered descriptors.
   mutex registered_descriptors_mutex_;
 
@@ -44,6 +44,7 @@ epoll_reactor::epoll_reactor(asio::execution_context& ctx)
     epoll_fd_(do_epoll_create()),
     timer_fd_(do_timerfd_create()),
     shutdown_(false),
+    events_(default_event_batch_size),
     registered_descriptors_mutex_(mutex_.enabled())
 {
   // Add the interrupter's descriptor to epoll.
@@ -473,6 +474,11 @@ void epoll_reactor::cleanup_descriptor_data(
   }
 }
 
+void epoll_reactor::set_event_batch_size(std::size_t size)
+{
+  events_.resize(size > 0 ? size : 1);
+}
+
 void epoll_reactor::run(long usec, op_queue<operation>& ops)
 {
   // This code relies on the fact that the scheduler queues the reactor task
@@ -496,8 +502,9 @@ void epoll_reactor::run(long usec, op_queue<operation>& ops)
   }
 
   // Block on the epoll descriptor.
-  epoll_event events[128];
-  int num_events = epoll_wait(epoll_fd_, events, 128, timeout);
+  epoll_event* events = events_.data();
+  int num_events = epoll_wait(epoll_fd_, events,
+      static_cast<int>(events_.size()), timeout);
 
 #if defined(ASIO_ENABLE_HANDLER_TRACKING)
   // Trace the waiting events.
@@ -802,7 +809,9 @@ void epoll_reactor::descriptor_state::do_complete(
     uint32_t events = static_cast<uint32_t>(bytes_transferred);
     if (operation* op = descriptor_data->perform_io(events))
     {
-      op->complete(owner, ec, 0);
+      // Completed through the scheduler so that its heartbeat shows the
+      // handler rather than this function.
+      descriptor_data->reactor_->scheduler_.complete_nested(op, ec, 0);
     }
   }
 }
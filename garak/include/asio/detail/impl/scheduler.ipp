@@ -65,6 +65,10 @@ struct scheduler::task_cleanup
     }
     this_thread_->private_outstanding_work = 0;
 
+    // Operations the task completed are ready from now. The reactor reuses
+    // its descriptor states, so stamp them however they were last stamped.
+    scheduler_->observe_ready(this_thread_->private_op_queue);
+
     // Enqueue the completed operations and reinsert the task at the end of
     // the operation queue.
     lock_->lock();
@@ -108,6 +112,71 @@ struct scheduler::work_cleanup
   thread_info* this_thread_;
 };
 
+struct scheduler::run_observation
+{
+  run_observation(observer* o, operation* op)
+    : observer_(o),
+      started_(o ? o->run_begin(op->ready_at_) : 0)
+  {
+    // Leave recycled operations unstamped for their next use.
+    op->ready_at_ = 0;
+  }
+
+  ~run_observation()
+  {
+    if (observer_)
+      observer_->run_end(started_);
+  }
+
+  observer* observer_;
+  uint64_t started_;
+};
+
+struct scheduler::wait_observation
+{
+  explicit wait_observation(observer* o)
+    : observer_(o),
+      started_(o ? o->wait_begin() : 0)
+  {
+  }
+
+  ~wait_observation()
+  {
+    if (observer_)
+      observer_->wait_end(started_);
+  }
+
+  observer* observer_;
+  uint64_t started_;
+};
+
+struct scheduler::heartbeat_beat
+{
+  heartbeat_beat(heartbeat* h, const operation* op)
+    : heartbeat_(h),
+      previous_(0)
+  {
+    if (heartbeat_)
+    {
+      // Nested runs put back the outer operation when they finish.
+      previous_ = heartbeat_->running.load(std::memory_order_relaxed);
+      heartbeat_->runs.store(heartbeat_->runs.load(
+            std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      heartbeat_->running.store(reinterpret_cast<uintptr_t>(op->func_),
+          std::memory_order_relaxed);
+    }
+  }
+
+  ~heartbeat_beat()
+  {
+    if (heartbeat_)
+      heartbeat_->running.store(previous_, std::memory_order_relaxed);
+  }
+
+  heartbeat* heartbeat_;
+  uintptr_t previous_;
+};
+
 scheduler::scheduler(asio::execution_context& ctx,
     int concurrency_hint, bool own_thread, get_task_func_type get_task)
   : asio::detail::execution_context_service_base<scheduler>(ctx),
@@ -125,7 +194,9 @@ scheduler::scheduler(asio::execution_context& ctx,
     stopped_(false),
     shutdown_(false),
     concurrency_hint_(concurrency_hint),
-    thread_(0)
+    thread_(0),
+    observer_(0),
+    heartbeat_source_(0)
 {
   ASIO_HANDLER_TRACKING_INIT;
 
@@ -200,7 +271,7 @@ std::size_t scheduler::run(asio::error_code& ec)
   }
 
   thread_info this_thread;
-  this_thread.private_outstanding_work = 0;
+  init_thread_info(this_thread);
   thread_call_stack::context ctx(this, this_thread);
 
   mutex::scoped_lock lock(mutex_);
@@ -222,7 +293,7 @@ std::size_t scheduler::run_one(asio::error_code& ec)
   }
 
   thread_info this_thread;
-  this_thread.private_outstanding_work = 0;
+  init_thread_info(this_thread);
   thread_call_stack::context ctx(this, this_thread);
 
   mutex::scoped_lock lock(mutex_);
@@ -240,7 +311,7 @@ std::size_t scheduler::wait_one(long usec, asio::error_code& ec)
   }
 
   thread_info this_thread;
-  this_thread.private_outstanding_work = 0;
+  init_thread_info(this_thread);
   thread_call_stack::context ctx(this, this_thread);
 
   mutex::scoped_lock lock(mutex_);
@@ -258,7 +329,7 @@ std::size_t scheduler::poll(asio::error_code& ec)
   }
 
   thread_info this_thread;
-  this_thread.private_outstanding_work = 0;
+  init_thread_info(this_thread);
   thread_call_stack::context ctx(this, this_thread);
 
   mutex::scoped_lock lock(mutex_);
@@ -289,7 +360,7 @@ std::size_t scheduler::poll_one(asio::error_code& ec)
   }
 
   thread_info this_thread;
-  this_thread.private_outstanding_work = 0;
+  init_thread_info(this_thread);
   thread_call_stack::context ctx(this, this_thread);
 
   mutex::scoped_lock lock(mutex_);
@@ -344,6 +415,8 @@ void scheduler::capture_current_exception()
 void scheduler::post_immediate_completion(
     scheduler::operation* op, bool is_continuation)
 {
+  observe_ready(op);
+
 #if defined(ASIO_HAS_THREADS)
   if (one_thread_ || is_continuation)
   {
@@ -367,6 +440,8 @@ void scheduler::post_immediate_completion(
 void scheduler::post_immediate_completions(std::size_t n,
     op_queue<scheduler::operation>& ops, bool is_continuation)
 {
+  observe_ready(ops);
+
 #if defined(ASIO_HAS_THREADS)
   if (one_thread_ || is_continuation)
   {
@@ -390,6 +465,8 @@ void scheduler::post_immediate_completions(std::size_t n,
 
 void scheduler::post_deferred_completion(scheduler::operation* op)
 {
+  observe_ready(op);
+
 #if defined(ASIO_HAS_THREADS)
   if (one_thread_)
   {
@@ -411,6 +488,8 @@ void scheduler::post_deferred_completions(
 {
   if (!ops.empty())
   {
+    observe_ready(ops);
+
 #if defined(ASIO_HAS_THREADS)
     if (one_thread_)
     {
@@ -431,6 +510,7 @@ void scheduler::post_deferred_completions(
 void scheduler::do_dispatch(
     scheduler::operation* op)
 {
+  observe_ready(op);
   work_started();
   mutex::scoped_lock lock(mutex_);
   op_queue_.push(op);
@@ -444,6 +524,46 @@ void scheduler::abandon_operations(
   ops2.push(ops);
 }
 
+void scheduler::complete_nested(scheduler::operation* op,
+    const asio::error_code& ec, std::size_t bytes_transferred)
+{
+  heartbeat* h = 0;
+  if (heartbeat_source_)
+    if (thread_info_base* this_thread = thread_call_stack::contains(this))
+      h = static_cast<thread_info*>(this_thread)->heartbeat;
+
+  heartbeat_beat beat(h, op);
+  (void)beat;
+  op->complete(this, ec, bytes_transferred);
+}
+
+void scheduler::init_thread_info(thread_info& this_thread)
+{
+  this_thread.private_outstanding_work = 0;
+  this_thread.heartbeat = heartbeat_source_ ? heartbeat_source_->attach() : 0;
+}
+
+void scheduler::observe_ready(scheduler::operation* op)
+{
+  if (observer_)
+    op->ready_at_ = observer_->ready(1);
+}
+
+void scheduler::observe_ready(op_queue<scheduler::operation>& ops)
+{
+  if (!observer_ || ops.empty())
+    return;
+
+  std::size_t n = 0;
+  operation* o = op_queue_access::front(ops);
+  for (; o; o = op_queue_access::next(o))
+    ++n;
+
+  uint64_t now = observer_->ready(n);
+  for (o = op_queue_access::front(ops); o; o = op_queue_access::next(o))
+    o->ready_at_ = now;
+}
+
 std::size_t scheduler::do_run_one(mutex::scoped_lock& lock,
     scheduler::thread_info& this_thread,
     const asio::error_code& ec)
@@ -472,6 +592,8 @@ std::size_t scheduler::do_run_one(mutex::scoped_lock& lock,
         // Run the task. May throw an exception. Only block if the operation
         // queue is empty and we're not polling, otherwise we want to return
         // as soon as possible.
+        wait_observation observed(more_handlers ? 0 : observer_);
+        (void)observed;
         task_->run(more_handlers ? 0 : -1, this_thread.private_op_queue);
       }
       else
@@ -488,6 +610,9 @@ std::size_t scheduler::do_run_one(mutex::scoped_lock& lock,
         (void)on_exit;
 
         // Complete the operation. May throw an exception. Deletes the object.
+        run_observation observed(observer_, o);
+        heartbeat_beat beat(this_thread.heartbeat, o);
+        (void)observed;
         o->complete(this, ec, task_result);
         this_thread.rethrow_pending_exception();
 
@@ -497,6 +622,8 @@ std::size_t scheduler::do_run_one(mutex::scoped_lock& lock,
     else
     {
       wakeup_event_.clear(lock);
+      wait_observation observed(observer_);
+      (void)observed;
       wakeup_event_.wait(lock);
     }
   }
@@ -515,6 +642,8 @@ std::size_t scheduler::do_wait_one(mutex::scoped_lock& lock,
   if (o == 0)
   {
     wakeup_event_.clear(lock);
+    wait_observation observed(observer_);
+    (void)observed;
     wakeup_event_.wait_for_usec(lock, usec);
     usec = 0; // Wait at most once.
     o = op_queue_.front();
@@ -539,6 +668,8 @@ std::size_t scheduler::do_wait_one(mutex::scoped_lock& lock,
       // Run the task. May throw an exception. Only block if the operation
       // queue is empty and we're not polling, otherwise we want to return
       // as soon as possible.
+      wait_observation observed(more_handlers || usec == 0 ? 0 : observer_);
+      (void)observed;
       task_->run(more_handlers ? 0 : usec, this_thread.private_op_queue);
     }
 
@@ -569,6 +700,9 @@ std::size_t scheduler::do_wait_one(mutex::scoped_lock& lock,
   (void)on_exit;
 
   // Complete the operation. May throw an exception. Deletes the object.
+  run_observation observed(observer_, o);
+  heartbeat_beat beat(this_thread.heartbeat, o);
+  (void)observed;
   o->complete(this, ec, task_result);
   this_thread.rethrow_pending_exception();
 
@@ -624,6 +758,9 @@ std::size_t scheduler::do_poll_one(mutex::scoped_lock& lock,
   (void)on_exit;
 
   // Complete the operation. May throw an exception. Deletes the object.
+  run_observation observed(observer_, o);
+  heartbeat_beat beat(this_thread.heartbeat, o);
+  (void)observed;
   o->complete(this, ec, task_result);
   this_thread.rethrow_pending_exception();
 
@@ -25,6 +25,7 @@
 #include "asio/detail/op_queue.hpp"
 #include "asio/detail/scheduler_operation.hpp"
 #include "asio/detail/scheduler_task.hpp"
+#include "asio/detail/scheduler_thread_info.hpp"
 #include "asio/detail/thread.hpp"
 #include "asio/detail/thread_context.hpp"
 
@@ -141,6 +142,75 @@ public:
     return concurrency_hint_;
   }
 
+  // Interface notified as operations become ready and run, and as threads
+  // block waiting for work.
+  class observer
+  {
+  public:
+    // Some operations became ready to run. Returns a timestamp that is kept
+    // with each of them and passed to run_begin.
+    virtual uint64_t ready(std::size_t n) = 0;
+
+    // An operation is about to run. Returns a value passed to run_end.
+    virtual uint64_t run_begin(uint64_t ready_at) = 0;
+
+    // The operation started by the matching run_begin has finished.
+    virtual void run_end(uint64_t started) = 0;
+
+    // A thread is about to block waiting for work. Returns a value passed to
+    // wait_end.
+    virtual uint64_t wait_begin() = 0;
+
+    // The thread has stopped waiting.
+    virtual void wait_end(uint64_t started) = 0;
+
+  protected:
+    // Prevent deletion through this type.
+    ~observer() {}
+  };
+
+  // Set the observer, or clear it with 0. Must not be called while the
+  // scheduler is being run.
+  void set_observer(observer* o)
+  {
+    observer_ = o;
+  }
+
+  // The record a thread updates around each operation it runs.
+  typedef scheduler_heartbeat heartbeat;
+
+  // Interface supplying each thread that runs the scheduler with its
+  // heartbeat.
+  class heartbeat_source
+  {
+  public:
+    // The calling thread is about to run the scheduler. Returns the
+    // heartbeat to keep, or 0 for none.
+    virtual heartbeat* attach() = 0;
+
+  protected:
+    // Prevent deletion through this type.
+    ~heartbeat_source() {}
+  };
+
+  // Set the heartbeat source, or clear it with 0. Must not be called while
+  // the scheduler is being run.
+  void set_heartbeat_source(heartbeat_source* s)
+  {
+    heartbeat_source_ = s;
+  }
+
+  // Complete an operation from inside the one being run, publishing it on
+  // the calling thread's heartbeat until it returns.
+  ASIO_DECL void complete_nested(operation* op,
+      const asio::error_code& ec, std::size_t bytes_transferred);
+
+  // Get the count of unfinished work.
+  long outstanding_work() const
+  {
+    return static_cast<long>(outstanding_work_);
+  }
+
 private:
   // The mutex type used by this scheduler.
   typedef conditionally_enabled_mutex mutex;
@@ -186,6 +256,20 @@ private:
   struct work_cleanup;
   friend struct work_cleanup;
 
+  // Helper classes to notify the observer around running and waiting.
+  struct run_observation;
+  struct wait_observation;
+
+  // Helper class to publish the running operation on the heartbeat.
+  struct heartbeat_beat;
+
+  // Prepare a thread's data before it runs the scheduler.
+  ASIO_DECL void init_thread_info(thread_info& this_thread);
+
+  // Stamp operations as ready for the observer, if there is one.
+  ASIO_DECL void observe_ready(operation* op);
+  ASIO_DECL void observe_ready(op_queue<operation>& ops);
+
   // Whether to optimise for single-threaded use cases.
   const bool one_thread_;
 
@@ -227,6 +311,12 @@ private:
 
   // The thread that is running the scheduler.
   asio::detail::thread* thread_;
+
+  // The observer, if any.
+  observer* observer_;
+
+  // The heartbeat source, if any.
+  heartbeat_source* heartbeat_source_;
 };
 
 } // namespace detail
@@ -16,6 +16,7 @@
 #endif // defined(_MSC_VER) && (_MSC_VER >= 1200)
 
 #include "asio/error_code.hpp"
+#include "asio/detail/cstdint.hpp"
 #include "asio/detail/handler_tracking.hpp"
 #include "asio/detail/op_queue.hpp"
 
@@ -52,7 +53,8 @@ protected:
   scheduler_operation(func_type func)
     : next_(0),
       func_(func),
-      task_result_(0)
+      task_result_(0),
+      ready_at_(0)
   {
   }
 
@@ -68,6 +70,7 @@ private:
 protected:
   friend class scheduler;
   unsigned int task_result_; // Passed into bytes transferred.
+  uint64_t ready_at_; // Set by the scheduler's observer, if any.
 };
 
 } // namespace detail
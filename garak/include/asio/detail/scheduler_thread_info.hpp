@@ -15,6 +15,8 @@
 # pragma once
 #endif // defined(_MSC_VER) && (_MSC_VER >= 1200)
 
+#include <atomic>
+#include "asio/detail/cstdint.hpp"
 #include "asio/detail/op_queue.hpp"
 #include "asio/detail/thread_info_base.hpp"
 
@@ -26,10 +28,22 @@ namespace detail {
 class scheduler;
 class scheduler_operation;
 
+// What a thread running a scheduler is doing, for sampling from another
+// thread. Only the running thread writes, with relaxed stores.
+struct scheduler_heartbeat
+{
+  // The number of operations the thread has started.
+  std::atomic<uint64_t> runs;
+
+  // The completion function of the operation being run, or 0 when idle.
+  std::atomic<uintptr_t> running;
+};
+
 struct scheduler_thread_info : public thread_info_base
 {
   op_queue<scheduler_operation> private_op_queue;
   long private_outstanding_work;
+  scheduler_heartbeat* heartbeat;
 };
 
 } // namespace detail
@@ -0,0 +1,183 @@
+#ifndef GARAK_BUSY_POLL_HPP
+#define GARAK_BUSY_POLL_HPP
+
+/**
+ * @file garak/busy_poll.hpp
+ * @brief A spin-then-block run loop for latency critical io_contexts
+ * @date 2026-10-19
+ *
+ * io_context::run() parks an idle thread in epoll_wait, or on the
+ * scheduler's condition variable, so each new event costs a wakeup and a
+ * context switch before its handler runs. busy_poll_runner instead keeps
+ * calling poll_one(), which does a zero-timeout epoll_wait whenever the
+ * handler queue is empty, for a spin budget before it falls back to
+ * blocking in run_one(). The budget follows the recent gaps between
+ * events, so the thread spins when the next event is likely to arrive
+ * soon and blocks when it isn't.
+ *
+ * Spinning burns a core per thread, reserve it for latency sensitive
+ * services.
+ */
+
+#include <algorithm>
+#include <asio/detail/socket_option.hpp>
+#include <asio/io_context.hpp>
+#include <chrono>
+#include <cstddef>
+#include <sys/socket.h>
+
+namespace garak {
+/**
+ * @brief Socket option for SO_BUSY_POLL, the microseconds a blocking
+ * receive busy polls the device queue before sleeping
+ *
+ * @code
+ * socket.set_option(garak::busy_poll{50}, ec);
+ * @endcode
+ *
+ * Raising it above net.core.busy_read needs CAP_NET_ADMIN.
+ * */
+using busy_poll =
+    asio::detail::socket_option::integer<SOL_SOCKET, SO_BUSY_POLL>;
+
+/**
+ * @brief Tuning for garak::busy_poll_runner
+ * */
+struct busy_poll_options {
+  /// Spin at least this long even when events are sparse
+  std::chrono::nanoseconds min_spin{std::chrono::microseconds(2)};
+  /// Never spin longer than this before blocking
+  std::chrono::nanoseconds max_spin{std::chrono::microseconds(200)};
+};
+
+/**
+ * @brief Counters kept by garak::busy_poll_runner
+ * */
+struct busy_poll_stats {
+  /// Idle periods that ended while spinning
+  std::size_t spin_hits{0};
+  /// Idle periods that outlasted the spin budget and blocked
+  std::size_t blocks{0};
+};
+
+/**
+ * @brief Adapts the spin budget to the gap between events
+ *
+ * Keeps an exponentially weighted mean of recent idle gaps and spins for
+ * twice that, within [min_spin, max_spin]. When gaps are routinely longer
+ * than max_spin there is nothing to gain and it drops back to min_spin.
+ * */
+class spin_budget {
+ public:
+  using duration = std::chrono::nanoseconds;
+
+  explicit spin_budget(const busy_poll_options& options = {})
+      : min_(options.min_spin),
+        max_(std::max(options.min_spin, options.max_spin)),
+        mean_gap_(min_),
+        budget_(min_) {}
+
+  [[nodiscard]] duration current() const { return budget_; }
+
+  /**
+   * @brief Account for an idle period of length gap ending in an event
+   * */
+  void record_gap(duration gap) {
+    // New gaps carry a weight of 1/8
+    mean_gap_ += (gap - mean_gap_) / 8;
+    const auto target = mean_gap_ * 2;
+    budget_ = target > max_ ? min_ : std::max(target, min_);
+  }
+
+ private:
+  duration min_;
+  duration max_;
+  duration mean_gap_;
+  duration budget_;
+};
+
+/**
+ * @brief Runs an io_context, spinning for an adaptive budget before
+ * blocking whenever it goes idle.
+ *
+ * Use in place of io_context::run() on each thread that should spin:
+ *
+ * @code
+ * garak::busy_poll_runner runner{{.max_spin = 100us}};
+ * runner.run(ctx);
+ * @endcode
+ *
+ * Like run(), it returns once the io_context is stopped or out of work. A
+ * runner keeps per-thread state, use one per thread.
+ * */
+class busy_poll_runner {
+ public:
+  using clock = std::chrono::steady_clock;
+
+  explicit busy_poll_runner(const busy_poll_options& options = {})
+      : budget_(options) {}
+
+  /**
+   * @brief Run handlers until ctx stops
+   *
+   * @returns the number of handlers executed
+   * */
+  std::size_t run(asio::io_context& ctx) {
+    std::size_t handlers = 0;
+    while (!ctx.stopped()) {
+      const std::size_t ready = ctx.poll();
+      if (ready > 0) {
+        handlers += ready;
+        continue;
+      }
+
+      const auto idle_since = clock::now();
+      const auto spin_until = idle_since + budget_.current();
+      std::size_t ran = 0;
+      while (!ctx.stopped() && (ran = ctx.poll_one()) == 0 &&
+             clock::now() < spin_until) {
+        relax();
+      }
+      if (ran > 0) {
+        ++stats_.spin_hits;
+      } else if (!ctx.stopped()) {
+        ++stats_.blocks;
+        ran = ctx.run_one();
+      }
+      budget_.record_gap(clock::now() - idle_since);
+      handlers += ran;
+    }
+    return handlers;
+  }
+
+  [[nodiscard]] const busy_poll_stats& stats() const { return stats_; }
+
+  [[nodiscard]] spin_budget::duration current_budget() const {
+    return budget_.current();
+  }
+
+ private:
+  // Tell the core we are spinning, freeing resources for its sibling
+  static void relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+  }
+
+  spin_budget budget_;
+  busy_poll_stats stats_;
+};
+
+/**
+ * @brief Convenience for a one-off busy_poll_runner
+ * */
+inline std::size_t run_busy_poll(asio::io_context& ctx,
+                                 const busy_poll_options& options = {}) {
+  busy_poll_runner runner{options};
+  return runner.run(ctx);
+}
+}  // namespace garak
+
+#endif
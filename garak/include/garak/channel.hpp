@@ -0,0 +1,560 @@
+#ifndef GARAK_CHANNEL_HPP
+#define GARAK_CHANNEL_HPP
+
+/**
+ * @file garak/channel.hpp
+ * @brief Lock-free bounded channels for passing values between io_contexts
+ * @date 2026-10-19
+ *
+ * asio::experimental::concurrent_channel takes a mutex for every send and
+ * receive, so a pipeline stage moving millions of small messages a second
+ * spends its time on that lock. garak::spsc_channel and
+ * garak::mpsc_channel keep the same async_send / async_receive interface
+ * over a bounded lock-free ring, and only leave the fast path when a
+ * receiver finds the ring empty or a sender finds it full:
+ *
+ * @code
+ * garak::mpsc_channel<order> orders{matcher_ctx.get_executor(), 4096};
+ *
+ * // any number of producer coroutines, on any io_context
+ * co_await orders.async_send(std::move(o), asio::use_awaitable);
+ *
+ * // the one consumer
+ * std::array<order, 64> batch;
+ * auto n = co_await orders.async_receive_some(batch, asio::use_awaitable);
+ * @endcode
+ */
+
+#include <algorithm>
+#include <asio/any_io_executor.hpp>
+#include <asio/async_result.hpp>
+#include <asio/compose.hpp>
+#include <asio/error.hpp>
+#include <asio/experimental/channel_error.hpp>
+#include <asio/post.hpp>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+namespace garak {
+namespace detail {
+/**
+ * @brief Raw storage for one value in a ring
+ * */
+template <typename T>
+struct ring_storage {
+  alignas(T) std::byte bytes[sizeof(T)];
+
+  T* get() { return std::launder(reinterpret_cast<T*>(bytes)); }
+};
+
+/**
+ * @brief Single producer, single consumer ring
+ *
+ * Each side keeps a cached copy of the other's index, so it only touches
+ * the other side's cache line when the ring looks full or empty.
+ * */
+template <typename T>
+class spsc_ring {
+ public:
+  explicit spsc_ring(std::size_t capacity)
+      : mask_(capacity - 1),
+        slots_(std::make_unique<ring_storage<T>[]>(capacity)) {}
+
+  spsc_ring(const spsc_ring&) = delete;
+  spsc_ring& operator=(const spsc_ring&) = delete;
+
+  ~spsc_ring() {
+    const auto tail = tail_.load(std::memory_order_acquire);
+    for (auto head = head_.load(std::memory_order_relaxed); head != tail;
+         ++head) {
+      std::destroy_at(slots_[head & mask_].get());
+    }
+  }
+
+  template <typename U>
+  bool try_push(U&& value) {
+    const auto tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_cache_ > mask_) {
+      head_cache_ = head_.load(std::memory_order_acquire);
+      if (tail - head_cache_ > mask_) {
+        return false;
+      }
+    }
+    std::construct_at(slots_[tail & mask_].get(), std::forward<U>(value));
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  std::size_t try_pop(std::span<T> out) {
+    const auto head = head_.load(std::memory_order_relaxed);
+    if (tail_cache_ - head < out.size()) {
+      tail_cache_ = tail_.load(std::memory_order_acquire);
+    }
+    const auto n = std::min<std::size_t>(out.size(), tail_cache_ - head);
+    for (std::size_t i = 0; i < n; ++i) {
+      T* slot = slots_[(head + i) & mask_].get();
+      out[i] = std::move(*slot);
+      std::destroy_at(slot);
+    }
+    if (n > 0) {
+      head_.store(head + n, std::memory_order_release);
+    }
+    return n;
+  }
+
+  [[nodiscard]] bool empty() const {
+    return head_.load(std::memory_order_acquire) ==
+           tail_.load(std::memory_order_acquire);
+  }
+
+  [[nodiscard]] std::size_t size() const {
+    return tail_.load(std::memory_order_acquire) -
+           head_.load(std::memory_order_acquire);
+  }
+
+  [[nodiscard]] std::size_t capacity() const { return mask_ + 1; }
+
+ private:
+  const std::size_t mask_;
+  std::unique_ptr<ring_storage<T>[]> slots_;
+  // Producer's line
+  alignas(64) std::atomic<std::size_t> tail_{0};
+  std::size_t head_cache_{0};
+  // Consumer's line
+  alignas(64) std::atomic<std::size_t> head_{0};
+  std::size_t tail_cache_{0};
+};
+
+/**
+ * @brief Multi producer, single consumer ring
+ *
+ * Producers claim a slot by advancing tail with a CAS, and publish it
+ * through the slot's sequence number (D. Vyukov's bounded queue), so a
+ * producer preempted mid-write holds up only the slots behind its own.
+ * */
+template <typename T>
+class mpsc_ring {
+ public:
+  explicit mpsc_ring(std::size_t capacity)
+      : mask_(capacity - 1), cells_(std::make_unique<cell[]>(capacity)) {
+    for (std::size_t i = 0; i < capacity; ++i) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  mpsc_ring(const mpsc_ring&) = delete;
+  mpsc_ring& operator=(const mpsc_ring&) = delete;
+
+  ~mpsc_ring() {
+    for (auto head = head_.load(std::memory_order_relaxed);; ++head) {
+      cell& c = cells_[head & mask_];
+      if (c.sequence.load(std::memory_order_acquire) != head + 1) {
+        break;
+      }
+      std::destroy_at(c.storage.get());
+    }
+  }
+
+  template <typename U>
+  bool try_push(U&& value) {
+    auto tail = tail_.load(std::memory_order_relaxed);
+    for (;;) {
+      cell& c = cells_[tail & mask_];
+      const auto sequence = c.sequence.load(std::memory_order_acquire);
+      const auto lag = static_cast<std::ptrdiff_t>(sequence - tail);
+      if (lag == 0) {
+        if (tail_.compare_exchange_weak(tail, tail + 1,
+                                        std::memory_order_relaxed)) {
+          std::construct_at(c.storage.get(), std::forward<U>(value));
+          c.sequence.store(tail + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (lag < 0) {
+        return false;
+      } else {
+        tail = tail_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  std::size_t try_pop(std::span<T> out) {
+    auto head = head_.load(std::memory_order_relaxed);
+    std::size_t n = 0;
+    for (; n < out.size(); ++n, ++head) {
+      cell& c = cells_[head & mask_];
+      if (c.sequence.load(std::memory_order_acquire) != head + 1) {
+        break;
+      }
+      T* slot = c.storage.get();
+      out[n] = std::move(*slot);
+      std::destroy_at(slot);
+      c.sequence.store(head + mask_ + 1, std::memory_order_release);
+    }
+    if (n > 0) {
+      head_.store(head, std::memory_order_release);
+    }
+    return n;
+  }
+
+  /**
+   * @brief Nothing published at the head, only meaningful to the consumer
+   * */
+  [[nodiscard]] bool empty() const {
+    const auto head = head_.load(std::memory_order_relaxed);
+    return cells_[head & mask_].sequence.load(std::memory_order_acquire) !=
+           head + 1;
+  }
+
+  [[nodiscard]] std::size_t size() const {
+    return tail_.load(std::memory_order_acquire) -
+           head_.load(std::memory_order_acquire);
+  }
+
+  [[nodiscard]] std::size_t capacity() const { return mask_ + 1; }
+
+ private:
+  struct cell {
+    std::atomic<std::size_t> sequence{0};
+    ring_storage<T> storage;
+  };
+
+  const std::size_t mask_;
+  std::unique_ptr<cell[]> cells_;
+  alignas(64) std::atomic<std::size_t> tail_{0};
+  alignas(64) std::atomic<std::size_t> head_{0};
+};
+
+/**
+ * @brief An operation parked until the other side makes progress
+ * */
+struct channel_waiter {
+  channel_waiter* next{nullptr};
+
+  channel_waiter() = default;
+  channel_waiter(const channel_waiter&) = delete;
+  channel_waiter& operator=(const channel_waiter&) = delete;
+  virtual ~channel_waiter() = default;
+
+  /**
+   * @brief Post the operation to run again, and free the waiter
+   * */
+  virtual void wake() = 0;
+};
+
+template <typename Self>
+struct parked_op final : channel_waiter {
+  explicit parked_op(Self&& s) : self(std::move(s)) {}
+
+  void wake() override {
+    auto resumed = std::move(self);
+    delete this;
+    asio::post(std::move(resumed));
+  }
+
+  Self self;
+};
+
+/**
+ * @brief Lock-free stack of parked operations, woken all at once
+ *
+ * An operation parks, then checks its condition again, and wakes the list
+ * itself if it has come true meanwhile. The other side changes the ring,
+ * then wakes the list. Both use seq_cst fences in between, so one of them
+ * sees the other and no wakeup is lost; a woken operation that still can't
+ * go ahead simply parks again.
+ * */
+class wait_list {
+ public:
+  wait_list() = default;
+  wait_list(const wait_list&) = delete;
+  wait_list& operator=(const wait_list&) = delete;
+
+  /**
+   * @brief Destroys parked operations without resuming them, as asio does
+   * with the handlers of a destroyed io object
+   * */
+  ~wait_list() {
+    auto* waiter = head_.exchange(nullptr);
+    while (waiter != nullptr) {
+      delete std::exchange(waiter, waiter->next);
+    }
+  }
+
+  template <typename Self>
+  void park(Self&& self) {
+    auto* waiter = new parked_op<std::decay_t<Self>>(std::move(self));
+    waiter->next = head_.load(std::memory_order_relaxed);
+    while (!head_.compare_exchange_weak(waiter->next, waiter,
+                                        std::memory_order_release,
+                                        std::memory_order_relaxed)) {
+    }
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+  }
+
+  void wake_all() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (head_.load(std::memory_order_relaxed) == nullptr) {
+      return;
+    }
+    auto* waiter = head_.exchange(nullptr, std::memory_order_acquire);
+    while (waiter != nullptr) {
+      std::exchange(waiter, waiter->next)->wake();
+    }
+  }
+
+ private:
+  std::atomic<channel_waiter*> head_{nullptr};
+};
+
+template <typename Channel, typename T>
+struct channel_send_op {
+  Channel* channel;
+  T value;
+  bool started{false};
+  bool posted{false};
+  asio::error_code result{};
+
+  template <typename Self>
+  void operator()(Self& self) {
+    if (posted) {
+      self.complete(result);
+      return;
+    }
+    const bool first = !started;
+    started = true;
+    if (!channel->is_open()) {
+      result = asio::experimental::error::channel_closed;
+    } else if (!channel->try_send(std::move(value))) {
+      auto* parked_on = channel;
+      parked_on->senders_.park(std::move(self));
+      if (parked_on->draining() || !parked_on->is_open()) {
+        parked_on->senders_.wake_all();
+      }
+      return;
+    }
+    if (first) {
+      // Never complete from inside the initiating function
+      posted = true;
+      asio::post(std::move(self));
+      return;
+    }
+    self.complete(result);
+  }
+};
+
+/**
+ * @brief Receives a batch into out, or with Single one value into the op
+ * */
+template <typename Channel, typename T, bool Single>
+struct channel_receive_op {
+  Channel* channel;
+  std::span<T> out;
+  [[no_unique_address]] std::conditional_t<Single, T, std::monostate> value{};
+  bool started{false};
+  bool posted{false};
+  asio::error_code result{};
+  std::size_t received{0};
+
+  template <typename Self>
+  void operator()(Self& self) {
+    if (posted) {
+      finish(self);
+      return;
+    }
+    const bool first = !started;
+    started = true;
+    if constexpr (Single) {
+      // The op moves between steps, so point at wherever it is now
+      out = {&value, 1};
+    }
+    received = channel->try_receive_some(out);
+    if (received == 0) {
+      if (!channel->is_open() && channel->ring_.empty()) {
+        result = asio::experimental::error::channel_closed;
+      } else {
+        auto* parked_on = channel;
+        parked_on->receivers_.park(std::move(self));
+        if (!parked_on->ring_.empty() || !parked_on->is_open()) {
+          parked_on->receivers_.wake_all();
+        }
+        return;
+      }
+    }
+    if (first) {
+      posted = true;
+      asio::post(std::move(self));
+      return;
+    }
+    finish(self);
+  }
+
+  template <typename Self>
+  void finish(Self& self) {
+    if constexpr (Single) {
+      self.complete(result, std::move(value));
+    } else {
+      self.complete(result, received);
+    }
+  }
+};
+}  // namespace detail
+
+/**
+ * @brief A bounded channel of T over a lock-free Ring, see garak::spsc_channel
+ * and garak::mpsc_channel
+ *
+ * Capacity is rounded up to a power of two. Only one receive may be
+ * outstanding at a time, and with an spsc ring only one send, as with the
+ * reads and writes of an asio socket; either side may run on any thread
+ * or io_context. A closed channel refuses sends, and receives fail with
+ * asio::experimental::error::channel_closed once it is drained. Operations
+ * still parked when the channel is destroyed are dropped without being
+ * called.
+ * */
+template <typename T, template <typename> class Ring>
+class basic_ring_channel {
+ public:
+  using executor_type = asio::any_io_executor;
+  using value_type = T;
+
+  static_assert(std::is_default_constructible_v<T> &&
+                    std::is_move_assignable_v<T>,
+                "channel values must be default constructible and movable");
+
+  basic_ring_channel(executor_type executor, std::size_t capacity)
+      : executor_(std::move(executor)),
+        ring_(std::bit_ceil(std::max<std::size_t>(capacity, 2))) {}
+
+  basic_ring_channel(const basic_ring_channel&) = delete;
+  basic_ring_channel& operator=(const basic_ring_channel&) = delete;
+
+  [[nodiscard]] executor_type get_executor() const { return executor_; }
+  [[nodiscard]] std::size_t capacity() const { return ring_.capacity(); }
+  [[nodiscard]] bool is_open() const {
+    return !closed_.load(std::memory_order_acquire);
+  }
+
+  /**
+   * @brief Stop accepting values and wake everything that is waiting
+   * */
+  void close() {
+    closed_.store(true, std::memory_order_release);
+    senders_.wake_all();
+    receivers_.wake_all();
+  }
+
+  /**
+   * @brief Send value if there is room, leaving it untouched otherwise
+   * */
+  template <typename U>
+  bool try_send(U&& value) {
+    if (!is_open() || !ring_.try_push(std::forward<U>(value))) {
+      return false;
+    }
+    receivers_.wake_all();
+    return true;
+  }
+
+  /**
+   * @brief Move up to out.size() queued values into out
+   *
+   * @returns how many were received
+   * */
+  std::size_t try_receive_some(std::span<T> out) {
+    const auto n = ring_.try_pop(out);
+    if (n > 0 && draining()) {
+      senders_.wake_all();
+    }
+    return n;
+  }
+
+  std::optional<T> try_receive() {
+    T value{};
+    if (try_receive_some({&value, 1}) == 0) {
+      return std::nullopt;
+    }
+    return value;
+  }
+
+  /**
+   * @brief Send value, waiting for room if the channel is full
+   *
+   * Completion signature `void(asio::error_code)`
+   * */
+  template <typename CompletionToken>
+  auto async_send(T value, CompletionToken&& token) {
+    return asio::async_compose<CompletionToken, void(asio::error_code)>(
+        detail::channel_send_op<basic_ring_channel, T>{this, std::move(value)},
+        token, executor_);
+  }
+
+  /**
+   * @brief Receive the next value, waiting for one if the channel is empty
+   *
+   * Completion signature `void(asio::error_code, T)`
+   * */
+  template <typename CompletionToken>
+  auto async_receive(CompletionToken&& token) {
+    return asio::async_compose<CompletionToken, void(asio::error_code, T)>(
+        detail::channel_receive_op<basic_ring_channel, T, true>{this, {}},
+        token, executor_);
+  }
+
+  /**
+   * @brief Receive at least one and up to out.size() values into out,
+   * waiting if the channel is empty
+   *
+   * Completion signature `void(asio::error_code, std::size_t)`. Taking a
+   * whole batch per wakeup is what lets a consumer keep up with several
+   * producers.
+   * */
+  template <typename CompletionToken>
+  auto async_receive_some(std::span<T> out, CompletionToken&& token) {
+    using op = detail::channel_receive_op<basic_ring_channel, T, false>;
+    return asio::async_compose<CompletionToken,
+                               void(asio::error_code, std::size_t)>(
+        op{this, out}, token, executor_);
+  }
+
+ private:
+  template <typename, typename>
+  friend struct detail::channel_send_op;
+  template <typename, typename, bool>
+  friend struct detail::channel_receive_op;
+
+  // Parked senders wait for the ring to drain to half full, rather than
+  // each waking for every slot freed
+  [[nodiscard]] bool draining() const {
+    return ring_.size() <= ring_.capacity() / 2;
+  }
+
+  executor_type executor_;
+  Ring<T> ring_;
+  std::atomic<bool> closed_{false};
+  detail::wait_list senders_;
+  detail::wait_list receivers_;
+};
+
+/**
+ * @brief Channel with one producer and one consumer
+ * */
+template <typename T>
+using spsc_channel = basic_ring_channel<T, detail::spsc_ring>;
+
+/**
+ * @brief Channel with any number of producers and one consumer
+ * */
+template <typename T>
+using mpsc_channel = basic_ring_channel<T, detail::mpsc_ring>;
+}  // namespace garak
+
+#endif
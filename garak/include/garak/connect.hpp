@@ -0,0 +1,257 @@
+#ifndef GARAK_CONNECT_HPP
+#define GARAK_CONNECT_HPP
+
+/**
+ * @file garak/connect.hpp
+ * @brief Happy Eyeballs (RFC 8305) connection racing
+ * @date 2026-10-19
+ *
+ * asio::async_connect tries each resolved endpoint only after the previous
+ * one has failed, so an address that silently drops SYNs costs a whole
+ * connect timeout before the next is tried. async_connect_racing starts the
+ * next attempt after a short delay instead, keeps whichever connects first
+ * and abandons the rest.
+ */
+
+#include <algorithm>
+#include <asio/async_result.hpp>
+#include <asio/compose.hpp>
+#include <asio/error.hpp>
+#include <asio/steady_timer.hpp>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace garak {
+/**
+ * @brief The RFC 8305 recommended "Connection Attempt Delay"
+ * */
+inline constexpr std::chrono::milliseconds default_connection_attempt_delay{
+    250};
+
+namespace detail {
+/**
+ * @brief Order endpoints so that address families alternate, starting with
+ * the family of the first endpoint (RFC 8305 section 4)
+ *
+ * The relative order within each family is kept.
+ * */
+template <typename Endpoint>
+std::vector<Endpoint> interleave_families(std::vector<Endpoint> endpoints) {
+  if (endpoints.empty()) {
+    return endpoints;
+  }
+  const bool first_v6 = endpoints.front().address().is_v6();
+  std::vector<Endpoint> preferred;
+  std::vector<Endpoint> other;
+  for (auto& endpoint : endpoints) {
+    (endpoint.address().is_v6() == first_v6 ? preferred : other)
+        .push_back(std::move(endpoint));
+  }
+  endpoints.clear();
+  for (std::size_t i = 0; i < std::max(preferred.size(), other.size()); ++i) {
+    if (i < preferred.size()) {
+      endpoints.push_back(std::move(preferred[i]));
+    }
+    if (i < other.size()) {
+      endpoints.push_back(std::move(other[i]));
+    }
+  }
+  return endpoints;
+}
+
+/**
+ * @brief The attempts of one async_connect_racing call, shared by their
+ * handlers
+ * */
+template <typename Socket>
+class connect_race
+    : public std::enable_shared_from_this<connect_race<Socket>> {
+ public:
+  using endpoint_type = typename Socket::endpoint_type;
+  using executor_type = typename Socket::executor_type;
+
+  connect_race(const executor_type& executor,
+               std::vector<endpoint_type> targets,
+               std::chrono::steady_clock::duration attempt_delay)
+      : endpoints(std::move(targets)),
+        delay(attempt_delay),
+        finished(executor),
+        executor_(executor),
+        stagger_(executor) {
+    finished.expires_at(std::chrono::steady_clock::time_point::max());
+    attempts.reserve(endpoints.size());
+  }
+
+  void start() {
+    if (endpoints.empty()) {
+      finish(asio::error::not_found);
+      return;
+    }
+    launch_next();
+  }
+
+  // Give up on every attempt still running
+  void abort() {
+    if (!done) {
+      finish(asio::error::operation_aborted);
+    }
+  }
+
+  std::vector<endpoint_type> endpoints;
+  std::chrono::steady_clock::duration delay;
+  std::vector<std::optional<Socket>> attempts;
+  std::optional<std::size_t> winner;
+  asio::error_code error;
+  bool done{false};
+  // Expires once the race is decided, for the initiating op to wait on
+  asio::steady_timer finished;
+
+ private:
+  void launch_next() {
+    const auto index = attempts.size();
+    auto& socket = attempts.emplace_back(std::in_place, executor_);
+    ++running_;
+    socket->async_connect(
+        endpoints[index], [self = this->shared_from_this(),
+                           index](asio::error_code ec) {
+          self->on_attempt(index, ec);
+        });
+    arm_stagger();
+  }
+
+  // Start the next attempt if this one hasn't connected within delay
+  void arm_stagger() {
+    if (attempts.size() == endpoints.size()) {
+      stagger_.cancel();
+      return;
+    }
+    stagger_.expires_after(delay);
+    stagger_.async_wait(
+        [self = this->shared_from_this(), generation = attempts.size()](
+            asio::error_code ec) {
+          if (!ec && !self->done && self->attempts.size() == generation) {
+            self->launch_next();
+          }
+        });
+  }
+
+  void on_attempt(std::size_t index, asio::error_code ec) {
+    --running_;
+    if (done) {
+      return;
+    }
+    if (!ec) {
+      winner = index;
+      finish({});
+      return;
+    }
+    error = ec;
+    attempts[index].reset();
+    if (attempts.size() < endpoints.size()) {
+      // A failure frees us to try the next address straight away
+      launch_next();
+    } else if (running_ == 0) {
+      finish(error);
+    }
+  }
+
+  void finish(asio::error_code ec) {
+    done = true;
+    error = ec;
+    stagger_.cancel();
+    for (std::size_t i = 0; i < attempts.size(); ++i) {
+      if (attempts[i] && (!winner || i != *winner)) {
+        asio::error_code ignored;
+        attempts[i]->close(ignored);
+      }
+    }
+    finished.expires_at(std::chrono::steady_clock::now());
+  }
+
+  executor_type executor_;
+  asio::steady_timer stagger_;
+  std::size_t running_{0};
+};
+
+template <typename Socket>
+struct connect_racing_op {
+  Socket& socket;
+  std::shared_ptr<connect_race<Socket>> race;
+  bool started{false};
+
+  template <typename Self>
+  void operator()(Self& self, asio::error_code /*ec*/ = {}) {
+    if (!started) {
+      started = true;
+      asio::error_code ignored;
+      socket.close(ignored);
+      race->start();
+      race->finished.async_wait(std::move(self));
+      return;
+    }
+    if (!race->done) {
+      // Our cancellation slot fired before any attempt won
+      race->abort();
+      self.complete(asio::error::operation_aborted, {});
+      return;
+    }
+    if (race->error) {
+      self.complete(race->error, {});
+      return;
+    }
+    socket = std::move(*race->attempts[*race->winner]);
+    self.complete({}, race->endpoints[*race->winner]);
+  }
+};
+}  // namespace detail
+
+/**
+ * @brief Connect socket to the first of endpoints to accept, racing
+ * attempts RFC 8305 style
+ *
+ * IPv6 and IPv4 endpoints are interleaved, an attempt is started every
+ * attempt_delay (or as soon as the previous one fails), and the first
+ * connection established wins while the rest are closed.
+ *
+ * Completion signature `void(asio::error_code, Socket::endpoint_type)`,
+ * carrying the winning endpoint. Fails with the last attempt's error when
+ * none connects, or asio::error::not_found for an empty sequence. Supports
+ * terminal cancellation.
+ * */
+template <typename Socket, typename EndpointSequence,
+          typename CompletionToken>
+auto async_connect_racing(Socket& socket, const EndpointSequence& endpoints,
+                          std::chrono::steady_clock::duration attempt_delay,
+                          CompletionToken&& token) {
+  using endpoint_type = typename Socket::endpoint_type;
+  std::vector<endpoint_type> targets;
+  for (const auto& entry : endpoints) {
+    targets.emplace_back(entry);
+  }
+  auto race = std::make_shared<detail::connect_race<Socket>>(
+      socket.get_executor(), detail::interleave_families(std::move(targets)),
+      attempt_delay);
+  return asio::async_compose<CompletionToken,
+                             void(asio::error_code, endpoint_type)>(
+      detail::connect_racing_op<Socket>{socket, std::move(race)}, token,
+      socket);
+}
+
+/**
+ * @brief async_connect_racing with the RFC 8305 default attempt delay
+ * */
+template <typename Socket, typename EndpointSequence,
+          typename CompletionToken>
+auto async_connect_racing(Socket& socket, const EndpointSequence& endpoints,
+                          CompletionToken&& token) {
+  return async_connect_racing(socket, endpoints,
+                              default_connection_attempt_delay,
+                              std::forward<CompletionToken>(token));
+}
+}  // namespace garak
+
+#endif
@@ -0,0 +1,481 @@
+#ifndef GARAK_CONNECTION_POOL_HPP
+#define GARAK_CONNECTION_POOL_HPP
+
+/**
+ * @file garak/connection_pool.hpp
+ * @brief A bounded pool of pre-connected client connections to one endpoint
+ * @date 2026-10-19
+ *
+ * Connection setup is paid once and amortised over many short calls:
+ *
+ * @code
+ * garak::connection_pool<tcp> pool{ctx.get_executor(), endpoints,
+ *                                  {.min_size = 4, .max_size = 32}};
+ * pool.start();
+ * {
+ *   auto conn = co_await pool.acquire();
+ *   co_await asio::async_write(*conn, request, asio::use_awaitable);
+ * }  // conn goes back to the pool here
+ * @endcode
+ *
+ * How a connection is established is a Connector policy, so the same pool
+ * serves plain sockets and wrapped streams.
+ */
+
+#include <algorithm>
+#include <asio/any_io_executor.hpp>
+#include <asio/as_tuple.hpp>
+#include <asio/bind_cancellation_slot.hpp>
+#include <asio/cancellation_signal.hpp>
+#include <asio/co_spawn.hpp>
+#include <asio/connect.hpp>
+#include <asio/detached.hpp>
+#include <asio/dispatch.hpp>
+#include <asio/error.hpp>
+#include <asio/socket_base.hpp>
+#include <asio/steady_timer.hpp>
+#include <asio/this_coro.hpp>
+#include <asio/use_awaitable.hpp>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <sys/socket.h>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+namespace garak {
+/**
+ * @brief Connects a plain Protocol::socket with asio::async_connect, trying
+ * each endpoint in turn.
+ *
+ * A Connector names its `connection_type` and provides
+ * `asio::awaitable<connection_type> connect(std::vector<endpoint>) const`,
+ * run on the pool's executor. The connection must expose `lowest_layer()`.
+ * A Connector may also provide `bool alive(connection_type&) const` to
+ * replace the default check on idle connections.
+ * */
+template <typename Protocol>
+struct socket_connector {
+  using endpoint_type = typename Protocol::endpoint;
+  using connection_type = typename Protocol::socket;
+
+  asio::awaitable<connection_type> connect(
+      std::vector<endpoint_type> endpoints) const {
+    connection_type socket{co_await asio::this_coro::executor};
+    co_await asio::async_connect(socket, endpoints, asio::use_awaitable);
+    co_return socket;
+  }
+};
+
+/**
+ * @brief Sizing and timing knobs for garak::connection_pool
+ * */
+struct pool_options {
+  /// Connections kept open even when idle, opened up front by start()
+  std::size_t min_size{0};
+  /// Connections open at once, idle and leased together
+  std::size_t max_size{16};
+  /// Idle connections above min_size are closed after this long unused
+  std::chrono::steady_clock::duration idle_timeout{std::chrono::seconds(60)};
+  /// How often idle connections are checked for eviction
+  std::chrono::steady_clock::duration health_check_interval{
+      std::chrono::seconds(5)};
+  /// A connect attempt that takes longer fails with asio::error::timed_out
+  std::chrono::steady_clock::duration connect_timeout{std::chrono::seconds(5)};
+  /// Turn on SO_KEEPALIVE for every pooled connection
+  bool keep_alive{true};
+};
+
+namespace detail {
+/**
+ * @brief Whether an idle connection is still usable
+ *
+ * Nothing should arrive on a connection nobody is using, so a readable
+ * socket means the peer closed it, reset it, or sent something we would
+ * misread as the reply to our next request. Either way it can't be reused.
+ * */
+template <typename Connection>
+bool idle_connection_alive(Connection& connection) {
+  auto& socket = connection.lowest_layer();
+  if (!socket.is_open()) {
+    return false;
+  }
+  char probe = 0;
+  const auto n = ::recv(socket.native_handle(), &probe, 1,
+                        MSG_PEEK | MSG_DONTWAIT);
+  return n < 0 && errno == EAGAIN;
+}
+}  // namespace detail
+
+/**
+ * @brief Hands out pre-connected connections and takes them back.
+ *
+ * Idle connections are reused most recently used first, so a quiet pool
+ * lets its surplus age out. Once max_size connections are open, acquire()
+ * waits for one to be returned. A periodic health check closes idle
+ * connections the peer has dropped or that sat unused past idle_timeout,
+ * and reconnects back up to min_size.
+ *
+ * Like garak::rpc_client the pool is not thread safe, acquire and release
+ * connections from the executor it was created with.
+ * */
+template <typename Protocol, typename Connector = socket_connector<Protocol>>
+class connection_pool {
+ public:
+  using clock = std::chrono::steady_clock;
+  using executor_type = asio::any_io_executor;
+  using endpoint_type = typename Protocol::endpoint;
+  using connection_type = typename Connector::connection_type;
+
+ private:
+  class state;
+
+ public:
+  /**
+   * @brief A leased connection, returned to the pool when destroyed
+   * */
+  class lease {
+   public:
+    lease(std::shared_ptr<state> pool, connection_type connection)
+        : pool_(std::move(pool)), connection_(std::move(connection)) {}
+
+    ~lease() { release(); }
+
+    lease(const lease&) = delete;
+    lease& operator=(const lease&) = delete;
+
+    lease(lease&& other) noexcept
+        : pool_(std::move(other.pool_)),
+          connection_(std::exchange(other.connection_, std::nullopt)),
+          reusable_(other.reusable_) {}
+
+    lease& operator=(lease&& other) noexcept {
+      if (this != &other) {
+        release();
+        pool_ = std::move(other.pool_);
+        connection_ = std::exchange(other.connection_, std::nullopt);
+        reusable_ = other.reusable_;
+      }
+      return *this;
+    }
+
+    connection_type& operator*() { return *connection_; }
+    connection_type* operator->() { return &*connection_; }
+
+    /**
+     * @brief Close the connection instead of returning it, for when a
+     * request failed half way and the stream state is unknown
+     * */
+    void discard() { reusable_ = false; }
+
+   private:
+    void release() {
+      if (pool_ && connection_) {
+        pool_->release(std::move(*connection_), reusable_);
+      }
+      connection_.reset();
+      pool_.reset();
+    }
+
+    std::shared_ptr<state> pool_;
+    std::optional<connection_type> connection_;
+    bool reusable_{true};
+  };
+
+  connection_pool(executor_type executor, std::vector<endpoint_type> endpoints,
+                  pool_options options = {}, Connector connector = {})
+      : state_(std::make_shared<state>(std::move(executor),
+                                       std::move(endpoints), options,
+                                       std::move(connector))) {}
+
+  ~connection_pool() {
+    if (state_) {
+      close();
+    }
+  }
+
+  connection_pool(const connection_pool&) = delete;
+  connection_pool& operator=(const connection_pool&) = delete;
+  connection_pool(connection_pool&&) noexcept = default;
+  connection_pool& operator=(connection_pool&&) noexcept = default;
+
+  executor_type get_executor() { return state_->executor; }
+
+  /**
+   * @brief Warm up to min_size and start the periodic health check
+   * */
+  void start() {
+    asio::co_spawn(state_->executor, state::maintain(state_), asio::detached);
+  }
+
+  /**
+   * @brief Close every idle connection and fail waiting acquires with
+   * asio::error::operation_aborted, leased connections are closed as they
+   * come back
+   * */
+  void close() {
+    asio::dispatch(state_->executor, [self = state_] { self->close(); });
+  }
+
+  /**
+   * @brief Lease a connection, reusing an idle one when possible
+   *
+   * Throws std::system_error when a new connection can't be established or
+   * the pool is closed while waiting.
+   * */
+  asio::awaitable<lease> acquire() { return state::acquire(state_); }
+
+  /**
+   * @brief Connections open, idle and leased
+   * */
+  [[nodiscard]] std::size_t size() const { return state_->open; }
+
+  /**
+   * @brief Connections sitting in the pool ready to be leased
+   * */
+  [[nodiscard]] std::size_t idle() const { return state_->idle.size(); }
+
+  /**
+   * @brief acquire() calls waiting for a connection to come back
+   * */
+  [[nodiscard]] std::size_t waiting() const { return state_->waiters.size(); }
+
+ private:
+  struct idle_connection {
+    connection_type connection;
+    clock::time_point since;
+  };
+
+  struct waiter {
+    explicit waiter(const executor_type& executor) : timer(executor) {
+      timer.expires_at(clock::time_point::max());
+    }
+
+    asio::steady_timer timer;
+    bool done{false};
+    std::optional<connection_type> connection;
+    asio::error_code ec;
+  };
+
+  class state : public std::enable_shared_from_this<state> {
+   public:
+    state(executor_type pool_executor, std::vector<endpoint_type> targets,
+          pool_options pool_settings, Connector pool_connector)
+        : executor(std::move(pool_executor)),
+          endpoints(std::move(targets)),
+          options(pool_settings),
+          connector(std::move(pool_connector)),
+          health_timer(executor) {}
+
+    static asio::awaitable<lease> acquire(std::shared_ptr<state> self) {
+      for (;;) {
+        if (self->closed) {
+          throw std::system_error(asio::error::operation_aborted);
+        }
+        while (!self->idle.empty()) {
+          auto entry = std::move(self->idle.back());
+          self->idle.pop_back();
+          if (self->alive(entry.connection)) {
+            co_return lease{self, std::move(entry.connection)};
+          }
+          --self->open;
+        }
+        if (self->open < self->options.max_size) {
+          ++self->open;
+          std::exception_ptr error;
+          try {
+            co_return lease{self, co_await self->connect()};
+          } catch (...) {
+            error = std::current_exception();
+          }
+          --self->open;
+          self->wake_one();
+          std::rethrow_exception(error);
+        }
+
+        auto w = std::make_shared<waiter>(self->executor);
+        self->waiters.push_back(w);
+        co_await w->timer.async_wait(asio::as_tuple(asio::use_awaitable));
+        if (!w->done) {
+          // Cancelled while waiting
+          std::erase(self->waiters, w);
+          throw std::system_error(asio::error::operation_aborted);
+        }
+        if (w->ec) {
+          throw std::system_error(w->ec);
+        }
+        if (w->connection) {
+          co_return lease{self, std::move(*w->connection)};
+        }
+        // A slot was freed rather than a connection handed over, go round
+      }
+    }
+
+    static asio::awaitable<void> maintain(std::shared_ptr<state> self) {
+      while (!self->closed) {
+        self->refill();
+        self->health_timer.expires_after(self->options.health_check_interval);
+        auto [ec] = co_await self->health_timer.async_wait(
+            asio::as_tuple(asio::use_awaitable));
+        if (ec || self->closed) {
+          co_return;
+        }
+        self->evict();
+      }
+    }
+
+    void release(connection_type connection, bool reusable) {
+      if (closed || !reusable || !connection.lowest_layer().is_open()) {
+        asio::error_code ignored;
+        connection.lowest_layer().close(ignored);
+        --open;
+        wake_one();
+        return;
+      }
+      if (!waiters.empty()) {
+        // Hand it straight over, no need to park it
+        auto w = std::move(waiters.front());
+        waiters.pop_front();
+        w->done = true;
+        w->connection.emplace(std::move(connection));
+        w->timer.cancel();
+        return;
+      }
+      idle.push_back({std::move(connection), clock::now()});
+    }
+
+    void close() {
+      if (closed) {
+        return;
+      }
+      closed = true;
+      health_timer.cancel();
+      for (auto& entry : idle) {
+        asio::error_code ignored;
+        entry.connection.lowest_layer().close(ignored);
+      }
+      open -= idle.size();
+      idle.clear();
+      for (auto& w : waiters) {
+        w->done = true;
+        w->ec = asio::error::operation_aborted;
+        w->timer.cancel();
+      }
+      waiters.clear();
+    }
+
+    executor_type executor;
+    std::vector<endpoint_type> endpoints;
+    pool_options options;
+    Connector connector;
+    asio::steady_timer health_timer;
+    // Most recently returned at the back
+    std::vector<idle_connection> idle;
+    std::deque<std::shared_ptr<waiter>> waiters;
+    // Idle, leased and still connecting
+    std::size_t open{0};
+    bool closed{false};
+
+   private:
+    bool alive(connection_type& connection) const {
+      if constexpr (requires { connector.alive(connection); }) {
+        return connector.alive(connection);
+      } else {
+        return detail::idle_connection_alive(connection);
+      }
+    }
+
+    // Let one waiter retry now that there is room for another connection
+    void wake_one() {
+      if (waiters.empty()) {
+        return;
+      }
+      auto w = std::move(waiters.front());
+      waiters.pop_front();
+      w->done = true;
+      w->timer.cancel();
+    }
+
+    static asio::awaitable<std::optional<connection_type>> connect_once(
+        Connector connector, std::vector<endpoint_type> endpoints) {
+      co_return co_await connector.connect(std::move(endpoints));
+    }
+
+    asio::awaitable<connection_type> connect() {
+      // The attempt runs as its own coroutine so the deadline can cancel it
+      struct attempt {
+        asio::cancellation_signal cancel;
+        bool expired{false};
+      };
+      auto current = std::make_shared<attempt>();
+      asio::steady_timer deadline{executor, options.connect_timeout};
+      deadline.async_wait([current](asio::error_code ec) {
+        if (!ec) {
+          current->expired = true;
+          current->cancel.emit(asio::cancellation_type::terminal);
+        }
+      });
+      auto [error, connection] = co_await asio::co_spawn(
+          executor, connect_once(connector, endpoints),
+          asio::bind_cancellation_slot(current->cancel.slot(),
+                                       asio::as_tuple(asio::use_awaitable)));
+      deadline.cancel();
+      if (error) {
+        if (current->expired) {
+          throw std::system_error(asio::error::timed_out);
+        }
+        std::rethrow_exception(error);
+      }
+      if (options.keep_alive) {
+        connection->lowest_layer().set_option(
+            asio::socket_base::keep_alive{true});
+      }
+      co_return std::move(*connection);
+    }
+
+    static asio::awaitable<void> warm(std::shared_ptr<state> self) {
+      try {
+        auto connection = co_await self->connect();
+        self->release(std::move(connection), true);
+      } catch (const std::system_error&) {
+        // The next health check tries again
+        --self->open;
+        self->wake_one();
+      }
+    }
+
+    void refill() {
+      while (!closed && open < std::min(options.min_size, options.max_size)) {
+        ++open;
+        asio::co_spawn(executor, warm(this->shared_from_this()),
+                       asio::detached);
+      }
+    }
+
+    void evict() {
+      const auto now = clock::now();
+      // Oldest first, so surplus ages out before the warm core
+      std::erase_if(idle, [&](idle_connection& entry) {
+        const bool expired = now - entry.since >= options.idle_timeout &&
+                             open > options.min_size;
+        if (!expired && alive(entry.connection)) {
+          return false;
+        }
+        asio::error_code ignored;
+        entry.connection.lowest_layer().close(ignored);
+        --open;
+        return true;
+      });
+    }
+  };
+
+  std::shared_ptr<state> state_;
+};
+}  // namespace garak
+
+#endif
@@ -0,0 +1,268 @@
+#ifndef GARAK_DISPATCHER_HPP
+#define GARAK_DISPATCHER_HPP
+
+/**
+ * @file garak/dispatcher.hpp
+ * @brief Compile-time message dispatch keyed by message type id
+ * @date 2026-10-19
+ */
+
+#include <algorithm>
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <tuple>
+#include <utility>
+
+namespace garak {
+/**
+ * @brief The type used to identify a message on the wire
+ * */
+using message_id = std::uint32_t;
+
+/**
+ * @brief Customisation point used by the dispatcher to turn a payload into
+ * the handler's message type.
+ *
+ * The primary template calls `Message::decode(payload)`, specialise it for
+ * message types that can not carry a static `decode` member.
+ * */
+template <typename Message>
+struct message_traits {
+  static Message decode(std::span<const std::byte> payload) {
+    return Message::decode(payload);
+  }
+};
+
+/**
+ * @brief Handlers that take the raw payload get it untouched
+ * */
+template <>
+struct message_traits<std::span<const std::byte>> {
+  static std::span<const std::byte> decode(
+      std::span<const std::byte> payload) {
+    return payload;
+  }
+};
+
+/**
+ * @brief A handler declares the id it answers to, and the message type it
+ * wants to be called with
+ * */
+template <typename Handler>
+concept message_handler = requires {
+  { Handler::id } -> std::convertible_to<message_id>;
+  typename Handler::message_type;
+};
+
+namespace detail {
+/**
+ * @brief Shape of a dispatch table, either a dense range indexed by
+ * `id - base`, or a multiplicative perfect hash over sparse ids
+ * */
+struct dispatch_layout {
+  bool dense{true};
+  message_id base{0};
+  std::size_t size{0};
+  std::uint32_t seed{0};
+  unsigned bits{0};
+
+  [[nodiscard]] constexpr std::size_t slot(message_id id) const {
+    if (dense) {
+      return static_cast<std::size_t>(id - base);
+    }
+    const std::uint32_t mixed = id * seed;
+    return bits == 0 ? 0 : static_cast<std::size_t>(mixed >> (32U - bits));
+  }
+};
+
+template <typename Thunk>
+struct dispatch_entry {
+  message_id id{0};
+  Thunk fn{nullptr};
+};
+
+constexpr unsigned ceil_log2(std::size_t n) {
+  unsigned bits = 0;
+  while ((std::size_t{1} << bits) < n) {
+    ++bits;
+  }
+  return bits;
+}
+
+template <std::size_t N>
+constexpr bool collision_free(const std::array<message_id, N>& ids,
+                              const dispatch_layout& layout) {
+  for (std::size_t i = 0; i < N; ++i) {
+    for (std::size_t j = i + 1; j < N; ++j) {
+      if (layout.slot(ids[i]) == layout.slot(ids[j])) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Pick the table layout for a set of ids.
+ *
+ * Ids that cover at most four times as many slots as there are handlers get
+ * a dense table, anything sparser searches for a collision free multiplier.
+ * */
+template <std::size_t N>
+constexpr dispatch_layout make_dispatch_layout(
+    const std::array<message_id, N>& ids) {
+  constexpr std::size_t dense_factor = 4;
+  constexpr std::uint32_t golden_seed = 0x9E3779B1U;
+  constexpr std::uint32_t seed_attempts = 1U << 12U;
+  constexpr unsigned extra_bits = 4;
+
+  const auto [lowest, highest] = std::minmax_element(ids.begin(), ids.end());
+  const auto range = static_cast<std::size_t>(*highest - *lowest) + 1;
+  if (range <= dense_factor * N) {
+    return dispatch_layout{true, *lowest, range, 0, 0};
+  }
+
+  for (unsigned bits = ceil_log2(N); bits <= ceil_log2(N) + extra_bits;
+       ++bits) {
+    for (std::uint32_t attempt = 0; attempt < seed_attempts; ++attempt) {
+      dispatch_layout layout{
+          false, 0, std::size_t{1} << bits, golden_seed + 2U * attempt, bits};
+      if (collision_free(ids, layout)) {
+        return layout;
+      }
+    }
+  }
+  return dispatch_layout{false, 0, 0, 0, 0};
+}
+
+template <std::size_t N>
+constexpr bool unique_ids(std::array<message_id, N> ids) {
+  std::sort(ids.begin(), ids.end());
+  return std::adjacent_find(ids.begin(), ids.end()) == ids.end();
+}
+}  // namespace detail
+
+/**
+ * @brief Dispatch a payload to one of a fixed set of handlers by message id.
+ *
+ * The table is built at compile time from each handler's `static constexpr
+ * id`, dense ids index straight into an array, sparse ids go through a
+ * perfect hash. Each table slot calls its handler directly with the decoded
+ * message, so there is no type erasure, no heap and no runtime hashing.
+ *
+ * @code
+ * struct ping_handler {
+ *   static constexpr garak::message_id id = 1;
+ *   using message_type = ping;
+ *   void operator()(ping msg, session& s);
+ * };
+ *
+ * garak::dispatcher<ping_handler, pong_handler> dispatch;
+ * dispatch.dispatch(header.id, payload, session);
+ * @endcode
+ * */
+template <message_handler... Handlers>
+class dispatcher {
+  static_assert(sizeof...(Handlers) > 0,
+                "dispatcher requires at least one handler");
+
+  static constexpr std::array<message_id, sizeof...(Handlers)> ids_{
+      static_cast<message_id>(Handlers::id)...};
+
+  static_assert(detail::unique_ids(ids_),
+                "dispatcher handlers must declare unique ids");
+
+  static constexpr detail::dispatch_layout layout_ =
+      detail::make_dispatch_layout(ids_);
+
+  static_assert(layout_.size > 0,
+                "no perfect hash found for the handler ids, consider "
+                "renumbering them");
+
+ public:
+  dispatcher() = default;
+
+  explicit dispatcher(Handlers... handlers)
+      : handlers_(std::move(handlers)...) {}
+
+  /**
+   * @brief Decode the payload and call the handler registered for id
+   *
+   * @param id the message id read from the wire
+   * @param payload the encoded message
+   * @param args forwarded to the handler after the decoded message
+   * @returns false when no handler is registered for id
+   * */
+  template <typename... Args>
+  bool dispatch(message_id id, std::span<const std::byte> payload,
+                Args&&... args) {
+    const auto slot = layout_.slot(id);
+    if (slot >= layout_.size) {
+      return false;
+    }
+    const auto& entry = table_<Args&&...>[slot];
+    if (entry.fn == nullptr || entry.id != id) {
+      return false;
+    }
+    entry.fn(handlers_, payload, std::forward<Args>(args)...);
+    return true;
+  }
+
+  /**
+   * @brief Is a handler registered for id
+   * */
+  [[nodiscard]] static constexpr bool contains(message_id id) {
+    return std::find(ids_.begin(), ids_.end(), id) != ids_.end();
+  }
+
+  /**
+   * @brief True when ids are spread too far apart for a dense table
+   * */
+  [[nodiscard]] static constexpr bool is_hashed() { return !layout_.dense; }
+
+  /**
+   * @brief Access a handler instance, for handlers carrying state
+   * */
+  template <typename Handler>
+  Handler& get() {
+    return std::get<Handler>(handlers_);
+  }
+
+ private:
+  using handler_tuple = std::tuple<Handlers...>;
+
+  template <typename... Args>
+  using thunk_type = void (*)(handler_tuple&, std::span<const std::byte>,
+                              Args...);
+
+  template <std::size_t I, typename... Args>
+  static void invoke(handler_tuple& handlers,
+                     std::span<const std::byte> payload, Args... args) {
+    using message_type =
+        typename std::tuple_element_t<I, handler_tuple>::message_type;
+    std::get<I>(handlers)(message_traits<message_type>::decode(payload),
+                          std::forward<Args>(args)...);
+  }
+
+  template <typename... Args>
+  static constexpr auto make_table() {
+    std::array<detail::dispatch_entry<thunk_type<Args...>>, layout_.size>
+        table{};
+    [&]<std::size_t... I>(std::index_sequence<I...>) {
+      ((table[layout_.slot(ids_[I])] = {ids_[I], &invoke<I, Args...>}), ...);
+    }
+    (std::index_sequence_for<Handlers...>{});
+    return table;
+  }
+
+  template <typename... Args>
+  static constexpr auto table_ = make_table<Args...>();
+
+  handler_tuple handlers_;
+};
+}  // namespace garak
+
+#endif
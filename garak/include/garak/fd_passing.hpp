@@ -0,0 +1,317 @@
+#ifndef GARAK_FD_PASSING_HPP
+#define GARAK_FD_PASSING_HPP
+
+/**
+ * @file garak/fd_passing.hpp
+ * @brief Passing file descriptors over unix sockets
+ * @date 2026-10-19
+ *
+ * A descriptor sent with SCM_RIGHTS arrives in the receiving process as a
+ * new descriptor for the same open file, socket or memory. The descriptors
+ * ride along with the first byte of the data they are sent with, a stream
+ * socket needs at least one.
+ *
+ * @code
+ * co_await garak::async_send_fds(socket, asio::buffer(header), fds,
+ *                                asio::use_awaitable);
+ * auto [ec, n, received] = co_await garak::async_receive_fds(
+ *     socket, asio::buffer(header), asio::as_tuple(asio::use_awaitable));
+ * @endcode
+ */
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <asio/async_result.hpp>
+#include <asio/buffer.hpp>
+#include <asio/compose.hpp>
+#include <asio/error.hpp>
+#include <asio/post.hpp>
+#include <asio/socket_base.hpp>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace garak {
+/**
+ * @brief An owned file descriptor, closed on destruction
+ * */
+class unique_fd {
+ public:
+  unique_fd() = default;
+  explicit unique_fd(int fd) : fd_(fd) {}
+  unique_fd(unique_fd&& other) noexcept : fd_(other.release()) {}
+  unique_fd& operator=(unique_fd&& other) noexcept {
+    if (this != &other) {
+      reset(other.release());
+    }
+    return *this;
+  }
+  ~unique_fd() { reset(); }
+
+  unique_fd(const unique_fd&) = delete;
+  unique_fd& operator=(const unique_fd&) = delete;
+
+  [[nodiscard]] int get() const { return fd_; }
+  [[nodiscard]] bool is_open() const { return fd_ >= 0; }
+  explicit operator bool() const { return is_open(); }
+
+  /**
+   * @brief Give up ownership, e.g. to assign the descriptor to a socket
+   * */
+  int release() { return std::exchange(fd_, -1); }
+
+  void reset(int fd = -1) {
+    if (fd_ >= 0) {
+      ::close(fd_);
+    }
+    fd_ = fd;
+  }
+
+ private:
+  int fd_{-1};
+};
+
+/**
+ * @brief Most descriptors one receive takes, more are discarded by the
+ * kernel and the receive fails with asio::error::no_buffer_space
+ * */
+inline constexpr std::size_t max_passed_fds = 64;
+
+namespace detail {
+/**
+ * @brief One sendmsg of data with fds attached, 0 with would_block when
+ * the socket is full
+ * */
+inline std::size_t send_with_fds(int socket, std::span<const iovec> data,
+                                 std::span<const int> fds,
+                                 asio::error_code& ec) {
+  // CMSG_FIRSTHDR hands this out as a cmsghdr*, so align it for one
+  alignas(cmsghdr) std::array<char, CMSG_SPACE(sizeof(int) * max_passed_fds)>
+      control{};
+  msghdr message{};
+  message.msg_iov = const_cast<iovec*>(data.data());
+  message.msg_iovlen = data.size();
+  if (!fds.empty()) {
+    if (fds.size() > max_passed_fds) {
+      ec = asio::error::invalid_argument;
+      return 0;
+    }
+    message.msg_control = control.data();
+    message.msg_controllen = CMSG_SPACE(fds.size_bytes());
+    cmsghdr* header = CMSG_FIRSTHDR(&message);
+    header->cmsg_level = SOL_SOCKET;
+    header->cmsg_type = SCM_RIGHTS;
+    header->cmsg_len = CMSG_LEN(fds.size_bytes());
+    std::memcpy(CMSG_DATA(header), fds.data(), fds.size_bytes());
+  }
+  for (;;) {
+    const auto n = ::sendmsg(socket, &message, MSG_NOSIGNAL);
+    if (n >= 0) {
+      ec = {};
+      return static_cast<std::size_t>(n);
+    }
+    if (errno != EINTR) {
+      ec = errno == EAGAIN ? asio::error::would_block
+                           : asio::error_code(errno, asio::system_category());
+      return 0;
+    }
+  }
+}
+
+/**
+ * @brief One recvmsg into data, appending the descriptors that came with
+ * it to fds; 0 with would_block when nothing is queued, or eof
+ * */
+inline std::size_t receive_with_fds(int socket, asio::mutable_buffer data,
+                                    std::vector<unique_fd>& fds,
+                                    asio::error_code& ec) {
+  // CMSG_FIRSTHDR hands this out as a cmsghdr*, so align it for one
+  alignas(cmsghdr) std::array<char, CMSG_SPACE(sizeof(int) * max_passed_fds)>
+      control{};
+  iovec vec{data.data(), data.size()};
+  msghdr message{};
+  message.msg_iov = &vec;
+  message.msg_iovlen = 1;
+  message.msg_control = control.data();
+  message.msg_controllen = control.size();
+  ssize_t n = 0;
+  do {
+    n = ::recvmsg(socket, &message, MSG_CMSG_CLOEXEC);
+  } while (n < 0 && errno == EINTR);
+  if (n < 0) {
+    ec = errno == EAGAIN ? asio::error::would_block
+                         : asio::error_code(errno, asio::system_category());
+    return 0;
+  }
+  for (cmsghdr* header = CMSG_FIRSTHDR(&message); header != nullptr;
+       header = CMSG_NXTHDR(&message, header)) {
+    if (header->cmsg_level == SOL_SOCKET && header->cmsg_type == SCM_RIGHTS) {
+      const auto count = (header->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+      for (std::size_t i = 0; i < count; ++i) {
+        int fd = -1;
+        std::memcpy(&fd, CMSG_DATA(header) + i * sizeof(int), sizeof(int));
+        fds.emplace_back(fd);
+      }
+    }
+  }
+  if ((message.msg_flags & MSG_CTRUNC) != 0) {
+    ec = asio::error::no_buffer_space;
+  } else if (n == 0 && data.size() != 0) {
+    ec = asio::error::eof;
+  } else {
+    ec = {};
+  }
+  return static_cast<std::size_t>(n);
+}
+
+template <typename Socket>
+struct send_fds_op {
+  Socket& socket;
+  std::vector<asio::const_buffer> buffers;
+  std::vector<int> fds;
+  std::size_t total;
+  std::size_t sent{0};
+  bool started{false};
+  bool posted{false};
+  asio::error_code result{};
+
+  template <typename Self>
+  void operator()(Self& self, asio::error_code ec = {}) {
+    if (posted) {
+      self.complete(result, sent);
+      return;
+    }
+    const bool first = !started;
+    started = true;
+    if (first && total == 0) {
+      // A stream socket drops descriptors sent without data
+      ec = asio::error::invalid_argument;
+    }
+    if (first && !ec) {
+      socket.native_non_blocking(true, ec);
+    }
+    while (!ec && sent < total) {
+      std::vector<iovec> data;
+      std::size_t skip = sent;
+      for (const auto& buffer : buffers) {
+        if (skip >= buffer.size()) {
+          skip -= buffer.size();
+          continue;
+        }
+        data.push_back(
+            {static_cast<char*>(const_cast<void*>(buffer.data())) + skip,
+             buffer.size() - skip});
+        skip = 0;
+      }
+      // The descriptors go with the first byte only
+      const auto n = send_with_fds(
+          socket.native_handle(), data,
+          sent == 0 ? std::span<const int>{fds} : std::span<const int>{}, ec);
+      if (ec == asio::error::would_block) {
+        socket.async_wait(asio::socket_base::wait_write, std::move(self));
+        return;
+      }
+      sent += n;
+    }
+    if (first) {
+      // Never complete from inside the initiating function
+      result = ec;
+      posted = true;
+      asio::post(std::move(self));
+      return;
+    }
+    self.complete(ec, sent);
+  }
+};
+
+template <typename Socket>
+struct receive_fds_op {
+  Socket& socket;
+  asio::mutable_buffer buffer;
+  std::size_t received{0};
+  std::vector<unique_fd> fds{};
+  bool started{false};
+  bool posted{false};
+  asio::error_code result{};
+
+  template <typename Self>
+  void operator()(Self& self, asio::error_code ec = {}) {
+    if (posted) {
+      self.complete(result, received, std::move(fds));
+      return;
+    }
+    const bool first = !started;
+    started = true;
+    if (first) {
+      socket.native_non_blocking(true, ec);
+    }
+    if (!ec) {
+      received = receive_with_fds(socket.native_handle(), buffer, fds, ec);
+      if (ec == asio::error::would_block) {
+        socket.async_wait(asio::socket_base::wait_read, std::move(self));
+        return;
+      }
+    }
+    if (first) {
+      result = ec;
+      posted = true;
+      asio::post(std::move(self));
+      return;
+    }
+    self.complete(ec, received, std::move(fds));
+  }
+};
+}  // namespace detail
+
+/**
+ * @brief Send all of data over a unix socket, with fds attached to its
+ * first byte
+ *
+ * The descriptors are duplicated into the receiving process, ours stay
+ * open. Completion signature `void(asio::error_code, std::size_t)` with
+ * the bytes sent. data must not be empty.
+ * */
+template <typename Socket, typename ConstBufferSequence,
+          typename CompletionToken>
+auto async_send_fds(Socket& socket, const ConstBufferSequence& data,
+                    std::span<const int> fds, CompletionToken&& token) {
+  std::vector<asio::const_buffer> buffers;
+  for (auto it = asio::buffer_sequence_begin(data);
+       it != asio::buffer_sequence_end(data); ++it) {
+    buffers.emplace_back(*it);
+  }
+  const auto total = asio::buffer_size(data);
+  return asio::async_compose<CompletionToken,
+                             void(asio::error_code, std::size_t)>(
+      detail::send_fds_op<Socket>{socket, std::move(buffers),
+                                  std::vector<int>(fds.begin(), fds.end()),
+                                  total},
+      token, socket);
+}
+
+/**
+ * @brief Receive some bytes from a unix socket into data, with whatever
+ * descriptors came along with them
+ *
+ * Completion signature `void(asio::error_code, std::size_t,
+ * std::vector<garak::unique_fd>)`. Like read_some, fewer bytes than data
+ * holds may arrive; descriptors sent with later bytes come with a later
+ * receive.
+ * */
+template <typename Socket, typename CompletionToken>
+auto async_receive_fds(Socket& socket, asio::mutable_buffer data,
+                       CompletionToken&& token) {
+  return asio::async_compose<CompletionToken,
+                             void(asio::error_code, std::size_t,
+                                  std::vector<unique_fd>)>(
+      detail::receive_fds_op<Socket>{socket, data}, token, socket);
+}
+}  // namespace garak
+
+#endif
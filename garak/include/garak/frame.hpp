@@ -0,0 +1,307 @@
+#ifndef GARAK_FRAME_HPP
+#define GARAK_FRAME_HPP
+
+/**
+ * @file garak/frame.hpp
+ * @brief Length prefixed framing over any asio stream
+ * @date 2026-10-19
+ *
+ * A frame is a little-endian u32 payload length followed by the payload.
+ * Anything that exposes `get_executor()`, `async_read_frame(token)` and
+ * `async_write_frame(buffers, token)` with the signatures below is a framed
+ * session, and can carry garak::rpc_client / garak::rpc_server.
+ */
+
+#include <algorithm>
+#include <array>
+#include <asio/async_result.hpp>
+#include <asio/buffer.hpp>
+#include <asio/compose.hpp>
+#include <asio/error.hpp>
+#include <asio/post.hpp>
+#include <asio/write.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace garak {
+/**
+ * @brief Wraps a stream, reading and writing whole frames.
+ *
+ * Reads go through an internal buffer so that one `read_some` can pick up
+ * several pipelined frames, the frame handed to the completion handler is a
+ * view into that buffer and stays valid until the next read is started.
+ *
+ * Like the asio streams it wraps, at most one read and one write may be
+ * outstanding at a time.
+ * */
+template <typename Stream>
+class framed_stream {
+ public:
+  using next_layer_type = Stream;
+  using executor_type = typename Stream::executor_type;
+
+  static constexpr std::size_t header_size = sizeof(std::uint32_t);
+  static constexpr std::size_t default_buffer_size = 64 * 1024;
+  static constexpr std::size_t default_max_frame_size = 16 * 1024 * 1024;
+
+  template <typename... Args>
+  explicit framed_stream(Args&&... args)
+      : stream_(std::forward<Args>(args)...),
+        buffer_(default_buffer_size) {}
+
+  executor_type get_executor() { return stream_.get_executor(); }
+
+  next_layer_type& next_layer() { return stream_; }
+  const next_layer_type& next_layer() const { return stream_; }
+
+  /**
+   * @brief Close the underlying transport, aborting outstanding operations
+   * */
+  void close() {
+    asio::error_code ignored;
+    stream_.lowest_layer().close(ignored);
+  }
+
+  /**
+   * @brief Frames announcing a larger payload fail with
+   * asio::error::message_size
+   * */
+  void max_frame_size(std::size_t size) { max_frame_size_ = size; }
+  [[nodiscard]] std::size_t max_frame_size() const { return max_frame_size_; }
+
+  /**
+   * @brief After each read completes, keep reading without blocking until
+   * the socket would block, the buffer is full, or budget bytes have been
+   * taken, 0 (the default) turns draining off
+   *
+   * A busy connection then hands over several frames per reactor wakeup.
+   * The budget keeps one connection from starving the rest. Draining puts
+   * the socket in non-blocking mode, and only applies to streams with
+   * synchronous non-blocking reads such as plain sockets.
+   * */
+  void drain(std::size_t budget) { drain_budget_ = budget; }
+  [[nodiscard]] std::size_t drain() const { return drain_budget_; }
+
+  /**
+   * @brief Bytes read from the stream but not yet handed out as frames,
+   * e.g. to pass on with the connection in a garak::handoff_bundle
+   * */
+  [[nodiscard]] std::span<const std::byte> buffered() const {
+    return {buffer_.data() + head_, tail_ - head_};
+  }
+
+  /**
+   * @brief Put bytes in front of what is read from the stream next, e.g.
+   * those another process had buffered before handing the connection over
+   * */
+  void unread(std::span<const std::byte> bytes) {
+    if (bytes.empty()) {
+      return;
+    }
+    reserve(tail_ - head_ + bytes.size());
+    std::memmove(buffer_.data() + head_ + bytes.size(),
+                 buffer_.data() + head_, tail_ - head_);
+    std::memcpy(buffer_.data() + head_, bytes.data(), bytes.size());
+    tail_ += bytes.size();
+  }
+
+  /**
+   * @brief Read the next frame
+   *
+   * Completion signature `void(asio::error_code, std::span<const std::byte>)`
+   * */
+  template <typename CompletionToken>
+  auto async_read_frame(CompletionToken&& token) {
+    return asio::async_compose<CompletionToken,
+                               void(asio::error_code,
+                                    std::span<const std::byte>)>(
+        read_frame_op{this}, token, stream_);
+  }
+
+  /**
+   * @brief Write payload as a single frame, the header and payload go out in
+   * one gathered write
+   *
+   * Completion signature `void(asio::error_code, std::size_t)`, the size is
+   * the payload length.
+   * */
+  template <typename ConstBufferSequence, typename CompletionToken>
+  auto async_write_frame(const ConstBufferSequence& payload,
+                         CompletionToken&& token) {
+    const auto length = asio::buffer_size(payload);
+    encode_header(write_header_, length);
+    gather_.clear();
+    gather_.emplace_back(asio::buffer(write_header_));
+    for (auto it = asio::buffer_sequence_begin(payload);
+         it != asio::buffer_sequence_end(payload); ++it) {
+      gather_.emplace_back(*it);
+    }
+    return asio::async_compose<CompletionToken,
+                               void(asio::error_code, std::size_t)>(
+        write_frame_op{this, length}, token, stream_);
+  }
+
+  /**
+   * @brief Encode a frame header for length into out
+   * */
+  static void encode_header(std::array<std::byte, header_size>& out,
+                            std::size_t length) {
+    const auto value = static_cast<std::uint32_t>(length);
+    for (std::size_t i = 0; i < header_size; ++i) {
+      out[i] = static_cast<std::byte>((value >> (8U * i)) & 0xFFU);
+    }
+  }
+
+  /**
+   * @brief Decode the frame header at the start of in
+   * */
+  static std::size_t decode_header(const std::byte* in) {
+    std::uint32_t value = 0;
+    for (std::size_t i = 0; i < header_size; ++i) {
+      value |= static_cast<std::uint32_t>(std::to_integer<std::uint8_t>(in[i]))
+               << (8U * i);
+    }
+    return value;
+  }
+
+ private:
+  struct read_frame_op {
+    enum class state { start, reading, posted };
+
+    framed_stream* owner;
+    state current{state::start};
+    asio::error_code result{};
+    std::span<const std::byte> frame{};
+
+    template <typename Self>
+    void operator()(Self& self, asio::error_code ec = {},
+                    std::size_t transferred = 0) {
+      auto& f = *owner;
+      if (current == state::posted) {
+        self.complete(result, frame);
+        return;
+      }
+      if (current == state::reading) {
+        if (ec) {
+          self.complete(ec, {});
+          return;
+        }
+        f.tail_ += transferred;
+        f.drain_socket();
+      }
+
+      if (f.parse(frame, result)) {
+        if (current == state::start) {
+          // Never complete from inside the initiating function
+          current = state::posted;
+          asio::post(std::move(self));
+          return;
+        }
+        self.complete(result, frame);
+        return;
+      }
+
+      current = state::reading;
+      f.stream_.async_read_some(
+          asio::buffer(f.buffer_.data() + f.tail_, f.buffer_.size() - f.tail_),
+          std::move(self));
+    }
+  };
+
+  struct write_frame_op {
+    framed_stream* owner;
+    std::size_t length;
+    bool started{false};
+
+    template <typename Self>
+    void operator()(Self& self, asio::error_code ec = {},
+                    std::size_t /*transferred*/ = 0) {
+      if (!started) {
+        started = true;
+        asio::async_write(owner->stream_, owner->gather_, std::move(self));
+        return;
+      }
+      self.complete(ec, ec ? 0 : length);
+    }
+  };
+
+  // Pop the next complete frame out of the buffer, or make room to read it
+  bool parse(std::span<const std::byte>& frame, asio::error_code& ec) {
+    const auto available = tail_ - head_;
+    if (available < header_size) {
+      reserve(header_size);
+      return false;
+    }
+    const auto length = decode_header(buffer_.data() + head_);
+    if (length > max_frame_size_) {
+      ec = asio::error::message_size;
+      return true;
+    }
+    if (available < header_size + length) {
+      reserve(header_size + length);
+      return false;
+    }
+    frame = {buffer_.data() + head_ + header_size, length};
+    head_ += header_size + length;
+    return true;
+  }
+
+  // Read whatever else is already queued on the socket, within the budget
+  void drain_socket() {
+    if constexpr (requires(Stream& s, asio::error_code& ec) {
+                    s.non_blocking(true, ec);
+                    s.read_some(asio::mutable_buffer{}, ec);
+                  }) {
+      if (drain_budget_ == 0) {
+        return;
+      }
+      asio::error_code ec;
+      if (!stream_.non_blocking()) {
+        stream_.non_blocking(true, ec);
+      }
+      std::size_t drained = 0;
+      while (!ec && drained < drain_budget_ && tail_ < buffer_.size()) {
+        const auto n = stream_.read_some(
+            asio::buffer(buffer_.data() + tail_,
+                         std::min(buffer_.size() - tail_,
+                                  drain_budget_ - drained)),
+            ec);
+        tail_ += n;
+        drained += n;
+      }
+      // Errors other than would_block come back from the next async read
+    }
+  }
+
+  // Make room behind the unread bytes for `needed` bytes from head_
+  void reserve(std::size_t needed) {
+    if (head_ == tail_) {
+      head_ = tail_ = 0;
+    }
+    if (buffer_.size() - head_ >= needed) {
+      return;
+    }
+    std::memmove(buffer_.data(), buffer_.data() + head_, tail_ - head_);
+    tail_ -= head_;
+    head_ = 0;
+    if (buffer_.size() < needed) {
+      buffer_.resize(std::max(needed, buffer_.size() * 2));
+    }
+  }
+
+  Stream stream_;
+  std::vector<std::byte> buffer_;
+  std::size_t head_{0};
+  std::size_t tail_{0};
+  std::size_t max_frame_size_{default_max_frame_size};
+  std::size_t drain_budget_{0};
+  std::array<std::byte, header_size> write_header_{};
+  std::vector<asio::const_buffer> gather_;
+};
+}  // namespace garak
+
+#endif
@@ -0,0 +1,213 @@
+#ifndef GARAK_HANDLER_TRACKING_HPP
+#define GARAK_HANDLER_TRACKING_HPP
+
+/**
+ * @file garak/handler_tracking.hpp
+ * @brief asio handler tracking hooks that record into garak::tracing
+ * @date 2026-10-19
+ *
+ * A drop-in for asio's text handler_tracking, selected with
+ * `ASIO_CUSTOM_HANDLER_TRACKING="garak/handler_tracking.hpp"`, which
+ * -DGARAK_ENABLE_TRACING=ON defines for everything linking asio. The
+ * macro changes the layout of asio's operations, so it must be the same
+ * in every translation unit of a program.
+ */
+
+#include <cstdint>
+#include <garak/tracing.hpp>
+#include <type_traits>
+
+namespace garak::tracing {
+/**
+ * @brief The hooks asio calls, mirroring asio::detail::handler_tracking
+ * */
+struct handler_hooks {
+  /**
+   * @brief Base of every asio operation, carries the handler's id
+   * */
+  class tracked_handler {
+   protected:
+    tracked_handler() = default;
+    ~tracked_handler() = default;
+
+   private:
+    friend struct handler_hooks;
+    std::uint64_t id_{0};
+  };
+
+  static void init() {
+    // Pin the calibration start before the first handler runs
+    detail::get_registry();
+  }
+
+  /**
+   * @brief Names the initiating function for handlers created in scope
+   * */
+  class location {
+   public:
+    location(const char* /*file*/, int /*line*/, const char* function)
+        : previous_(detail::current_location) {
+      detail::current_location = function;
+    }
+    ~location() { detail::current_location = previous_; }
+
+    location(const location&) = delete;
+    location& operator=(const location&) = delete;
+
+   private:
+    const char* previous_;
+  };
+
+  template <typename Context>
+  static void creation(Context& /*context*/, tracked_handler& h,
+                       const char* object_type, void* /*object*/,
+                       std::uintmax_t native_handle, const char* op_name) {
+    h.id_ = next_id();
+    record(event_kind::creation, h.id_, detail::current_handler,
+           native_handle, object_type, op_name, detail::current_location);
+  }
+
+  /**
+   * @brief Brackets a handler's invocation, and notes handlers destroyed
+   * without ever running
+   * */
+  class completion {
+   public:
+    explicit completion(const tracked_handler& h) : id_(h.id_) {}
+
+    ~completion() {
+      if (!invoked_) {
+        record(event_kind::abandoned, id_);
+      } else if (running_) {
+        // Unwinding out of the handler
+        invocation_end();
+      }
+    }
+
+    completion(const completion&) = delete;
+    completion& operator=(const completion&) = delete;
+
+    void invocation_begin() { begin(0, 0); }
+
+    template <typename ErrorCode>
+    void invocation_begin(const ErrorCode& ec) {
+      begin(code(ec), 0);
+    }
+
+    template <typename ErrorCode, typename Arg>
+    void invocation_begin(const ErrorCode& ec, const Arg& arg) {
+      if constexpr (std::is_integral_v<Arg>) {
+        begin(code(ec), static_cast<std::uint64_t>(arg));
+      } else {
+        begin(code(ec), 0);
+      }
+    }
+
+    void invocation_end() {
+      record(event_kind::invocation_end, id_);
+      detail::current_handler = parent_;
+      running_ = false;
+    }
+
+   private:
+    void begin(std::uint64_t ec, std::uint64_t extra) {
+      record(event_kind::invocation_begin, id_, ec, extra);
+      parent_ = detail::current_handler;
+      detail::current_handler = id_;
+      invoked_ = true;
+      running_ = true;
+    }
+
+    std::uint64_t id_;
+    std::uint64_t parent_{0};
+    bool invoked_{false};
+    bool running_{false};
+  };
+
+  template <typename Context>
+  static void operation(Context& /*context*/, const char* object_type,
+                        void* /*object*/, std::uintmax_t native_handle,
+                        const char* op_name) {
+    record(event_kind::operation, 0, detail::current_handler, native_handle,
+           object_type, op_name, detail::current_location);
+  }
+
+  template <typename Context>
+  static void reactor_registration(Context& /*context*/,
+                                   std::uintmax_t native_handle,
+                                   std::uintmax_t registration) {
+    record(event_kind::reactor_registration, 0, registration, native_handle);
+  }
+
+  template <typename Context>
+  static void reactor_deregistration(Context& /*context*/,
+                                     std::uintmax_t native_handle,
+                                     std::uintmax_t registration) {
+    record(event_kind::reactor_deregistration, 0, registration,
+           native_handle);
+  }
+
+  template <typename Context>
+  static void reactor_events(Context& /*context*/,
+                             std::uintmax_t registration, unsigned events) {
+    record(event_kind::reactor_events, 0, registration, events);
+  }
+
+  template <typename ErrorCode>
+  static void reactor_operation(const tracked_handler& h, const char* op_name,
+                                const ErrorCode& ec,
+                                std::size_t bytes_transferred = 0) {
+    record(event_kind::reactor_operation, h.id_, code(ec), bytes_transferred,
+           nullptr, op_name);
+  }
+
+ private:
+  template <typename ErrorCode>
+  static std::uint64_t code(const ErrorCode& ec) {
+    return static_cast<std::uint32_t>(ec.value());
+  }
+};
+}  // namespace garak::tracing
+
+#define ASIO_INHERIT_TRACKED_HANDLER \
+  : public garak::tracing::handler_hooks::tracked_handler
+
+#define ASIO_ALSO_INHERIT_TRACKED_HANDLER \
+  , public garak::tracing::handler_hooks::tracked_handler
+
+#define ASIO_HANDLER_TRACKING_INIT garak::tracing::handler_hooks::init()
+
+#define ASIO_HANDLER_LOCATION(args) \
+  garak::tracing::handler_hooks::location tracked_location args
+
+#define ASIO_HANDLER_CREATION(args) \
+  garak::tracing::handler_hooks::creation args
+
+#define ASIO_HANDLER_COMPLETION(args) \
+  garak::tracing::handler_hooks::completion tracked_completion args
+
+#define ASIO_HANDLER_INVOCATION_BEGIN(args) \
+  tracked_completion.invocation_begin args
+
+#define ASIO_HANDLER_INVOCATION_END tracked_completion.invocation_end()
+
+#define ASIO_HANDLER_OPERATION(args) \
+  garak::tracing::handler_hooks::operation args
+
+#define ASIO_HANDLER_REACTOR_REGISTRATION(args) \
+  garak::tracing::handler_hooks::reactor_registration args
+
+#define ASIO_HANDLER_REACTOR_DEREGISTRATION(args) \
+  garak::tracing::handler_hooks::reactor_deregistration args
+
+#define ASIO_HANDLER_REACTOR_READ_EVENT 1
+#define ASIO_HANDLER_REACTOR_WRITE_EVENT 2
+#define ASIO_HANDLER_REACTOR_ERROR_EVENT 4
+
+#define ASIO_HANDLER_REACTOR_EVENTS(args) \
+  garak::tracing::handler_hooks::reactor_events args
+
+#define ASIO_HANDLER_REACTOR_OPERATION(args) \
+  garak::tracing::handler_hooks::reactor_operation args
+
+#endif
@@ -0,0 +1,377 @@
+#ifndef GARAK_HANDOFF_HPP
+#define GARAK_HANDOFF_HPP
+
+/**
+ * @file garak/handoff.hpp
+ * @brief Handing listening sockets and live connections to another process
+ * @date 2026-10-19
+ *
+ * Restarting a server by closing its sockets drops every connection, and
+ * the clients all reconnect at once. Instead the old process collects its
+ * listeners, and optionally its connections along with the bytes it had
+ * read but not yet handled, in a handoff_bundle and sends them over a unix
+ * socket to its replacement, which picks them up and carries on:
+ *
+ * @code
+ * // old process
+ * garak::handoff_bundle bundle;
+ * bundle.add_listener("http", acceptor);
+ * bundle.add_connection("conn-7", stream.next_layer(), stream.buffered());
+ * co_await garak::async_send_handoff(unix_socket, std::move(bundle),
+ *                                    asio::use_awaitable);
+ * acceptor.close();  // close, never shutdown(), our copies
+ *
+ * // new process
+ * auto bundle = co_await garak::async_receive_handoff(unix_socket,
+ *                                                     asio::use_awaitable);
+ * bundle.take_listener("http", acceptor, ec);
+ * @endcode
+ *
+ * Both processes hold the listening socket until the old one closes its
+ * copy, so no connection attempt is refused in between.
+ */
+
+#include <fcntl.h>
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <array>
+#include <asio/async_result.hpp>
+#include <asio/buffer.hpp>
+#include <asio/compose.hpp>
+#include <asio/error.hpp>
+#include <asio/read.hpp>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <garak/fd_passing.hpp>
+#include <iterator>
+#include <memory>
+#include <span>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+namespace garak {
+/**
+ * @brief What a handoff_item carries
+ * */
+enum class handoff_kind : std::uint8_t {
+  listener = 1,
+  connection = 2,
+};
+
+/**
+ * @brief One socket in a handoff_bundle
+ * */
+struct handoff_item {
+  handoff_kind kind{handoff_kind::listener};
+  std::string name;
+  unique_fd fd;
+  /// For connections, bytes read from the socket but not yet handled
+  std::vector<std::byte> unread;
+};
+
+/**
+ * @brief Named sockets to hand from one process to another
+ *
+ * The bundle holds duplicates of the descriptors, so the sockets added stay
+ * usable (and must be closed) by their owner.
+ * */
+class handoff_bundle {
+ public:
+  /**
+   * @brief Add a listening socket
+   * */
+  template <typename Acceptor>
+  void add_listener(std::string name, Acceptor& acceptor) {
+    add(handoff_kind::listener, std::move(name), acceptor.native_handle(),
+        {});
+  }
+
+  /**
+   * @brief Add a connected socket, with the bytes already read from it
+   * that the new owner should see first
+   * */
+  template <typename Socket>
+  void add_connection(std::string name, Socket& socket,
+                      std::span<const std::byte> unread = {}) {
+    add(handoff_kind::connection, std::move(name), socket.native_handle(),
+        unread);
+  }
+
+  /**
+   * @brief Open acceptor on the listening socket called name
+   *
+   * @returns false with asio::error::not_found if there is none
+   * */
+  template <typename Acceptor>
+  bool take_listener(const std::string& name, Acceptor& acceptor,
+                     asio::error_code& ec) {
+    auto item = take(handoff_kind::listener, name, ec);
+    return item && assign<typename Acceptor::endpoint_type>(
+                       acceptor, std::move(item->fd), ec);
+  }
+
+  /**
+   * @brief Open socket on the connection called name, and hand over the
+   * bytes the previous owner had buffered, e.g. for
+   * garak::framed_stream::unread()
+   *
+   * @returns false with asio::error::not_found if there is none
+   * */
+  template <typename Socket>
+  bool take_connection(const std::string& name, Socket& socket,
+                       std::vector<std::byte>& unread, asio::error_code& ec) {
+    auto item = take(handoff_kind::connection, name, ec);
+    if (!item) {
+      return false;
+    }
+    unread = std::move(item->unread);
+    return assign<typename Socket::endpoint_type>(socket, std::move(item->fd),
+                                                  ec);
+  }
+
+  [[nodiscard]] const std::vector<handoff_item>& items() const {
+    return items_;
+  }
+  std::vector<handoff_item>& items() { return items_; }
+
+ private:
+  void add(handoff_kind kind, std::string name, int fd,
+           std::span<const std::byte> unread) {
+    unique_fd copy{::fcntl(fd, F_DUPFD_CLOEXEC, 0)};
+    if (!copy) {
+      throw std::system_error(errno, std::system_category(),
+                              "handoff_bundle: dup failed");
+    }
+    items_.push_back(handoff_item{kind, std::move(name), std::move(copy),
+                                  {unread.begin(), unread.end()}});
+  }
+
+  std::unique_ptr<handoff_item> take(handoff_kind kind,
+                                     const std::string& name,
+                                     asio::error_code& ec) {
+    const auto it =
+        std::find_if(items_.begin(), items_.end(), [&](const auto& item) {
+          return item.kind == kind && item.name == name;
+        });
+    if (it == items_.end()) {
+      ec = asio::error::not_found;
+      return nullptr;
+    }
+    auto item = std::make_unique<handoff_item>(std::move(*it));
+    items_.erase(it);
+    return item;
+  }
+
+  // Assign fd to io_object, with the protocol the socket was opened with
+  template <typename Endpoint, typename IoObject>
+  static bool assign(IoObject& io_object, unique_fd fd, asio::error_code& ec) {
+    Endpoint endpoint;
+    auto length = static_cast<socklen_t>(endpoint.capacity());
+    if (::getsockname(fd.get(), endpoint.data(), &length) != 0) {
+      ec = asio::error_code(errno, asio::system_category());
+      return false;
+    }
+    endpoint.resize(length);
+    io_object.assign(endpoint.protocol(), fd.get(), ec);
+    if (ec) {
+      return false;
+    }
+    fd.release();
+    return true;
+  }
+
+  std::vector<handoff_item> items_;
+};
+
+namespace detail {
+/**
+ * @brief Precedes each item on the wire, the item's descriptor rides with
+ * its first byte; a header with kind 0 ends the bundle
+ * */
+struct handoff_header {
+  static constexpr std::uint32_t expected_magic = 0x67726b68;  // "grkh"
+  static constexpr std::size_t max_body = 64 * 1024 * 1024;
+
+  std::uint32_t magic{expected_magic};
+  std::uint8_t kind{0};
+  std::array<std::uint8_t, 3> reserved{};
+  std::uint32_t name_size{0};
+  std::uint32_t unread_size{0};
+};
+
+template <typename Socket>
+struct send_handoff_op {
+  struct state {
+    handoff_bundle bundle;
+    std::vector<std::byte> message;
+    std::size_t next{0};
+  };
+
+  Socket& socket;
+  std::unique_ptr<state> s;
+
+  template <typename Self>
+  void operator()(Self& self, asio::error_code ec = {},
+                  std::size_t /*sent*/ = 0) {
+    auto& items = s->bundle.items();
+    if (ec || s->next > items.size()) {
+      self.complete(ec);
+      return;
+    }
+    handoff_header header;
+    std::span<const int> fds;
+    int fd = -1;
+    if (s->next < items.size()) {
+      const auto& item = items[s->next];
+      header.kind = static_cast<std::uint8_t>(item.kind);
+      header.name_size = static_cast<std::uint32_t>(item.name.size());
+      header.unread_size = static_cast<std::uint32_t>(item.unread.size());
+      fd = item.fd.get();
+      fds = {&fd, 1};
+    }
+    auto& message = s->message;
+    message.resize(sizeof(header));
+    std::memcpy(message.data(), &header, sizeof(header));
+    if (s->next < items.size()) {
+      const auto& item = items[s->next];
+      const auto* name = reinterpret_cast<const std::byte*>(item.name.data());
+      message.insert(message.end(), name, name + item.name.size());
+      message.insert(message.end(), item.unread.begin(), item.unread.end());
+    }
+    ++s->next;
+    async_send_fds(socket, asio::buffer(message), fds, std::move(self));
+  }
+};
+
+template <typename Socket>
+struct receive_handoff_op {
+  struct state {
+    handoff_bundle bundle;
+    handoff_header header;
+    std::size_t header_bytes{0};
+    std::vector<unique_fd> fds;
+    std::vector<std::byte> body;
+  };
+
+  enum class stage { start, header, body };
+
+  Socket& socket;
+  std::unique_ptr<state> s;
+  stage at{stage::start};
+
+  template <typename Self>
+  void operator()(Self& self, asio::error_code ec = {}, std::size_t n = 0,
+                  std::vector<unique_fd> fds = {}) {
+    if (ec) {
+      self.complete(ec, handoff_bundle{});
+      return;
+    }
+    switch (at) {
+      case stage::start:
+        break;
+      case stage::header:
+        s->header_bytes += n;
+        std::move(fds.begin(), fds.end(), std::back_inserter(s->fds));
+        if (s->header_bytes < sizeof(handoff_header)) {
+          break;
+        }
+        if (!parsed(ec)) {
+          self.complete(ec, handoff_bundle{});
+          return;
+        }
+        if (s->header.kind == 0) {
+          self.complete({}, std::move(s->bundle));
+          return;
+        }
+        if (!s->body.empty()) {
+          at = stage::body;
+          asio::async_read(socket, asio::buffer(s->body), std::move(self));
+          return;
+        }
+        add_item();
+        break;
+      case stage::body:
+        add_item();
+        break;
+    }
+    at = stage::header;
+    auto* header = reinterpret_cast<std::byte*>(&s->header);
+    async_receive_fds(
+        socket,
+        asio::buffer(header + s->header_bytes,
+                     sizeof(handoff_header) - s->header_bytes),
+        std::move(self));
+  }
+
+  // Check a complete header, and size the body it announces
+  bool parsed(asio::error_code& ec) {
+    const auto& header = s->header;
+    const bool end = header.kind == 0;
+    const bool known =
+        end ||
+        header.kind == static_cast<std::uint8_t>(handoff_kind::listener) ||
+        header.kind == static_cast<std::uint8_t>(handoff_kind::connection);
+    const auto body =
+        std::size_t{header.name_size} + std::size_t{header.unread_size};
+    if (header.magic != handoff_header::expected_magic || !known ||
+        s->fds.size() != (end ? 0U : 1U) || body > handoff_header::max_body) {
+      ec = asio::error::invalid_argument;
+      return false;
+    }
+    s->body.resize(body);
+    return true;
+  }
+
+  void add_item() {
+    const auto& header = s->header;
+    const auto* body = reinterpret_cast<const char*>(s->body.data());
+    s->bundle.items().push_back(handoff_item{
+        static_cast<handoff_kind>(header.kind),
+        std::string(body, header.name_size), std::move(s->fds.front()),
+        {s->body.begin() + header.name_size, s->body.end()}});
+    s->fds.clear();
+    s->body.clear();
+    s->header_bytes = 0;
+  }
+};
+}  // namespace detail
+
+/**
+ * @brief Send bundle over socket, a unix socket connected to a process
+ * running garak::async_receive_handoff()
+ *
+ * Completion signature `void(asio::error_code)`. Once it succeeds the
+ * receiver holds its own descriptors for the sockets, and the sender
+ * should close its copies without shutting them down.
+ * */
+template <typename Socket, typename CompletionToken>
+auto async_send_handoff(Socket& socket, handoff_bundle bundle,
+                        CompletionToken&& token) {
+  using op = detail::send_handoff_op<Socket>;
+  auto state = std::make_unique<typename op::state>();
+  state->bundle = std::move(bundle);
+  return asio::async_compose<CompletionToken, void(asio::error_code)>(
+      op{socket, std::move(state)}, token, socket);
+}
+
+/**
+ * @brief Receive a handoff_bundle sent with garak::async_send_handoff()
+ *
+ * Completion signature `void(asio::error_code, garak::handoff_bundle)`,
+ * fails with asio::error::invalid_argument if what arrives isn't a bundle.
+ * */
+template <typename Socket, typename CompletionToken>
+auto async_receive_handoff(Socket& socket, CompletionToken&& token) {
+  using op = detail::receive_handoff_op<Socket>;
+  return asio::async_compose<CompletionToken,
+                             void(asio::error_code, handoff_bundle)>(
+      op{socket, std::make_unique<typename op::state>()}, token, socket);
+}
+}  // namespace garak
+
+#endif
@@ -0,0 +1,258 @@
+#ifndef GARAK_HDR_HISTOGRAM_HPP
+#define GARAK_HDR_HISTOGRAM_HPP
+
+/**
+ * @file garak/hdr_histogram.hpp
+ * @brief A High Dynamic Range histogram for latency recording
+ * @date 2026-10-19
+ *
+ * Follows Gil Tene's HdrHistogram: values are kept to a fixed number of
+ * significant decimal digits across the whole trackable range, in
+ * logarithmic buckets of linear sub-buckets. Recording is a couple of
+ * shifts and an increment, and percentiles stay exact to the configured
+ * precision however skewed the distribution.
+ */
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+namespace garak {
+/**
+ * @brief Counts of values between 1 and highest, kept to a given number of
+ * significant digits
+ *
+ * @code
+ * garak::hdr_histogram latencies{std::chrono::microseconds(10s).count(), 3};
+ * latencies.record(elapsed_us);
+ * latencies.value_at_percentile(99.9);
+ * @endcode
+ *
+ * Values above highest are clamped to it. Not thread safe, keep one per
+ * thread and merge() them.
+ * */
+class hdr_histogram {
+ public:
+  /**
+   * @param highest the largest value to track, at least 2
+   * @param significant_digits precision kept, 1 to 5
+   * */
+  hdr_histogram(std::int64_t highest, int significant_digits)
+      : highest_(highest), digits_(significant_digits) {
+    if (highest < 2 || significant_digits < 1 || significant_digits > 5) {
+      throw std::invalid_argument("hdr_histogram: bad range or precision");
+    }
+    // Enough sub-buckets that neighbours differ by one unit in the last
+    // significant digit
+    const auto largest_single_unit =
+        2 * static_cast<std::int64_t>(std::pow(10, significant_digits));
+    const int magnitude = static_cast<int>(
+        std::ceil(std::log2(static_cast<double>(largest_single_unit))));
+    sub_bucket_half_count_magnitude_ = std::max(magnitude, 1) - 1;
+    sub_bucket_count_ = std::int64_t{1} << (sub_bucket_half_count_magnitude_ + 1);
+    sub_bucket_half_count_ = sub_bucket_count_ / 2;
+    sub_bucket_mask_ = sub_bucket_count_ - 1;
+
+    int buckets = 1;
+    for (std::int64_t untrackable = sub_bucket_count_; untrackable <= highest;
+         untrackable <<= 1) {
+      ++buckets;
+      if (untrackable > std::numeric_limits<std::int64_t>::max() / 2) {
+        break;
+      }
+    }
+    counts_.assign(
+        static_cast<std::size_t>((buckets + 1) * sub_bucket_half_count_), 0);
+  }
+
+  /**
+   * @brief Count value count times
+   * */
+  void record(std::int64_t value, std::int64_t count = 1) {
+    value = std::clamp<std::int64_t>(value, 0, highest_);
+    counts_[index_of(value)] += count;
+    total_ += count;
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+  }
+
+  /**
+   * @brief Record value, and back-fill the samples a stalled closed loop
+   * client failed to take every expected_interval while waiting for it
+   *
+   * Open loop clients that measure from the intended send time don't need
+   * this, their samples are already corrected for coordinated omission.
+   * */
+  void record_corrected(std::int64_t value, std::int64_t expected_interval) {
+    record(value);
+    if (expected_interval <= 0) {
+      return;
+    }
+    for (std::int64_t missing = value - expected_interval;
+         missing >= expected_interval; missing -= expected_interval) {
+      record(missing);
+    }
+  }
+
+  /**
+   * @brief Add other's counts, which must have the same range and precision
+   * */
+  void merge(const hdr_histogram& other) {
+    if (other.counts_.size() != counts_.size() ||
+        other.digits_ != digits_) {
+      throw std::invalid_argument("hdr_histogram: merging unlike histograms");
+    }
+    for (std::size_t i = 0; i < counts_.size(); ++i) {
+      counts_[i] += other.counts_[i];
+    }
+    total_ += other.total_;
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+  }
+
+  void reset() {
+    std::fill(counts_.begin(), counts_.end(), 0);
+    total_ = 0;
+    min_ = std::numeric_limits<std::int64_t>::max();
+    max_ = 0;
+  }
+
+  [[nodiscard]] std::int64_t total_count() const { return total_; }
+  [[nodiscard]] std::int64_t min() const { return total_ == 0 ? 0 : min_; }
+  [[nodiscard]] std::int64_t max() const { return max_; }
+  [[nodiscard]] std::int64_t highest_trackable() const { return highest_; }
+  [[nodiscard]] int significant_digits() const { return digits_; }
+
+  [[nodiscard]] double mean() const {
+    if (total_ == 0) {
+      return 0.0;
+    }
+    double sum = 0.0;
+    for (std::size_t i = 0; i < counts_.size(); ++i) {
+      if (counts_[i] != 0) {
+        sum += static_cast<double>(counts_[i]) *
+               static_cast<double>(median_equivalent(value_at_index(i)));
+      }
+    }
+    return sum / static_cast<double>(total_);
+  }
+
+  /**
+   * @brief The value at or below which percentile percent of the recorded
+   * values fall, reported as the highest value equivalent to it
+   * */
+  [[nodiscard]] std::int64_t value_at_percentile(double percentile) const {
+    if (total_ == 0) {
+      return 0;
+    }
+    const double fraction = std::clamp(percentile, 0.0, 100.0) / 100.0;
+    const auto wanted = std::max<std::int64_t>(
+        1, static_cast<std::int64_t>(
+               std::ceil(fraction * static_cast<double>(total_))));
+    std::int64_t seen = 0;
+    for (std::size_t i = 0; i < counts_.size(); ++i) {
+      seen += counts_[i];
+      if (seen >= wanted) {
+        return std::min(highest_equivalent(value_at_index(i)), max_);
+      }
+    }
+    return max_;
+  }
+
+  /**
+   * @brief Calls visit(value, percentile, count_so_far) at each distinct
+   * recorded value, lowest first, for printing a percentile distribution
+   * */
+  template <typename Visitor>
+  void for_each_value(Visitor visit) const {
+    std::int64_t seen = 0;
+    for (std::size_t i = 0; i < counts_.size(); ++i) {
+      if (counts_[i] == 0) {
+        continue;
+      }
+      seen += counts_[i];
+      visit(std::min(highest_equivalent(value_at_index(i)), max_),
+            100.0 * static_cast<double>(seen) / static_cast<double>(total_),
+            seen);
+    }
+  }
+
+  /**
+   * @brief The smallest value counted together with value
+   * */
+  [[nodiscard]] std::int64_t lowest_equivalent(std::int64_t value) const {
+    const int bucket = bucket_index(value);
+    return sub_bucket_index(value, bucket) << bucket;
+  }
+
+  /**
+   * @brief The largest value counted together with value
+   * */
+  [[nodiscard]] std::int64_t highest_equivalent(std::int64_t value) const {
+    return lowest_equivalent(value) + equivalent_range(value) - 1;
+  }
+
+ private:
+  [[nodiscard]] int bucket_index(std::int64_t value) const {
+    // Position of the highest set bit, with everything under the first
+    // bucket's sub-bucket count in bucket 0
+    const int pow2_ceiling = 64 - std::countl_zero(static_cast<std::uint64_t>(
+                                      value | sub_bucket_mask_));
+    return pow2_ceiling - (sub_bucket_half_count_magnitude_ + 1);
+  }
+
+  [[nodiscard]] static std::int64_t sub_bucket_index(std::int64_t value,
+                                                     int bucket) {
+    return value >> bucket;
+  }
+
+  [[nodiscard]] std::size_t index_of(std::int64_t value) const {
+    const int bucket = bucket_index(value);
+    const auto sub_bucket = sub_bucket_index(value, bucket);
+    const auto base = static_cast<std::int64_t>(bucket + 1)
+                      << sub_bucket_half_count_magnitude_;
+    return static_cast<std::size_t>(base + sub_bucket -
+                                    sub_bucket_half_count_);
+  }
+
+  [[nodiscard]] std::int64_t value_at_index(std::size_t index) const {
+    const auto i = static_cast<std::int64_t>(index);
+    auto bucket = (i >> sub_bucket_half_count_magnitude_) - 1;
+    auto sub_bucket = (i & (sub_bucket_half_count_ - 1)) + sub_bucket_half_count_;
+    if (bucket < 0) {
+      sub_bucket -= sub_bucket_half_count_;
+      bucket = 0;
+    }
+    return sub_bucket << bucket;
+  }
+
+  [[nodiscard]] std::int64_t equivalent_range(std::int64_t value) const {
+    const int bucket = bucket_index(value);
+    const auto sub_bucket = sub_bucket_index(value, bucket);
+    return std::int64_t{1}
+           << (sub_bucket >= sub_bucket_count_ ? bucket + 1 : bucket);
+  }
+
+  [[nodiscard]] std::int64_t median_equivalent(std::int64_t value) const {
+    return lowest_equivalent(value) + equivalent_range(value) / 2;
+  }
+
+  std::int64_t highest_;
+  int digits_;
+  int sub_bucket_half_count_magnitude_{0};
+  std::int64_t sub_bucket_count_{0};
+  std::int64_t sub_bucket_half_count_{0};
+  std::int64_t sub_bucket_mask_{0};
+  std::vector<std::int64_t> counts_;
+  std::int64_t total_{0};
+  std::int64_t min_{std::numeric_limits<std::int64_t>::max()};
+  std::int64_t max_{0};
+};
+}  // namespace garak
+
+#endif
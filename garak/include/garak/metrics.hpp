@@ -0,0 +1,317 @@
+#ifndef GARAK_METRICS_HPP
+#define GARAK_METRICS_HPP
+
+/**
+ * @file garak/metrics.hpp
+ * @brief Opt-in scheduler metrics for an io_context
+ * @date 2026-10-19
+ *
+ * Reports how busy an io_context is: handlers run, the ready queue depth,
+ * outstanding work, how long handlers take, how long they wait in the
+ * queue, and how much time threads spend blocked waiting for events
+ * against running handlers. A hot io_context shows a growing queue depth
+ * and queue delay, a blocking handler shows up in the handler time tail.
+ *
+ * The bundled scheduler calls an observer as operations become ready and
+ * run, which costs one branch per operation when metrics are off. Turned
+ * on, each thread keeps its own relaxed counters and histograms, without
+ * locked instructions; stats() sums them.
+ */
+
+#include <algorithm>
+#include <array>
+#include <asio/detail/scheduler.hpp>
+#include <asio/io_context.hpp>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <garak/hdr_histogram.hpp>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace garak {
+namespace detail {
+/**
+ * @brief A log-linear histogram of nanoseconds, eight buckets per power of
+ * two (within 12.5%), updated by one thread and read by any
+ * */
+class atomic_histogram {
+ public:
+  static constexpr int sub_bucket_bits = 3;
+  static constexpr std::uint64_t sub_buckets = 1U << sub_bucket_bits;
+  // About 18 minutes, anything longer is clamped
+  static constexpr int max_exponent = 40;
+  static constexpr std::size_t bucket_count =
+      sub_buckets + (max_exponent - sub_bucket_bits) * sub_buckets;
+
+  /**
+   * @brief Count value, only from the owning thread
+   * */
+  void record(std::uint64_t value) {
+    auto& bucket = buckets_[index_of(value)];
+    bucket.store(bucket.load(std::memory_order_relaxed) + 1,
+                 std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Add the counts to out, each at the middle of its bucket
+   * */
+  void add_to(hdr_histogram& out) const {
+    for (std::size_t i = 0; i < bucket_count; ++i) {
+      const auto count = buckets_[i].load(std::memory_order_relaxed);
+      if (count != 0) {
+        out.record(static_cast<std::int64_t>(middle_of(i)),
+                   static_cast<std::int64_t>(count));
+      }
+    }
+  }
+
+  static std::size_t index_of(std::uint64_t value) {
+    if (value < sub_buckets) {
+      return value;
+    }
+    const int exponent = std::min(
+        static_cast<int>(std::bit_width(value)) - 1, max_exponent - 1);
+    const int shift = exponent - sub_bucket_bits;
+    const auto sub = std::min<std::uint64_t>(
+        (value >> shift) - sub_buckets, sub_buckets - 1);
+    return sub_buckets + static_cast<std::size_t>(shift) * sub_buckets +
+           static_cast<std::size_t>(sub);
+  }
+
+  static std::uint64_t middle_of(std::size_t index) {
+    if (index < sub_buckets) {
+      return index;
+    }
+    const auto shift = (index - sub_buckets) / sub_buckets;
+    const auto sub = (index - sub_buckets) % sub_buckets;
+    const auto width = std::uint64_t{1} << shift;
+    return ((sub_buckets + sub) << shift) + width / 2;
+  }
+
+ private:
+  std::array<std::atomic<std::uint64_t>, bucket_count> buckets_{};
+};
+
+/**
+ * @brief One thread's counters for one io_context, written by that thread
+ * only
+ * */
+struct scheduler_counters {
+  std::atomic<std::uint64_t> ready{0};
+  std::atomic<std::uint64_t> run{0};
+  std::atomic<std::uint64_t> busy_ns{0};
+  std::atomic<std::uint64_t> wait_ns{0};
+  atomic_histogram handler_ns;
+  atomic_histogram delay_ns;
+};
+
+// Single writer, so a plain add is enough and avoids a locked instruction
+inline void bump(std::atomic<std::uint64_t>& counter, std::uint64_t by) {
+  counter.store(counter.load(std::memory_order_relaxed) + by,
+                std::memory_order_relaxed);
+}
+}  // namespace detail
+
+/**
+ * @brief What an io_context's scheduler has been doing since metrics were
+ * enabled
+ * */
+struct scheduler_stats {
+  /// Since metrics were enabled
+  std::chrono::nanoseconds elapsed{0};
+  /// Operations that became ready to run
+  std::uint64_t handlers_ready{0};
+  /// Operations run, including reactor completions
+  std::uint64_t handlers_run{0};
+  /// Ready but not yet run
+  std::int64_t queue_depth{0};
+  /// Work keeping run() from returning, including pending I/O and timers
+  long outstanding_work{0};
+  /// Time spent running handlers
+  std::chrono::nanoseconds busy{0};
+  /// Time threads spent blocked in the reactor or idle waiting for work
+  std::chrono::nanoseconds waiting{0};
+  /// Handler execution time in nanoseconds
+  hdr_histogram handler_time{std::int64_t{1} << 40, 2};
+  /// Nanoseconds from an operation becoming ready to it starting
+  hdr_histogram queue_delay{std::int64_t{1} << 40, 2};
+
+  /**
+   * @brief Handlers run per second between earlier and this
+   * */
+  [[nodiscard]] double handlers_per_second(
+      const scheduler_stats& earlier) const {
+    const auto seconds =
+        std::chrono::duration<double>(elapsed - earlier.elapsed).count();
+    return seconds > 0 ? static_cast<double>(handlers_run -
+                                             earlier.handlers_run) /
+                             seconds
+                       : 0.0;
+  }
+
+  /**
+   * @brief Share of the time between earlier and this spent running
+   * handlers rather than waiting; near 1 with a growing queue means the
+   * io_context is saturated
+   * */
+  [[nodiscard]] double utilization(const scheduler_stats& earlier) const {
+    const auto busy_ns = static_cast<double>((busy - earlier.busy).count());
+    const auto wait_ns =
+        static_cast<double>((waiting - earlier.waiting).count());
+    return busy_ns + wait_ns > 0 ? busy_ns / (busy_ns + wait_ns) : 0.0;
+  }
+};
+
+/**
+ * @brief Collects scheduler_stats for one io_context, installed with
+ * garak::enable_metrics()
+ * */
+class scheduler_metrics
+    : public asio::detail::execution_context_service_base<scheduler_metrics>,
+      private asio::detail::scheduler::observer {
+ public:
+  explicit scheduler_metrics(asio::execution_context& ctx)
+      : asio::detail::execution_context_service_base<scheduler_metrics>(ctx),
+        scheduler_(asio::use_service<asio::detail::scheduler>(ctx)),
+        key_(next_key()),
+        start_(now()) {
+    scheduler_.set_observer(this);
+  }
+
+  ~scheduler_metrics() { scheduler_.set_observer(nullptr); }
+
+  scheduler_metrics(const scheduler_metrics&) = delete;
+  scheduler_metrics& operator=(const scheduler_metrics&) = delete;
+
+  /**
+   * @brief Sum every thread's counters, safe while the io_context runs
+   * */
+  [[nodiscard]] scheduler_stats stats() const {
+    scheduler_stats s;
+    s.elapsed = std::chrono::nanoseconds(now() - start_);
+    s.outstanding_work = scheduler_.outstanding_work();
+    std::uint64_t busy = 0;
+    std::uint64_t waiting = 0;
+    const std::lock_guard lock{mutex_};
+    for (const auto& c : threads_) {
+      constexpr auto relaxed = std::memory_order_relaxed;
+      s.handlers_ready += c->ready.load(relaxed);
+      s.handlers_run += c->run.load(relaxed);
+      busy += c->busy_ns.load(relaxed);
+      waiting += c->wait_ns.load(relaxed);
+      c->handler_ns.add_to(s.handler_time);
+      c->delay_ns.add_to(s.queue_delay);
+    }
+    s.queue_depth = static_cast<std::int64_t>(s.handlers_ready) -
+                    static_cast<std::int64_t>(s.handlers_run);
+    s.busy = std::chrono::nanoseconds(busy);
+    s.waiting = std::chrono::nanoseconds(waiting);
+    return s;
+  }
+
+ private:
+  void shutdown() override { scheduler_.set_observer(nullptr); }
+
+  static std::uint64_t now() {
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+  }
+
+  static std::uint64_t next_key() {
+    static std::atomic<std::uint64_t> keys{0};
+    return ++keys;
+  }
+
+  /**
+   * @brief This thread's counters, from a small per-thread cache so a
+   * thread posting across several io_contexts rarely takes the lock
+   * */
+  detail::scheduler_counters& local() {
+    struct entry {
+      std::uint64_t key{0};
+      detail::scheduler_counters* counters{nullptr};
+    };
+    thread_local std::array<entry, 4> cache{};
+    thread_local std::size_t victim{0};
+    for (const auto& e : cache) {
+      if (e.key == key_) {
+        return *e.counters;
+      }
+    }
+    auto* counters = register_thread();
+    cache[victim] = {key_, counters};
+    victim = (victim + 1) % cache.size();
+    return *counters;
+  }
+
+  detail::scheduler_counters* register_thread() {
+    const std::lock_guard lock{mutex_};
+    const auto self = std::this_thread::get_id();
+    for (std::size_t i = 0; i < owners_.size(); ++i) {
+      if (owners_[i] == self) {
+        return threads_[i].get();
+      }
+    }
+    owners_.push_back(self);
+    return threads_.emplace_back(std::make_unique<detail::scheduler_counters>())
+        .get();
+  }
+
+  std::uint64_t ready(std::size_t n) override {
+    detail::bump(local().ready, n);
+    return now();
+  }
+
+  std::uint64_t run_begin(std::uint64_t ready_at) override {
+    const auto started = now();
+    if (ready_at != 0) {
+      local().delay_ns.record(started - ready_at);
+    }
+    return started;
+  }
+
+  void run_end(std::uint64_t started) override {
+    const auto took = now() - started;
+    auto& c = local();
+    detail::bump(c.run, 1);
+    detail::bump(c.busy_ns, took);
+    c.handler_ns.record(took);
+  }
+
+  std::uint64_t wait_begin() override { return now(); }
+
+  void wait_end(std::uint64_t started) override {
+    detail::bump(local().wait_ns, now() - started);
+  }
+
+  asio::detail::scheduler& scheduler_;
+  const std::uint64_t key_;
+  const std::uint64_t start_;
+  mutable std::mutex mutex_;
+  std::vector<std::thread::id> owners_;
+  std::vector<std::unique_ptr<detail::scheduler_counters>> threads_;
+};
+
+/**
+ * @brief Start collecting scheduler metrics for ctx, before it runs
+ *
+ * @code
+ * auto& metrics = garak::enable_metrics(ctx);
+ * ...
+ * const auto stats = metrics.stats();
+ * stats.queue_delay.value_at_percentile(99);
+ * @endcode
+ * */
+inline scheduler_metrics& enable_metrics(asio::io_context& ctx) {
+  return asio::use_service<scheduler_metrics>(ctx);
+}
+}  // namespace garak
+
+#endif
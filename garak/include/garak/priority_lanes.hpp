@@ -0,0 +1,353 @@
+#ifndef GARAK_PRIORITY_LANES_HPP
+#define GARAK_PRIORITY_LANES_HPP
+
+/**
+ * @file garak/priority_lanes.hpp
+ * @brief Priority lanes for an io_context's handlers, so control traffic
+ * overtakes bulk data
+ * @date 2026-10-19
+ *
+ * The scheduler runs ready handlers in the order they became ready, so a
+ * heartbeat completing behind a thousand bulk transfer completions waits
+ * for all of them, and times out under load it should shrug off. Binding
+ * handlers to a lane's executor queues them by priority instead:
+ *
+ * @code
+ * auto& lanes = garak::enable_priority_lanes(ctx);  // lane 0 first
+ * socket.async_read_some(buffer,
+ *     asio::bind_executor(lanes.get_executor(1), on_bulk_data));
+ * timer.async_wait(
+ *     asio::bind_executor(lanes.get_executor(0), send_heartbeat));
+ * @endcode
+ *
+ * Each handler given to a lane posts one token to the io_context, and
+ * whichever token the scheduler runs next takes the highest priority
+ * handler waiting rather than its own. A control handler therefore runs
+ * at the next token, not behind the backlog, and lane handlers still run
+ * concurrently on every thread running the io_context. A lower lane that
+ * has been passed over starvation_limit times runs next, so bulk work
+ * slows down under a flood of control messages but does not stop.
+ *
+ * Only handlers bound to a lane are ordered; completions handled directly
+ * on the io_context's own executor keep their place in its queue.
+ */
+
+#include <asio/execution.hpp>
+#include <asio/execution_context.hpp>
+#include <asio/io_context.hpp>
+#include <asio/prefer.hpp>
+#include <asio/query.hpp>
+#include <asio/recycling_allocator.hpp>
+#include <asio/require.hpp>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace garak {
+struct priority_options {
+  /// Lanes per io_context, lane 0 has the highest priority
+  std::size_t lanes{2};
+  /// Handlers a waiting lane lets higher lanes run before it runs one
+  std::size_t starvation_limit{16};
+};
+
+namespace detail {
+/**
+ * @brief A handler waiting in a lane
+ * */
+struct lane_op {
+  lane_op* next{nullptr};
+  // Runs the handler if invoke is set, and frees the op either way
+  void (*complete)(lane_op*, bool invoke){nullptr};
+};
+
+template <typename Function>
+struct lane_handler final : lane_op {
+  using allocator_type = asio::recycling_allocator<lane_handler>;
+  using traits = std::allocator_traits<allocator_type>;
+
+  explicit lane_handler(Function&& f) : function(std::move(f)) {
+    complete = &do_complete;
+  }
+
+  static lane_op* create(Function f) {
+    allocator_type allocator;
+    auto* op = traits::allocate(allocator, 1);
+    try {
+      traits::construct(allocator, op, std::move(f));
+    } catch (...) {
+      traits::deallocate(allocator, op, 1);
+      throw;
+    }
+    return op;
+  }
+
+  static void do_complete(lane_op* base, bool invoke) {
+    auto* self = static_cast<lane_handler*>(base);
+    // Free the memory before the upcall, so the handler can reuse it
+    Function function{std::move(self->function)};
+    allocator_type allocator;
+    traits::destroy(allocator, self);
+    traits::deallocate(allocator, self, 1);
+    if (invoke) {
+      std::move(function)();
+    }
+  }
+
+  Function function;
+};
+}  // namespace detail
+
+template <typename Executor>
+class basic_priority_executor;
+
+/**
+ * @brief The lanes of one io_context, installed with
+ * garak::enable_priority_lanes()
+ * */
+class priority_lanes
+    : public asio::detail::execution_context_service_base<priority_lanes> {
+ public:
+  using executor_type =
+      basic_priority_executor<asio::io_context::executor_type>;
+
+  explicit priority_lanes(asio::execution_context& ctx,
+                          priority_options options = {})
+      : asio::detail::execution_context_service_base<priority_lanes>(ctx),
+        ctx_(static_cast<asio::io_context&>(ctx)),
+        starvation_limit_(options.starvation_limit),
+        lanes_(options.lanes) {
+    if (options.lanes == 0) {
+      throw std::invalid_argument("priority_lanes: no lanes");
+    }
+  }
+
+  ~priority_lanes() { destroy_all(); }
+
+  priority_lanes(const priority_lanes&) = delete;
+  priority_lanes& operator=(const priority_lanes&) = delete;
+
+  /**
+   * @brief The executor queueing handlers on lane, 0 being the highest
+   * priority
+   * */
+  [[nodiscard]] executor_type get_executor(std::size_t lane);
+
+  [[nodiscard]] std::size_t lanes() const { return lanes_.size(); }
+
+  /**
+   * @brief Handlers waiting on lane
+   * */
+  [[nodiscard]] std::size_t pending(std::size_t lane) const {
+    const std::lock_guard lock{mutex_};
+    return lanes_.at(lane).size;
+  }
+
+ private:
+  template <typename>
+  friend class basic_priority_executor;
+
+  /**
+   * @brief Posted once per queued handler, runs whichever goes next
+   * */
+  struct token {
+    priority_lanes* lanes;
+
+    void operator()() const { lanes->run_one(); }
+  };
+
+  struct lane_queue {
+    detail::lane_op* head{nullptr};
+    detail::lane_op* tail{nullptr};
+    std::size_t size{0};
+    // Handlers run from higher lanes while this one waited
+    std::size_t passed_over{0};
+  };
+
+  void shutdown() override { destroy_all(); }
+
+  void enqueue(std::size_t index, detail::lane_op* op) {
+    const std::lock_guard lock{mutex_};
+    auto& l = lanes_[index];
+    if (l.tail != nullptr) {
+      l.tail->next = op;
+    } else {
+      l.head = op;
+    }
+    l.tail = op;
+    ++l.size;
+  }
+
+  detail::lane_op* pop(lane_queue& l) {
+    auto* op = l.head;
+    l.head = op->next;
+    if (l.head == nullptr) {
+      l.tail = nullptr;
+    }
+    --l.size;
+    op->next = nullptr;
+    return op;
+  }
+
+  /**
+   * @brief The highest non-empty lane, unless a lower one has waited too
+   * long, or nullptr if every lane is empty
+   * */
+  lane_queue* pick() {
+    std::size_t first = 0;
+    while (first < lanes_.size() && lanes_[first].head == nullptr) {
+      ++first;
+    }
+    if (first == lanes_.size()) {
+      return nullptr;
+    }
+    for (auto i = lanes_.size() - 1; i > first; --i) {
+      auto& l = lanes_[i];
+      if (l.head != nullptr && ++l.passed_over >= starvation_limit_) {
+        l.passed_over = 0;
+        return &l;
+      }
+    }
+    lanes_[first].passed_over = 0;
+    return &lanes_[first];
+  }
+
+  void run_one() {
+    detail::lane_op* op = nullptr;
+    {
+      const std::lock_guard lock{mutex_};
+      if (auto* l = pick()) {
+        op = pop(*l);
+      }
+    }
+    if (op != nullptr) {
+      op->complete(op, true);
+    }
+  }
+
+  /**
+   * @brief Free the queued handlers without running them, as the
+   * io_context does with its own on shutdown
+   * */
+  void destroy_all() {
+    for (;;) {
+      detail::lane_op* op = nullptr;
+      {
+        const std::lock_guard lock{mutex_};
+        for (auto& l : lanes_) {
+          if (l.head != nullptr) {
+            op = pop(l);
+            break;
+          }
+        }
+      }
+      if (op == nullptr) {
+        return;
+      }
+      op->complete(op, false);
+    }
+  }
+
+  asio::io_context& ctx_;
+  const std::size_t starvation_limit_;
+  mutable std::mutex mutex_;
+  std::vector<lane_queue> lanes_;
+};
+
+/**
+ * @brief An executor queueing the functions it is given on one of an
+ * io_context's priority lanes; never runs them inline
+ * */
+template <typename Executor>
+class basic_priority_executor {
+ public:
+  basic_priority_executor(priority_lanes& lanes, std::size_t lane,
+                          Executor executor)
+      : lanes_(&lanes), lane_(lane), executor_(std::move(executor)) {}
+
+  [[nodiscard]] std::size_t lane() const { return lane_; }
+
+  [[nodiscard]] const Executor& get_inner_executor() const {
+    return executor_;
+  }
+
+  template <typename Function>
+  void execute(Function&& f) const {
+    using handler = detail::lane_handler<std::decay_t<Function>>;
+    lanes_->enqueue(lane_, handler::create(std::forward<Function>(f)));
+    asio::execution::execute(
+        asio::require(executor_, asio::execution::blocking.never),
+        priority_lanes::token{lanes_});
+  }
+
+  /**
+   * @brief The inner executor's properties, except that execute() never
+   * blocks
+   * */
+  template <typename Property>
+    requires asio::can_query<const Executor&, Property>::value
+  [[nodiscard]] decltype(auto) query(const Property& p) const {
+    if constexpr (std::is_convertible_v<Property,
+                                        asio::execution::blocking_t>) {
+      return asio::execution::blocking_t(asio::execution::blocking.never);
+    } else {
+      return asio::query(executor_, p);
+    }
+  }
+
+  template <typename Property>
+    requires asio::can_require<const Executor&, Property>::value
+  [[nodiscard]] auto require(const Property& p) const {
+    return rebind(asio::require(executor_, p));
+  }
+
+  template <typename Property>
+    requires asio::can_prefer<const Executor&, Property>::value
+  [[nodiscard]] auto prefer(const Property& p) const {
+    return rebind(asio::prefer(executor_, p));
+  }
+
+  friend bool operator==(const basic_priority_executor& a,
+                         const basic_priority_executor& b) noexcept {
+    return a.lanes_ == b.lanes_ && a.lane_ == b.lane_ &&
+           a.executor_ == b.executor_;
+  }
+
+  friend bool operator!=(const basic_priority_executor& a,
+                         const basic_priority_executor& b) noexcept {
+    return !(a == b);
+  }
+
+ private:
+  template <typename Other>
+  basic_priority_executor<std::decay_t<Other>> rebind(Other&& other) const {
+    return {*lanes_, lane_, std::forward<Other>(other)};
+  }
+
+  priority_lanes* lanes_;
+  std::size_t lane_;
+  Executor executor_;
+};
+
+inline priority_lanes::executor_type priority_lanes::get_executor(
+    std::size_t lane) {
+  if (lane >= lanes_.size()) {
+    throw std::out_of_range("priority_lanes: no such lane");
+  }
+  return {*this, lane, ctx_.get_executor()};
+}
+
+/**
+ * @brief Give ctx priority lanes, once and before handlers use them
+ * */
+inline priority_lanes& enable_priority_lanes(asio::io_context& ctx,
+                                             priority_options options = {}) {
+  return asio::make_service<priority_lanes>(ctx, options);
+}
+}  // namespace garak
+
+#endif
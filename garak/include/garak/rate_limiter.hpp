@@ -0,0 +1,422 @@
+#ifndef GARAK_RATE_LIMITER_HPP
+#define GARAK_RATE_LIMITER_HPP
+
+/**
+ * @file garak/rate_limiter.hpp
+ * @brief Token bucket rate limiting per client, and admission control at
+ * accept time
+ * @date 2026-10-19
+ *
+ * Limiting a client after its request has been read and parsed means a
+ * flood still costs us the accept, the buffers and the parse. A
+ * rate_limiter keeps a token bucket per key, a client address or a
+ * session id, and is cheap enough to consult before any of that: buckets
+ * live in hash sharded maps, so threads checking different keys rarely
+ * share a lock, and refill lazily from the time since they were last
+ * used, with no timers.
+ *
+ * At accept time, admission_control turns away clients over their rate
+ * with a reset before a byte is read, and stops accepting altogether
+ * while the listener is over its own accept rate. The connections queue
+ * in the kernel's listen backlog meanwhile, and beyond it the kernel
+ * drops SYNs or answers with cookies, so size the backlog passed to
+ * listen() for the bursts to absorb rather than as large as possible:
+ *
+ * @code
+ * garak::rate_limiter per_client{{.per_second = 5, .burst = 20}};
+ * garak::admission_control admission{per_client, {.per_second = 2000,
+ *                                                 .burst = 500}};
+ * for (;;) {
+ *   auto socket = co_await admission.async_accept(acceptor,
+ *                                                 asio::use_awaitable);
+ *   ...
+ *   // and per message, before decoding it
+ *   if (!per_session.try_acquire(session_id)) { ... }
+ * }
+ * @endcode
+ */
+
+#include <algorithm>
+#include <asio/async_result.hpp>
+#include <asio/compose.hpp>
+#include <asio/error.hpp>
+#include <asio/ip/address.hpp>
+#include <asio/socket_base.hpp>
+#include <asio/steady_timer.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace garak {
+/**
+ * @brief A sustained rate and the burst allowed on top of it
+ * */
+struct rate_limit {
+  /// Tokens added per second; zero or less never refills, so a bucket
+  /// grants its burst and then nothing
+  double per_second{100};
+  /// Most tokens a bucket holds, and what a new bucket starts with
+  double burst{100};
+};
+
+namespace detail {
+/**
+ * @brief How long adding tokens at per_second takes, or
+ * steady_clock::duration::max() when that is never or too far off to add
+ * to a time point
+ * */
+inline std::chrono::steady_clock::duration refill_duration(
+    double tokens, double per_second) {
+  using duration = std::chrono::steady_clock::duration;
+  // About 31 years, well inside what a time point can have added
+  constexpr double longest = 1e9;
+  if (!(per_second > 0) || !(tokens / per_second < longest)) {
+    return duration::max();
+  }
+  return std::chrono::ceil<duration>(
+      std::chrono::duration<double>(tokens / per_second));
+}
+}  // namespace detail
+
+/**
+ * @brief One token bucket, refilled from the time passed whenever it is
+ * used; not thread safe
+ * */
+class token_bucket {
+ public:
+  using clock = std::chrono::steady_clock;
+
+  explicit token_bucket(rate_limit limit, clock::time_point now = {})
+      : limit_(limit), tokens_(limit.burst), last_(now) {}
+
+  /**
+   * @brief Take cost tokens if there are that many
+   * */
+  bool try_take(double cost = 1, clock::time_point now = clock::now()) {
+    refill(now);
+    if (tokens_ < cost) {
+      return false;
+    }
+    tokens_ -= cost;
+    return true;
+  }
+
+  /**
+   * @brief How long until cost tokens are available, zero if they are,
+   * clock::duration::max() if they never will be
+   * */
+  [[nodiscard]] clock::duration time_until(
+      double cost = 1, clock::time_point now = clock::now()) {
+    refill(now);
+    if (tokens_ >= cost) {
+      return clock::duration::zero();
+    }
+    return detail::refill_duration(cost - tokens_, limit_.per_second);
+  }
+
+  /**
+   * @brief Whether the bucket has refilled completely by now, so
+   * forgetting it loses nothing
+   * */
+  [[nodiscard]] bool full(clock::time_point now) {
+    refill(now);
+    return tokens_ >= limit_.burst;
+  }
+
+  [[nodiscard]] double tokens(clock::time_point now = clock::now()) {
+    refill(now);
+    return tokens_;
+  }
+
+ private:
+  void refill(clock::time_point now) {
+    if (now <= last_ || !(limit_.per_second > 0)) {
+      return;
+    }
+    const auto elapsed = std::chrono::duration<double>(now - last_).count();
+    tokens_ = std::min(limit_.burst, tokens_ + elapsed * limit_.per_second);
+    last_ = now;
+  }
+
+  rate_limit limit_;
+  double tokens_;
+  clock::time_point last_;
+};
+
+/**
+ * @brief What a rate limiter has decided since it was created
+ * */
+struct rate_limiter_stats {
+  std::uint64_t admitted{0};
+  std::uint64_t refused{0};
+  /// Decisions for keys that found their shard full and shared its
+  /// overflow bucket
+  std::uint64_t overflowed{0};
+  /// Keys with a bucket of their own
+  std::size_t keys{0};
+};
+
+/**
+ * @brief A token bucket per key, thread safe, in maps sharded by the
+ * key's hash
+ *
+ * Memory is bounded by capacity. A key arriving at a full shard first
+ * makes the shard forget the buckets that have refilled, which are no
+ * different from new ones, and if none have, shares the shard's overflow
+ * bucket with every other key that didn't fit. A flood of spoofed or
+ * rotating addresses therefore exhausts the overflow bucket rather than
+ * getting a fresh burst per address, while known clients keep theirs.
+ * */
+template <typename Key, typename Hash = std::hash<Key>>
+class basic_rate_limiter {
+ public:
+  using clock = token_bucket::clock;
+
+  explicit basic_rate_limiter(rate_limit limit, std::size_t shards = 16,
+                              std::size_t capacity = 65536)
+      : limit_(limit),
+        shards_(std::max<std::size_t>(shards, 1)),
+        shard_capacity_(std::max<std::size_t>(capacity / shards_.size(), 1)),
+        refill_time_(detail::refill_duration(limit.burst, limit.per_second)) {
+    for (auto& bucket : shards_) {
+      bucket.overflow = token_bucket{limit_, clock::now()};
+    }
+  }
+
+  /**
+   * @brief Take cost tokens from key's bucket if it has that many
+   * */
+  bool try_acquire(const Key& key, double cost = 1,
+                   clock::time_point now = clock::now()) {
+    auto& bucket = shard_for(key);
+    const std::scoped_lock lock{bucket.mutex};
+    auto* tokens = find_or_add(bucket, key, now);
+    if (tokens == &bucket.overflow) {
+      ++bucket.overflowed;
+    }
+    if (tokens->try_take(cost, now)) {
+      ++bucket.admitted;
+      return true;
+    }
+    ++bucket.refused;
+    return false;
+  }
+
+  /**
+   * @brief Forget every bucket that has refilled by now
+   * */
+  void sweep(clock::time_point now = clock::now()) {
+    for (auto& bucket : shards_) {
+      const std::scoped_lock lock{bucket.mutex};
+      sweep(bucket, now);
+    }
+  }
+
+  [[nodiscard]] rate_limiter_stats stats() {
+    rate_limiter_stats total;
+    for (auto& bucket : shards_) {
+      const std::scoped_lock lock{bucket.mutex};
+      total.admitted += bucket.admitted;
+      total.refused += bucket.refused;
+      total.overflowed += bucket.overflowed;
+      total.keys += bucket.buckets.size();
+    }
+    return total;
+  }
+
+ private:
+  struct shard {
+    std::mutex mutex;
+    std::unordered_map<Key, token_bucket, Hash> buckets;
+    token_bucket overflow{rate_limit{}};
+    // A full shard with nothing to forget isn't swept again before this
+    clock::time_point next_sweep;
+    std::uint64_t admitted{0};
+    std::uint64_t refused{0};
+    std::uint64_t overflowed{0};
+  };
+
+  token_bucket* find_or_add(shard& bucket, const Key& key,
+                            clock::time_point now) {
+    auto it = bucket.buckets.find(key);
+    if (it != bucket.buckets.end()) {
+      return &it->second;
+    }
+    if (bucket.buckets.size() >= shard_capacity_) {
+      if (now < bucket.next_sweep) {
+        return &bucket.overflow;
+      }
+      sweep(bucket, now);
+      if (bucket.buckets.size() >= shard_capacity_) {
+        // Nothing refills sooner than an empty bucket does
+        bucket.next_sweep = refill_time_ == clock::duration::max()
+                                ? clock::time_point::max()
+                                : now + refill_time_;
+        return &bucket.overflow;
+      }
+    }
+    return &bucket.buckets.try_emplace(key, limit_, now).first->second;
+  }
+
+  static void sweep(shard& bucket, clock::time_point now) {
+    for (auto it = bucket.buckets.begin(); it != bucket.buckets.end();) {
+      it = it->second.full(now) ? bucket.buckets.erase(it) : std::next(it);
+    }
+  }
+
+  shard& shard_for(const Key& key) {
+    // Spread the hash first, std::hash of an integer is the identity
+    auto h = static_cast<std::uint64_t>(Hash{}(key));
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return shards_[h % shards_.size()];
+  }
+
+  const rate_limit limit_;
+  std::vector<shard> shards_;
+  const std::size_t shard_capacity_;
+  const clock::duration refill_time_;
+};
+
+/**
+ * @brief Rate limits per client address
+ * */
+using rate_limiter = basic_rate_limiter<asio::ip::address>;
+
+/**
+ * @brief Rate limits per session, or any other integer id
+ * */
+using session_rate_limiter = basic_rate_limiter<std::uint64_t>;
+
+/**
+ * @brief What an admission_control has done with connections
+ * */
+struct admission_stats {
+  std::uint64_t accepted{0};
+  /// Reset straight after accepting, their client over its rate
+  std::uint64_t refused{0};
+  /// Times accepting stopped with the listener over its accept rate
+  std::uint64_t paused{0};
+};
+
+namespace detail {
+template <typename Admission, typename Acceptor>
+struct admission_accept_op;
+}  // namespace detail
+
+/**
+ * @brief Accepts connections within a listener's accept rate and each
+ * client's rate; use one per acceptor, from one thread at a time
+ * */
+class admission_control {
+ public:
+  using clock = token_bucket::clock;
+
+  /**
+   * @brief Admit clients within per_client, sharing it with other
+   * listeners and with checks elsewhere, and accept within accepts
+   * */
+  admission_control(rate_limiter& per_client, rate_limit accepts)
+      : per_client_(per_client), accepts_(accepts, clock::now()) {}
+
+  /**
+   * @brief Accept the next connection whose client is within its rate
+   *
+   * While the listener is over its accept rate, no accept is outstanding
+   * and connections wait in the listen backlog. Connections from clients
+   * over their rate are reset without reading from them. Completion
+   * signature `void(asio::error_code, socket)`, the socket being what the
+   * acceptor's move accept produces. Supports cancellation.
+   * */
+  template <typename Acceptor, typename CompletionToken>
+  auto async_accept(Acceptor& acceptor, CompletionToken&& token) {
+    using socket_type =
+        typename Acceptor::protocol_type::socket::template rebind_executor<
+            typename Acceptor::executor_type>::other;
+    return asio::async_compose<CompletionToken,
+                               void(asio::error_code, socket_type)>(
+        detail::admission_accept_op<admission_control, Acceptor>{
+            *this, acceptor, nullptr},
+        token, acceptor);
+  }
+
+  [[nodiscard]] const admission_stats& stats() const { return stats_; }
+
+ private:
+  template <typename, typename>
+  friend struct detail::admission_accept_op;
+
+  rate_limiter& per_client_;
+  token_bucket accepts_;
+  admission_stats stats_;
+};
+
+namespace detail {
+template <typename Admission, typename Acceptor>
+struct admission_accept_op {
+  Admission& admission;
+  Acceptor& acceptor;
+  std::unique_ptr<asio::steady_timer> pause;
+
+  template <typename Self>
+  void operator()(Self& self, asio::error_code ec = {}) {
+    if (ec) {
+      fail(self, ec);
+      return;
+    }
+    const auto wait = admission.accepts_.time_until();
+    if (wait > Admission::clock::duration::zero()) {
+      ++admission.stats_.paused;
+      if (!pause) {
+        pause = std::make_unique<asio::steady_timer>(acceptor.get_executor());
+      }
+      pause->expires_after(wait);
+      pause->async_wait(std::move(self));
+      return;
+    }
+    acceptor.async_accept(std::move(self));
+  }
+
+  template <typename Self, typename Socket>
+  void operator()(Self& self, asio::error_code ec, Socket socket) {
+    if (ec) {
+      fail(self, ec);
+      return;
+    }
+    // Every accept counts against the listener, admitted or not
+    admission.accepts_.try_take();
+    asio::error_code ignored;
+    const auto remote = socket.remote_endpoint(ignored);
+    if (!ignored && admission.per_client_.try_acquire(remote.address())) {
+      ++admission.stats_.accepted;
+      self.complete(ec, std::move(socket));
+      return;
+    }
+    // Reset rather than close, so the client doesn't linger in TIME_WAIT
+    // at our end
+    ++admission.stats_.refused;
+    socket.set_option(asio::socket_base::linger{true, 0}, ignored);
+    socket.close(ignored);
+    (*this)(self);
+  }
+
+  template <typename Self>
+  void fail(Self& self, asio::error_code ec) {
+    using socket_type =
+        typename Acceptor::protocol_type::socket::template rebind_executor<
+            typename Acceptor::executor_type>::other;
+    self.complete(ec, socket_type{acceptor.get_executor()});
+  }
+};
+}  // namespace detail
+}  // namespace garak
+
+#endif
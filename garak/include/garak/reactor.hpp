@@ -0,0 +1,50 @@
+#ifndef GARAK_REACTOR_HPP
+#define GARAK_REACTOR_HPP
+
+/**
+ * @file garak/reactor.hpp
+ * @brief Tuning for the io_context's reactor
+ * @date 2026-10-19
+ */
+
+#include <asio/io_context.hpp>
+#include <cstddef>
+
+#if defined(ASIO_HAS_EPOLL)
+#include <asio/detail/epoll_reactor.hpp>
+#endif
+
+namespace garak {
+/**
+ * @brief Set how many ready descriptors one epoll_wait call may return for
+ * ctx, 128 unless changed
+ *
+ * With many busy connections a larger batch means fewer epoll_wait calls,
+ * a smaller one returns to queued handlers sooner. Call it before ctx is
+ * run. Does nothing on platforms without epoll.
+ * */
+inline void set_event_batch_size(asio::io_context& ctx, std::size_t size) {
+#if defined(ASIO_HAS_EPOLL)
+  asio::use_service<asio::detail::epoll_reactor>(ctx).set_event_batch_size(
+      size);
+#else
+  (void)ctx;
+  (void)size;
+#endif
+}
+
+/**
+ * @brief The current epoll_wait batch size for ctx, 0 without epoll
+ * */
+inline std::size_t event_batch_size(asio::io_context& ctx) {
+#if defined(ASIO_HAS_EPOLL)
+  return asio::use_service<asio::detail::epoll_reactor>(ctx)
+      .event_batch_size();
+#else
+  (void)ctx;
+  return 0;
+#endif
+}
+}  // namespace garak
+
+#endif
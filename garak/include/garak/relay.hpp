@@ -0,0 +1,394 @@
+#ifndef GARAK_RELAY_HPP
+#define GARAK_RELAY_HPP
+
+/**
+ * @file garak/relay.hpp
+ * @brief Bidirectional byte relaying between two streams
+ * @date 2026-10-19
+ *
+ * A relay reading into a buffer and writing it back out touches every byte
+ * twice in user space. Between two sockets async_relay splices instead:
+ * each direction moves bytes from one socket into a pipe and from the pipe
+ * into the other, and the kernel hands the pages over without copying
+ * them. Streams splice can't reach, such as TLS streams, are relayed
+ * through a recycled buffer instead.
+ *
+ * @code
+ * auto [ec, stats] = co_await garak::async_relay(
+ *     client, upstream, asio::as_tuple(asio::use_awaitable));
+ * @endcode
+ */
+
+#include <asio/async_result.hpp>
+#include <asio/buffer.hpp>
+#include <asio/compose.hpp>
+#include <asio/error.hpp>
+#include <asio/socket_base.hpp>
+#include <asio/steady_timer.hpp>
+#include <asio/write.hpp>
+#include <cerrno>
+#include <chrono>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <fcntl.h>
+#include <garak/send_file.hpp>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace garak {
+/**
+ * @brief Bytes moved by an async_relay, in each direction
+ * */
+struct relay_stats {
+  std::uint64_t a_to_b{0};
+  std::uint64_t b_to_a{0};
+};
+
+/**
+ * @brief How async_relay moves bytes
+ * */
+enum class relay_mode {
+  /// Splice between sockets, copy for anything else
+  automatic,
+  /// Always copy through a buffer
+  copy,
+};
+
+/**
+ * @brief A socket whose descriptor splice can use directly
+ * */
+template <typename Stream>
+concept splice_socket = requires(Stream& s, asio::error_code& ec) {
+  { s.native_handle() } -> std::convertible_to<int>;
+  s.native_non_blocking(true, ec);
+  s.async_wait(asio::socket_base::wait_read, [](asio::error_code) {});
+};
+
+namespace detail {
+/**
+ * @brief A copy buffer, taken from and returned to a small per-thread
+ * cache so busy relays don't allocate
+ * */
+class relay_buffer {
+ public:
+  static constexpr std::size_t size = 64 * 1024;
+
+  relay_buffer() {
+    auto& free = cache();
+    if (free.empty()) {
+      data_ = std::make_unique<std::byte[]>(size);
+    } else {
+      data_ = std::move(free.back());
+      free.pop_back();
+    }
+  }
+
+  ~relay_buffer() {
+    auto& free = cache();
+    if (free.size() < cached) {
+      free.push_back(std::move(data_));
+    }
+  }
+
+  relay_buffer(const relay_buffer&) = delete;
+  relay_buffer& operator=(const relay_buffer&) = delete;
+
+  [[nodiscard]] asio::mutable_buffer buffer() const {
+    return asio::buffer(data_.get(), size);
+  }
+
+ private:
+  static constexpr std::size_t cached = 16;
+
+  static std::vector<std::unique_ptr<std::byte[]>>& cache() {
+    thread_local std::vector<std::unique_ptr<std::byte[]>> free;
+    return free;
+  }
+
+  std::unique_ptr<std::byte[]> data_;
+};
+
+/**
+ * @brief Shut down the sending side of stream, or of the socket beneath
+ * it for streams without a shutdown of their own
+ * */
+template <typename Stream>
+void shutdown_send(Stream& stream) {
+  asio::error_code ignored;
+  if constexpr (requires {
+                  stream.shutdown(asio::socket_base::shutdown_send, ignored);
+                }) {
+    stream.shutdown(asio::socket_base::shutdown_send, ignored);
+  } else {
+    stream.lowest_layer().shutdown(asio::socket_base::shutdown_send,
+                                   ignored);
+  }
+}
+
+/**
+ * @brief The state of one async_relay call, shared by the handlers of both
+ * directions
+ *
+ * Each direction runs until its source ends, passes the end on by shutting
+ * down the sending side of its destination, and stops. The first error
+ * stops both.
+ * */
+template <typename StreamA, typename StreamB>
+class relay_session
+    : public std::enable_shared_from_this<relay_session<StreamA, StreamB>> {
+ public:
+  relay_session(StreamA& a, StreamB& b, relay_mode mode)
+      : finished(a.get_executor()),
+        forward_{a, b, stats.a_to_b},
+        backward_{b, a, stats.b_to_a},
+        a_(a),
+        b_(b),
+        mode_(mode) {
+    finished.expires_at(std::chrono::steady_clock::time_point::max());
+  }
+
+  void start() {
+    run(forward_);
+    run(backward_);
+  }
+
+  // Stop both directions, finishing once their handlers have returned
+  void abort(asio::error_code ec) {
+    if (stopping_) {
+      return;
+    }
+    stopping_ = true;
+    error = ec;
+    asio::error_code ignored;
+    a_.lowest_layer().cancel(ignored);
+    b_.lowest_layer().cancel(ignored);
+  }
+
+  relay_stats stats;
+  asio::error_code error;
+  bool done{false};
+  // Expires once both directions have stopped, for the initiating op
+  asio::steady_timer finished;
+
+ private:
+  // Largest count one splice is given, and the pipe capacity asked for;
+  // fewer, larger splices cost noticeably less than the default 64 KiB
+  static constexpr std::size_t splice_step = 1024 * 1024;
+
+  template <typename From, typename To>
+  struct direction {
+    From& from;
+    To& to;
+    std::uint64_t& moved;
+    pipe_pair pipe{};
+    // Read from the source but not yet into the destination
+    std::size_t piped{0};
+    bool ended{false};
+    std::unique_ptr<relay_buffer> buffer{};
+  };
+
+  template <typename From, typename To>
+  void run(direction<From, To>& d) {
+    if constexpr (splice_socket<From> && splice_socket<To>) {
+      if (mode_ == relay_mode::automatic) {
+        asio::error_code ec;
+        d.from.native_non_blocking(true, ec);
+        if (!ec) {
+          d.to.native_non_blocking(true, ec);
+        }
+        if (!ec && d.pipe.open(ec)) {
+          // Best effort, past /proc/sys/fs/pipe-max-size it stays smaller
+          ::fcntl(d.pipe.write_end(), F_SETPIPE_SZ,
+                  static_cast<int>(splice_step));
+          pump(d);
+          return;
+        }
+      }
+    }
+    copy(d);
+  }
+
+  template <typename From, typename To>
+  void pump(direction<From, To>& d) {
+    constexpr unsigned flags = SPLICE_F_MOVE | SPLICE_F_NONBLOCK;
+    while (!stopping_) {
+      if (d.piped == 0 && !d.ended) {
+        const auto n = ::splice(d.from.native_handle(), nullptr,
+                                d.pipe.write_end(), nullptr, splice_step,
+                                flags);
+        if (n > 0) {
+          d.piped = static_cast<std::size_t>(n);
+        } else if (n == 0) {
+          d.ended = true;
+        } else if (errno == EAGAIN) {
+          d.from.async_wait(asio::socket_base::wait_read,
+                            resume(d, &relay_session::pump<From, To>));
+          return;
+        } else if (errno == EINVAL && d.moved == 0) {
+          // Something splice doesn't support, copy instead
+          copy(d);
+          return;
+        } else if (errno != EINTR) {
+          abort(asio::error_code(errno, asio::system_category()));
+          break;
+        }
+        continue;
+      }
+      if (d.piped > 0) {
+        const auto n = ::splice(d.pipe.read_end(), nullptr,
+                                d.to.native_handle(), nullptr, d.piped, flags);
+        if (n > 0) {
+          d.piped -= static_cast<std::size_t>(n);
+          d.moved += static_cast<std::uint64_t>(n);
+        } else if (n < 0 && errno == EAGAIN) {
+          d.to.async_wait(asio::socket_base::wait_write,
+                          resume(d, &relay_session::pump<From, To>));
+          return;
+        } else if (n == 0 || errno != EINTR) {
+          abort(n < 0 ? asio::error_code(errno, asio::system_category())
+                      : asio::error::broken_pipe);
+          break;
+        }
+        continue;
+      }
+      shutdown_send(d.to);
+      break;
+    }
+    stopped();
+  }
+
+  template <typename From, typename To>
+  void copy(direction<From, To>& d) {
+    if (stopping_) {
+      stopped();
+      return;
+    }
+    if (!d.buffer) {
+      d.buffer = std::make_unique<relay_buffer>();
+    }
+    d.from.async_read_some(
+        d.buffer->buffer(),
+        [self = this->shared_from_this(), &d](asio::error_code ec,
+                                              std::size_t n) {
+          if (ec == asio::error::eof) {
+            shutdown_send(d.to);
+            d.buffer.reset();
+            self->stopped();
+          } else if (ec) {
+            self->abort(ec);
+            self->stopped();
+          } else {
+            self->forward(d, n);
+          }
+        });
+  }
+
+  template <typename From, typename To>
+  void forward(direction<From, To>& d, std::size_t n) {
+    asio::async_write(
+        d.to, asio::buffer(d.buffer->buffer(), n),
+        [self = this->shared_from_this(), &d](asio::error_code ec,
+                                              std::size_t written) {
+          d.moved += written;
+          if (ec) {
+            self->abort(ec);
+            self->stopped();
+          } else {
+            self->copy(d);
+          }
+        });
+  }
+
+  // A wait handler that carries on with step, or stops on error
+  template <typename From, typename To>
+  auto resume(direction<From, To>& d,
+              void (relay_session::*step)(direction<From, To>&)) {
+    return [self = this->shared_from_this(), &d, step](asio::error_code ec) {
+      if (ec) {
+        self->abort(ec);
+        self->stopped();
+      } else {
+        ((*self).*step)(d);
+      }
+    };
+  }
+
+  // One direction has returned for good
+  void stopped() {
+    if (++stopped_ == 2) {
+      done = true;
+      finished.expires_at(std::chrono::steady_clock::now());
+    }
+  }
+
+  direction<StreamA, StreamB> forward_;
+  direction<StreamB, StreamA> backward_;
+  StreamA& a_;
+  StreamB& b_;
+  relay_mode mode_;
+  bool stopping_{false};
+  int stopped_{0};
+};
+
+template <typename StreamA, typename StreamB>
+struct relay_op {
+  std::shared_ptr<relay_session<StreamA, StreamB>> session;
+  bool started{false};
+
+  template <typename Self>
+  void operator()(Self& self, asio::error_code /*ec*/ = {}) {
+    if (!started) {
+      started = true;
+      session->start();
+    } else if (session->done) {
+      self.complete(session->error, session->stats);
+      return;
+    } else {
+      // Our cancellation slot fired, wait for both directions to return
+      session->abort(asio::error::operation_aborted);
+    }
+    session->finished.async_wait(std::move(self));
+  }
+};
+}  // namespace detail
+
+/**
+ * @brief Relay bytes between a and b in both directions until both have
+ * ended
+ *
+ * When one side ends its sending, the other side's sending is shut down
+ * in turn, and the opposite direction carries on until it ends as well.
+ * Between two sockets the bytes are spliced through a pipe per direction
+ * and never enter user space; where either side isn't a plain socket, or
+ * with relay_mode::copy, they are copied through a recycled buffer.
+ *
+ * Completion signature `void(asio::error_code, garak::relay_stats)` with
+ * the bytes moved each way, and the first error that stopped the relay
+ * (after which the other direction is cancelled too). Supports terminal
+ * cancellation. Leaves sockets in non-blocking mode. The streams must be
+ * used from one thread at a time, e.g. a single threaded io_context or a
+ * strand.
+ * */
+template <typename StreamA, typename StreamB, typename CompletionToken>
+auto async_relay(StreamA& a, StreamB& b, relay_mode mode,
+                 CompletionToken&& token) {
+  auto session =
+      std::make_shared<detail::relay_session<StreamA, StreamB>>(a, b, mode);
+  return asio::async_compose<CompletionToken,
+                             void(asio::error_code, relay_stats)>(
+      detail::relay_op<StreamA, StreamB>{std::move(session)}, token, a, b);
+}
+
+/**
+ * @brief async_relay, splicing where it can
+ * */
+template <typename StreamA, typename StreamB, typename CompletionToken>
+auto async_relay(StreamA& a, StreamB& b, CompletionToken&& token) {
+  return async_relay(a, b, relay_mode::automatic,
+                     std::forward<CompletionToken>(token));
+}
+}  // namespace garak
+
+#endif
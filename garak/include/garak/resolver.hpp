@@ -0,0 +1,1062 @@
+#ifndef GARAK_RESOLVER_HPP
+#define GARAK_RESOLVER_HPP
+
+/**
+ * @file garak/resolver.hpp
+ * @brief A caching asynchronous DNS resolver
+ * @date 2026-10-19
+ *
+ * asio::ip::basic_resolver runs getaddrinfo on a single private thread, so
+ * one slow lookup holds up every other behind it, and nothing is kept
+ * between lookups. caching_resolver remembers answers for their TTL and
+ * failures for a short while, and joins concurrent lookups of one name:
+ *
+ * @code
+ * garak::caching_resolver resolver{ctx.get_executor()};
+ * auto endpoints = co_await resolver.async_resolve("example.com", "443",
+ *                                                  asio::use_awaitable);
+ * @endcode
+ *
+ * Misses run getaddrinfo on a small thread pool or, with nameservers set,
+ * are sent straight to those servers as UDP queries for A and AAAA records,
+ * which also gives real record TTLs. The UDP client reads neither
+ * /etc/hosts nor search domains, so names should be fully qualified.
+ */
+
+#include <algorithm>
+#include <array>
+#include <asio/any_io_executor.hpp>
+#include <asio/as_tuple.hpp>
+#include <asio/co_spawn.hpp>
+#include <asio/compose.hpp>
+#include <asio/detached.hpp>
+#include <asio/error.hpp>
+#include <asio/experimental/awaitable_operators.hpp>
+#include <asio/ip/address.hpp>
+#include <asio/ip/basic_resolver_results.hpp>
+#include <asio/ip/tcp.hpp>
+#include <asio/ip/udp.hpp>
+#include <asio/post.hpp>
+#include <asio/steady_timer.hpp>
+#include <asio/this_coro.hpp>
+#include <asio/thread_pool.hpp>
+#include <asio/use_awaitable.hpp>
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <optional>
+#include <random>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <sys/socket.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace garak {
+/**
+ * @brief Cache and lookup knobs for garak::caching_resolver
+ * */
+struct resolver_options {
+  /// Cache shards, each behind its own lock
+  std::size_t shards{16};
+  /// Names cached across all shards, those closest to expiry go first
+  std::size_t capacity{4096};
+  /// Threads running getaddrinfo for misses, without nameservers
+  std::size_t threads{4};
+  /// Query these servers over UDP instead of calling getaddrinfo
+  std::vector<asio::ip::udp::endpoint> nameservers;
+  /// How long one server has to answer before the next is asked
+  std::chrono::steady_clock::duration query_timeout{std::chrono::seconds(2)};
+  /// Passes over the nameservers before a lookup fails
+  std::size_t attempts{2};
+  /// How long getaddrinfo answers are kept, they carry no TTL
+  std::chrono::steady_clock::duration default_ttl{std::chrono::seconds(30)};
+  /// Record TTLs are raised to at least this
+  std::chrono::steady_clock::duration min_ttl{std::chrono::seconds(1)};
+  /// And cut to at most this
+  std::chrono::steady_clock::duration max_ttl{std::chrono::minutes(10)};
+  /// Failed lookups are kept at most this long
+  std::chrono::steady_clock::duration negative_ttl{std::chrono::seconds(5)};
+};
+
+/**
+ * @brief How well a caching_resolver's cache is doing
+ * */
+struct resolver_stats {
+  /// Resolves answered from the cache, failures included
+  std::uint64_t hits{0};
+  /// Resolves that started a lookup
+  std::uint64_t misses{0};
+  /// Resolves that joined a lookup already running
+  std::uint64_t coalesced{0};
+  /// Names cached or being looked up
+  std::size_t entries{0};
+};
+
+/**
+ * @brief The nameservers listed in a resolv.conf, at most the three glibc
+ * would use
+ * */
+inline std::vector<asio::ip::udp::endpoint> nameservers_from_resolv_conf(
+    const std::string& path = "/etc/resolv.conf") {
+  std::vector<asio::ip::udp::endpoint> servers;
+  std::ifstream in{path};
+  std::string line;
+  while (servers.size() < 3 && std::getline(in, line)) {
+    std::istringstream words{line};
+    std::string keyword;
+    std::string address;
+    if (words >> keyword >> address && keyword == "nameserver") {
+      asio::error_code ec;
+      const auto parsed = asio::ip::make_address(address, ec);
+      if (!ec) {
+        servers.emplace_back(parsed, 53);
+      }
+    }
+  }
+  return servers;
+}
+
+namespace detail {
+using address_list = std::shared_ptr<const std::vector<asio::ip::address>>;
+
+/**
+ * @brief What a lookup found or why it failed, and how long that holds
+ * */
+struct dns_answer {
+  asio::error_code error;
+  std::vector<asio::ip::address> addresses;
+  std::chrono::steady_clock::duration ttl{};
+};
+
+/**
+ * @brief Bring answer's TTL within the configured bounds
+ * */
+inline dns_answer settle(dns_answer answer, const resolver_options& options) {
+  if (answer.error) {
+    answer.ttl = std::min(answer.ttl, options.negative_ttl);
+  } else {
+    answer.ttl =
+        std::min(std::max(answer.ttl, options.min_ttl), options.max_ttl);
+  }
+  return answer;
+}
+
+/**
+ * @brief Cache key for host, lowercased without the root label's dot
+ * */
+inline std::string dns_key(std::string_view host) {
+  if (!host.empty() && host.back() == '.') {
+    host.remove_suffix(1);
+  }
+  std::string key{host};
+  for (auto& ch : key) {
+    ch = static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+  }
+  return key;
+}
+
+/**
+ * @brief A resolve parked on a lookup in flight
+ * */
+class resolve_waiter {
+ public:
+  resolve_waiter() = default;
+  virtual ~resolve_waiter() = default;
+  resolve_waiter(const resolve_waiter&) = delete;
+  resolve_waiter& operator=(const resolve_waiter&) = delete;
+
+  virtual void complete(asio::error_code ec, address_list addresses) = 0;
+};
+
+/**
+ * @brief Answers keyed by name, split into shards so threads resolving
+ * different names rarely share a lock
+ *
+ * An entry holds either an answer and when it expires, or a lookup in
+ * flight and the resolves waiting on it.
+ * */
+class dns_cache {
+ public:
+  using clock = std::chrono::steady_clock;
+
+  enum class outcome {
+    // ec and addresses are filled in
+    hit,
+    // Parked behind a lookup already running
+    joined,
+    // Parked, and the caller must start the lookup
+    miss
+  };
+
+  dns_cache(std::size_t shards, std::size_t capacity)
+      : shards_(std::max<std::size_t>(shards, 1)),
+        shard_capacity_(
+            std::max<std::size_t>(capacity / shards_.size(), 1)) {}
+
+  /**
+   * @brief Answer name from the cache, or park the waiter make() returns
+   * until fill(name, ...)
+   * */
+  template <typename MakeWaiter>
+  outcome find(const std::string& name, asio::error_code& ec,
+               address_list& addresses, MakeWaiter&& make) {
+    auto& bucket = shard_for(name);
+    const auto now = clock::now();
+    const std::scoped_lock lock{bucket.mutex};
+    auto it = bucket.entries.find(name);
+    if (it == bucket.entries.end()) {
+      if (bucket.entries.size() >= shard_capacity_) {
+        evict(bucket);
+      }
+      it = bucket.entries.try_emplace(name).first;
+    } else if (it->second.pending) {
+      it->second.waiters.push_back(make());
+      ++bucket.coalesced;
+      return outcome::joined;
+    } else if (it->second.expires > now) {
+      ec = it->second.error;
+      addresses = it->second.addresses;
+      ++bucket.hits;
+      return outcome::hit;
+    }
+    it->second.pending = true;
+    it->second.waiters.push_back(make());
+    ++bucket.misses;
+    return outcome::miss;
+  }
+
+  /**
+   * @brief Keep answer for name and complete every resolve waiting on it
+   * */
+  void fill(const std::string& name, const dns_answer& answer) {
+    auto& bucket = shard_for(name);
+    address_list addresses;
+    if (!answer.error) {
+      addresses = std::make_shared<const std::vector<asio::ip::address>>(
+          answer.addresses);
+    }
+    std::vector<std::unique_ptr<resolve_waiter>> waiters;
+    {
+      const std::scoped_lock lock{bucket.mutex};
+      auto it = bucket.entries.find(name);
+      if (it == bucket.entries.end() || !it->second.pending) {
+        // Aborted meanwhile
+        return;
+      }
+      auto& e = it->second;
+      e.pending = false;
+      e.error = answer.error;
+      e.addresses = addresses;
+      e.expires = clock::now() + answer.ttl;
+      waiters.swap(e.waiters);
+    }
+    for (auto& waiter : waiters) {
+      waiter->complete(answer.error, addresses);
+    }
+  }
+
+  /**
+   * @brief Fail every parked resolve with asio::error::operation_aborted
+   * */
+  void abort() {
+    for (auto& bucket : shards_) {
+      std::vector<std::unique_ptr<resolve_waiter>> waiters;
+      {
+        const std::scoped_lock lock{bucket.mutex};
+        for (auto it = bucket.entries.begin(); it != bucket.entries.end();) {
+          if (it->second.pending) {
+            std::move(it->second.waiters.begin(), it->second.waiters.end(),
+                      std::back_inserter(waiters));
+            it = bucket.entries.erase(it);
+          } else {
+            ++it;
+          }
+        }
+      }
+      for (auto& waiter : waiters) {
+        waiter->complete(asio::error::operation_aborted, nullptr);
+      }
+    }
+  }
+
+  [[nodiscard]] resolver_stats stats() {
+    resolver_stats total;
+    for (auto& bucket : shards_) {
+      const std::scoped_lock lock{bucket.mutex};
+      total.hits += bucket.hits;
+      total.misses += bucket.misses;
+      total.coalesced += bucket.coalesced;
+      total.entries += bucket.entries.size();
+    }
+    return total;
+  }
+
+ private:
+  struct entry {
+    bool pending{false};
+    asio::error_code error;
+    address_list addresses;
+    clock::time_point expires;
+    std::vector<std::unique_ptr<resolve_waiter>> waiters;
+  };
+
+  struct shard {
+    std::mutex mutex;
+    std::unordered_map<std::string, entry> entries;
+    std::uint64_t hits{0};
+    std::uint64_t misses{0};
+    std::uint64_t coalesced{0};
+  };
+
+  // Drop the answer closest to expiring, lookups in flight stay
+  static void evict(shard& bucket) {
+    auto victim = bucket.entries.end();
+    for (auto it = bucket.entries.begin(); it != bucket.entries.end(); ++it) {
+      if (!it->second.pending &&
+          (victim == bucket.entries.end() ||
+           it->second.expires < victim->second.expires)) {
+        victim = it;
+      }
+    }
+    if (victim != bucket.entries.end()) {
+      bucket.entries.erase(victim);
+    }
+  }
+
+  shard& shard_for(const std::string& name) {
+    return shards_[std::hash<std::string>{}(name) % shards_.size()];
+  }
+
+  std::vector<shard> shards_;
+  std::size_t shard_capacity_;
+};
+
+enum class dns_type : std::uint16_t { a = 1, soa = 6, aaaa = 28 };
+
+/**
+ * @brief The parts of a DNS response a resolver needs
+ * */
+struct dns_reply {
+  // 0 no error, 3 no such name, anything else a server failure
+  std::uint16_t rcode{0};
+  std::vector<asio::ip::address> addresses;
+  // Smallest TTL of the answers, or a negative reply's SOA derived TTL
+  std::optional<std::uint32_t> ttl;
+};
+
+inline constexpr std::uint16_t dns_no_such_name = 3;
+
+/**
+ * @brief A recursive query for name's records of type, empty if name isn't
+ * a valid host name
+ * */
+inline std::vector<std::uint8_t> encode_dns_query(std::uint16_t id,
+                                                  std::string_view name,
+                                                  dns_type type) {
+  if (!name.empty() && name.back() == '.') {
+    name.remove_suffix(1);
+  }
+  if (name.empty() || name.size() > 253) {
+    return {};
+  }
+  std::vector<std::uint8_t> out;
+  out.reserve(name.size() + 18);
+  auto put16 = [&out](std::uint16_t value) {
+    out.push_back(static_cast<std::uint8_t>(value >> 8));
+    out.push_back(static_cast<std::uint8_t>(value));
+  };
+  put16(id);
+  // Recursion desired
+  put16(0x0100);
+  put16(1);
+  put16(0);
+  put16(0);
+  put16(0);
+  for (std::size_t start = 0; start <= name.size();) {
+    const auto end = std::min(name.find('.', start), name.size());
+    const auto length = end - start;
+    if (length == 0 || length > 63) {
+      return {};
+    }
+    out.push_back(static_cast<std::uint8_t>(length));
+    out.insert(out.end(), name.begin() + static_cast<std::ptrdiff_t>(start),
+               name.begin() + static_cast<std::ptrdiff_t>(end));
+    start = end + 1;
+  }
+  out.push_back(0);
+  put16(static_cast<std::uint16_t>(type));
+  // Class IN
+  put16(1);
+  return out;
+}
+
+/**
+ * @brief Bounds checked reads from a DNS message, a failed read clears
+ * ok() and yields zeros
+ * */
+class dns_reader {
+ public:
+  explicit dns_reader(std::span<const std::uint8_t> message)
+      : message_(message) {}
+
+  [[nodiscard]] bool ok() const { return ok_; }
+
+  std::uint16_t u16() {
+    const auto data = bytes(2);
+    return data.empty()
+               ? 0
+               : static_cast<std::uint16_t>(data[0] << 8 | data[1]);
+  }
+
+  std::uint32_t u32() {
+    const std::uint32_t high = u16();
+    return high << 16 | u16();
+  }
+
+  std::span<const std::uint8_t> bytes(std::size_t n) {
+    if (!ok_ || message_.size() - position_ < n) {
+      ok_ = false;
+      return {};
+    }
+    const auto data = message_.subspan(position_, n);
+    position_ += n;
+    return data;
+  }
+
+  /**
+   * @brief A possibly compressed name, lowercased and dot separated
+   * */
+  std::string name() {
+    std::string out;
+    auto at = position_;
+    bool jumped = false;
+    // Bounds both the labels of a name and any pointer loop
+    for (int step = 0; ok_ && step < 128; ++step) {
+      if (at >= message_.size()) {
+        break;
+      }
+      const auto length = message_[at];
+      if ((length & 0xC0) == 0xC0) {
+        if (at + 1 >= message_.size()) {
+          break;
+        }
+        if (!jumped) {
+          position_ = at + 2;
+          jumped = true;
+        }
+        at = static_cast<std::size_t>((length & 0x3F) << 8 | message_[at + 1]);
+        continue;
+      }
+      if ((length & 0xC0) != 0 || at + 1 + length > message_.size()) {
+        break;
+      }
+      if (length == 0) {
+        if (!jumped) {
+          position_ = at + 1;
+        }
+        return out;
+      }
+      if (!out.empty()) {
+        out += '.';
+      }
+      for (std::size_t i = 0; i < length; ++i) {
+        out += static_cast<char>(std::tolower(message_[at + 1 + i]));
+      }
+      at += 1 + length;
+    }
+    ok_ = false;
+    return {};
+  }
+
+ private:
+  std::span<const std::uint8_t> message_;
+  std::size_t position_{0};
+  bool ok_{true};
+};
+
+/**
+ * @brief Parse the response to query id for name's records of type,
+ * nothing if it's malformed or answers some other query
+ *
+ * name is as dns_key() gives it.
+ * */
+inline std::optional<dns_reply> parse_dns_response(
+    std::span<const std::uint8_t> message, std::uint16_t id,
+    const std::string& name, dns_type type) {
+  dns_reader in{message};
+  const auto reply_id = in.u16();
+  const auto flags = in.u16();
+  const auto questions = in.u16();
+  const auto answers = in.u16();
+  const auto authorities = in.u16();
+  in.u16();
+  // Must be a response, to this query
+  if (!in.ok() || reply_id != id || (flags & 0x8000) == 0 || questions != 1 ||
+      in.name() != name || in.u16() != static_cast<std::uint16_t>(type) ||
+      in.u16() != 1 || !in.ok()) {
+    return std::nullopt;
+  }
+  dns_reply reply;
+  reply.rcode = flags & 0x0F;
+  for (std::uint16_t i = 0; i < answers; ++i) {
+    in.name();
+    const auto record_type = in.u16();
+    const auto record_class = in.u16();
+    const auto ttl = in.u32();
+    const auto data = in.bytes(in.u16());
+    if (!in.ok()) {
+      return std::nullopt;
+    }
+    // Skips the CNAMEs of a chain, their targets' records follow
+    if (record_class != 1 || record_type != static_cast<std::uint16_t>(type)) {
+      continue;
+    }
+    if (type == dns_type::a && data.size() == 4) {
+      asio::ip::address_v4::bytes_type bytes{};
+      std::copy(data.begin(), data.end(), bytes.begin());
+      reply.addresses.emplace_back(asio::ip::address_v4{bytes});
+    } else if (type == dns_type::aaaa && data.size() == 16) {
+      asio::ip::address_v6::bytes_type bytes{};
+      std::copy(data.begin(), data.end(), bytes.begin());
+      reply.addresses.emplace_back(asio::ip::address_v6{bytes});
+    } else {
+      continue;
+    }
+    reply.ttl = std::min(reply.ttl.value_or(ttl), ttl);
+  }
+  if (reply.addresses.empty()) {
+    // A negative answer holds for its SOA's TTL or minimum (RFC 2308)
+    for (std::uint16_t i = 0; i < authorities && in.ok(); ++i) {
+      in.name();
+      const auto record_type = in.u16();
+      in.u16();
+      const auto ttl = in.u32();
+      const auto length = in.u16();
+      auto soa = in;
+      in.bytes(length);
+      if (in.ok() && record_type == static_cast<std::uint16_t>(dns_type::soa)) {
+        soa.name();
+        soa.name();
+        soa.bytes(16);
+        const auto minimum = soa.u32();
+        if (soa.ok()) {
+          reply.ttl = std::min(ttl, minimum);
+        }
+        break;
+      }
+    }
+  }
+  return reply;
+}
+
+/**
+ * @brief A random query id, for telling answers from spoofed ones
+ * */
+inline std::uint16_t next_dns_query_id() {
+  thread_local std::mt19937 engine{std::random_device{}()};
+  return static_cast<std::uint16_t>(engine());
+}
+
+/**
+ * @brief Where misses go, answers come back through dns_cache::fill()
+ * */
+class dns_lookup {
+ public:
+  dns_lookup() = default;
+  virtual ~dns_lookup() = default;
+  dns_lookup(const dns_lookup&) = delete;
+  dns_lookup& operator=(const dns_lookup&) = delete;
+
+  virtual void start(std::string name) = 0;
+
+  /**
+   * @brief Stop taking lookups, those not yet answered may never be
+   * */
+  virtual void shutdown() = 0;
+};
+
+/**
+ * @brief Runs getaddrinfo on a private thread pool
+ * */
+class getaddrinfo_lookup final : public dns_lookup {
+ public:
+  getaddrinfo_lookup(std::shared_ptr<dns_cache> cache,
+                     std::shared_ptr<const resolver_options> options)
+      : cache_(std::move(cache)),
+        options_(std::move(options)),
+        pool_(std::max<std::size_t>(options_->threads, 1)) {}
+
+  ~getaddrinfo_lookup() override { getaddrinfo_lookup::shutdown(); }
+
+  getaddrinfo_lookup(const getaddrinfo_lookup&) = delete;
+  getaddrinfo_lookup& operator=(const getaddrinfo_lookup&) = delete;
+
+  void start(std::string name) override {
+    asio::post(pool_, [cache = cache_, options = options_,
+                       name = std::move(name)] {
+      auto answer = lookup(name);
+      answer.ttl = answer.error ? options->negative_ttl : options->default_ttl;
+      cache->fill(name, settle(std::move(answer), *options));
+    });
+  }
+
+  void shutdown() override {
+    pool_.stop();
+    pool_.join();
+  }
+
+ private:
+  static dns_answer lookup(const std::string& name) {
+    dns_answer answer;
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    // One entry per address rather than one per socket type
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_ADDRCONFIG;
+    addrinfo* found = nullptr;
+    const int status = ::getaddrinfo(name.c_str(), nullptr, &hints, &found);
+    if (status != 0) {
+      answer.error = error_of(status);
+      return answer;
+    }
+    for (const auto* info = found; info != nullptr; info = info->ai_next) {
+      asio::ip::address address;
+      if (info->ai_family == AF_INET) {
+        sockaddr_in in{};
+        std::memcpy(&in, info->ai_addr, sizeof(in));
+        address = asio::ip::address_v4{ntohl(in.sin_addr.s_addr)};
+      } else if (info->ai_family == AF_INET6) {
+        sockaddr_in6 in6{};
+        std::memcpy(&in6, info->ai_addr, sizeof(in6));
+        asio::ip::address_v6::bytes_type bytes{};
+        std::memcpy(bytes.data(), &in6.sin6_addr, bytes.size());
+        address = asio::ip::address_v6{bytes, in6.sin6_scope_id};
+      } else {
+        continue;
+      }
+      if (std::find(answer.addresses.begin(), answer.addresses.end(),
+                    address) == answer.addresses.end()) {
+        answer.addresses.push_back(address);
+      }
+    }
+    ::freeaddrinfo(found);
+    if (answer.addresses.empty()) {
+      answer.error = asio::error::host_not_found;
+    }
+    return answer;
+  }
+
+  static asio::error_code error_of(int status) {
+    switch (status) {
+      case EAI_AGAIN:
+        return asio::error::host_not_found_try_again;
+      case EAI_MEMORY:
+        return asio::error::no_memory;
+      case EAI_SYSTEM:
+        return {errno, asio::error::get_system_category()};
+      case EAI_FAIL:
+        return asio::error::no_recovery;
+      default:
+        return asio::error::host_not_found;
+    }
+  }
+
+  std::shared_ptr<dns_cache> cache_;
+  std::shared_ptr<const resolver_options> options_;
+  asio::thread_pool pool_;
+};
+
+/**
+ * @brief Asks the configured nameservers for A and AAAA records over UDP
+ *
+ * Both queries go out together on one connected socket, a server that
+ * doesn't answer both within query_timeout, refuses, or fails is skipped.
+ * */
+class udp_dns_lookup final : public dns_lookup {
+ public:
+  udp_dns_lookup(asio::any_io_executor executor,
+                 std::shared_ptr<dns_cache> cache,
+                 std::shared_ptr<const resolver_options> options)
+      : executor_(std::move(executor)),
+        cache_(std::move(cache)),
+        options_(std::move(options)) {}
+
+  void start(std::string name) override {
+    asio::co_spawn(executor_, resolve(cache_, options_, std::move(name)),
+                   asio::detached);
+  }
+
+  // Queries already sent run to their timeout, their answers find nothing
+  // left waiting
+  void shutdown() override {}
+
+ private:
+  using replies = std::array<std::optional<dns_reply>, 2>;
+
+  static constexpr std::array<dns_type, 2> types{dns_type::aaaa,
+                                                 dns_type::a};
+
+  static asio::awaitable<void> resolve(
+      std::shared_ptr<dns_cache> cache,
+      std::shared_ptr<const resolver_options> options, std::string name) {
+    dns_answer answer;
+    answer.error = asio::error::host_not_found_try_again;
+    answer.ttl = options->negative_ttl;
+    if (encode_dns_query(0, name, dns_type::a).empty()) {
+      answer.error = asio::error::host_not_found;
+    } else {
+      for (std::size_t attempt = 0;
+           attempt < std::max<std::size_t>(options->attempts, 1); ++attempt) {
+        std::optional<dns_answer> found;
+        for (const auto& server : options->nameservers) {
+          found = co_await exchange(server, name, *options);
+          if (found) {
+            break;
+          }
+        }
+        if (found) {
+          answer = std::move(*found);
+          break;
+        }
+      }
+    }
+    cache->fill(name, settle(std::move(answer), *options));
+  }
+
+  static asio::awaitable<std::optional<dns_answer>> exchange(
+      asio::ip::udp::endpoint server, std::string name,
+      resolver_options options) {
+    using namespace asio::experimental::awaitable_operators;
+    const auto executor = co_await asio::this_coro::executor;
+    asio::ip::udp::socket socket{executor};
+    asio::error_code ec;
+    socket.open(server.protocol(), ec);
+    if (!ec) {
+      // Connected, so only the server's datagrams are delivered
+      socket.connect(server, ec);
+    }
+    if (ec) {
+      co_return std::nullopt;
+    }
+    std::array<std::uint16_t, 2> ids{next_dns_query_id(), 0};
+    do {
+      ids[1] = next_dns_query_id();
+    } while (ids[1] == ids[0]);
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+      const auto query = encode_dns_query(ids[i], name, types[i]);
+      auto [send_ec, sent] = co_await socket.async_send(
+          asio::buffer(query), asio::as_tuple(asio::use_awaitable));
+      if (send_ec) {
+        co_return std::nullopt;
+      }
+    }
+    asio::steady_timer timer{executor, options.query_timeout};
+    auto result = co_await (receive(socket, name, ids) ||
+                            timer.async_wait(asio::use_awaitable));
+    if (result.index() != 0) {
+      co_return std::nullopt;
+    }
+    const auto& got = std::get<0>(result);
+    if (!got) {
+      co_return std::nullopt;
+    }
+    co_return combine(*got, options);
+  }
+
+  // Both replies, or one saying the name doesn't exist. Nothing if the
+  // server fails or refuses.
+  static asio::awaitable<std::optional<replies>> receive(
+      asio::ip::udp::socket& socket, std::string name,
+      std::array<std::uint16_t, 2> ids) {
+    replies got;
+    std::array<std::uint8_t, 1500> buffer{};
+    while (!got[0] || !got[1]) {
+      auto [ec, n] = co_await socket.async_receive(
+          asio::buffer(buffer), asio::as_tuple(asio::use_awaitable));
+      if (ec) {
+        co_return std::nullopt;
+      }
+      for (std::size_t i = 0; i < ids.size(); ++i) {
+        if (!got[i]) {
+          got[i] = parse_dns_response({buffer.data(), n}, ids[i], name,
+                                      types[i]);
+          if (got[i]) {
+            if (got[i]->rcode == dns_no_such_name) {
+              co_return got;
+            }
+            if (got[i]->rcode != 0) {
+              co_return std::nullopt;
+            }
+            break;
+          }
+        }
+      }
+    }
+    co_return got;
+  }
+
+  static dns_answer combine(const replies& got,
+                            const resolver_options& options) {
+    dns_answer answer;
+    std::optional<std::uint32_t> ttl;
+    for (const auto& reply : got) {
+      if (!reply) {
+        continue;
+      }
+      answer.addresses.insert(answer.addresses.end(),
+                              reply->addresses.begin(),
+                              reply->addresses.end());
+      if (reply->ttl) {
+        ttl = std::min(ttl.value_or(*reply->ttl), *reply->ttl);
+      }
+    }
+    if (answer.addresses.empty()) {
+      answer.error = asio::error::host_not_found;
+    }
+    answer.ttl = ttl ? std::chrono::seconds(*ttl)
+                     : (answer.error ? options.negative_ttl
+                                     : options.default_ttl);
+    return answer;
+  }
+
+  asio::any_io_executor executor_;
+  std::shared_ptr<dns_cache> cache_;
+  std::shared_ptr<const resolver_options> options_;
+};
+
+/**
+ * @brief Puts a composed resolve back in motion once its lookup is done
+ * */
+template <typename Self>
+class composed_resolve_waiter final : public resolve_waiter {
+ public:
+  explicit composed_resolve_waiter(Self&& self) : self_(std::move(self)) {}
+
+  void complete(asio::error_code ec, address_list addresses) override {
+    self_(ec, std::move(addresses));
+  }
+
+ private:
+  Self self_;
+};
+
+/**
+ * @brief The port service names for protocol, numeric or from the
+ * services database
+ * */
+inline std::optional<std::uint16_t> service_port(const std::string& service,
+                                                 const char* protocol) {
+  if (service.empty()) {
+    return 0;
+  }
+  std::uint16_t port = 0;
+  const auto* end = service.data() + service.size();
+  if (const auto [ptr, ec] = std::from_chars(service.data(), end, port);
+      ec == std::errc{} && ptr == end) {
+    return port;
+  }
+  servent entry{};
+  servent* found = nullptr;
+  std::array<char, 1024> buffer{};
+  ::getservbyname_r(service.c_str(), protocol, &entry, buffer.data(),
+                    buffer.size(), &found);
+  if (found == nullptr) {
+    return std::nullopt;
+  }
+  return ntohs(static_cast<std::uint16_t>(found->s_port));
+}
+}  // namespace detail
+
+/**
+ * @brief Resolves host and service names like asio::ip::basic_resolver,
+ * from a cache shared by every thread using it
+ *
+ * Answers are kept for their TTL within [min_ttl, max_ttl], failures for
+ * up to negative_ttl, and resolves of a name already being looked up wait
+ * for that lookup rather than starting their own. IP address literals
+ * skip the cache. Safe to use from several threads at once. Destroying
+ * the resolver fails resolves still waiting with
+ * asio::error::operation_aborted.
+ * */
+template <typename InternetProtocol>
+class basic_caching_resolver {
+ public:
+  using protocol_type = InternetProtocol;
+  using endpoint_type = typename InternetProtocol::endpoint;
+  using results_type = asio::ip::basic_resolver_results<InternetProtocol>;
+  using executor_type = asio::any_io_executor;
+
+  explicit basic_caching_resolver(const executor_type& executor,
+                                  resolver_options options = {})
+      : executor_(executor) {
+    auto shared = std::make_shared<const resolver_options>(std::move(options));
+    cache_ = std::make_shared<detail::dns_cache>(shared->shards,
+                                                 shared->capacity);
+    if (shared->nameservers.empty()) {
+      lookup_ =
+          std::make_unique<detail::getaddrinfo_lookup>(cache_, shared);
+    } else {
+      lookup_ = std::make_unique<detail::udp_dns_lookup>(executor_, cache_,
+                                                         shared);
+    }
+  }
+
+  ~basic_caching_resolver() {
+    if (lookup_) {
+      lookup_->shutdown();
+      cache_->abort();
+    }
+  }
+
+  basic_caching_resolver(basic_caching_resolver&&) noexcept = default;
+  basic_caching_resolver(const basic_caching_resolver&) = delete;
+  basic_caching_resolver& operator=(const basic_caching_resolver&) = delete;
+  basic_caching_resolver& operator=(basic_caching_resolver&&) = delete;
+
+  executor_type get_executor() const noexcept { return executor_; }
+
+  /**
+   * @brief Resolve host and service to endpoints of either address family
+   *
+   * Completion signature `void(asio::error_code, results_type)`. Fails
+   * with asio::error::host_not_found for names that don't exist or have no
+   * addresses, asio::error::host_not_found_try_again when no server
+   * answers, and asio::error::service_not_found for unknown services.
+   * */
+  template <typename CompletionToken>
+  auto async_resolve(std::string host, std::string service,
+                     CompletionToken&& token) {
+    return async_resolve(std::nullopt, std::move(host), std::move(service),
+                         std::forward<CompletionToken>(token));
+  }
+
+  /**
+   * @brief Resolve host and service to endpoints of protocol's family
+   * */
+  template <typename CompletionToken>
+  auto async_resolve(const protocol_type& protocol, std::string host,
+                     std::string service, CompletionToken&& token) {
+    return async_resolve(std::optional{protocol}, std::move(host),
+                         std::move(service),
+                         std::forward<CompletionToken>(token));
+  }
+
+  [[nodiscard]] resolver_stats stats() const { return cache_->stats(); }
+
+ private:
+  template <typename CompletionToken>
+  auto async_resolve(std::optional<protocol_type> protocol, std::string host,
+                     std::string service, CompletionToken&& token) {
+    return asio::async_compose<CompletionToken,
+                               void(asio::error_code, results_type)>(
+        resolve_op{cache_.get(), lookup_.get(), protocol, std::move(host),
+                   std::move(service)},
+        token, executor_);
+  }
+
+  struct resolve_op {
+    enum class state { start, done };
+
+    // Only used while starting, when the resolver is certainly alive
+    detail::dns_cache* cache;
+    detail::dns_lookup* lookup;
+    std::optional<protocol_type> protocol;
+    std::string host;
+    std::string service;
+    state current{state::start};
+    std::uint16_t port{0};
+    asio::error_code ec{};
+    detail::address_list addresses{};
+
+    template <typename Self>
+    void operator()(Self& self) {
+      if (current == state::done) {
+        finish(self);
+        return;
+      }
+      current = state::done;
+      const auto type = protocol_type::v4().type();
+      const auto service_port =
+          detail::service_port(service, type == SOCK_DGRAM ? "udp" : "tcp");
+      asio::error_code literal_ec;
+      const auto literal = asio::ip::make_address(host, literal_ec);
+      if (!service_port) {
+        ec = asio::error::service_not_found;
+      } else if (!literal_ec) {
+        port = *service_port;
+        addresses = std::make_shared<const std::vector<asio::ip::address>>(
+            1, literal);
+      } else {
+        port = *service_port;
+        auto key = detail::dns_key(host);
+        auto* const starter = lookup;
+        const auto found = cache->find(key, ec, addresses, [&self] {
+          return std::make_unique<detail::composed_resolve_waiter<Self>>(
+              std::move(self));
+        });
+        // Unless it was a hit, self now belongs to the cache
+        if (found == detail::dns_cache::outcome::miss) {
+          starter->start(std::move(key));
+        }
+        if (found != detail::dns_cache::outcome::hit) {
+          return;
+        }
+      }
+      // Never complete inside the initiating function
+      asio::post(std::move(self));
+    }
+
+    template <typename Self>
+    void operator()(Self& self, asio::error_code result,
+                    detail::address_list found) {
+      ec = result;
+      addresses = std::move(found);
+      // Likely on a lookup's thread, so hop to the handler's executor
+      asio::post(std::move(self));
+    }
+
+    template <typename Self>
+    void finish(Self& self) {
+      if (ec) {
+        self.complete(ec, results_type{});
+        return;
+      }
+      std::vector<endpoint_type> endpoints;
+      for (const auto& address : *addresses) {
+        if (!protocol ||
+            (*protocol == protocol_type::v6()) == address.is_v6()) {
+          endpoints.emplace_back(address, port);
+        }
+      }
+      if (endpoints.empty()) {
+        self.complete(asio::error::host_not_found, results_type{});
+        return;
+      }
+      self.complete({}, results_type::create(endpoints.begin(),
+                                             endpoints.end(), host, service));
+    }
+  };
+
+  executor_type executor_;
+  std::shared_ptr<detail::dns_cache> cache_;
+  std::unique_ptr<detail::dns_lookup> lookup_;
+};
+
+using caching_resolver = basic_caching_resolver<asio::ip::tcp>;
+}  // namespace garak
+
+#endif
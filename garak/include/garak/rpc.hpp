@@ -0,0 +1,611 @@
+#ifndef GARAK_RPC_HPP
+#define GARAK_RPC_HPP
+
+/**
+ * @file garak/rpc.hpp
+ * @brief Multiplexed request/response RPC over a single framed connection
+ * @date 2026-10-19
+ *
+ * Every frame carries a 16 byte RPC header in front of its body:
+ *
+ *   u64 correlation id, u32 method, u8 kind, u8 status, u16 reserved
+ *
+ * The client may have any number of calls in flight on one connection, and
+ * the server runs each request as its own coroutine, so responses go back
+ * in whatever order the handlers finish.
+ */
+
+#include <array>
+#include <asio/as_tuple.hpp>
+#include <asio/bind_cancellation_slot.hpp>
+#include <asio/cancellation_signal.hpp>
+#include <asio/co_spawn.hpp>
+#include <asio/compose.hpp>
+#include <asio/detached.hpp>
+#include <asio/dispatch.hpp>
+#include <asio/error.hpp>
+#include <asio/post.hpp>
+#include <asio/steady_timer.hpp>
+#include <asio/use_awaitable.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <iterator>
+#include <garak/wire.hpp>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace garak {
+/**
+ * @brief Errors reported to a caller by garak::rpc_client
+ * */
+enum class rpc_errc {
+  /// The server handler failed while serving the request
+  remote_error = 1,
+  /// The server has no handler for the method
+  unknown_method,
+  /// The peer sent a frame that is not a valid RPC message
+  protocol_error,
+};
+
+namespace detail {
+class rpc_category_impl : public std::error_category {
+ public:
+  [[nodiscard]] const char* name() const noexcept override {
+    return "garak.rpc";
+  }
+
+  [[nodiscard]] std::string message(int value) const override {
+    switch (static_cast<rpc_errc>(value)) {
+      case rpc_errc::remote_error:
+        return "remote handler failed";
+      case rpc_errc::unknown_method:
+        return "unknown method";
+      case rpc_errc::protocol_error:
+        return "malformed rpc frame";
+    }
+    return "unknown rpc error";
+  }
+};
+}  // namespace detail
+
+inline const std::error_category& rpc_category() {
+  static const detail::rpc_category_impl category;
+  return category;
+}
+
+inline std::error_code make_error_code(rpc_errc value) {
+  return {static_cast<int>(value), rpc_category()};
+}
+}  // namespace garak
+
+template <>
+struct std::is_error_code_enum<garak::rpc_errc> : std::true_type {};
+
+namespace garak {
+using rpc_method = std::uint32_t;
+
+namespace detail {
+enum class rpc_kind : std::uint8_t { request = 0, response = 1, cancel = 2 };
+
+enum class rpc_status : std::uint8_t {
+  ok = 0,
+  unknown_method = 1,
+  remote_error = 2,
+};
+
+struct rpc_header {
+  static constexpr std::size_t size = 16;
+
+  std::uint64_t correlation_id{0};
+  rpc_method method{0};
+  rpc_kind kind{rpc_kind::request};
+  rpc_status status{rpc_status::ok};
+
+  [[nodiscard]] std::array<std::byte, size> encode() const {
+    std::array<std::byte, size> out{};
+    wire::detail::store(out.data(), correlation_id);
+    wire::detail::store(out.data() + 8, method);
+    wire::detail::store(out.data() + 12, static_cast<std::uint8_t>(kind));
+    wire::detail::store(out.data() + 13, static_cast<std::uint8_t>(status));
+    return out;
+  }
+
+  static std::optional<rpc_header> decode(std::span<const std::byte> frame) {
+    if (frame.size() < size) {
+      return std::nullopt;
+    }
+    rpc_header header;
+    header.correlation_id = wire::detail::load<std::uint64_t>(frame.data());
+    header.method = wire::detail::load<rpc_method>(frame.data() + 8);
+    header.kind = static_cast<rpc_kind>(
+        wire::detail::load<std::uint8_t>(frame.data() + 12));
+    header.status = static_cast<rpc_status>(
+        wire::detail::load<std::uint8_t>(frame.data() + 13));
+    if (header.kind > rpc_kind::cancel ||
+        header.status > rpc_status::remote_error) {
+      return std::nullopt;
+    }
+    return header;
+  }
+};
+
+/**
+ * @brief The half shared by client and server, owns the session and
+ * serialises writes through a queue
+ * */
+template <typename Session>
+class rpc_connection
+    : public std::enable_shared_from_this<rpc_connection<Session>> {
+ public:
+  using executor_type = decltype(std::declval<Session&>().get_executor());
+
+  explicit rpc_connection(Session session) : session_(std::move(session)) {}
+
+  virtual ~rpc_connection() = default;
+  rpc_connection(const rpc_connection&) = delete;
+  rpc_connection& operator=(const rpc_connection&) = delete;
+  rpc_connection(rpc_connection&&) = delete;
+  rpc_connection& operator=(rpc_connection&&) = delete;
+
+  executor_type get_executor() { return session_.get_executor(); }
+
+  Session& session() { return session_; }
+
+  [[nodiscard]] bool closed() const { return closed_; }
+
+  [[nodiscard]] asio::error_code close_reason() const { return close_reason_; }
+
+  void send(const rpc_header& header, std::vector<std::byte> body = {}) {
+    if (closed_) {
+      return;
+    }
+    queue_.push_back(outgoing{header.encode(), std::move(body)});
+    if (!writing_) {
+      write_next();
+    }
+  }
+
+  void close(asio::error_code ec) {
+    if (closed_) {
+      return;
+    }
+    closed_ = true;
+    close_reason_ = ec;
+    // A write in flight still reads the front of the queue, its completion
+    // drops it
+    queue_.erase(writing_ ? std::next(queue_.begin()) : queue_.begin(),
+                 queue_.end());
+    session_.close();
+    on_close(ec);
+  }
+
+ protected:
+  virtual void on_close(asio::error_code ec) = 0;
+
+ private:
+  struct outgoing {
+    std::array<std::byte, rpc_header::size> header;
+    std::vector<std::byte> body;
+  };
+
+  void write_next() {
+    writing_ = true;
+    const auto& front = queue_.front();
+    const std::array<asio::const_buffer, 2> buffers{asio::buffer(front.header),
+                                                    asio::buffer(front.body)};
+    session_.async_write_frame(
+        buffers,
+        [self = this->shared_from_this()](asio::error_code ec, std::size_t) {
+          self->writing_ = false;
+          if (self->closed_) {
+            self->queue_.clear();
+            return;
+          }
+          if (ec) {
+            self->close(ec);
+            return;
+          }
+          self->queue_.pop_front();
+          if (!self->queue_.empty()) {
+            self->write_next();
+          }
+        });
+  }
+
+  Session session_;
+  std::deque<outgoing> queue_;
+  bool writing_{false};
+  bool closed_{false};
+  asio::error_code close_reason_;
+};
+}  // namespace detail
+
+/**
+ * @brief Issues calls over one connection, with any number outstanding.
+ *
+ * Each call carries a 64-bit correlation id, a deadline, and honours the
+ * cancellation slot bound to its completion token:
+ *
+ * @code
+ * garak::rpc_client client{garak::framed_stream<tcp::socket>{std::move(s)}};
+ * client.start();
+ * auto reply = co_await client.async_call(method, std::move(request),
+ *                                         100ms, asio::use_awaitable);
+ * @endcode
+ *
+ * The client is not thread safe, drive it from the session's executor or
+ * give the session a strand when the io_context runs on several threads.
+ * */
+template <typename Session>
+class rpc_client {
+ public:
+  using clock = std::chrono::steady_clock;
+  using executor_type = typename detail::rpc_connection<Session>::executor_type;
+
+  static constexpr clock::duration default_timeout = std::chrono::seconds(30);
+
+  explicit rpc_client(Session session,
+                      clock::duration timeout = default_timeout)
+      : impl_(std::make_shared<impl>(std::move(session), timeout)) {}
+
+  ~rpc_client() {
+    if (impl_) {
+      close();
+    }
+  }
+
+  rpc_client(const rpc_client&) = delete;
+  rpc_client& operator=(const rpc_client&) = delete;
+  rpc_client(rpc_client&&) noexcept = default;
+  rpc_client& operator=(rpc_client&&) noexcept = default;
+
+  executor_type get_executor() { return impl_->get_executor(); }
+
+  /**
+   * @brief Start reading responses
+   * */
+  void start() {
+    asio::co_spawn(impl_->get_executor(), impl::read_loop(impl_),
+                   asio::detached);
+  }
+
+  /**
+   * @brief Close the connection, failing every outstanding call with
+   * asio::error::operation_aborted
+   * */
+  void close() {
+    asio::dispatch(impl_->get_executor(), [self = impl_] {
+      self->close(asio::error::operation_aborted);
+    });
+  }
+
+  /**
+   * @brief Call method with the client's default timeout
+   * */
+  template <typename CompletionToken>
+  auto async_call(rpc_method method, std::vector<std::byte> request,
+                  CompletionToken&& token) {
+    return async_call(method, std::move(request), impl_->timeout,
+                      std::forward<CompletionToken>(token));
+  }
+
+  /**
+   * @brief Call method, completing with the response body
+   *
+   * Completion signature `void(asio::error_code, std::vector<std::byte>)`.
+   * Fails with asio::error::timed_out once timeout passes, and with
+   * asio::error::operation_aborted when cancelled, either way the server is
+   * told to abandon the request.
+   * */
+  template <typename CompletionToken>
+  auto async_call(rpc_method method, std::vector<std::byte> request,
+                  clock::duration timeout, CompletionToken&& token) {
+    return asio::async_compose<CompletionToken,
+                               void(asio::error_code, std::vector<std::byte>)>(
+        call_op{impl_, method, std::move(request), timeout}, token,
+        impl_->get_executor());
+  }
+
+  /**
+   * @brief Number of calls waiting on a response
+   * */
+  [[nodiscard]] std::size_t outstanding() const {
+    return impl_->pending.size();
+  }
+
+ private:
+  struct pending_call {
+    explicit pending_call(const executor_type& executor) : timer(executor) {}
+
+    asio::steady_timer timer;
+    bool done{false};
+    asio::error_code ec;
+    std::vector<std::byte> response;
+  };
+
+  class impl : public detail::rpc_connection<Session> {
+   public:
+    impl(Session session, clock::duration default_timeout)
+        : detail::rpc_connection<Session>(std::move(session)),
+          timeout(default_timeout) {}
+
+    static asio::awaitable<void> read_loop(std::shared_ptr<impl> self) {
+      while (!self->closed()) {
+        auto [ec, frame] = co_await self->session().async_read_frame(
+            asio::as_tuple(asio::use_awaitable));
+        if (ec) {
+          self->close(ec);
+          co_return;
+        }
+        const auto header = detail::rpc_header::decode(frame);
+        if (!header || header->kind != detail::rpc_kind::response) {
+          self->close(rpc_errc::protocol_error);
+          co_return;
+        }
+        self->complete(*header, frame.subspan(detail::rpc_header::size));
+      }
+    }
+
+    void complete(const detail::rpc_header& header,
+                  std::span<const std::byte> body) {
+      auto it = pending.find(header.correlation_id);
+      if (it == pending.end()) {
+        // The caller already gave up on this one
+        return;
+      }
+      auto& call = *it->second;
+      call.done = true;
+      switch (header.status) {
+        case detail::rpc_status::ok:
+          call.response.assign(body.begin(), body.end());
+          break;
+        case detail::rpc_status::unknown_method:
+          call.ec = rpc_errc::unknown_method;
+          break;
+        case detail::rpc_status::remote_error:
+          call.ec = rpc_errc::remote_error;
+          break;
+      }
+      call.timer.cancel();
+      pending.erase(it);
+    }
+
+    clock::duration timeout;
+    std::uint64_t next_id{0};
+    std::unordered_map<std::uint64_t, std::shared_ptr<pending_call>> pending;
+
+   protected:
+    void on_close(asio::error_code ec) override {
+      for (auto& [id, call] : pending) {
+        call->done = true;
+        call->ec = ec;
+        call->timer.cancel();
+      }
+      pending.clear();
+    }
+  };
+
+  struct call_op {
+    enum class state { start, ready, waiting };
+
+    std::shared_ptr<impl> owner;
+    rpc_method method;
+    std::vector<std::byte> request;
+    clock::duration timeout;
+    state current{state::start};
+    std::uint64_t id{0};
+    std::shared_ptr<pending_call> call{};
+
+    template <typename Self>
+    void operator()(Self& self, asio::error_code ec = {}) {
+      switch (current) {
+        case state::start:
+          self.reset_cancellation_state(asio::enable_total_cancellation());
+          // Hop onto the connection's executor, this also keeps the call
+          // from completing inside the initiating function
+          current = state::ready;
+          asio::post(owner->get_executor(), std::move(self));
+          return;
+
+        case state::ready:
+          if (owner->closed()) {
+            self.complete(owner->close_reason(), {});
+            return;
+          }
+          if (self.get_cancellation_state().cancelled() !=
+              asio::cancellation_type::none) {
+            self.complete(asio::error::operation_aborted, {});
+            return;
+          }
+          id = ++owner->next_id;
+          call = std::make_shared<pending_call>(owner->get_executor());
+          call->timer.expires_after(timeout);
+          owner->pending.emplace(id, call);
+          owner->send(detail::rpc_header{id, method}, std::move(request));
+          current = state::waiting;
+          call->timer.async_wait(std::move(self));
+          return;
+
+        case state::waiting:
+          if (call->done) {
+            self.complete(call->ec, std::move(call->response));
+            return;
+          }
+          owner->pending.erase(id);
+          owner->send(detail::rpc_header{id, method, detail::rpc_kind::cancel});
+          self.complete(ec ? asio::error_code{asio::error::operation_aborted}
+                           : asio::error_code{asio::error::timed_out},
+                        {});
+          return;
+      }
+    }
+  };
+
+  std::shared_ptr<impl> impl_;
+};
+
+/**
+ * @brief Serves requests from one connection, each in its own coroutine.
+ *
+ * The handler is called as `handler(method, request_body)` and returns an
+ * `asio::awaitable<std::vector<std::byte>>` holding the response body.
+ * Throwing `std::system_error(rpc_errc::unknown_method)` reports an unknown
+ * method, any other exception a remote error. A handler whose request the
+ * client abandons has its cancellation slot triggered.
+ * */
+template <typename Session, typename Handler>
+class rpc_server {
+ public:
+  using executor_type = typename detail::rpc_connection<Session>::executor_type;
+
+  rpc_server(Session session, Handler handler)
+      : impl_(std::make_shared<impl>(std::move(session), std::move(handler))) {
+  }
+
+  ~rpc_server() {
+    if (impl_) {
+      close();
+    }
+  }
+
+  rpc_server(const rpc_server&) = delete;
+  rpc_server& operator=(const rpc_server&) = delete;
+  rpc_server(rpc_server&&) noexcept = default;
+  rpc_server& operator=(rpc_server&&) noexcept = default;
+
+  executor_type get_executor() { return impl_->get_executor(); }
+
+  /**
+   * @brief Start reading requests
+   * */
+  void start() {
+    asio::co_spawn(impl_->get_executor(), impl::read_loop(impl_),
+                   asio::detached);
+  }
+
+  /**
+   * @brief Close the connection and cancel every running handler
+   * */
+  void close() {
+    asio::dispatch(impl_->get_executor(), [self = impl_] {
+      self->close(asio::error::operation_aborted);
+    });
+  }
+
+  /**
+   * @brief Number of requests currently being handled
+   * */
+  [[nodiscard]] std::size_t in_flight() const {
+    return impl_->in_flight.size();
+  }
+
+ private:
+  class impl : public detail::rpc_connection<Session> {
+   public:
+    impl(Session session, Handler request_handler)
+        : detail::rpc_connection<Session>(std::move(session)),
+          handler(std::move(request_handler)) {}
+
+    static asio::awaitable<void> read_loop(std::shared_ptr<impl> self) {
+      while (!self->closed()) {
+        auto [ec, frame] = co_await self->session().async_read_frame(
+            asio::as_tuple(asio::use_awaitable));
+        if (ec) {
+          self->close(ec);
+          co_return;
+        }
+        const auto header = detail::rpc_header::decode(frame);
+        if (!header || header->kind == detail::rpc_kind::response) {
+          self->close(rpc_errc::protocol_error);
+          co_return;
+        }
+        if (header->kind == detail::rpc_kind::cancel) {
+          self->cancel(header->correlation_id);
+        } else {
+          self->spawn(*header, frame.subspan(detail::rpc_header::size));
+        }
+      }
+    }
+
+    void spawn(const detail::rpc_header& header,
+               std::span<const std::byte> body) {
+      auto signal = std::make_shared<asio::cancellation_signal>();
+      in_flight.insert_or_assign(header.correlation_id, signal);
+      asio::co_spawn(
+          this->get_executor(),
+          handler(header.method, std::vector<std::byte>(body.begin(),
+                                                        body.end())),
+          asio::bind_cancellation_slot(
+              signal->slot(),
+              [self = std::static_pointer_cast<impl>(this->shared_from_this()),
+               header, signal](std::exception_ptr error,
+                               std::vector<std::byte> response) {
+                self->respond(header, error, std::move(response));
+              }));
+    }
+
+    void cancel(std::uint64_t id) {
+      auto it = in_flight.find(id);
+      if (it == in_flight.end()) {
+        return;
+      }
+      auto signal = std::move(it->second);
+      in_flight.erase(it);
+      signal->emit(asio::cancellation_type::terminal);
+    }
+
+    void respond(detail::rpc_header header, const std::exception_ptr& error,
+                 std::vector<std::byte> response) {
+      if (in_flight.erase(header.correlation_id) == 0) {
+        // Cancelled by the client, nobody is waiting for the answer
+        return;
+      }
+      header.kind = detail::rpc_kind::response;
+      if (error) {
+        response.clear();
+        header.status = classify(error);
+      }
+      this->send(header, std::move(response));
+    }
+
+    static detail::rpc_status classify(const std::exception_ptr& error) {
+      try {
+        std::rethrow_exception(error);
+      } catch (const std::system_error& e) {
+        if (e.code() == rpc_errc::unknown_method) {
+          return detail::rpc_status::unknown_method;
+        }
+      } catch (...) {
+      }
+      return detail::rpc_status::remote_error;
+    }
+
+    Handler handler;
+    std::unordered_map<std::uint64_t,
+                       std::shared_ptr<asio::cancellation_signal>>
+        in_flight;
+
+   protected:
+    void on_close(asio::error_code /*ec*/) override {
+      auto running = std::move(in_flight);
+      in_flight.clear();
+      for (auto& [id, signal] : running) {
+        signal->emit(asio::cancellation_type::terminal);
+      }
+    }
+  };
+
+  std::shared_ptr<impl> impl_;
+};
+}  // namespace garak
+
+#endif
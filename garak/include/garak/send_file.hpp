@@ -0,0 +1,286 @@
+#ifndef GARAK_SEND_FILE_HPP
+#define GARAK_SEND_FILE_HPP
+
+/**
+ * @file garak/send_file.hpp
+ * @brief Zero copy file to socket transfers
+ * @date 2026-10-19
+ *
+ * Serving a file with read() and async_write copies every byte into user
+ * space and back out again. async_send_file hands the kernel the file
+ * instead: sendfile(2) moves pages from the page cache straight into the
+ * socket, and where sendfile can't read the source the bytes are spliced
+ * through a pipe, which is no copy either.
+ *
+ * @code
+ * auto [ec, sent] = co_await garak::async_send_file(
+ *     socket, file, 0, size, asio::as_tuple(asio::use_awaitable));
+ * @endcode
+ */
+
+#include <algorithm>
+#include <array>
+#include <asio/async_result.hpp>
+#include <asio/compose.hpp>
+#include <asio/error.hpp>
+#include <asio/posix/stream_descriptor.hpp>
+#include <asio/post.hpp>
+#include <asio/socket_base.hpp>
+#include <cerrno>
+#include <concepts>
+#include <cstddef>
+#include <fcntl.h>
+#include <memory>
+#include <sys/sendfile.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <utility>
+
+namespace garak {
+/**
+ * @brief A file object with a POSIX descriptor, e.g.
+ * asio::random_access_file or asio::stream_file
+ * */
+template <typename File>
+concept native_file = requires(File& file) {
+  { file.native_handle() } -> std::convertible_to<int>;
+};
+
+namespace detail {
+/**
+ * @brief Both ends of a non-blocking pipe, closed on destruction
+ * */
+class pipe_pair {
+ public:
+  pipe_pair() = default;
+  pipe_pair(pipe_pair&& other) noexcept
+      : ends_(std::exchange(other.ends_, {-1, -1})) {}
+  pipe_pair& operator=(pipe_pair&& other) noexcept {
+    if (this != &other) {
+      close();
+      ends_ = std::exchange(other.ends_, {-1, -1});
+    }
+    return *this;
+  }
+  ~pipe_pair() { close(); }
+
+  pipe_pair(const pipe_pair&) = delete;
+  pipe_pair& operator=(const pipe_pair&) = delete;
+
+  /**
+   * @brief Create the pipe, unless already open
+   * */
+  bool open(asio::error_code& ec) {
+    if (is_open()) {
+      return true;
+    }
+    if (::pipe2(ends_.data(), O_CLOEXEC | O_NONBLOCK) != 0) {
+      ec = asio::error_code(errno, asio::system_category());
+      return false;
+    }
+    return true;
+  }
+
+  [[nodiscard]] bool is_open() const { return ends_[0] >= 0; }
+  [[nodiscard]] int read_end() const { return ends_[0]; }
+  [[nodiscard]] int write_end() const { return ends_[1]; }
+
+ private:
+  void close() {
+    for (int& fd : ends_) {
+      if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+      }
+    }
+  }
+
+  std::array<int, 2> ends_{-1, -1};
+};
+
+template <typename Socket>
+struct send_file_op {
+  // Largest count one sendfile or splice call is given
+  static constexpr std::size_t max_step = std::size_t{1} << 30;
+
+  // What pump() stopped for
+  enum class stop { done, socket_full, source_empty };
+
+  Socket& socket;
+  int file;
+  off_t offset;
+  std::size_t remaining;
+  std::size_t sent{0};
+  bool started{false};
+  bool posted{false};
+  asio::error_code failure{};
+  // Set once sendfile turns out not to read this file
+  bool splicing{false};
+  // Set for sources without offsets, e.g. pipes
+  bool streaming{false};
+  pipe_pair pipe{};
+  // Read from the file but not yet into the socket
+  std::size_t piped{0};
+  // A copy of the source's descriptor to wait on, once it has run dry; a
+  // copy, as the caller may have the descriptor itself in the reactor
+  std::unique_ptr<asio::posix::stream_descriptor> source{};
+
+  template <typename Self>
+  void operator()(Self& self, asio::error_code ec = {}) {
+    if (posted) {
+      self.complete(failure, sent);
+      return;
+    }
+    const bool first = !started;
+    started = true;
+    if (first) {
+      socket.native_non_blocking(true, ec);
+    }
+    const auto stopped = ec ? stop::done : pump(ec);
+    if (stopped == stop::socket_full) {
+      socket.async_wait(asio::socket_base::wait_write, std::move(self));
+      return;
+    }
+    if (stopped == stop::source_empty && watch_source(ec)) {
+      source->async_wait(asio::posix::stream_descriptor::wait_read,
+                         std::move(self));
+      return;
+    }
+    if (first) {
+      // Never complete from inside the initiating function
+      failure = ec;
+      posted = true;
+      asio::post(std::move(self));
+      return;
+    }
+    self.complete(ec, sent);
+  }
+
+  // Set up the wait on the source the first time it runs dry
+  bool watch_source(asio::error_code& ec) {
+    if (source) {
+      return true;
+    }
+    const int copy = ::fcntl(file, F_DUPFD_CLOEXEC, 0);
+    if (copy < 0) {
+      ec = asio::error_code(errno, asio::system_category());
+      return false;
+    }
+    source = std::make_unique<asio::posix::stream_descriptor>(
+        socket.get_executor());
+    source->assign(copy, ec);
+    if (ec) {
+      ::close(copy);
+      return false;
+    }
+    return true;
+  }
+
+  // Move bytes until the socket is full or a live source has nothing yet
+  stop pump(asio::error_code& ec) {
+    while (remaining > 0 || piped > 0) {
+      if (!splicing) {
+        const auto n = ::sendfile(socket.native_handle(), file, &offset,
+                                  std::min(remaining, max_step));
+        if (n > 0) {
+          sent += static_cast<std::size_t>(n);
+          remaining -= static_cast<std::size_t>(n);
+          continue;
+        }
+        if (n == 0) {
+          // The file ended first
+          return stop::done;
+        }
+        if (errno == EINTR) {
+          continue;
+        }
+        if (errno == EAGAIN) {
+          return stop::socket_full;
+        }
+        if (errno != EINVAL && errno != ENOSYS && errno != ESPIPE) {
+          ec = asio::error_code(errno, asio::system_category());
+          return stop::done;
+        }
+        splicing = true;
+        continue;
+      }
+      if (piped == 0) {
+        if (!pipe.open(ec)) {
+          return stop::done;
+        }
+        const auto n = ::splice(file, streaming ? nullptr : &offset,
+                                pipe.write_end(), nullptr,
+                                std::min(remaining, max_step),
+                                SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (n > 0) {
+          piped = static_cast<std::size_t>(n);
+          remaining -= piped;
+        } else if (n == 0) {
+          return stop::done;
+        } else if (errno == ESPIPE && !streaming) {
+          streaming = true;
+          continue;
+        } else if (errno == EINTR) {
+          continue;
+        } else if (errno == EAGAIN) {
+          return stop::source_empty;
+        } else {
+          ec = asio::error_code(errno, asio::system_category());
+          return stop::done;
+        }
+      }
+      const auto n =
+          ::splice(pipe.read_end(), nullptr, socket.native_handle(), nullptr,
+                   piped, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+      if (n > 0) {
+        piped -= static_cast<std::size_t>(n);
+        sent += static_cast<std::size_t>(n);
+      } else if (n < 0 && errno == EAGAIN) {
+        return stop::socket_full;
+      } else if (n < 0 && errno == EINTR) {
+        continue;
+      } else {
+        ec = n < 0 ? asio::error_code(errno, asio::system_category())
+                   : asio::error::broken_pipe;
+        return stop::done;
+      }
+    }
+    return stop::done;
+  }
+};
+}  // namespace detail
+
+/**
+ * @brief Send length bytes of file from offset to socket, without copying
+ * them through user space
+ *
+ * The file's own position is left alone, except for sources that have no
+ * offsets such as pipes, which are read from where they are. Completion
+ * signature `void(asio::error_code, std::size_t)` with the bytes sent,
+ * short of length only on error or when the file ends first. Waits on the
+ * socket's writability between partial sends, and on a source such as an
+ * empty pipe until it has data, and supports cancellation of those waits.
+ * Leaves socket in non-blocking mode.
+ * */
+template <typename Socket, typename CompletionToken>
+auto async_send_file(Socket& socket, int file, off_t offset,
+                     std::size_t length, CompletionToken&& token) {
+  return asio::async_compose<CompletionToken,
+                             void(asio::error_code, std::size_t)>(
+      detail::send_file_op<Socket>{socket, file, offset, length}, token,
+      socket);
+}
+
+/**
+ * @brief async_send_file from a file object's descriptor
+ * */
+template <typename Socket, native_file File, typename CompletionToken>
+auto async_send_file(Socket& socket, File& file, off_t offset,
+                     std::size_t length, CompletionToken&& token) {
+  const int descriptor = file.native_handle();
+  return async_send_file(socket, descriptor, offset, length,
+                         std::forward<CompletionToken>(token));
+}
+}  // namespace garak
+
+#endif
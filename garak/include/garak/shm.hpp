@@ -0,0 +1,869 @@
+#ifndef GARAK_SHM_HPP
+#define GARAK_SHM_HPP
+
+/**
+ * @file garak/shm.hpp
+ * @brief A shared memory transport for clients on the same host
+ * @date 2026-10-19
+ *
+ * Even over a unix socket every message is copied into the kernel and out
+ * again, with a system call on each side. Here the two sides negotiate over
+ * a unix socket once: the connecting side creates a memfd holding a pair of
+ * single producer, single consumer rings and passes it, along with eventfd
+ * doorbells, over SCM_RIGHTS. From then on a frame is written straight into
+ * the ring and read in place by the peer. A doorbell is only rung when the
+ * peer has said it is going to sleep, so a busy pair exchanges frames
+ * without any system calls at all.
+ *
+ * shm_session is a framed session like garak::framed_stream, so it carries
+ * garak::rpc_client and garak::rpc_server unchanged.
+ *
+ * @code
+ * // server, for each accepted unix socket
+ * auto [ec, session] = co_await garak::async_shm_accept(
+ *     std::move(socket), asio::as_tuple(asio::use_awaitable));
+ * // client
+ * auto [ec, session] = co_await garak::async_shm_connect(
+ *     std::move(socket), garak::shm_options{},
+ *     asio::as_tuple(asio::use_awaitable));
+ * @endcode
+ *
+ * The unix socket stays open alongside the rings, so a peer that exits
+ * without closing still shows up as the end of the session.
+ */
+
+#include <fcntl.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <array>
+#include <asio/any_io_executor.hpp>
+#include <asio/async_result.hpp>
+#include <asio/buffer.hpp>
+#include <asio/compose.hpp>
+#include <asio/error.hpp>
+#include <asio/local/stream_protocol.hpp>
+#include <asio/posix/stream_descriptor.hpp>
+#include <asio/post.hpp>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <garak/fd_passing.hpp>
+#include <memory>
+#include <new>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace garak {
+/**
+ * @brief Settings the connecting side picks for a shm_session
+ * */
+struct shm_options {
+  /// Bytes in each direction's ring, rounded up to a power of two; a frame
+  /// may take at most half of it
+  std::size_t ring_size{1024 * 1024};
+};
+
+namespace detail {
+/**
+ * @brief The control block of one ring, at the start of the shared memory
+ *
+ * Positions count bytes since the ring was created. The consumer's and the
+ * producer's fields sit on cache lines of their own.
+ * */
+struct shm_ring_header {
+  // Consumer's position
+  alignas(64) std::atomic<std::uint64_t> head;
+  // Set while the consumer waits on its doorbell for data
+  std::atomic<std::uint32_t> consumer_waiting;
+  // Producer's position
+  alignas(64) std::atomic<std::uint64_t> tail;
+  // Set while the producer waits on its doorbell for room
+  std::atomic<std::uint32_t> producer_waiting;
+  // Set by either side on close
+  std::atomic<std::uint32_t> closed;
+};
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free &&
+                  std::atomic<std::uint32_t>::is_always_lock_free,
+              "shared memory rings need address free atomics");
+
+/**
+ * @brief What the connecting side sends along with the descriptors
+ * */
+struct shm_offer {
+  static constexpr std::uint32_t expected_magic = 0x67726b73;  // "grks"
+  static constexpr std::uint32_t current_version = 1;
+
+  std::uint32_t magic{expected_magic};
+  std::uint32_t version{current_version};
+  std::uint64_t ring_size{0};
+};
+
+/**
+ * @brief One side's view of the shared rings and the descriptors around
+ * them, owned by a shm_session
+ *
+ * The memory holds both ring headers followed by both rings' data. Ring 0
+ * carries frames from the connecting side, ring 1 from the accepting side.
+ * Each ring has two eventfd doorbells: one rung when data arrives, one
+ * when room frees up.
+ * */
+class shm_channel : public std::enable_shared_from_this<shm_channel> {
+ public:
+  using socket_type = asio::local::stream_protocol::socket;
+
+  // Each record is a u32 length and the payload, padded to this
+  static constexpr std::size_t record_alignment = 8;
+  static constexpr std::uint32_t wrap_marker = 0xFFFFFFFF;
+  static constexpr std::size_t header_stride = 128;
+  static constexpr std::size_t descriptor_count = 5;
+  static constexpr int required_seals = F_SEAL_SHRINK | F_SEAL_GROW;
+
+  explicit shm_channel(socket_type socket)
+      : socket_(std::move(socket)),
+        doorbells_{asio::posix::stream_descriptor{socket_.get_executor()},
+                   asio::posix::stream_descriptor{socket_.get_executor()},
+                   asio::posix::stream_descriptor{socket_.get_executor()},
+                   asio::posix::stream_descriptor{socket_.get_executor()}} {}
+
+  ~shm_channel() {
+    if (memory_ != nullptr) {
+      ::munmap(memory_, mapped_);
+    }
+    if (memfd_ >= 0) {
+      ::close(memfd_);
+    }
+  }
+
+  shm_channel(const shm_channel&) = delete;
+  shm_channel& operator=(const shm_channel&) = delete;
+
+  socket_type& socket() { return socket_; }
+  asio::any_io_executor get_executor() { return socket_.get_executor(); }
+  [[nodiscard]] std::uint64_t ring_size() const { return capacity_; }
+
+  /**
+   * @brief The memfd and the doorbells, in the order adopt() takes them
+   * */
+  std::array<int, descriptor_count> descriptors() {
+    std::array<int, descriptor_count> out{memfd_};
+    for (std::size_t i = 0; i < doorbells_.size(); ++i) {
+      out[i + 1] = doorbells_[i].native_handle();
+    }
+    return out;
+  }
+
+  /**
+   * @brief Bytes mapped for two rings of capacity each
+   * */
+  static std::size_t mapping_size(std::uint64_t capacity) {
+    return 2 * header_stride + 2 * capacity;
+  }
+
+  /**
+   * @brief The connecting side: create the memory and doorbells
+   * */
+  bool create(std::size_t ring_size, asio::error_code& ec) {
+    capacity_ = std::bit_ceil(std::max<std::uint64_t>(ring_size, 4096));
+    memfd_ = ::memfd_create("garak-shm", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    // Sealed at its size, so neither side can truncate the memory under
+    // the other's mapping
+    if (memfd_ < 0 ||
+        ::ftruncate(memfd_, static_cast<off_t>(mapping_size(capacity_))) !=
+            0 ||
+        ::fcntl(memfd_, F_ADD_SEALS, required_seals) != 0 || !map(ec)) {
+      return fail(ec);
+    }
+    for (std::size_t ring = 0; ring < 2; ++ring) {
+      std::construct_at(header(ring));
+    }
+    for (auto& doorbell : doorbells_) {
+      const int fd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+      if (fd < 0) {
+        return fail(ec);
+      }
+      doorbell.assign(fd, ec);
+      if (ec) {
+        ::close(fd);
+        return false;
+      }
+    }
+    attach(0);
+    return true;
+  }
+
+  /**
+   * @brief The accepting side: take over the descriptors the connecting
+   * side sent, memfd first, and map the memory
+   * */
+  bool adopt(const shm_offer& offer, std::vector<unique_fd>& descriptors,
+             asio::error_code& ec) {
+    memfd_ = descriptors[0].release();
+    for (std::size_t i = 0; i < doorbells_.size(); ++i) {
+      doorbells_[i].assign(descriptors[i + 1].release(), ec);
+      if (ec) {
+        return false;
+      }
+    }
+    struct stat st {};
+    if (offer.magic != shm_offer::expected_magic ||
+        offer.version != shm_offer::current_version ||
+        !std::has_single_bit(offer.ring_size) || offer.ring_size < 4096 ||
+        ::fstat(memfd_, &st) != 0 ||
+        static_cast<std::uint64_t>(st.st_size) !=
+            mapping_size(offer.ring_size) ||
+        (::fcntl(memfd_, F_GET_SEALS) & required_seals) != required_seals) {
+      ec = asio::error::invalid_argument;
+      return false;
+    }
+    capacity_ = offer.ring_size;
+    if (!map(ec)) {
+      return false;
+    }
+    attach(1);
+    return true;
+  }
+
+  /**
+   * @brief Once negotiated, the memfd isn't needed, and the socket is only
+   * watched for the peer going away
+   * */
+  void start() {
+    ::close(std::exchange(memfd_, -1));
+    socket_.async_wait(
+        socket_type::wait_read,
+        [weak = weak_from_this()](asio::error_code ec) {
+          if (auto self = weak.lock(); self && !ec) {
+            self->peer_gone();
+          }
+        });
+  }
+
+  /**
+   * @brief Largest payload one frame can carry
+   * */
+  [[nodiscard]] std::size_t max_frame_size() const {
+    return capacity_ / 2 - record_alignment;
+  }
+
+  /**
+   * @brief Take the next frame out of the inbound ring, releasing the last
+   * one; false means the doorbell is armed, wait on inbound_doorbell()
+   * */
+  bool try_read(std::span<const std::byte>& frame, asio::error_code& ec) {
+    auto& ring = *inbound_;
+    if (closed_) {
+      ec = asio::error::operation_aborted;
+      return true;
+    }
+    if (consumer_waiting_) {
+      // Back from a wait, reset the doorbell before looking again
+      drain(inbound_doorbell());
+    }
+    if (released_ != 0) {
+      ring.head.store(head_ += std::exchange(released_, 0),
+                      std::memory_order_seq_cst);
+      if (ring.producer_waiting.load(std::memory_order_seq_cst) != 0) {
+        ring_bell(inbound_room_);
+      }
+    }
+    for (;;) {
+      const auto tail = ring.tail.load(std::memory_order_acquire);
+      if (tail == head_ + released_) {
+        if (ring.closed.load(std::memory_order_acquire) != 0 || peer_gone_) {
+          ec = asio::error::eof;
+          return true;
+        }
+        if (!consumer_waiting_) {
+          // Announce the sleep, then look once more so a frame published
+          // in between isn't missed
+          consumer_waiting_ = true;
+          ring.consumer_waiting.store(1, std::memory_order_seq_cst);
+          continue;
+        }
+        return false;
+      }
+      if (consumer_waiting_) {
+        consumer_waiting_ = false;
+        ring.consumer_waiting.store(0, std::memory_order_relaxed);
+      }
+      // The peer writes the positions and lengths, so check a record
+      // lies inside the ring and before its tail before trusting it
+      const auto available = tail - (head_ + released_);
+      const auto offset = (head_ + released_) & (capacity_ - 1);
+      if (available > capacity_ || available < record_alignment) {
+        ec = asio::error::invalid_argument;
+        return true;
+      }
+      std::uint32_t length = 0;
+      std::memcpy(&length, inbound_data_ + offset, sizeof(length));
+      if (length == wrap_marker) {
+        if (capacity_ - offset > available) {
+          ec = asio::error::invalid_argument;
+          return true;
+        }
+        released_ += capacity_ - offset;
+        continue;
+      }
+      if (length > max_frame_size()) {
+        ec = asio::error::message_size;
+        return true;
+      }
+      if (offset + sizeof(length) + length > capacity_ ||
+          record_size(length) > available) {
+        ec = asio::error::invalid_argument;
+        return true;
+      }
+      frame = {inbound_data_ + offset + sizeof(length), length};
+      released_ += record_size(length);
+      return true;
+    }
+  }
+
+  /**
+   * @brief Copy the frame in gather() into the outbound ring; false means
+   * the doorbell is armed, wait on outbound_doorbell()
+   * */
+  bool try_write(std::size_t length, asio::error_code& ec) {
+    auto& ring = *outbound_;
+    if (closed_) {
+      ec = asio::error::operation_aborted;
+      return true;
+    }
+    if (producer_waiting_) {
+      drain(outbound_doorbell());
+    }
+    if (length > max_frame_size()) {
+      ec = asio::error::message_size;
+      return true;
+    }
+    const auto needed = record_size(length);
+    for (;;) {
+      if (ring.closed.load(std::memory_order_acquire) != 0 || peer_gone_) {
+        ec = asio::error::broken_pipe;
+        return true;
+      }
+      const auto offset = tail_ & (capacity_ - 1);
+      const auto to_end = capacity_ - offset;
+      const auto total = needed <= to_end ? needed : to_end + needed;
+      const auto head = ring.head.load(std::memory_order_seq_cst);
+      if (capacity_ - (tail_ - head) >= total) {
+        if (producer_waiting_) {
+          producer_waiting_ = false;
+          ring.producer_waiting.store(0, std::memory_order_relaxed);
+        }
+        break;
+      }
+      if (!producer_waiting_) {
+        producer_waiting_ = true;
+        ring.producer_waiting.store(1, std::memory_order_seq_cst);
+        continue;
+      }
+      return false;
+    }
+    auto offset = tail_ & (capacity_ - 1);
+    if (needed > capacity_ - offset) {
+      std::memcpy(outbound_data_ + offset, &wrap_marker, sizeof(wrap_marker));
+      tail_ += capacity_ - offset;
+      offset = 0;
+    }
+    const auto header = static_cast<std::uint32_t>(length);
+    std::memcpy(outbound_data_ + offset, &header, sizeof(header));
+    asio::buffer_copy(
+        asio::buffer(outbound_data_ + offset + sizeof(header), length),
+        gather_);
+    tail_ += needed;
+    ring.tail.store(tail_, std::memory_order_seq_cst);
+    if (ring.consumer_waiting.load(std::memory_order_seq_cst) != 0) {
+      ring_bell(outbound_data_bell_);
+    }
+    return true;
+  }
+
+  /**
+   * @brief Mark both rings closed, wake the peer and abort our own waits
+   * */
+  void close() {
+    if (closed_) {
+      return;
+    }
+    closed_ = true;
+    if (inbound_ != nullptr) {
+      for (auto* ring : {inbound_, outbound_}) {
+        ring->closed.store(1, std::memory_order_seq_cst);
+      }
+      ring_bell(outbound_data_bell_);
+      ring_bell(inbound_room_);
+    }
+    asio::error_code ignored;
+    for (auto& doorbell : doorbells_) {
+      doorbell.close(ignored);
+    }
+    socket_.close(ignored);
+  }
+
+  asio::posix::stream_descriptor& inbound_doorbell() {
+    return doorbells_[inbound_data_bell_];
+  }
+  asio::posix::stream_descriptor& outbound_doorbell() {
+    return doorbells_[outbound_room_];
+  }
+  std::vector<asio::const_buffer>& gather() { return gather_; }
+  // The accepting side's one byte answer, which ends the negotiation
+  asio::mutable_buffer acknowledgement() { return asio::buffer(&ack_, 1); }
+  [[nodiscard]] bool acknowledged() const { return ack_ == 1; }
+  [[nodiscard]] bool is_closed() const { return closed_; }
+
+ private:
+  static std::uint64_t record_size(std::size_t length) {
+    return (sizeof(std::uint32_t) + length + record_alignment - 1) &
+           ~std::uint64_t{record_alignment - 1};
+  }
+
+  bool fail(asio::error_code& ec) {
+    if (!ec) {
+      ec = asio::error_code(errno, asio::system_category());
+    }
+    return false;
+  }
+
+  bool map(asio::error_code& ec) {
+    mapped_ = mapping_size(capacity_);
+    void* memory = ::mmap(nullptr, mapped_, PROT_READ | PROT_WRITE,
+                          MAP_SHARED, memfd_, 0);
+    if (memory == MAP_FAILED) {
+      return fail(ec);
+    }
+    memory_ = static_cast<std::byte*>(memory);
+    return true;
+  }
+
+  shm_ring_header* header(std::size_t ring) {
+    return std::launder(
+        reinterpret_cast<shm_ring_header*>(memory_ + ring * header_stride));
+  }
+
+  std::byte* data(std::size_t ring) {
+    return memory_ + 2 * header_stride + ring * capacity_;
+  }
+
+  // Wire up the rings for the side that writes ring `outbound`
+  void attach(std::size_t outbound) {
+    const std::size_t inbound = 1 - outbound;
+    inbound_ = header(inbound);
+    outbound_ = header(outbound);
+    inbound_data_ = data(inbound);
+    outbound_data_ = data(outbound);
+    inbound_data_bell_ = inbound * 2;
+    inbound_room_ = inbound * 2 + 1;
+    outbound_data_bell_ = outbound * 2;
+    outbound_room_ = outbound * 2 + 1;
+  }
+
+  void ring_bell(std::size_t index) {
+    if (doorbells_[index].is_open()) {
+      ::eventfd_write(doorbells_[index].native_handle(), 1);
+    }
+  }
+
+  static void drain(asio::posix::stream_descriptor& doorbell) {
+    eventfd_t ignored = 0;
+    ::eventfd_read(doorbell.native_handle(), &ignored);
+  }
+
+  void peer_gone() {
+    peer_gone_ = true;
+    // Wake our own waits so they see it
+    asio::error_code ignored;
+    inbound_doorbell().cancel(ignored);
+    outbound_doorbell().cancel(ignored);
+  }
+
+  static_assert(sizeof(shm_ring_header) <= header_stride);
+
+  socket_type socket_;
+  std::array<asio::posix::stream_descriptor, 4> doorbells_;
+  int memfd_{-1};
+  std::byte* memory_{nullptr};
+  std::size_t mapped_{0};
+  std::uint64_t capacity_{0};
+  shm_ring_header* inbound_{nullptr};
+  shm_ring_header* outbound_{nullptr};
+  std::byte* inbound_data_{nullptr};
+  std::byte* outbound_data_{nullptr};
+  std::size_t inbound_data_bell_{0};
+  std::size_t inbound_room_{0};
+  std::size_t outbound_data_bell_{0};
+  std::size_t outbound_room_{0};
+  // Our own copies of our positions; released_ is the frame handed out
+  // last, given back when the next read starts
+  std::uint64_t head_{0};
+  std::uint64_t released_{0};
+  std::uint64_t tail_{0};
+  bool consumer_waiting_{false};
+  bool producer_waiting_{false};
+  bool peer_gone_{false};
+  bool closed_{false};
+  std::vector<asio::const_buffer> gather_;
+  std::uint8_t ack_{0};
+};
+}  // namespace detail
+
+/**
+ * @brief A framed session over shared memory rings, set up by
+ * garak::async_shm_connect() or garak::async_shm_accept()
+ *
+ * A frame handed to a read completion points into the shared ring and
+ * stays valid until the next read is started. At most one read and one
+ * write may be outstanding at a time, from one thread at a time.
+ * */
+class shm_session {
+ public:
+  using executor_type = asio::any_io_executor;
+
+  explicit shm_session(std::shared_ptr<detail::shm_channel> channel)
+      : channel_(std::move(channel)) {}
+
+  shm_session(shm_session&&) noexcept = default;
+  shm_session& operator=(shm_session&& other) noexcept {
+    if (this != &other) {
+      close();
+      channel_ = std::move(other.channel_);
+    }
+    return *this;
+  }
+  ~shm_session() { close(); }
+
+  shm_session(const shm_session&) = delete;
+  shm_session& operator=(const shm_session&) = delete;
+
+  executor_type get_executor() { return channel_->get_executor(); }
+
+  /**
+   * @brief Close both directions, the peer reads the end of its session
+   * once it has taken what is already in the ring
+   * */
+  void close() {
+    if (channel_) {
+      channel_->close();
+    }
+  }
+
+  /**
+   * @brief Frames with larger payloads fail with asio::error::message_size
+   * */
+  [[nodiscard]] std::size_t max_frame_size() const {
+    return channel_->max_frame_size();
+  }
+
+  /**
+   * @brief Read the next frame
+   *
+   * Completion signature `void(asio::error_code, std::span<const std::byte>)`,
+   * fails with asio::error::invalid_argument if the peer corrupted the ring
+   * */
+  template <typename CompletionToken>
+  auto async_read_frame(CompletionToken&& token) {
+    return asio::async_compose<CompletionToken,
+                               void(asio::error_code,
+                                    std::span<const std::byte>)>(
+        read_frame_op{channel_}, token, channel_->inbound_doorbell());
+  }
+
+  /**
+   * @brief Write payload as a single frame, copied once into the ring
+   *
+   * Completion signature `void(asio::error_code, std::size_t)`, the size is
+   * the payload length.
+   * */
+  template <typename ConstBufferSequence, typename CompletionToken>
+  auto async_write_frame(const ConstBufferSequence& payload,
+                         CompletionToken&& token) {
+    auto& gather = channel_->gather();
+    gather.clear();
+    for (auto it = asio::buffer_sequence_begin(payload);
+         it != asio::buffer_sequence_end(payload); ++it) {
+      gather.emplace_back(*it);
+    }
+    return asio::async_compose<CompletionToken,
+                               void(asio::error_code, std::size_t)>(
+        write_frame_op{channel_, asio::buffer_size(payload)}, token,
+        channel_->outbound_doorbell());
+  }
+
+ private:
+  /**
+   * @brief Whether a doorbell wait failed for a reason other than being
+   * cancelled; cancellation means close() or peer_gone(), and the next
+   * try_read() or try_write() reports which
+   * */
+  static bool wait_failed(const asio::error_code& ec) {
+    return ec && ec != asio::error::operation_aborted;
+  }
+
+  // Both ops share the channel, so it outlives a session closed or
+  // destroyed while they wait
+  struct read_frame_op {
+    std::shared_ptr<detail::shm_channel> channel;
+    bool started{false};
+    bool posted{false};
+    asio::error_code result{};
+    std::span<const std::byte> frame{};
+
+    template <typename Self>
+    void operator()(Self& self, asio::error_code ec = {}) {
+      if (posted) {
+        self.complete(result, frame);
+        return;
+      }
+      if (wait_failed(ec)) {
+        self.complete(ec, {});
+        return;
+      }
+      const bool first = !started;
+      started = true;
+      if (!channel->try_read(frame, result)) {
+        channel->inbound_doorbell().async_wait(
+            asio::posix::stream_descriptor::wait_read, std::move(self));
+        return;
+      }
+      if (first) {
+        // Never complete from inside the initiating function
+        posted = true;
+        asio::post(std::move(self));
+        return;
+      }
+      self.complete(result, frame);
+    }
+  };
+
+  struct write_frame_op {
+    std::shared_ptr<detail::shm_channel> channel;
+    std::size_t length;
+    bool started{false};
+    bool posted{false};
+    asio::error_code result{};
+
+    template <typename Self>
+    void operator()(Self& self, asio::error_code ec = {}) {
+      if (wait_failed(ec)) {
+        self.complete(ec, 0);
+        return;
+      }
+      if (!posted) {
+        const bool first = !started;
+        started = true;
+        if (!channel->try_write(length, result)) {
+          channel->outbound_doorbell().async_wait(
+              asio::posix::stream_descriptor::wait_read, std::move(self));
+          return;
+        }
+        if (first) {
+          posted = true;
+          asio::post(std::move(self));
+          return;
+        }
+      }
+      self.complete(result, result ? 0 : length);
+    }
+  };
+
+  std::shared_ptr<detail::shm_channel> channel_;
+};
+
+namespace detail {
+struct shm_connect_op {
+  enum class state { start, sending, receiving, posted };
+
+  std::shared_ptr<shm_channel> channel;
+  shm_offer offer;
+  asio::error_code failure;
+  state current{state::start};
+
+  template <typename Self>
+  void operator()(Self& self, asio::error_code ec = {},
+                  std::size_t /*transferred*/ = 0) {
+    auto& socket = channel->socket();
+    if (current == state::start && failure) {
+      // Never complete from inside the initiating function
+      current = state::posted;
+      asio::post(std::move(self));
+      return;
+    }
+    if (current == state::posted) {
+      ec = failure;
+    }
+    if (!ec && (current == state::start || current == state::sending)) {
+      const bool first = current == state::start;
+      current = state::sending;
+      if (!send(ec)) {
+        socket.async_wait(shm_channel::socket_type::wait_write,
+                          std::move(self));
+        return;
+      }
+      if (!ec) {
+        current = state::receiving;
+        socket.async_receive(channel->acknowledgement(), std::move(self));
+        return;
+      }
+      if (first) {
+        failure = ec;
+        current = state::posted;
+        asio::post(std::move(self));
+        return;
+      }
+    }
+    if (!ec && !channel->acknowledged()) {
+      ec = asio::error::connection_refused;
+    }
+    if (ec) {
+      channel->close();
+      self.complete(ec, shm_session{nullptr});
+      return;
+    }
+    channel->start();
+    self.complete({}, shm_session{std::move(channel)});
+  }
+
+  // One sendmsg with the descriptors attached, false when it would block
+  bool send(asio::error_code& ec) {
+    auto& socket = channel->socket();
+    socket.native_non_blocking(true, ec);
+    if (ec) {
+      return true;
+    }
+    const auto descriptors = channel->descriptors();
+    const iovec data{&offer, sizeof(offer)};
+    send_with_fds(socket.native_handle(), {&data, 1}, descriptors, ec);
+    if (ec == asio::error::would_block) {
+      ec = {};
+      return false;
+    }
+    return true;
+  }
+};
+
+struct shm_accept_op {
+  std::shared_ptr<shm_channel> channel;
+  bool started{false};
+  bool received{false};
+  bool posted{false};
+  asio::error_code failure{};
+
+  template <typename Self>
+  void operator()(Self& self, asio::error_code ec = {},
+                  std::size_t /*transferred*/ = 0) {
+    auto& socket = channel->socket();
+    if (posted) {
+      ec = failure;
+    } else if (!ec && !received) {
+      const bool first = !started;
+      started = true;
+      if (!receive(ec)) {
+        socket.async_wait(shm_channel::socket_type::wait_read,
+                          std::move(self));
+        return;
+      }
+      received = true;
+      if (!ec) {
+        auto ack = channel->acknowledgement();
+        *static_cast<std::uint8_t*>(ack.data()) = 1;
+        socket.async_send(ack, std::move(self));
+        return;
+      }
+      if (first) {
+        // The offer was already waiting and didn't check out; never
+        // complete from inside the initiating function
+        failure = ec;
+        posted = true;
+        asio::post(std::move(self));
+        return;
+      }
+    }
+    if (ec) {
+      channel->close();
+      self.complete(ec, shm_session{nullptr});
+      return;
+    }
+    channel->start();
+    self.complete({}, shm_session{std::move(channel)});
+  }
+
+  // One recvmsg for the offer and its descriptors, false when it would
+  // block
+  bool receive(asio::error_code& ec) {
+    auto& socket = channel->socket();
+    socket.native_non_blocking(true, ec);
+    if (ec) {
+      return true;
+    }
+    shm_offer offer{};
+    std::vector<unique_fd> descriptors;
+    const auto n = receive_with_fds(socket.native_handle(),
+                                    asio::buffer(&offer, sizeof(offer)),
+                                    descriptors, ec);
+    if (ec == asio::error::would_block) {
+      ec = {};
+      return false;
+    }
+    if (!ec && (n != sizeof(offer) ||
+                descriptors.size() != shm_channel::descriptor_count)) {
+      ec = asio::error::invalid_argument;
+    }
+    if (!ec) {
+      channel->adopt(offer, descriptors, ec);
+    }
+    return true;
+  }
+};
+}  // namespace detail
+
+/**
+ * @brief Set up a shm_session over socket, a unix socket connected to a
+ * peer running garak::async_shm_accept()
+ *
+ * Creates the shared rings and doorbells and passes them over socket.
+ * Completion signature `void(asio::error_code, garak::shm_session)`.
+ * */
+template <typename CompletionToken>
+auto async_shm_connect(asio::local::stream_protocol::socket socket,
+                       const shm_options& options, CompletionToken&& token) {
+  auto channel = std::make_shared<detail::shm_channel>(std::move(socket));
+  asio::error_code ec;
+  channel->create(options.ring_size, ec);
+  detail::shm_offer offer;
+  offer.ring_size = channel->ring_size();
+  auto& io_object = channel->socket();
+  return asio::async_compose<CompletionToken,
+                             void(asio::error_code, shm_session)>(
+      detail::shm_connect_op{std::move(channel), offer, ec}, token,
+      io_object);
+}
+
+/**
+ * @brief Set up a shm_session over socket, a unix socket connected to a
+ * peer running garak::async_shm_connect()
+ *
+ * Completion signature `void(asio::error_code, garak::shm_session)`, fails
+ * with asio::error::invalid_argument when the peer's offer doesn't check
+ * out.
+ * */
+template <typename CompletionToken>
+auto async_shm_accept(asio::local::stream_protocol::socket socket,
+                      CompletionToken&& token) {
+  auto channel = std::make_shared<detail::shm_channel>(std::move(socket));
+  auto& io_object = channel->socket();
+  return asio::async_compose<CompletionToken,
+                             void(asio::error_code, shm_session)>(
+      detail::shm_accept_op{std::move(channel)}, token, io_object);
+}
+}  // namespace garak
+
+#endif
@@ -0,0 +1,592 @@
+#ifndef GARAK_THREADS_HPP
+#define GARAK_THREADS_HPP
+
+/**
+ * @file garak/threads.hpp
+ * @brief Launching io and worker threads pinned to cores, with local memory
+ * @date 2026-10-19
+ *
+ * A thread the scheduler moves to the other socket keeps using memory on
+ * the node it started on, and every access crosses the interconnect.
+ * io_context_pool and thread_group pin each thread to a core chosen from
+ * the machine's topology, make its memory policy prefer that core's NUMA
+ * node, and name it so perf and top tell the threads apart. Each
+ * io_context is constructed on its own thread, so its internals, and the
+ * buffers and recycled handler memory its thread allocates later, land on
+ * the local node:
+ *
+ * @code
+ * garak::thread_options options;
+ * options.name = "io";
+ * options.placement = garak::cpu_placement::physical_cores;
+ * garak::io_context_pool pool{options};
+ * pool.start();
+ * for (std::size_t i = 0; i < pool.size(); ++i) {
+ *   // one SO_REUSEPORT listener per thread, preferring connections whose
+ *   // packets the NIC steers to that thread's core
+ *   asio::ip::tcp::acceptor acceptor{pool.context(i)};
+ *   acceptor.open(endpoint.protocol());
+ *   acceptor.set_option(garak::reuse_port{true});
+ *   acceptor.set_option(garak::incoming_cpu{pool.slot(i).cpu});
+ *   ...
+ * }
+ * @endcode
+ */
+
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <asio/detail/socket_option.hpp>
+#include <asio/error.hpp>
+#include <asio/executor_work_guard.hpp>
+#include <asio/io_context.hpp>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <optional>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace garak {
+/**
+ * @brief Socket option for SO_REUSEPORT, letting one listener per thread
+ * share a port
+ * */
+using reuse_port =
+    asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+
+/**
+ * @brief Socket option for SO_INCOMING_CPU
+ *
+ * On a listener in an SO_REUSEPORT group it makes the kernel prefer that
+ * listener for connections whose packets are processed on the given CPU,
+ * so with RSS queues steered to the io threads' cores each connection is
+ * handled on the core its packets arrive on.
+ * */
+using incoming_cpu =
+    asio::detail::socket_option::integer<SOL_SOCKET, SO_INCOMING_CPU>;
+
+/**
+ * @brief Parse a sysfs CPU or node list such as "0-3,8,10-11"
+ * */
+inline std::vector<int> parse_cpu_list(std::string_view list) {
+  std::vector<int> out;
+  while (!list.empty()) {
+    const auto comma = list.find(',');
+    auto range = list.substr(0, comma);
+    list = comma == std::string_view::npos ? std::string_view{}
+                                           : list.substr(comma + 1);
+    while (!range.empty() && (range.back() == '\n' || range.back() == ' ')) {
+      range.remove_suffix(1);
+    }
+    if (range.empty()) {
+      continue;
+    }
+    int first = 0;
+    auto [end, ec] =
+        std::from_chars(range.data(), range.data() + range.size(), first);
+    if (ec != std::errc{}) {
+      throw std::invalid_argument("parse_cpu_list: bad list");
+    }
+    int last = first;
+    if (end != range.data() + range.size()) {
+      if (*end != '-' ||
+          std::from_chars(end + 1, range.data() + range.size(), last).ec !=
+              std::errc{} ||
+          last < first) {
+        throw std::invalid_argument("parse_cpu_list: bad list");
+      }
+    }
+    for (int cpu = first; cpu <= last; ++cpu) {
+      out.push_back(cpu);
+    }
+  }
+  return out;
+}
+
+/**
+ * @brief Where one logical CPU sits
+ * */
+struct cpu_info {
+  int cpu{0};
+  /// Physical package (socket)
+  int package{0};
+  /// Physical core within the package, shared by SMT siblings
+  int core{0};
+  /// NUMA node, -1 when the kernel reports none
+  int node{-1};
+};
+
+/**
+ * @brief The logical CPUs of the machine and how they group into cores,
+ * packages and NUMA nodes
+ * */
+class cpu_topology {
+ public:
+  cpu_topology() = default;
+  explicit cpu_topology(std::vector<cpu_info> cpus) : cpus_(std::move(cpus)) {
+    std::sort(cpus_.begin(), cpus_.end(),
+              [](const auto& a, const auto& b) { return a.cpu < b.cpu; });
+  }
+
+  /**
+   * @brief The CPUs this process may run on, from /sys and its affinity
+   * mask
+   * */
+  static cpu_topology detect() {
+    auto all = read("/sys/devices/system");
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (::sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+      return all;
+    }
+    std::vector<cpu_info> cpus;
+    for (const auto& info : all.cpus()) {
+      const auto cpu = static_cast<std::size_t>(info.cpu);
+      if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)) {
+        cpus.push_back(info);
+      }
+    }
+    return cpu_topology{std::move(cpus)};
+  }
+
+  /**
+   * @brief Every online CPU as described under root, normally
+   * /sys/devices/system
+   * */
+  static cpu_topology read(const std::filesystem::path& root) {
+    const auto online = read_file(root / "cpu" / "online");
+    std::vector<cpu_info> cpus;
+    for (const int cpu : parse_cpu_list(online.value_or("0"))) {
+      const auto topology =
+          root / "cpu" / ("cpu" + std::to_string(cpu)) / "topology";
+      cpu_info info;
+      info.cpu = cpu;
+      info.package = read_int(topology / "physical_package_id", 0);
+      info.core = read_int(topology / "core_id", cpu);
+      cpus.push_back(info);
+    }
+    if (const auto nodes = read_file(root / "node" / "online")) {
+      for (const int node : parse_cpu_list(*nodes)) {
+        const auto list = read_file(root / "node" /
+                                    ("node" + std::to_string(node)) /
+                                    "cpulist");
+        for (const int cpu : parse_cpu_list(list.value_or(""))) {
+          for (auto& info : cpus) {
+            if (info.cpu == cpu) {
+              info.node = node;
+            }
+          }
+        }
+      }
+    }
+    return cpu_topology{std::move(cpus)};
+  }
+
+  [[nodiscard]] const std::vector<cpu_info>& cpus() const { return cpus_; }
+
+  /**
+   * @brief The lowest numbered CPU of each physical core, leaving out SMT
+   * siblings
+   * */
+  [[nodiscard]] std::vector<int> physical_cores() const {
+    std::set<std::pair<int, int>> seen;
+    std::vector<int> out;
+    for (const auto& info : cpus_) {
+      if (seen.emplace(info.package, info.core).second) {
+        out.push_back(info.cpu);
+      }
+    }
+    return out;
+  }
+
+  /**
+   * @brief NUMA node of cpu, -1 if unknown
+   * */
+  [[nodiscard]] int node_of(int cpu) const {
+    for (const auto& info : cpus_) {
+      if (info.cpu == cpu) {
+        return info.node;
+      }
+    }
+    return -1;
+  }
+
+  [[nodiscard]] std::size_t nodes() const {
+    std::set<int> nodes;
+    for (const auto& info : cpus_) {
+      if (info.node >= 0) {
+        nodes.insert(info.node);
+      }
+    }
+    return nodes.size();
+  }
+
+ private:
+  static std::optional<std::string> read_file(
+      const std::filesystem::path& path) {
+    std::ifstream in{path};
+    std::string line;
+    if (!in || !std::getline(in, line)) {
+      return std::nullopt;
+    }
+    return line;
+  }
+
+  static int read_int(const std::filesystem::path& path, int fallback) {
+    const auto text = read_file(path);
+    int value = fallback;
+    if (text) {
+      std::from_chars(text->data(), text->data() + text->size(), value);
+    }
+    return value;
+  }
+
+  std::vector<cpu_info> cpus_;
+};
+
+/**
+ * @brief Which CPUs threads are spread over
+ * */
+enum class cpu_placement {
+  /// Leave placement to the scheduler
+  none,
+  /// Every CPU the process may use, SMT siblings included
+  every_cpu,
+  /// One CPU per physical core
+  physical_cores,
+};
+
+/**
+ * @brief How to launch a group of threads
+ * */
+struct thread_options {
+  /// Threads to start, 0 for one per CPU of the placement (or per
+  /// hardware thread without one)
+  std::size_t threads{0};
+  /// Threads are named `name-<index>`, cut to the kernel's 15 characters
+  std::string name{"garak"};
+  cpu_placement placement{cpu_placement::none};
+  /// Explicit CPUs, used in turn, instead of placement
+  std::vector<int> cpus{};
+  /// Prefer memory on the node of each thread's CPU
+  bool local_memory{true};
+};
+
+/**
+ * @brief One planned thread: its index, CPU and node (-1 for none), and
+ * name
+ * */
+struct thread_slot {
+  std::size_t index{0};
+  int cpu{-1};
+  int node{-1};
+  std::string name;
+};
+
+/**
+ * @brief Assign threads to CPUs; when there are more threads than CPUs
+ * they wrap around
+ *
+ * Throws std::invalid_argument for an explicit CPU the topology doesn't
+ * have.
+ * */
+inline std::vector<thread_slot> plan_threads(const thread_options& options,
+                                             const cpu_topology& topology) {
+  std::vector<int> cpus = options.cpus;
+  for (const int cpu : cpus) {
+    if (std::none_of(topology.cpus().begin(), topology.cpus().end(),
+                     [cpu](const auto& info) { return info.cpu == cpu; })) {
+      throw std::invalid_argument("plan_threads: cpu " + std::to_string(cpu) +
+                                  " is not available");
+    }
+  }
+  if (cpus.empty() && options.placement == cpu_placement::every_cpu) {
+    for (const auto& info : topology.cpus()) {
+      cpus.push_back(info.cpu);
+    }
+  } else if (cpus.empty() &&
+             options.placement == cpu_placement::physical_cores) {
+    cpus = topology.physical_cores();
+  }
+  auto count = options.threads;
+  if (count == 0) {
+    count = !cpus.empty() ? cpus.size()
+                          : std::max(1U, std::thread::hardware_concurrency());
+  }
+  std::vector<thread_slot> slots(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    auto& slot = slots[i];
+    slot.index = i;
+    slot.name = (options.name + "-" + std::to_string(i)).substr(0, 15);
+    if (!cpus.empty()) {
+      slot.cpu = cpus[i % cpus.size()];
+      // One node has nothing to prefer
+      if (options.local_memory && topology.nodes() > 1) {
+        slot.node = topology.node_of(slot.cpu);
+      }
+    }
+  }
+  return slots;
+}
+
+namespace detail {
+/**
+ * @brief A node mask for mbind / set_mempolicy with only node set
+ * */
+struct node_mask {
+  // NOLINTNEXTLINE(google-runtime-int)
+  std::array<unsigned long, 16> words{};
+
+  explicit node_mask(int node) {
+    constexpr auto bits = sizeof(words[0]) * 8;
+    if (node < 0 || static_cast<std::size_t>(node) >= max_nodes()) {
+      throw std::invalid_argument("node_mask: bad node");
+    }
+    const auto n = static_cast<std::size_t>(node);
+    words[n / bits] |= 1UL << (n % bits);
+  }
+
+  [[nodiscard]] static constexpr std::size_t max_nodes() {
+    return sizeof(words) * 8;
+  }
+};
+
+/**
+ * @brief Name, pin and set the memory policy of the calling thread
+ * */
+inline void enter_slot(const thread_slot& slot) {
+  ::pthread_setname_np(::pthread_self(), slot.name.c_str());
+  if (slot.cpu >= CPU_SETSIZE) {
+    throw std::system_error(EINVAL, std::system_category(),
+                            "pinning " + slot.name);
+  }
+  if (slot.cpu >= 0) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(static_cast<std::size_t>(slot.cpu), &set);
+    if (::sched_setaffinity(0, sizeof(set), &set) != 0) {
+      throw std::system_error(errno, std::system_category(),
+                              "pinning " + slot.name);
+    }
+  }
+  if (slot.node >= 0) {
+    const node_mask mask{slot.node};
+    if (::syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask.words.data(),
+                  node_mask::max_nodes()) != 0) {
+      throw std::system_error(errno, std::system_category(),
+                              "memory policy for " + slot.name);
+    }
+  }
+}
+}  // namespace detail
+
+/**
+ * @brief Prefer node for the pages of [data, data + size) not yet touched,
+ * for memory allocated before the thread that uses it was placed
+ *
+ * The range is widened to whole pages. Pages already in use stay where
+ * they are.
+ * */
+inline void bind_memory(void* data, std::size_t size, int node,
+                        asio::error_code& ec) {
+  if (node < 0 ||
+      static_cast<std::size_t>(node) >= detail::node_mask::max_nodes()) {
+    ec = asio::error::invalid_argument;
+    return;
+  }
+  const detail::node_mask mask{node};
+  const auto page = static_cast<std::uintptr_t>(::sysconf(_SC_PAGESIZE));
+  const auto begin = reinterpret_cast<std::uintptr_t>(data) & ~(page - 1);
+  const auto end = reinterpret_cast<std::uintptr_t>(data) + size;
+  if (::syscall(SYS_mbind, begin, end - begin, MPOL_PREFERRED,
+                mask.words.data(), detail::node_mask::max_nodes(), 0) != 0) {
+    ec = asio::error_code(errno, asio::system_category());
+    return;
+  }
+  ec = {};
+}
+
+/**
+ * @brief A group of placed threads, e.g. a worker pool
+ *
+ * launch() returns once every thread is named, pinned and has run its
+ * prepare step, or throws the first failure after stopping them all.
+ * */
+class thread_group {
+ public:
+  thread_group() = default;
+  thread_group(const thread_group&) = delete;
+  thread_group& operator=(const thread_group&) = delete;
+  ~thread_group() { join(); }
+
+  /**
+   * @brief Start a thread per slot that runs prepare(slot), then, once all
+   * of them have, run(slot)
+   * */
+  template <typename Prepare, typename Run>
+  void launch(const std::vector<thread_slot>& slots, Prepare prepare,
+              Run run) {
+    std::promise<bool> go;
+    const auto started = go.get_future().share();
+    std::vector<std::future<void>> ready;
+    for (const auto& slot : slots) {
+      std::promise<void> prepared;
+      ready.push_back(prepared.get_future());
+      threads_.emplace_back([slot, prepare, run, started,
+                             prepared = std::move(prepared)]() mutable {
+        try {
+          detail::enter_slot(slot);
+          prepare(slot);
+          prepared.set_value();
+        } catch (...) {
+          prepared.set_exception(std::current_exception());
+          return;
+        }
+        if (started.get()) {
+          run(slot);
+        }
+      });
+    }
+    std::exception_ptr failure;
+    for (auto& f : ready) {
+      try {
+        f.get();
+      } catch (...) {
+        if (!failure) {
+          failure = std::current_exception();
+        }
+      }
+    }
+    go.set_value(!failure);
+    if (failure) {
+      join();
+      std::rethrow_exception(failure);
+    }
+  }
+
+  template <typename Run>
+  void launch(const std::vector<thread_slot>& slots, Run run) {
+    launch(slots, [](const thread_slot&) {}, std::move(run));
+  }
+
+  void join() {
+    for (auto& thread : threads_) {
+      if (thread.joinable()) {
+        thread.join();
+      }
+    }
+    threads_.clear();
+  }
+
+  [[nodiscard]] std::size_t size() const { return threads_.size(); }
+
+ private:
+  std::vector<std::thread> threads_;
+};
+
+/**
+ * @brief One io_context per placed thread
+ *
+ * Each context is created on its own thread after placement and runs
+ * until stop(). Hand connections out with next(), or shard accepts with a
+ * listener per context.
+ * */
+class io_context_pool {
+ public:
+  explicit io_context_pool(
+      const thread_options& options,
+      const cpu_topology& topology = cpu_topology::detect())
+      : slots_(plan_threads(options, topology)),
+        contexts_(slots_.size()),
+        guards_(slots_.size()) {}
+
+  io_context_pool(const io_context_pool&) = delete;
+  io_context_pool& operator=(const io_context_pool&) = delete;
+
+  ~io_context_pool() {
+    stop();
+    threads_.join();
+  }
+
+  /**
+   * @brief Start the threads, the contexts are usable once it returns
+   * */
+  void start() {
+    threads_.launch(
+        slots_,
+        [this](const thread_slot& slot) {
+          auto& ctx = contexts_[slot.index];
+          ctx = std::make_unique<asio::io_context>();
+          guards_[slot.index].emplace(ctx->get_executor());
+        },
+        [this](const thread_slot& slot) { contexts_[slot.index]->run(); });
+  }
+
+  /**
+   * @brief Let the contexts run out of work, threads exit once they have
+   * */
+  void release() {
+    for (auto& guard : guards_) {
+      guard.reset();
+    }
+  }
+
+  /**
+   * @brief Stop every context now
+   * */
+  void stop() {
+    for (auto& ctx : contexts_) {
+      if (ctx) {
+        ctx->stop();
+      }
+    }
+  }
+
+  void join() { threads_.join(); }
+
+  [[nodiscard]] std::size_t size() const { return slots_.size(); }
+  [[nodiscard]] const thread_slot& slot(std::size_t i) const {
+    return slots_[i];
+  }
+  asio::io_context& context(std::size_t i) { return *contexts_[i]; }
+
+  /**
+   * @brief The contexts in turn
+   * */
+  asio::io_context& next() {
+    return context(next_.fetch_add(1, std::memory_order_relaxed) % size());
+  }
+
+ private:
+  using work_guard =
+      asio::executor_work_guard<asio::io_context::executor_type>;
+
+  std::vector<thread_slot> slots_;
+  std::vector<std::unique_ptr<asio::io_context>> contexts_;
+  std::vector<std::optional<work_guard>> guards_;
+  thread_group threads_;
+  std::atomic<std::size_t> next_{0};
+};
+}  // namespace garak
+
+#endif
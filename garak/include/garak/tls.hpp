@@ -0,0 +1,680 @@
+#ifndef GARAK_TLS_HPP
+#define GARAK_TLS_HPP
+
+/**
+ * @file garak/tls.hpp
+ * @brief TLS session resumption for servers and pooled clients
+ * @date 2026-10-19
+ *
+ * A full handshake costs an asymmetric key exchange and certificate
+ * signature, a resumed one only symmetric crypto. Servers resume clients
+ * either from a session cache (stateful) or from session tickets the client
+ * hands back (stateless), garak::tls_server_context sets up both:
+ *
+ * - a sharded in-memory cache replacing OpenSSL's single-lock internal one
+ * - session ticket keys rotated on a timer, with recent keys still
+ *   accepted so outstanding tickets survive a rotation
+ * - counters for full and resumed handshakes
+ *
+ * On the client side garak::tls_connector keeps the sessions servers hand
+ * out and offers one on each new connection of a garak::connection_pool.
+ *
+ * Only available when garak is built with GARAK_ENABLE_TLS, and needs
+ * OpenSSL 3.0 for its ticket key callback.
+ */
+
+#include <openssl/core_names.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <openssl/ssl.h>
+
+#include <algorithm>
+#include <array>
+#include <asio/connect.hpp>
+#include <asio/ssl.hpp>
+#include <asio/this_coro.hpp>
+#include <asio/use_awaitable.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <garak/connection_pool.hpp>
+#include <garak/tls_stream.hpp>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+namespace garak {
+/**
+ * @brief Tuning for garak::tls_server_context
+ * */
+struct tls_server_options {
+  /// Issue stateless session tickets, otherwise resume from the cache only
+  bool session_tickets{true};
+  /// How long a ticket key encrypts new tickets before being replaced
+  std::chrono::seconds ticket_rotation{std::chrono::hours(1)};
+  /// Ticket keys still accepted for decryption, the current one included
+  std::size_t ticket_keys_kept{2};
+  /// Independently locked parts of the session cache
+  std::size_t cache_shards{16};
+  /// Sessions cached across all shards
+  std::size_t cache_capacity{20480};
+  /// Sessions and tickets older than this are not resumed
+  std::chrono::seconds session_lifetime{std::chrono::hours(2)};
+};
+
+/**
+ * @brief A snapshot of a server's resumption counters
+ * */
+struct tls_server_stats {
+  std::uint64_t full_handshakes{0};
+  std::uint64_t resumed_handshakes{0};
+  /// Session cache lookups that found the session
+  std::uint64_t cache_hits{0};
+  /// Session cache lookups that did not
+  std::uint64_t cache_misses{0};
+  /// Tickets accepted under an older key and reissued under the current one
+  std::uint64_t ticket_renewals{0};
+
+  /**
+   * @brief Fraction of completed handshakes that were resumed
+   * */
+  [[nodiscard]] double resumption_rate() const {
+    const auto total = full_handshakes + resumed_handshakes;
+    return total == 0 ? 0.0
+                      : static_cast<double>(resumed_handshakes) /
+                            static_cast<double>(total);
+  }
+};
+
+namespace detail {
+/**
+ * @brief Serialised sessions keyed by session id, split into shards so
+ * concurrent handshakes rarely contend on a lock
+ *
+ * Each shard evicts its oldest session once full.
+ * */
+class tls_session_cache {
+ public:
+  tls_session_cache(std::size_t shards, std::size_t capacity)
+      : shards_(std::max<std::size_t>(shards, 1)),
+        shard_capacity_(
+            std::max<std::size_t>(capacity / shards_.size(), 1)) {}
+
+  void store(std::string id, std::vector<unsigned char> session) {
+    auto& bucket = shard_for(id);
+    const std::scoped_lock lock{bucket.mutex};
+    if (auto it = bucket.entries.find(id); it != bucket.entries.end()) {
+      it->second.session = std::move(session);
+      return;
+    }
+    if (bucket.entries.size() >= shard_capacity_) {
+      bucket.entries.erase(bucket.order.front());
+      bucket.order.pop_front();
+    }
+    bucket.order.push_back(id);
+    const auto position = std::prev(bucket.order.end());
+    bucket.entries.emplace(std::move(id), entry{std::move(session), position});
+  }
+
+  [[nodiscard]] std::optional<std::vector<unsigned char>> find(
+      const std::string& id) {
+    auto& bucket = shard_for(id);
+    const std::scoped_lock lock{bucket.mutex};
+    auto it = bucket.entries.find(id);
+    if (it == bucket.entries.end()) {
+      return std::nullopt;
+    }
+    return it->second.session;
+  }
+
+  void erase(const std::string& id) {
+    auto& bucket = shard_for(id);
+    const std::scoped_lock lock{bucket.mutex};
+    if (auto it = bucket.entries.find(id); it != bucket.entries.end()) {
+      bucket.order.erase(it->second.position);
+      bucket.entries.erase(it);
+    }
+  }
+
+  [[nodiscard]] std::size_t size() {
+    std::size_t total = 0;
+    for (auto& bucket : shards_) {
+      const std::scoped_lock lock{bucket.mutex};
+      total += bucket.entries.size();
+    }
+    return total;
+  }
+
+ private:
+  struct entry {
+    std::vector<unsigned char> session;
+    std::list<std::string>::iterator position;
+  };
+
+  struct shard {
+    std::mutex mutex;
+    std::unordered_map<std::string, entry> entries;
+    // Oldest first
+    std::list<std::string> order;
+  };
+
+  shard& shard_for(const std::string& id) {
+    return shards_[std::hash<std::string>{}(id) % shards_.size()];
+  }
+
+  std::vector<shard> shards_;
+  std::size_t shard_capacity_;
+};
+
+/**
+ * @brief The keys session tickets are encrypted and authenticated with,
+ * newest first
+ * */
+class tls_ticket_keys {
+ public:
+  static constexpr std::size_t name_size = 16;
+
+  struct key {
+    std::array<unsigned char, name_size> name{};
+    std::array<unsigned char, 32> aes{};
+    std::array<unsigned char, 32> hmac{};
+    std::chrono::steady_clock::time_point created;
+  };
+
+  tls_ticket_keys(std::chrono::seconds rotation, std::size_t kept)
+      : rotation_(rotation), kept_(std::max<std::size_t>(kept, 1)) {
+    rotate_locked(std::chrono::steady_clock::now());
+  }
+
+  /**
+   * @brief The key to encrypt a new ticket with, rotating first when due
+   * */
+  key current() {
+    const std::scoped_lock lock{mutex_};
+    const auto now = std::chrono::steady_clock::now();
+    if (now - keys_.front().created >= rotation_) {
+      rotate_locked(now);
+    }
+    return keys_.front();
+  }
+
+  /**
+   * @brief The key named name, and whether it is the current one
+   * */
+  std::optional<std::pair<key, bool>> find(const unsigned char* name) {
+    const std::scoped_lock lock{mutex_};
+    for (std::size_t i = 0; i < keys_.size(); ++i) {
+      if (std::memcmp(keys_[i].name.data(), name, name_size) == 0) {
+        return std::pair{keys_[i], i == 0};
+      }
+    }
+    return std::nullopt;
+  }
+
+  void rotate() {
+    const std::scoped_lock lock{mutex_};
+    rotate_locked(std::chrono::steady_clock::now());
+  }
+
+ private:
+  void rotate_locked(std::chrono::steady_clock::time_point now) {
+    key fresh;
+    if (RAND_bytes(fresh.name.data(), static_cast<int>(fresh.name.size())) !=
+            1 ||
+        RAND_bytes(fresh.aes.data(), static_cast<int>(fresh.aes.size())) !=
+            1 ||
+        RAND_bytes(fresh.hmac.data(), static_cast<int>(fresh.hmac.size())) !=
+            1) {
+      throw std::system_error(std::make_error_code(std::errc::io_error),
+                              "RAND_bytes failed for ticket key");
+    }
+    fresh.created = now;
+    keys_.push_front(fresh);
+    while (keys_.size() > kept_) {
+      keys_.pop_back();
+    }
+  }
+
+  std::mutex mutex_;
+  std::deque<key> keys_;
+  std::chrono::seconds rotation_;
+  std::size_t kept_;
+};
+
+inline std::string session_id(const unsigned char* id, unsigned int length) {
+  return {reinterpret_cast<const char*>(id), length};
+}
+}  // namespace detail
+
+/**
+ * @brief An asio::ssl::context for servers, with session resumption set up
+ *
+ * Load the certificate and key through context() as usual, then hand
+ * context() to the ssl::stream of every accepted connection:
+ *
+ * @code
+ * garak::tls_server_context tls{{.ticket_rotation = 30min}};
+ * tls.context().use_certificate_chain_file("server.pem");
+ * tls.context().use_private_key_file("server.key", asio::ssl::context::pem);
+ * asio::ssl::stream<tcp::socket> stream{std::move(socket), tls.context()};
+ * @endcode
+ *
+ * Must outlive every stream created from it. Safe to use from several
+ * threads.
+ * */
+class tls_server_context {
+ public:
+  explicit tls_server_context(
+      const tls_server_options& options = {},
+      asio::ssl::context::method method = asio::ssl::context::tls_server)
+      : context_(method),
+        cache_(options.cache_shards, options.cache_capacity),
+        tickets_(options.ticket_rotation, options.ticket_keys_kept) {
+    auto* ctx = context_.native_handle();
+    SSL_CTX_set_ex_data(ctx, owner_index(), this);
+
+    SSL_CTX_set_session_cache_mode(
+        ctx, SSL_SESS_CACHE_SERVER | SSL_SESS_CACHE_NO_INTERNAL);
+    SSL_CTX_set_timeout(ctx, options.session_lifetime.count());
+    static constexpr std::string_view id_context = "garak";
+    SSL_CTX_set_session_id_context(
+        ctx, reinterpret_cast<const unsigned char*>(id_context.data()),
+        static_cast<unsigned int>(id_context.size()));
+    SSL_CTX_sess_set_new_cb(ctx, &tls_server_context::on_new_session);
+    SSL_CTX_sess_set_get_cb(ctx, &tls_server_context::on_get_session);
+    SSL_CTX_sess_set_remove_cb(ctx, &tls_server_context::on_remove_session);
+    SSL_CTX_set_info_callback(ctx, &tls_server_context::on_info);
+
+    if (options.session_tickets) {
+      SSL_CTX_set_tlsext_ticket_key_evp_cb(ctx,
+                                           &tls_server_context::on_ticket_key);
+    } else {
+      SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
+    }
+  }
+
+  tls_server_context(const tls_server_context&) = delete;
+  tls_server_context& operator=(const tls_server_context&) = delete;
+  tls_server_context(tls_server_context&&) = delete;
+  tls_server_context& operator=(tls_server_context&&) = delete;
+  ~tls_server_context() = default;
+
+  asio::ssl::context& context() { return context_; }
+
+  /**
+   * @brief Replace the ticket encryption key now, tickets under the
+   * previous keys stay valid while they are kept
+   * */
+  void rotate_ticket_keys() { tickets_.rotate(); }
+
+  /**
+   * @brief Sessions in the server side cache
+   * */
+  [[nodiscard]] std::size_t cached_sessions() { return cache_.size(); }
+
+  [[nodiscard]] tls_server_stats stats() const {
+    return {full_.load(std::memory_order_relaxed),
+            resumed_.load(std::memory_order_relaxed),
+            cache_hits_.load(std::memory_order_relaxed),
+            cache_misses_.load(std::memory_order_relaxed),
+            renewals_.load(std::memory_order_relaxed)};
+  }
+
+ private:
+  static int owner_index() {
+    static const int index =
+        CRYPTO_get_ex_new_index(CRYPTO_EX_INDEX_SSL_CTX, 0, nullptr, nullptr,
+                                nullptr, nullptr);
+    return index;
+  }
+
+  static tls_server_context* owner(SSL_CTX* ctx) {
+    return static_cast<tls_server_context*>(
+        SSL_CTX_get_ex_data(ctx, owner_index()));
+  }
+
+  static tls_server_context* owner(SSL* ssl) {
+    return owner(SSL_get_SSL_CTX(ssl));
+  }
+
+  static int on_new_session(SSL* ssl, SSL_SESSION* session) {
+    unsigned int length = 0;
+    const unsigned char* id = SSL_SESSION_get_id(session, &length);
+    const int size = i2d_SSL_SESSION(session, nullptr);
+    if (size <= 0) {
+      return 0;
+    }
+    std::vector<unsigned char> encoded(static_cast<std::size_t>(size));
+    unsigned char* out = encoded.data();
+    i2d_SSL_SESSION(session, &out);
+    owner(ssl)->cache_.store(detail::session_id(id, length),
+                             std::move(encoded));
+    // We kept a copy rather than a reference to session
+    return 0;
+  }
+
+  static SSL_SESSION* on_get_session(SSL* ssl, const unsigned char* id,
+                                     int length, int* copy) {
+    *copy = 0;
+    auto* self = owner(ssl);
+    const auto encoded = self->cache_.find(
+        detail::session_id(id, static_cast<unsigned int>(length)));
+    if (!encoded) {
+      self->cache_misses_.fetch_add(1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    self->cache_hits_.fetch_add(1, std::memory_order_relaxed);
+    const unsigned char* in = encoded->data();
+    return d2i_SSL_SESSION(nullptr, &in, static_cast<long>(encoded->size()));
+  }
+
+  static void on_remove_session(SSL_CTX* ctx, SSL_SESSION* session) {
+    unsigned int length = 0;
+    const unsigned char* id = SSL_SESSION_get_id(session, &length);
+    owner(ctx)->cache_.erase(detail::session_id(id, length));
+  }
+
+  static void on_info(const SSL* ssl, int where, int /*ret*/) {
+    if ((where & SSL_CB_HANDSHAKE_DONE) == 0) {
+      return;
+    }
+    auto* self = owner(SSL_get_SSL_CTX(ssl));
+    if (SSL_session_reused(ssl) != 0) {
+      self->resumed_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+      self->full_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  static int on_ticket_key(SSL* ssl, unsigned char* name, unsigned char* iv,
+                           EVP_CIPHER_CTX* cipher, EVP_MAC_CTX* mac,
+                           int encrypt) {
+    auto* self = owner(ssl);
+    detail::tls_ticket_keys::key key;
+    bool current = true;
+    if (encrypt != 0) {
+      key = self->tickets_.current();
+      std::memcpy(name, key.name.data(), key.name.size());
+      if (RAND_bytes(iv, EVP_MAX_IV_LENGTH) != 1 ||
+          EVP_EncryptInit_ex(cipher, EVP_aes_256_cbc(), nullptr,
+                             key.aes.data(), iv) != 1) {
+        return -1;
+      }
+    } else {
+      auto found = self->tickets_.find(name);
+      if (!found) {
+        // Unknown or retired key, fall back to a full handshake
+        return 0;
+      }
+      key = found->first;
+      current = found->second;
+      if (EVP_DecryptInit_ex(cipher, EVP_aes_256_cbc(), nullptr,
+                             key.aes.data(), iv) != 1) {
+        return -1;
+      }
+    }
+
+    std::array<OSSL_PARAM, 3> params{
+        OSSL_PARAM_construct_octet_string(OSSL_MAC_PARAM_KEY, key.hmac.data(),
+                                          key.hmac.size()),
+        OSSL_PARAM_construct_utf8_string(
+            OSSL_MAC_PARAM_DIGEST, const_cast<char*>(SN_sha256), 0),
+        OSSL_PARAM_construct_end()};
+    if (EVP_MAC_CTX_set_params(mac, params.data()) != 1) {
+      return -1;
+    }
+    if (!current) {
+      // Good ticket under an older key, ask OpenSSL to issue a fresh one
+      self->renewals_.fetch_add(1, std::memory_order_relaxed);
+      return 2;
+    }
+    return 1;
+  }
+
+  asio::ssl::context context_;
+  detail::tls_session_cache cache_;
+  detail::tls_ticket_keys tickets_;
+  std::atomic<std::uint64_t> full_{0};
+  std::atomic<std::uint64_t> resumed_{0};
+  std::atomic<std::uint64_t> cache_hits_{0};
+  std::atomic<std::uint64_t> cache_misses_{0};
+  std::atomic<std::uint64_t> renewals_{0};
+};
+
+/**
+ * @brief Sessions a client was given by one server, offered back on new
+ * connections
+ *
+ * Each session is handed out once, as RFC 8446 recommends for TLS 1.3
+ * tickets. A TLS 1.2 session that resumed goes back in for reuse.
+ * */
+class tls_client_sessions {
+ public:
+  static constexpr std::size_t default_capacity = 8;
+
+  explicit tls_client_sessions(std::size_t capacity = default_capacity)
+      : capacity_(std::max<std::size_t>(capacity, 1)) {}
+
+  tls_client_sessions(const tls_client_sessions&) = delete;
+  tls_client_sessions& operator=(const tls_client_sessions&) = delete;
+  tls_client_sessions(tls_client_sessions&&) = delete;
+  tls_client_sessions& operator=(tls_client_sessions&&) = delete;
+
+  ~tls_client_sessions() {
+    for (auto* session : sessions_) {
+      SSL_SESSION_free(session);
+    }
+  }
+
+  /**
+   * @brief Keep session, taking ownership of the reference
+   * */
+  void store(SSL_SESSION* session) {
+    const std::scoped_lock lock{mutex_};
+    sessions_.push_back(session);
+    if (sessions_.size() > capacity_) {
+      SSL_SESSION_free(sessions_.front());
+      sessions_.pop_front();
+    }
+  }
+
+  /**
+   * @brief The newest session, which the caller now owns, or nullptr
+   * */
+  SSL_SESSION* take() {
+    const std::scoped_lock lock{mutex_};
+    if (sessions_.empty()) {
+      return nullptr;
+    }
+    auto* session = sessions_.back();
+    sessions_.pop_back();
+    return session;
+  }
+
+  [[nodiscard]] std::size_t size() {
+    const std::scoped_lock lock{mutex_};
+    return sessions_.size();
+  }
+
+  /**
+   * @brief Connections that offered a session
+   * */
+  [[nodiscard]] std::uint64_t offered() const {
+    return offered_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Connections the server resumed
+   * */
+  [[nodiscard]] std::uint64_t resumed() const {
+    return resumed_.load(std::memory_order_relaxed);
+  }
+
+  void record(bool offered, bool resumed) {
+    offered_.fetch_add(offered ? 1 : 0, std::memory_order_relaxed);
+    resumed_.fetch_add(resumed ? 1 : 0, std::memory_order_relaxed);
+  }
+
+ private:
+  std::mutex mutex_;
+  std::deque<SSL_SESSION*> sessions_;
+  std::size_t capacity_;
+  std::atomic<std::uint64_t> offered_{0};
+  std::atomic<std::uint64_t> resumed_{0};
+};
+
+namespace detail {
+/**
+ * @brief The SSL ex-data slot holding a connection's session store, one
+ * for every tls_connector so they can share an ssl::context
+ * */
+inline int client_sessions_index() {
+  static const int index = CRYPTO_get_ex_new_index(
+      CRYPTO_EX_INDEX_SSL, 0, nullptr, nullptr, nullptr,
+      [](void*, void* ptr, CRYPTO_EX_DATA*, int, long, void*) {
+        delete static_cast<std::shared_ptr<tls_client_sessions>*>(ptr);
+      });
+  return index;
+}
+
+/**
+ * @brief The client context's new session callback, keeping tickets in
+ * the connection's session store
+ * */
+inline int store_client_session(SSL* ssl, SSL_SESSION* session) {
+  auto* sessions = static_cast<std::shared_ptr<tls_client_sessions>*>(
+      SSL_get_ex_data(ssl, client_sessions_index()));
+  if (sessions == nullptr) {
+    return 0;
+  }
+  // Keep a copy, OpenSSL marks the connection's own session unresumable
+  // if the connection is dropped without a TLS shutdown
+  SSL_SESSION* copy = SSL_SESSION_dup(session);
+  if (copy != nullptr) {
+    (*sessions)->store(copy);
+  }
+  return 0;
+}
+}  // namespace detail
+
+/**
+ * @brief A garak::connection_pool Connector that opens TLS connections and
+ * resumes sessions from earlier ones
+ *
+ * @code
+ * asio::ssl::context client{asio::ssl::context::tls_client};
+ * garak::connection_pool<tcp, garak::tls_connector<tcp>> pool{
+ *     ex, endpoints, {}, garak::tls_connector<tcp>{client, "example.com"}};
+ * @endcode
+ *
+ * The ssl::context must outlive the connector and its connections. The
+ * connector takes over the context's client session caching: it turns off
+ * OpenSSL's internal store and installs its own new session callback,
+ * replacing any set before. Connectors may share a context, each keeps
+ * the sessions of its own connections.
+ *
+ * A non-empty host name is sent as SNI and checked against the server's
+ * certificate when the context verifies peers. Connections are
+ * garak::tls_stream unless Stream says otherwise, asio::ssl::stream works
+ * as well.
+ * */
+template <typename Protocol,
+          typename Stream = tls_stream<typename Protocol::socket>>
+class tls_connector {
+ public:
+  using endpoint_type = typename Protocol::endpoint;
+  using connection_type = Stream;
+
+  explicit tls_connector(asio::ssl::context& context, std::string host = {},
+                         std::shared_ptr<tls_client_sessions> sessions =
+                             std::make_shared<tls_client_sessions>())
+      : context_(&context),
+        host_(std::move(host)),
+        sessions_(std::move(sessions)) {
+    auto* ctx = context_->native_handle();
+    SSL_CTX_set_session_cache_mode(
+        ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    SSL_CTX_sess_set_new_cb(ctx, &detail::store_client_session);
+  }
+
+  asio::awaitable<connection_type> connect(
+      std::vector<endpoint_type> endpoints) const {
+    connection_type stream{co_await asio::this_coro::executor, *context_};
+    co_await asio::async_connect(stream.lowest_layer(), endpoints,
+                                 asio::use_awaitable);
+
+    auto* ssl = stream.native_handle();
+    if (!host_.empty()) {
+      // SSL_set_tlsext_host_name without the macro's C cast
+      SSL_ctrl(ssl, SSL_CTRL_SET_TLSEXT_HOSTNAME, TLSEXT_NAMETYPE_host_name,
+               const_cast<char*>(host_.c_str()));
+      // Checked during certificate verification, when the context verifies
+      SSL_set1_host(ssl, host_.c_str());
+    }
+    // The connection keeps the store alive for tickets arriving late
+    SSL_set_ex_data(ssl, detail::client_sessions_index(),
+                    new std::shared_ptr<tls_client_sessions>(sessions_));
+    SSL_SESSION* offered = sessions_->take();
+    if (offered != nullptr) {
+      SSL_set_session(ssl, offered);
+      SSL_SESSION_free(offered);
+    }
+
+    co_await stream.async_handshake(asio::ssl::stream_base::client,
+                                    asio::use_awaitable);
+    const bool resumed = SSL_session_reused(ssl) != 0;
+    sessions_->record(offered != nullptr, resumed);
+    if (resumed && SSL_version(ssl) < TLS1_3_VERSION) {
+      sessions_->store(SSL_get1_session(ssl));
+    }
+    co_return stream;
+  }
+
+  /**
+   * @brief Whether an idle connection can be reused
+   *
+   * TLS 1.3 servers send session tickets after the handshake, so an idle
+   * connection may well be readable. Records are processed without
+   * blocking, tickets are kept, and anything else (data, close_notify, a
+   * closed socket) rules the connection out.
+   * */
+  bool alive(connection_type& stream) const {
+    auto& socket = stream.lowest_layer();
+    if (!socket.is_open()) {
+      return false;
+    }
+    if (detail::idle_connection_alive(stream)) {
+      return true;
+    }
+    asio::error_code ec;
+    const bool was_non_blocking = socket.non_blocking();
+    socket.non_blocking(true, ec);
+    std::array<char, 1> probe{};
+    const auto n = stream.read_some(asio::buffer(probe), ec);
+    asio::error_code ignored;
+    socket.non_blocking(was_non_blocking, ignored);
+    return n == 0 && ec == asio::error::would_block;
+  }
+
+  [[nodiscard]] const std::shared_ptr<tls_client_sessions>& sessions() const {
+    return sessions_;
+  }
+
+ private:
+  asio::ssl::context* context_;
+  std::string host_;
+  std::shared_ptr<tls_client_sessions> sessions_;
+};
+}  // namespace garak
+
+#endif
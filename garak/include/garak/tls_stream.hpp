@@ -0,0 +1,692 @@
+#ifndef GARAK_TLS_STREAM_HPP
+#define GARAK_TLS_STREAM_HPP
+
+/**
+ * @file garak/tls_stream.hpp
+ * @brief A TLS stream that lets OpenSSL use the socket directly
+ * @date 2026-10-19
+ *
+ * asio::ssl::stream runs OpenSSL over a BIO pair and moves records between
+ * the pair and the socket through two 17 KB buffers of its own. Every byte
+ * is copied socket to buffer to BIO to SSL, and an idle connection pins
+ * the buffers and the BIO pair's own storage, close to 70 KB.
+ *
+ * garak::tls_stream gives OpenSSL a BIO that reads and writes the
+ * non-blocking socket itself, so records go straight from the kernel into
+ * OpenSSL's record buffer. With SSL_MODE_RELEASE_BUFFERS OpenSSL hands
+ * that buffer back whenever no record is in flight, leaving an idle
+ * connection with no I/O buffers at all.
+ *
+ * On Linux the stream can also hand the session keys to the kernel once
+ * the handshake is done (kTLS, see enable_ktls()). Records are then
+ * encrypted by the kernel and files are sent encrypted straight from the
+ * page cache with async_sendfile(). Without the tls module, or with a
+ * cipher the kernel doesn't know, OpenSSL keeps doing the crypto.
+ *
+ * Handshakes can run their CPU heavy steps on a separate executor, see
+ * offload_handshake(), so a connection storm doesn't stall established
+ * connections sharing the io_context.
+ *
+ * Only available when garak is built with GARAK_ENABLE_TLS.
+ */
+
+#include <openssl/bio.h>
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+
+#include <asio/any_io_executor.hpp>
+#include <asio/async_result.hpp>
+#include <asio/buffer.hpp>
+#include <asio/compose.hpp>
+#include <asio/error.hpp>
+#include <asio/post.hpp>
+#include <asio/socket_base.hpp>
+#include <asio/ssl/context.hpp>
+#include <asio/ssl/error.hpp>
+#include <asio/ssl/stream_base.hpp>
+#include <asio/write.hpp>
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <memory>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <system_error>
+#include <type_traits>
+#include <unistd.h>
+#include <utility>
+
+#if defined(__linux__) && defined(SSL_OP_ENABLE_KTLS)
+#define GARAK_HAS_KTLS 1
+#endif
+
+namespace garak {
+namespace detail {
+/**
+ * @brief What the socket BIO of a garak::tls_stream works on, kept off the
+ * stream itself so that moving the stream doesn't invalidate it
+ *
+ * With kTLS it sits in front of OpenSSL's own socket BIO, which is the one
+ * OpenSSL installs keys through and reads kernel decrypted records from.
+ * Data is still written here, with MSG_NOSIGNAL, only TLS control
+ * messages (alerts, tickets) go through OpenSSL's.
+ * */
+struct tls_socket_bio {
+  // OpenSSL internal BIO controls, see bio.h, sent before and after a
+  // control message is written under kTLS
+  static constexpr int set_ktls_control_message = 74;
+  static constexpr int clear_ktls_control_message = 75;
+
+  int fd{-1};
+  /// errno of the last failed send or recv
+  int error{0};
+  /// The next write is a TLS control message for the kernel
+  bool control_message{false};
+
+  static int write(BIO* bio, const char* data, int size) {
+    auto* self = static_cast<tls_socket_bio*>(BIO_get_data(bio));
+    BIO_clear_retry_flags(bio);
+    if (BIO* next = BIO_next(bio); next != nullptr && self->control_message) {
+      return forward(bio, self, BIO_write(next, data, size));
+    }
+    const auto n = ::send(self->fd, data, static_cast<std::size_t>(size),
+                          MSG_NOSIGNAL);
+    if (n < 0) {
+      self->error = errno;
+      if (self->error == EAGAIN || self->error == EINTR) {
+        BIO_set_retry_write(bio);
+      }
+      return -1;
+    }
+    return static_cast<int>(n);
+  }
+
+  static int read(BIO* bio, char* data, int size) {
+    auto* self = static_cast<tls_socket_bio*>(BIO_get_data(bio));
+    BIO_clear_retry_flags(bio);
+    if (BIO* next = BIO_next(bio); next != nullptr) {
+      return forward(bio, self, BIO_read(next, data, size));
+    }
+    const auto n = ::recv(self->fd, data, static_cast<std::size_t>(size), 0);
+    if (n < 0) {
+      self->error = errno;
+      if (self->error == EAGAIN || self->error == EINTR) {
+        BIO_set_retry_read(bio);
+      }
+      return -1;
+    }
+    return static_cast<int>(n);
+  }
+
+  static long control(BIO* bio, int command, long num, void* ptr) {
+    if (BIO* next = BIO_next(bio); next != nullptr) {
+      auto* self = static_cast<tls_socket_bio*>(BIO_get_data(bio));
+      if (command == set_ktls_control_message) {
+        self->control_message = true;
+      } else if (command == clear_ktls_control_message) {
+        self->control_message = false;
+      }
+      return BIO_ctrl(next, command, num, ptr);
+    }
+    // Nothing is buffered, so there is never anything to flush
+    return command == BIO_CTRL_FLUSH ? 1 : 0;
+  }
+
+  // Pass on the outcome of a call on OpenSSL's socket BIO
+  static int forward(BIO* bio, tls_socket_bio* self, int result) {
+    if (result < 0) {
+      self->error = errno;
+    }
+    BIO_copy_next_retry(bio);
+    return result;
+  }
+
+  static int create(BIO* bio) {
+    BIO_set_init(bio, 1);
+    return 1;
+  }
+
+  static BIO_METHOD* method() {
+    static BIO_METHOD* const instance = [] {
+      BIO_METHOD* m = BIO_meth_new(BIO_get_new_index() | BIO_TYPE_SOURCE_SINK,
+                                   "garak socket");
+      if (m == nullptr) {
+        throw std::system_error(asio::error::no_memory,
+                                "BIO_meth_new failed");
+      }
+      BIO_meth_set_write(m, &tls_socket_bio::write);
+      BIO_meth_set_read(m, &tls_socket_bio::read);
+      BIO_meth_set_ctrl(m, &tls_socket_bio::control);
+      BIO_meth_set_create(m, &tls_socket_bio::create);
+      return m;
+    }();
+    return instance;
+  }
+};
+}  // namespace detail
+
+/**
+ * @brief A TLS stream over a socket, a lighter asio::ssl::stream
+ *
+ * @code
+ * garak::tls_stream<tcp::socket> stream{ex, ssl_context};
+ * co_await asio::async_connect(stream.lowest_layer(), endpoints,
+ *                              asio::use_awaitable);
+ * co_await stream.async_handshake(asio::ssl::stream_base::client,
+ *                                 asio::use_awaitable);
+ * @endcode
+ *
+ * The interface follows asio::ssl::stream, so it works with asio::async_read,
+ * asio::async_write, garak::framed_stream and garak::connection_pool. Like
+ * asio::ssl::stream, at most one read and one write may be outstanding at a
+ * time. Socket must be a socket, OpenSSL reads and writes its descriptor
+ * directly.
+ * */
+template <typename Socket>
+class tls_stream : public asio::ssl::stream_base {
+ public:
+  using next_layer_type = Socket;
+  using lowest_layer_type = typename Socket::lowest_layer_type;
+  using executor_type = typename Socket::executor_type;
+  using native_handle_type = SSL*;
+
+  /**
+   * @brief Construct the socket from arg, e.g. an executor or a connected
+   * socket, and a TLS session configured from context
+   * */
+  template <typename Arg>
+  tls_stream(Arg&& arg, asio::ssl::context& context)
+      : socket_(std::forward<Arg>(arg)),
+        ssl_(SSL_new(context.native_handle())),
+        bio_(std::make_unique<detail::tls_socket_bio>()) {
+    BIO* bio = ssl_ ? BIO_new(detail::tls_socket_bio::method()) : nullptr;
+    if (bio == nullptr) {
+      throw std::system_error(asio::error::no_memory, "SSL_new failed");
+    }
+    BIO_set_data(bio, bio_.get());
+    SSL_set_bio(ssl_.get(), bio, bio);
+    SSL_set_mode(ssl_.get(), SSL_MODE_ENABLE_PARTIAL_WRITE |
+                                 SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER |
+                                 SSL_MODE_RELEASE_BUFFERS);
+  }
+
+  executor_type get_executor() noexcept { return socket_.get_executor(); }
+  native_handle_type native_handle() noexcept { return ssl_.get(); }
+  next_layer_type& next_layer() noexcept { return socket_; }
+  lowest_layer_type& lowest_layer() noexcept { return socket_.lowest_layer(); }
+
+#if defined(GARAK_HAS_KTLS)
+  /**
+   * @brief Have OpenSSL move the session keys into the socket once the
+   * handshake is done, call before async_handshake
+   *
+   * Needs the kernel's tls module. Whether the kernel took over shows in
+   * ktls_send() and ktls_recv() after the handshake, where it didn't the
+   * stream carries on with OpenSSL doing the crypto.
+   * */
+  void enable_ktls() {
+    SSL_set_options(ssl_.get(), SSL_OP_ENABLE_KTLS);
+    ktls_ = true;
+  }
+#endif
+
+  /**
+   * @brief Run the SSL_do_handshake steps of async_handshake on executor,
+   * e.g. an asio::thread_pool's
+   *
+   * A full handshake spends hundreds of microseconds in key exchange and
+   * signatures. Offloaded, the io_context only waits for the socket in
+   * between steps and keeps serving other connections. Reads and writes
+   * after the handshake stay on the stream's own executor.
+   * */
+  void offload_handshake(asio::any_io_executor executor) {
+    handshake_executor_ = std::move(executor);
+  }
+
+  /**
+   * @brief Whether the kernel encrypts what this stream sends
+   * */
+  [[nodiscard]] bool ktls_send() const {
+#if defined(GARAK_HAS_KTLS)
+    return ktls_ && BIO_get_ktls_send(SSL_get_wbio(ssl_.get()));
+#else
+    return false;
+#endif
+  }
+
+  /**
+   * @brief Whether the kernel decrypts what this stream receives
+   * */
+  [[nodiscard]] bool ktls_recv() const {
+#if defined(GARAK_HAS_KTLS)
+    return ktls_ && BIO_get_ktls_recv(SSL_get_rbio(ssl_.get()));
+#else
+    return false;
+#endif
+  }
+
+  /**
+   * @brief Whether the synchronous read_some and write_some fail with
+   * would_block rather than wait for the socket
+   * */
+  [[nodiscard]] bool non_blocking() const { return socket_.non_blocking(); }
+
+  void non_blocking(bool mode, asio::error_code& ec) {
+    socket_.non_blocking(mode, ec);
+  }
+
+  std::size_t read_some(const asio::mutable_buffer& buffer,
+                        asio::error_code& ec) {
+    return run(reader{buffer}, ec);
+  }
+
+  template <typename MutableBufferSequence>
+  std::size_t read_some(const MutableBufferSequence& buffers,
+                        asio::error_code& ec) {
+    return read_some(first_buffer<asio::mutable_buffer>(buffers), ec);
+  }
+
+  std::size_t write_some(const asio::const_buffer& buffer,
+                         asio::error_code& ec) {
+    return run(writer{buffer}, ec);
+  }
+
+  template <typename ConstBufferSequence>
+  std::size_t write_some(const ConstBufferSequence& buffers,
+                         asio::error_code& ec) {
+    return write_some(first_buffer<asio::const_buffer>(buffers), ec);
+  }
+
+  template <typename CompletionToken>
+  auto async_handshake(handshake_type type, CompletionToken&& token) {
+    if (type == client) {
+      SSL_set_connect_state(ssl_.get());
+    } else {
+      SSL_set_accept_state(ssl_.get());
+    }
+    return async_perform<void(asio::error_code)>(handshaker{},
+                                                 std::forward<CompletionToken>(
+                                                     token));
+  }
+
+  template <typename MutableBufferSequence, typename CompletionToken>
+  auto async_read_some(const MutableBufferSequence& buffers,
+                       CompletionToken&& token) {
+    return async_perform<void(asio::error_code, std::size_t)>(
+        reader{first_buffer<asio::mutable_buffer>(buffers)},
+        std::forward<CompletionToken>(token));
+  }
+
+  template <typename ConstBufferSequence, typename CompletionToken>
+  auto async_write_some(const ConstBufferSequence& buffers,
+                        CompletionToken&& token) {
+    return async_perform<void(asio::error_code, std::size_t)>(
+        writer{first_buffer<asio::const_buffer>(buffers)},
+        std::forward<CompletionToken>(token));
+  }
+
+  /**
+   * @brief Send size bytes of file, from offset on
+   *
+   * With ktls_send() the kernel encrypts straight from the page cache,
+   * otherwise the file is read in chunks and written through OpenSSL.
+   * Completes with the bytes sent, which fall short of size only on error
+   * or when the file ends first.
+   * */
+  template <typename CompletionToken>
+  auto async_sendfile(int file, off_t offset, std::size_t size,
+                      CompletionToken&& token) {
+    return asio::async_compose<CompletionToken,
+                               void(asio::error_code, std::size_t)>(
+        sendfile_op{this, file, offset, size}, token, socket_);
+  }
+
+  /**
+   * @brief Send close_notify and wait for the peer's
+   * */
+  template <typename CompletionToken>
+  auto async_shutdown(CompletionToken&& token) {
+    return async_perform<void(asio::error_code)>(
+        shutdowner{}, std::forward<CompletionToken>(token));
+  }
+
+ private:
+  // What an SSL call needs before it can be retried
+  enum class want { nothing, read, write };
+
+  struct reader {
+    asio::mutable_buffer buffer;
+
+    int operator()(SSL* ssl, std::size_t& transferred) const {
+      if (buffer.size() == 0) {
+        return 1;
+      }
+      return SSL_read_ex(ssl, buffer.data(), buffer.size(), &transferred);
+    }
+  };
+
+  struct writer {
+    asio::const_buffer buffer;
+
+    int operator()(SSL* ssl, std::size_t& transferred) const {
+      if (buffer.size() == 0) {
+        return 1;
+      }
+      return SSL_write_ex(ssl, buffer.data(), buffer.size(), &transferred);
+    }
+  };
+
+  // One SSL_sendfile call, only valid with ktls_send()
+  struct file_sender {
+    int file;
+    off_t offset;
+    std::size_t size;
+
+    int operator()(SSL* ssl, std::size_t& transferred) const {
+#if defined(GARAK_HAS_KTLS)
+      const auto sent = SSL_sendfile(ssl, file, offset, size, 0);
+      if (sent < 0) {
+        return -1;
+      }
+      transferred = static_cast<std::size_t>(sent);
+      return 1;
+#else
+      (void)ssl;
+      (void)transferred;
+      return -1;
+#endif
+    }
+  };
+
+  struct handshaker {
+    int operator()(SSL* ssl, std::size_t& /*transferred*/) const {
+      return SSL_do_handshake(ssl);
+    }
+  };
+
+  struct shutdowner {
+    int operator()(SSL* ssl, std::size_t& /*transferred*/) const {
+      // 0 means our close_notify is out, call again to wait for the peer's
+      const int result = SSL_shutdown(ssl);
+      return result == 0 ? SSL_shutdown(ssl) : result;
+    }
+  };
+
+  struct ssl_free {
+    void operator()(SSL* ssl) const { SSL_free(ssl); }
+  };
+
+  template <typename Buffer, typename BufferSequence>
+  static Buffer first_buffer(const BufferSequence& buffers) {
+    const auto end = asio::buffer_sequence_end(buffers);
+    for (auto it = asio::buffer_sequence_begin(buffers); it != end; ++it) {
+      const Buffer buffer{*it};
+      if (buffer.size() > 0) {
+        return buffer;
+      }
+    }
+    return Buffer{};
+  }
+
+  // Point the BIO at the socket, which may have been opened since the last
+  // call
+  void attach() {
+    const int fd = socket_.native_handle();
+    if (bio_->fd == fd) {
+      return;
+    }
+    bio_->fd = fd;
+    asio::error_code ignored;
+    socket_.native_non_blocking(true, ignored);
+#if defined(GARAK_HAS_KTLS)
+    if (ktls_) {
+      // OpenSSL enables the tls ULP on the descriptor here, which needs a
+      // connected socket, so only now
+      BIO* filter = SSL_get_rbio(ssl_.get());
+      if (BIO* stale = BIO_next(filter); stale != nullptr) {
+        BIO_pop(stale);
+        BIO_free(stale);
+      }
+      if (BIO* socket = BIO_new_socket(fd, BIO_NOCLOSE); socket != nullptr) {
+        BIO_push(filter, socket);
+      }
+    }
+#endif
+  }
+
+  // Make one attempt at operation without blocking
+  template <typename Operation>
+  want perform(const Operation& operation, asio::error_code& ec,
+               std::size_t& transferred) {
+    attach();
+    ERR_clear_error();
+    bio_->error = 0;
+    transferred = 0;
+    ec = {};
+    const int result = operation(ssl_.get(), transferred);
+    if (result > 0) {
+      return want::nothing;
+    }
+    switch (SSL_get_error(ssl_.get(), result)) {
+      case SSL_ERROR_WANT_READ:
+        return want::read;
+      case SSL_ERROR_WANT_WRITE:
+        return want::write;
+      case SSL_ERROR_ZERO_RETURN:
+        ec = asio::error::eof;
+        break;
+      case SSL_ERROR_SYSCALL:
+        // A bare TCP close, without close_notify, fails without an errno
+        ec = bio_->error != 0 ? asio::error_code(bio_->error,
+                                                 asio::system_category())
+                              : asio::error_code(asio::ssl::error::
+                                                     stream_truncated);
+        break;
+      case SSL_ERROR_SSL: {
+        const auto error = ERR_get_error();
+#if defined(SSL_R_UNEXPECTED_EOF_WHILE_READING)
+        if (ERR_GET_REASON(error) == SSL_R_UNEXPECTED_EOF_WHILE_READING) {
+          ec = asio::ssl::error::stream_truncated;
+          break;
+        }
+#endif
+        ec = asio::error_code(static_cast<int>(error),
+                              asio::error::get_ssl_category());
+        break;
+      }
+      default:
+        ec = asio::ssl::error::unexpected_result;
+        break;
+    }
+    return want::nothing;
+  }
+
+  // Retry operation until done, waiting on the socket unless non-blocking
+  template <typename Operation>
+  std::size_t run(const Operation& operation, asio::error_code& ec) {
+    std::size_t transferred = 0;
+    for (;;) {
+      const auto next = perform(operation, ec, transferred);
+      if (next == want::nothing) {
+        return transferred;
+      }
+      if (socket_.non_blocking()) {
+        ec = asio::error::would_block;
+        return 0;
+      }
+      socket_.wait(next == want::read ? asio::socket_base::wait_read
+                                      : asio::socket_base::wait_write,
+                   ec);
+      if (ec) {
+        return 0;
+      }
+    }
+  }
+
+  template <typename Operation>
+  struct io_op {
+    tls_stream* owner;
+    Operation operation;
+    enum class state {
+      start,
+      waiting,
+      posted,
+      // Handed to the handshake executor, and back from it
+      offloaded,
+      returned
+    } current{state::start};
+    asio::error_code result{};
+    std::size_t transferred{0};
+    want next{want::nothing};
+
+    template <typename Self>
+    void operator()(Self& self, asio::error_code ec = {}) {
+      switch (current) {
+        case state::posted:
+          finish(self);
+          return;
+        case state::waiting:
+          if (ec) {
+            result = ec;
+            finish(self);
+            return;
+          }
+          break;
+        case state::offloaded:
+          // On the handshake executor, the stream is ours until we post
+          // back
+          next = owner->perform(operation, result, transferred);
+          current = state::returned;
+          asio::post(std::move(self));
+          return;
+        case state::returned:
+          proceed(self);
+          return;
+        case state::start:
+          break;
+      }
+      if constexpr (std::is_same_v<Operation, handshaker>) {
+        if (owner->handshake_executor_) {
+          current = state::offloaded;
+          asio::post(owner->handshake_executor_,
+                     [self = std::move(self)]() mutable { self(); });
+          return;
+        }
+      }
+      next = owner->perform(operation, result, transferred);
+      if (next == want::nothing && current == state::start) {
+        // Never complete from inside the initiating function
+        current = state::posted;
+        asio::post(std::move(self));
+        return;
+      }
+      proceed(self);
+    }
+
+    // Finish, or wait for the socket and go again
+    template <typename Self>
+    void proceed(Self& self) {
+      if (next == want::nothing) {
+        finish(self);
+        return;
+      }
+      current = state::waiting;
+      owner->socket_.async_wait(next == want::read
+                                    ? asio::socket_base::wait_read
+                                    : asio::socket_base::wait_write,
+                                std::move(self));
+    }
+
+    template <typename Self>
+    void finish(Self& self) {
+      if constexpr (!std::is_same_v<Operation, handshaker> &&
+                    !std::is_same_v<Operation, shutdowner>) {
+        self.complete(result, result ? 0 : transferred);
+      } else {
+        self.complete(result);
+      }
+    }
+  };
+
+  struct sendfile_op {
+    tls_stream* owner;
+    int file;
+    off_t offset;
+    std::size_t remaining;
+    std::size_t sent{0};
+    // Only for sending through OpenSSL
+    std::unique_ptr<std::array<char, 16384>> chunk{};
+    bool started{false};
+    bool posted{false};
+    asio::error_code failure{};
+
+    template <typename Self>
+    void operator()(Self& self, asio::error_code ec = {},
+                    std::size_t transferred = 0) {
+      if (posted) {
+        self.complete(failure, sent);
+        return;
+      }
+      if (started) {
+        sent += transferred;
+        offset += static_cast<off_t>(transferred);
+        remaining -= transferred;
+      }
+      const bool first = !started;
+      started = true;
+      if (ec || remaining == 0 || (!first && transferred == 0)) {
+        failure = ec;
+        complete(self, first);
+        return;
+      }
+      if (owner->ktls_send()) {
+        owner->async_perform<void(asio::error_code, std::size_t)>(
+            file_sender{file, offset, remaining}, std::move(self));
+        return;
+      }
+      if (!chunk) {
+        chunk = std::make_unique<std::array<char, 16384>>();
+      }
+      const auto n = ::pread(file, chunk->data(),
+                             std::min(remaining, chunk->size()), offset);
+      if (n <= 0) {
+        if (n < 0) {
+          failure = asio::error_code(errno, asio::system_category());
+        }
+        complete(self, first);
+        return;
+      }
+      asio::async_write(*owner,
+                        asio::buffer(chunk->data(),
+                                     static_cast<std::size_t>(n)),
+                        std::move(self));
+    }
+
+    template <typename Self>
+    void complete(Self& self, bool first) {
+      if (first) {
+        // Never complete from inside the initiating function
+        posted = true;
+        asio::post(std::move(self));
+        return;
+      }
+      self.complete(failure, sent);
+    }
+  };
+
+  template <typename Signature, typename Operation, typename CompletionToken>
+  auto async_perform(Operation operation, CompletionToken&& token) {
+    return asio::async_compose<CompletionToken, Signature>(
+        io_op<Operation>{this, std::move(operation)}, token, socket_);
+  }
+
+  Socket socket_;
+  std::unique_ptr<SSL, ssl_free> ssl_;
+  std::unique_ptr<detail::tls_socket_bio> bio_;
+  bool ktls_{false};
+  asio::any_io_executor handshake_executor_;
+};
+}  // namespace garak
+
+#endif
@@ -0,0 +1,627 @@
+#ifndef GARAK_TRACING_HPP
+#define GARAK_TRACING_HPP
+
+/**
+ * @file garak/tracing.hpp
+ * @brief Always-on binary handler tracing
+ * @date 2026-10-19
+ *
+ * Handler events go into per-thread rings of fixed size with a TSC
+ * timestamp, eight relaxed stores and a release of the head, no locks and
+ * no formatting. Older events are overwritten, so a dump holds the latest
+ * ring-full per thread. Dump on demand with dump(), or from a signal with
+ * dump_on_signal(), then turn the file into Chrome trace / Perfetto JSON
+ * with the garak_trace2json tool.
+ *
+ * The asio hooks live in garak/handler_tracking.hpp, enabled by configuring
+ * with -DGARAK_ENABLE_TRACING=ON. This header has no asio dependency, so
+ * it's safe to include from inside asio.
+ */
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace garak::tracing {
+enum class event_kind : std::uint8_t {
+  // A handler was created, arg is the id of the handler running at the time
+  creation,
+  // A handler started, arg holds the error code and extra the second
+  // completion argument if any
+  invocation_begin,
+  invocation_end,
+  // A handler was destroyed without being invoked
+  abandoned,
+  // An operation not tied to a handler, such as a timer cancel
+  operation,
+  // A descriptor was added to or removed from the reactor, extra is the
+  // descriptor and arg the registration
+  reactor_registration,
+  reactor_deregistration,
+  // The reactor saw events for registration arg, extra holds the mask
+  reactor_events,
+  // A non-blocking attempt for handler id, arg the error code and extra the
+  // bytes transferred
+  reactor_operation,
+};
+
+/**
+ * @brief Timestamp in TSC ticks, or steady clock nanoseconds where there
+ * is no TSC
+ * */
+inline std::uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return static_cast<std::uint64_t>(
+      std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+inline std::int64_t steady_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+namespace detail {
+/**
+ * @brief One event, a cache line, written with relaxed stores so a
+ * concurrent snapshot is a race the reader detects rather than undefined
+ * behaviour
+ * */
+struct alignas(64) slot {
+  std::atomic<std::uint64_t> tsc{0};
+  std::atomic<std::uint64_t> id{0};
+  std::atomic<std::uint64_t> arg{0};
+  std::atomic<std::uint64_t> extra{0};
+  std::atomic<const char*> object{nullptr};
+  std::atomic<const char*> op{nullptr};
+  std::atomic<const char*> location{nullptr};
+  std::atomic<event_kind> kind{event_kind::creation};
+};
+
+/**
+ * @brief A single-writer ring, owned by one thread at a time and reused
+ * once that thread exits
+ * */
+struct ring {
+  ring(std::uint32_t ring_index, std::size_t capacity)
+      : slots(std::make_unique<slot[]>(capacity)),
+        mask(capacity - 1),
+        index(ring_index) {}
+
+  std::unique_ptr<slot[]> slots;
+  std::uint64_t mask;
+  std::atomic<std::uint64_t> head{0};
+  std::uint32_t index;
+  std::uint64_t next_id{0};
+  std::atomic<bool> in_use{false};
+  std::array<char, 16> name{};
+};
+
+struct registry {
+  std::mutex mutex;
+  std::vector<std::unique_ptr<ring>> rings;
+  std::size_t capacity{std::size_t{1} << 15};
+  std::uint64_t start_tsc{now()};
+  std::int64_t start_ns{steady_ns()};
+};
+
+inline registry& get_registry() {
+  static registry r;
+  return r;
+}
+
+inline std::atomic<bool> enabled{true};
+
+/**
+ * @brief Hands the thread's ring back when it exits
+ * */
+struct ring_owner {
+  ring* r{nullptr};
+  ~ring_owner() {
+    if (r != nullptr) {
+      r->in_use.store(false, std::memory_order_release);
+    }
+  }
+};
+
+inline thread_local ring_owner local;
+// The handler this thread is running, the parent of any it creates
+inline thread_local std::uint64_t current_handler{0};
+// The innermost asio initiating function on this thread's stack
+inline thread_local const char* current_location{nullptr};
+
+inline ring& acquire_ring() {
+  auto& reg = get_registry();
+  const std::lock_guard lock{reg.mutex};
+  ring* r = nullptr;
+  for (auto& candidate : reg.rings) {
+    bool free = false;
+    if (candidate->in_use.compare_exchange_strong(free, true)) {
+      r = candidate.get();
+      break;
+    }
+  }
+  if (r == nullptr) {
+    r = reg.rings
+            .emplace_back(std::make_unique<ring>(
+                static_cast<std::uint32_t>(reg.rings.size()), reg.capacity))
+            .get();
+    r->in_use.store(true);
+  } else if (r->mask + 1 != reg.capacity) {
+    // Left by an exited thread before set_ring_capacity() changed the
+    // size; its events go with the old slots. Readers hold the mutex too.
+    r->slots = std::make_unique<slot[]>(reg.capacity);
+    r->mask = reg.capacity - 1;
+    r->head.store(0, std::memory_order_relaxed);
+  }
+  r->name.fill('\0');
+  pthread_getname_np(pthread_self(), r->name.data(), r->name.size());
+  local.r = r;
+  return *r;
+}
+
+inline ring& local_ring() {
+  ring* r = local.r;
+  return r != nullptr ? *r : acquire_ring();
+}
+}  // namespace detail
+
+/**
+ * @brief Turn recording on or off at runtime, on by default
+ * */
+inline void set_enabled(bool on) {
+  detail::enabled.store(on, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Events kept per thread, rounded up to a power of two; only
+ * affects threads that record for the first time after the call
+ * */
+inline void set_ring_capacity(std::size_t events) {
+  auto& reg = detail::get_registry();
+  const std::lock_guard lock{reg.mutex};
+  reg.capacity = std::bit_ceil(std::max<std::size_t>(events, 2));
+}
+
+/**
+ * @brief A new id, unique across threads without sharing a counter
+ * */
+inline std::uint64_t next_id() {
+  auto& r = detail::local_ring();
+  return (static_cast<std::uint64_t>(r.index + 1) << 40) | ++r.next_id;
+}
+
+/**
+ * @brief Append an event to this thread's ring
+ * */
+inline void record(event_kind kind, std::uint64_t id, std::uint64_t arg = 0,
+                   std::uint64_t extra = 0, const char* object = nullptr,
+                   const char* op = nullptr,
+                   const char* location = nullptr) {
+  if (!detail::enabled.load(std::memory_order_relaxed)) {
+    return;
+  }
+  auto& r = detail::local_ring();
+  const auto head = r.head.load(std::memory_order_relaxed);
+  auto& s = r.slots[head & r.mask];
+  constexpr auto relaxed = std::memory_order_relaxed;
+  s.tsc.store(now(), relaxed);
+  s.id.store(id, relaxed);
+  s.arg.store(arg, relaxed);
+  s.extra.store(extra, relaxed);
+  s.object.store(object, relaxed);
+  s.op.store(op, relaxed);
+  s.location.store(location, relaxed);
+  s.kind.store(kind, relaxed);
+  r.head.store(head + 1, std::memory_order_release);
+}
+
+/**
+ * @brief An event as read back, names are indexes into trace::strings
+ * with 0 the empty string
+ * */
+struct event {
+  std::uint64_t tsc{0};
+  std::uint64_t id{0};
+  std::uint64_t arg{0};
+  std::uint64_t extra{0};
+  std::uint32_t thread{0};
+  std::uint16_t object{0};
+  std::uint16_t op{0};
+  std::uint16_t location{0};
+  event_kind kind{event_kind::creation};
+};
+
+struct thread_info {
+  std::uint32_t index{0};
+  std::string name;
+};
+
+/**
+ * @brief A snapshot of every ring, with two TSC readings against the
+ * steady clock to convert ticks to time
+ * */
+struct trace {
+  std::uint64_t start_tsc{0};
+  std::int64_t start_ns{0};
+  std::uint64_t end_tsc{0};
+  std::int64_t end_ns{0};
+  std::vector<std::string> strings{""};
+  std::vector<thread_info> threads;
+  std::vector<event> events;
+
+  /**
+   * @brief Nanoseconds since start_tsc
+   * */
+  [[nodiscard]] double to_ns(std::uint64_t tsc) const {
+    const double ticks = static_cast<double>(end_tsc - start_tsc);
+    const double ns = static_cast<double>(end_ns - start_ns);
+    const double scale = ticks > 0 && ns > 0 ? ns / ticks : 1.0;
+    return static_cast<double>(tsc - start_tsc) * scale;
+  }
+
+  [[nodiscard]] const std::string& name(std::uint16_t index) const {
+    return index < strings.size() ? strings[index] : strings.front();
+  }
+};
+
+/**
+ * @brief Copy out every ring, safe to call while other threads record
+ *
+ * Events a writer lapped while being copied are dropped, as is the oldest
+ * event of a full ring, whose slot the writer may be filling.
+ * */
+inline trace snapshot() {
+  auto& reg = detail::get_registry();
+  trace t;
+  t.start_tsc = reg.start_tsc;
+  t.start_ns = reg.start_ns;
+
+  std::unordered_map<const char*, std::uint16_t> interned;
+  auto intern = [&](const char* s) -> std::uint16_t {
+    if (s == nullptr) {
+      return 0;
+    }
+    auto [it, added] = interned.try_emplace(s, 0);
+    if (added) {
+      if (t.strings.size() > UINT16_MAX) {
+        return 0;
+      }
+      it->second = static_cast<std::uint16_t>(t.strings.size());
+      t.strings.emplace_back(s);
+    }
+    return it->second;
+  };
+
+  const std::lock_guard lock{reg.mutex};
+  constexpr auto relaxed = std::memory_order_relaxed;
+  struct raw {
+    event e;
+    const char* object;
+    const char* op;
+    const char* location;
+  };
+  std::vector<raw> copied;
+  for (const auto& r : reg.rings) {
+    const auto capacity = r->mask + 1;
+    const auto head = r->head.load(std::memory_order_acquire);
+    const auto first = head > capacity ? head - capacity : 0;
+    copied.clear();
+    for (auto i = first; i < head; ++i) {
+      const auto& s = r->slots[i & r->mask];
+      raw c{};
+      c.e.tsc = s.tsc.load(relaxed);
+      c.e.id = s.id.load(relaxed);
+      c.e.arg = s.arg.load(relaxed);
+      c.e.extra = s.extra.load(relaxed);
+      c.e.kind = s.kind.load(relaxed);
+      c.e.thread = r->index;
+      c.object = s.object.load(relaxed);
+      c.op = s.op.load(relaxed);
+      c.location = s.location.load(relaxed);
+      copied.push_back(c);
+    }
+    // Slots from index (now - capacity) on may have been rewritten under us
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const auto now_head = r->head.load(relaxed);
+    const auto valid = now_head >= capacity ? now_head - capacity + 1 : 0;
+    for (auto i = first; i < head; ++i) {
+      if (i < valid) {
+        continue;
+      }
+      auto& c = copied[i - first];
+      c.e.object = intern(c.object);
+      c.e.op = intern(c.op);
+      c.e.location = intern(c.location);
+      t.events.push_back(c.e);
+    }
+    t.threads.push_back({r->index, std::string{r->name.data()}});
+  }
+  t.end_tsc = now();
+  t.end_ns = steady_ns();
+  std::stable_sort(
+      t.events.begin(), t.events.end(),
+      [](const event& a, const event& b) { return a.tsc < b.tsc; });
+  return t;
+}
+
+namespace detail {
+constexpr std::array<char, 8> magic{'G', 'A', 'R', 'A', 'K', 'T', 'R', '1'};
+
+// The on-disk event, host byte order
+struct file_event {
+  std::uint64_t tsc;
+  std::uint64_t id;
+  std::uint64_t arg;
+  std::uint64_t extra;
+  std::uint32_t thread;
+  std::uint16_t object;
+  std::uint16_t op;
+  std::uint16_t location;
+  std::uint8_t kind;
+  std::array<std::uint8_t, 5> pad;
+};
+static_assert(sizeof(file_event) == 48);
+
+template <typename T>
+void put(std::string& out, const T& value) {
+  out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+T get(std::string_view& in) {
+  if (in.size() < sizeof(T)) {
+    throw std::runtime_error("tracing: truncated trace file");
+  }
+  T value;
+  std::memcpy(&value, in.data(), sizeof(T));
+  in.remove_prefix(sizeof(T));
+  return value;
+}
+
+inline std::string get_string(std::string_view& in) {
+  const auto size = get<std::uint16_t>(in);
+  if (in.size() < size) {
+    throw std::runtime_error("tracing: truncated trace file");
+  }
+  std::string s{in.substr(0, size)};
+  in.remove_prefix(size);
+  return s;
+}
+}  // namespace detail
+
+/**
+ * @brief The compact binary form of a trace: a header with the clock
+ * calibration, the string and thread tables, then 48 byte events
+ * */
+inline std::string serialize(const trace& t) {
+  std::string out;
+  out.reserve(64 + t.events.size() * sizeof(detail::file_event));
+  out.append(detail::magic.data(), detail::magic.size());
+  detail::put(out, t.start_tsc);
+  detail::put(out, t.start_ns);
+  detail::put(out, t.end_tsc);
+  detail::put(out, t.end_ns);
+  detail::put(out, static_cast<std::uint32_t>(t.strings.size()));
+  detail::put(out, static_cast<std::uint32_t>(t.threads.size()));
+  detail::put<std::uint64_t>(out, t.events.size());
+  for (const auto& s : t.strings) {
+    const auto size = std::min<std::size_t>(s.size(), UINT16_MAX);
+    detail::put(out, static_cast<std::uint16_t>(size));
+    out.append(s, 0, size);
+  }
+  for (const auto& th : t.threads) {
+    detail::put(out, th.index);
+    const auto size = std::min<std::size_t>(th.name.size(), UINT16_MAX);
+    detail::put(out, static_cast<std::uint16_t>(size));
+    out.append(th.name, 0, size);
+  }
+  for (const auto& e : t.events) {
+    detail::put(out, detail::file_event{e.tsc, e.id, e.arg, e.extra,
+                                        e.thread, e.object, e.op, e.location,
+                                        static_cast<std::uint8_t>(e.kind),
+                                        {}});
+  }
+  return out;
+}
+
+inline trace deserialize(std::string_view in) {
+  if (in.size() < detail::magic.size() ||
+      !std::equal(detail::magic.begin(), detail::magic.end(), in.begin())) {
+    throw std::runtime_error("tracing: not a garak trace file");
+  }
+  in.remove_prefix(detail::magic.size());
+  trace t;
+  t.start_tsc = detail::get<std::uint64_t>(in);
+  t.start_ns = detail::get<std::int64_t>(in);
+  t.end_tsc = detail::get<std::uint64_t>(in);
+  t.end_ns = detail::get<std::int64_t>(in);
+  const auto strings = detail::get<std::uint32_t>(in);
+  const auto threads = detail::get<std::uint32_t>(in);
+  const auto events = detail::get<std::uint64_t>(in);
+  if (events > in.size() / sizeof(detail::file_event)) {
+    throw std::runtime_error("tracing: truncated trace file");
+  }
+  t.strings.clear();
+  for (std::uint32_t i = 0; i < strings; ++i) {
+    t.strings.push_back(detail::get_string(in));
+  }
+  if (t.strings.empty()) {
+    t.strings.emplace_back();
+  }
+  for (std::uint32_t i = 0; i < threads; ++i) {
+    const auto index = detail::get<std::uint32_t>(in);
+    t.threads.push_back({index, detail::get_string(in)});
+  }
+  t.events.reserve(events);
+  for (std::uint64_t i = 0; i < events; ++i) {
+    const auto e = detail::get<detail::file_event>(in);
+    t.events.push_back({e.tsc, e.id, e.arg, e.extra, e.thread, e.object,
+                        e.op, e.location, static_cast<event_kind>(e.kind)});
+  }
+  return t;
+}
+
+/**
+ * @brief Write a snapshot to path, replacing it
+ *
+ * @throws std::system_error if the file can't be written
+ * */
+inline void dump(const std::string& path) {
+  const auto bytes = serialize(snapshot());
+  const std::string temp = path + ".tmp";
+  const int fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                        0644);
+  if (fd < 0) {
+    throw std::system_error(errno, std::generic_category(), "tracing: open");
+  }
+  std::size_t written = 0;
+  while (written < bytes.size()) {
+    const auto n = ::write(fd, bytes.data() + written, bytes.size() - written);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0) {
+      const int error = errno;
+      ::close(fd);
+      throw std::system_error(error, std::generic_category(),
+                              "tracing: write");
+    }
+    written += static_cast<std::size_t>(n);
+  }
+  ::close(fd);
+  // Readers never see a half written dump
+  if (std::rename(temp.c_str(), path.c_str()) != 0) {
+    throw std::system_error(errno, std::generic_category(),
+                            "tracing: rename");
+  }
+}
+
+/**
+ * @brief Read a dump back
+ *
+ * @throws std::system_error or std::runtime_error on a missing or
+ * malformed file
+ * */
+inline trace load(const std::string& path) {
+  std::unique_ptr<std::FILE, decltype(&std::fclose)> file{
+      std::fopen(path.c_str(), "rb"), &std::fclose};
+  if (!file) {
+    throw std::system_error(errno, std::generic_category(), "tracing: open");
+  }
+  std::string bytes;
+  std::array<char, 64 * 1024> chunk{};
+  std::size_t n = 0;
+  while ((n = std::fread(chunk.data(), 1, chunk.size(), file.get())) > 0) {
+    bytes.append(chunk.data(), n);
+  }
+  return deserialize(bytes);
+}
+
+namespace detail {
+struct signal_dumper {
+  std::mutex mutex;
+  std::string path;
+  std::array<int, 2> pipe{-1, -1};
+};
+
+inline signal_dumper& get_signal_dumper() {
+  static signal_dumper d;
+  return d;
+}
+
+// Only an async-signal-safe write, the dump runs on the dumper thread
+inline std::atomic<int> signal_pipe{-1};
+
+inline void on_dump_signal(int) {
+  const int saved = errno;
+  const char byte = 1;
+  [[maybe_unused]] const auto n = ::write(signal_pipe.load(), &byte, 1);
+  errno = saved;
+}
+}  // namespace detail
+
+/**
+ * @brief Dump to path every time signo arrives, e.g. `kill -USR2 <pid>`
+ *
+ * The handler just writes a byte to a pipe, a background thread does the
+ * dump. Calling again changes the path.
+ *
+ * @throws std::system_error if the pipe or the handler can't be set up
+ * */
+inline void dump_on_signal(int signo, std::string path) {
+  auto& d = detail::get_signal_dumper();
+  const std::lock_guard lock{d.mutex};
+  d.path = std::move(path);
+  if (d.pipe[0] < 0) {
+    if (::pipe2(d.pipe.data(), O_CLOEXEC | O_NONBLOCK) != 0) {
+      throw std::system_error(errno, std::generic_category(), "tracing: pipe");
+    }
+    // Reads block, the handler's writes never do
+    ::fcntl(d.pipe[0], F_SETFL, 0);
+    detail::signal_pipe.store(d.pipe[1]);
+    std::thread{[&d] {
+      pthread_setname_np(pthread_self(), "garak-trace");
+      char byte = 0;
+      for (;;) {
+        const auto n = ::read(d.pipe[0], &byte, 1);
+        if (n < 0 && errno == EINTR) {
+          continue;
+        }
+        if (n <= 0) {
+          return;
+        }
+        std::string target;
+        {
+          const std::lock_guard dump_lock{d.mutex};
+          target = d.path;
+        }
+        try {
+          dump(target);
+        } catch (const std::exception& error) {
+          std::fprintf(stderr, "%s\n", error.what());
+        }
+      }
+    }}.detach();
+  }
+  struct sigaction action {};
+  action.sa_handler = &detail::on_dump_signal;
+  sigemptyset(&action.sa_mask);
+  action.sa_flags = SA_RESTART;
+  if (::sigaction(signo, &action, nullptr) != 0) {
+    throw std::system_error(errno, std::generic_category(),
+                            "tracing: sigaction");
+  }
+}
+}  // namespace garak::tracing
+
+#endif
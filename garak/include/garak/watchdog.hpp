@@ -0,0 +1,495 @@
+#ifndef GARAK_WATCHDOG_HPP
+#define GARAK_WATCHDOG_HPP
+
+/**
+ * @file garak/watchdog.hpp
+ * @brief Detecting handlers that block an io thread for too long
+ * @date 2026-10-19
+ *
+ * One blocking call in a handler stalls every connection on its io_context,
+ * and by the time the latency graph shows it the stack that caused it is
+ * gone. A watchdog samples the io threads of the contexts it watches from
+ * a thread of its own; when one has been running the same handler for
+ * longer than the threshold, it signals that thread to capture its stack
+ * and reports the thread, the handler and the stack:
+ *
+ * @code
+ * garak::watchdog_options options;
+ * options.threshold = std::chrono::milliseconds(50);
+ * garak::watchdog watchdog{options};
+ * watchdog.watch(ctx);  // before ctx runs
+ * ctx.run();
+ * @endcode
+ *
+ * The bundled scheduler publishes, per thread, how many handlers it has
+ * started and the completion function of the one it is running: two
+ * relaxed stores before a handler and one after it, and one branch when
+ * nothing is watching. The handler is named by symbolizing that function,
+ * whose name carries the handler's type; names, like the stack frames,
+ * need the executable linked with -rdynamic (ENABLE_EXPORTS in CMake),
+ * otherwise they are addresses to resolve with addr2line.
+ */
+
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <asio/detail/scheduler.hpp>
+#include <asio/io_context.hpp>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace garak {
+/**
+ * @brief A handler that ran for longer than the watchdog's threshold
+ * */
+struct stall_report {
+  /// The io thread's name, from /proc
+  std::string thread;
+  /// The io thread's kernel id
+  pid_t tid{0};
+  /// The handler's completion function, demangled, or its address
+  std::string handler;
+  /// How long the handler had been running when it was sampled, give or
+  /// take one sampling period
+  std::chrono::nanoseconds blocked{0};
+  /// The io thread's stack, innermost frame first; empty if the thread
+  /// moved on before it could be captured
+  std::vector<std::string> stack;
+};
+
+/**
+ * @brief Write report to stderr, the default for watchdog_options
+ * */
+inline void print_stall(const stall_report& report) {
+  std::fprintf(stderr, "garak: thread %s (%d) blocked for %lld ms in %s\n",
+               report.thread.c_str(), report.tid,
+               static_cast<long long>(
+                   std::chrono::duration_cast<std::chrono::milliseconds>(
+                       report.blocked)
+                       .count()),
+               report.handler.c_str());
+  for (const auto& frame : report.stack) {
+    std::fprintf(stderr, "    %s\n", frame.c_str());
+  }
+}
+
+struct watchdog_options {
+  /// How long a handler may run before it is reported
+  std::chrono::milliseconds threshold{100};
+  /// Sent to a stalled thread to capture its stack, with a handler
+  /// installed by the watchdog; pick one the process doesn't otherwise use
+  int signal{SIGURG};
+  /// Called on the watchdog thread, once per stalled handler run
+  std::function<void(const stall_report&)> on_stall{print_stall};
+};
+
+namespace detail {
+/**
+ * @brief The single stack capture in flight, written by the signalled
+ * thread from its signal handler
+ * */
+struct stack_request {
+  enum : int { idle, armed, writing, done };
+  static constexpr int max_frames = 64;
+
+  std::atomic<pid_t> tid{0};
+  std::atomic<int> state{idle};
+  std::array<void*, max_frames> frames{};
+  int depth{0};
+};
+
+inline stack_request pending_stack;
+
+inline pid_t current_tid() {
+  return static_cast<pid_t>(::syscall(SYS_gettid));
+}
+
+inline void capture_stack(int /*signal*/) {
+  const int saved_errno = errno;
+  auto& request = pending_stack;
+  int expected = stack_request::armed;
+  if (request.tid.load(std::memory_order_acquire) == current_tid() &&
+      request.state.compare_exchange_strong(expected,
+                                            stack_request::writing)) {
+    // backtrace() isn't async-signal-safe until libgcc is loaded, which
+    // the watchdog does before it ever signals
+    request.depth =
+        ::backtrace(request.frames.data(), stack_request::max_frames);
+    request.state.store(stack_request::done, std::memory_order_release);
+  }
+  errno = saved_errno;
+}
+
+/**
+ * @brief Signal tid to capture its stack and wait up to timeout for it,
+ * one capture at a time across every watchdog in the process
+ * */
+inline std::vector<void*> request_stack(pid_t tid, int signal,
+                                        std::chrono::milliseconds timeout) {
+  static std::mutex mutex;
+  const std::lock_guard lock{mutex};
+  auto& request = pending_stack;
+  request.tid.store(tid, std::memory_order_relaxed);
+  request.state.store(stack_request::armed, std::memory_order_release);
+  if (::syscall(SYS_tgkill, ::getpid(), tid, signal) != 0) {
+    request.state.store(stack_request::idle, std::memory_order_relaxed);
+    return {};
+  }
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  while (request.state.load(std::memory_order_acquire) !=
+         stack_request::done) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      int expected = stack_request::armed;
+      if (request.state.compare_exchange_strong(expected,
+                                                stack_request::idle)) {
+        return {};
+      }
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+  // The first two frames are the signal handler and the kernel's return
+  // trampoline
+  std::vector<void*> frames;
+  for (int i = 2; i < request.depth; ++i) {
+    frames.push_back(request.frames[static_cast<std::size_t>(i)]);
+  }
+  request.state.store(stack_request::idle, std::memory_order_relaxed);
+  return frames;
+}
+
+inline std::string demangle(const char* name) {
+  int status = 0;
+  std::unique_ptr<char, decltype(&std::free)> demangled{
+      abi::__cxa_demangle(name, nullptr, nullptr, &status), &std::free};
+  return status == 0 ? std::string{demangled.get()} : std::string{name};
+}
+
+inline std::string address_string(const void* address) {
+  std::array<char, 2 + 2 * sizeof(void*) + 1> text{};
+  std::snprintf(text.data(), text.size(), "%p", address);
+  return text.data();
+}
+
+/**
+ * @brief The demangled name of the function at address, or where it is in
+ * its binary; dladdr() would otherwise name the nearest exported symbol
+ * before a function that isn't exported
+ * */
+inline std::string symbolize(const void* address) {
+  Dl_info info{};
+  if (::dladdr(address, &info) == 0) {
+    return address_string(address);
+  }
+  if (info.dli_sname != nullptr && info.dli_saddr == address) {
+    return demangle(info.dli_sname);
+  }
+  std::array<char, 24> offset{};
+  std::snprintf(offset.data(), offset.size(), "+%#tx",
+                static_cast<const char*>(address) -
+                    static_cast<const char*>(info.dli_fbase));
+  return std::string{info.dli_fname} + offset.data();
+}
+
+/**
+ * @brief backtrace_symbols() with the function names demangled
+ * */
+inline std::vector<std::string> symbolize_stack(
+    const std::vector<void*>& frames) {
+  std::vector<std::string> lines;
+  if (frames.empty()) {
+    return lines;
+  }
+  std::unique_ptr<char*, decltype(&std::free)> symbols{
+      ::backtrace_symbols(frames.data(), static_cast<int>(frames.size())),
+      &std::free};
+  for (std::size_t i = 0; i < frames.size(); ++i) {
+    if (!symbols) {
+      lines.push_back(address_string(frames[i]));
+      continue;
+    }
+    // binary(mangled+offset) [address]
+    std::string line = symbols.get()[i];
+    const auto open = line.find('(');
+    const auto plus = line.find('+', open);
+    if (open != std::string::npos && plus != std::string::npos &&
+        plus > open + 1) {
+      const auto name = line.substr(open + 1, plus - open - 1);
+      line.replace(open + 1, name.size(), demangle(name.c_str()));
+    }
+    lines.push_back(std::move(line));
+  }
+  return lines;
+}
+
+inline std::string thread_name(pid_t tid) {
+  std::ifstream comm{"/proc/self/task/" + std::to_string(tid) + "/comm"};
+  std::string name;
+  std::getline(comm, name);
+  return name;
+}
+
+/**
+ * @brief One io thread of one watched io_context
+ * */
+struct watched_thread {
+  asio::detail::scheduler::heartbeat beat{};
+  pid_t tid{0};
+
+  // Sampling state, only touched by the watchdog thread
+  std::uint64_t runs{0};
+  std::uintptr_t running{0};
+  std::chrono::steady_clock::time_point since;
+  bool reported{false};
+};
+
+/**
+ * @brief The watched io_contexts, shared between a watchdog and the
+ * services it installs so either can go first
+ * */
+struct watch_list;
+
+/**
+ * @brief Hands each thread running an io_context its heartbeat, installed
+ * by watchdog::watch()
+ * */
+class heartbeat_service
+    : public asio::detail::execution_context_service_base<heartbeat_service>,
+      private asio::detail::scheduler::heartbeat_source {
+ public:
+  heartbeat_service(asio::execution_context& ctx,
+                    std::shared_ptr<watch_list> list);
+
+  ~heartbeat_service();
+
+  heartbeat_service(const heartbeat_service&) = delete;
+  heartbeat_service& operator=(const heartbeat_service&) = delete;
+
+  /**
+   * @brief Call f(thread) for every thread seen so far
+   * */
+  template <typename F>
+  void for_each_thread(F f) {
+    const std::lock_guard lock{mutex_};
+    for (const auto& thread : threads_) {
+      f(*thread);
+    }
+  }
+
+ private:
+  void shutdown() override { scheduler_.set_heartbeat_source(nullptr); }
+
+  static std::uint64_t next_key() {
+    static std::atomic<std::uint64_t> keys{0};
+    return ++keys;
+  }
+
+  /**
+   * @brief This thread's heartbeat, from a small per-thread cache since a
+   * loop of run_one() attaches once per handler
+   * */
+  asio::detail::scheduler::heartbeat* attach() override {
+    struct entry {
+      std::uint64_t key{0};
+      watched_thread* thread{nullptr};
+    };
+    thread_local std::array<entry, 4> cache{};
+    thread_local std::size_t victim{0};
+    for (const auto& e : cache) {
+      if (e.key == key_) {
+        return &e.thread->beat;
+      }
+    }
+    auto* thread = register_thread();
+    cache[victim] = {key_, thread};
+    victim = (victim + 1) % cache.size();
+    return &thread->beat;
+  }
+
+  watched_thread* register_thread() {
+    const std::lock_guard lock{mutex_};
+    const auto self = current_tid();
+    for (const auto& thread : threads_) {
+      if (thread->tid == self) {
+        return thread.get();
+      }
+    }
+    auto& thread = threads_.emplace_back(std::make_unique<watched_thread>());
+    thread->tid = self;
+    return thread.get();
+  }
+
+  asio::detail::scheduler& scheduler_;
+  const std::shared_ptr<watch_list> list_;
+  const std::uint64_t key_;
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<watched_thread>> threads_;
+};
+
+struct watch_list {
+  std::mutex mutex;
+  std::vector<heartbeat_service*> services;
+};
+
+inline heartbeat_service::heartbeat_service(asio::execution_context& ctx,
+                                            std::shared_ptr<watch_list> list)
+    : asio::detail::execution_context_service_base<heartbeat_service>(ctx),
+      scheduler_(asio::use_service<asio::detail::scheduler>(ctx)),
+      list_(std::move(list)),
+      key_(next_key()) {
+  {
+    const std::lock_guard lock{list_->mutex};
+    list_->services.push_back(this);
+  }
+  scheduler_.set_heartbeat_source(this);
+}
+
+inline heartbeat_service::~heartbeat_service() {
+  scheduler_.set_heartbeat_source(nullptr);
+  const std::lock_guard lock{list_->mutex};
+  std::erase(list_->services, this);
+}
+}  // namespace detail
+
+/**
+ * @brief Reports handlers that run for longer than a threshold on the io
+ * threads of the io_contexts it watches
+ * */
+class watchdog {
+ public:
+  explicit watchdog(watchdog_options options = {})
+      : options_(std::move(options)),
+        list_(std::make_shared<detail::watch_list>()) {
+    // Load libgcc's unwinder now, backtrace() would on first use and that
+    // isn't safe in a signal handler
+    std::array<void*, 1> warm{};
+    ::backtrace(warm.data(), static_cast<int>(warm.size()));
+    struct sigaction action {};
+    action.sa_handler = detail::capture_stack;
+    action.sa_flags = SA_RESTART;
+    ::sigemptyset(&action.sa_mask);
+    if (::sigaction(options_.signal, &action, nullptr) != 0) {
+      throw std::system_error(errno, std::system_category(), "sigaction");
+    }
+    thread_ = std::thread{[this] { sample_loop(); }};
+  }
+
+  ~watchdog() {
+    {
+      const std::lock_guard lock{mutex_};
+      stopping_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+  }
+
+  watchdog(const watchdog&) = delete;
+  watchdog& operator=(const watchdog&) = delete;
+
+  /**
+   * @brief Watch ctx's io threads, once per io_context and before it runs;
+   * the io_context may outlive the watchdog or go first
+   * */
+  void watch(asio::io_context& ctx) {
+    asio::make_service<detail::heartbeat_service>(ctx, list_);
+  }
+
+  /**
+   * @brief How many stalls have been reported
+   * */
+  [[nodiscard]] std::size_t stalls() const {
+    return stalls_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  /// How long to wait for a stalled thread to capture its stack
+  static constexpr std::chrono::milliseconds capture_timeout{100};
+
+  void sample_loop() {
+    const auto period = std::max(std::chrono::milliseconds(1),
+                                 options_.threshold / 4);
+    std::unique_lock lock{mutex_};
+    while (!wake_.wait_for(lock, period, [this] { return stopping_; })) {
+      lock.unlock();
+      for (const auto& report : sample()) {
+        stalls_.fetch_add(1, std::memory_order_relaxed);
+        if (options_.on_stall) {
+          options_.on_stall(report);
+        }
+      }
+      lock.lock();
+    }
+  }
+
+  /**
+   * @brief Look at every thread once, capturing the stacks of those that
+   * have been in the same handler run for at least the threshold
+   */
+  std::vector<stall_report> sample() {
+    constexpr auto relaxed = std::memory_order_relaxed;
+    std::vector<stall_report> reports;
+    // Holding the list keeps the services, and their threads, alive
+    const std::lock_guard lock{list_->mutex};
+    const auto now = std::chrono::steady_clock::now();
+    std::vector<detail::watched_thread*> stalled;
+    for (auto* service : list_->services) {
+      service->for_each_thread([&](detail::watched_thread& thread) {
+        const auto runs = thread.beat.runs.load(relaxed);
+        const auto running = thread.beat.running.load(relaxed);
+        if (runs != thread.runs || running != thread.running) {
+          thread.runs = runs;
+          thread.running = running;
+          thread.since = now;
+          thread.reported = false;
+        } else if (running != 0 && !thread.reported &&
+                   now - thread.since >= options_.threshold) {
+          thread.reported = true;
+          stalled.push_back(&thread);
+        }
+      });
+    }
+    for (auto* thread : stalled) {
+      stall_report report;
+      report.tid = thread->tid;
+      report.thread = detail::thread_name(thread->tid);
+      report.handler = detail::symbolize(
+          reinterpret_cast<const void*>(thread->running));
+      report.blocked = now - thread->since;
+      report.stack = detail::symbolize_stack(
+          detail::request_stack(thread->tid, options_.signal,
+                                capture_timeout));
+      reports.push_back(std::move(report));
+    }
+    return reports;
+  }
+
+  const watchdog_options options_;
+  const std::shared_ptr<detail::watch_list> list_;
+  std::atomic<std::size_t> stalls_{0};
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  bool stopping_{false};
+  std::thread thread_;
+};
+}  // namespace garak
+
+#endif
@@ -0,0 +1,793 @@
+#ifndef GARAK_WIRE_HPP
+#define GARAK_WIRE_HPP
+
+/**
+ * @file garak/wire.hpp
+ * @brief Zero-copy binary wire format with in-place accessors
+ * @date 2026-10-19
+ *
+ * A message is a little-endian, naturally aligned tree of tables:
+ *
+ *   message := u32 root offset, followed by the root table
+ *   table   := u32 table size, then each field in declaration order
+ *   field   := scalars are stored inline, strings, vectors and nested
+ *              structs are stored as a u32 offset relative to the field
+ *   string  := u32 length, bytes, a trailing NUL
+ *   vector  := u32 count, then the elements laid out like fields
+ *
+ * Offsets always point forward, and an offset of zero means the value is
+ * absent. Readers treat fields past the end of a table as absent, so new
+ * fields can be appended to a struct without breaking old readers.
+ *
+ * The schema is a plain aggregate, fields are discovered through structured
+ * bindings, so no code generation is needed:
+ *
+ * @code
+ * struct order {
+ *   std::uint64_t id;
+ *   std::string symbol;
+ *   std::vector<std::int32_t> fills;
+ * };
+ *
+ * garak::wire::builder builder{send_buffer};
+ * builder.encode(order{7, "GRK", {1, 2}});
+ *
+ * auto msg = garak::wire::root<order>(receive_buffer);
+ * if (msg) { std::string_view symbol = msg->get<1>(); }
+ * @endcode
+ */
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace garak::wire {
+/**
+ * @brief Thrown when a received message fails verification
+ * */
+class format_error : public std::runtime_error {
+ public:
+  using std::runtime_error::runtime_error;
+};
+
+using offset_type = std::uint32_t;
+
+template <typename T>
+class view;
+
+template <typename E>
+class vector_view;
+
+class builder;
+
+namespace detail {
+/**
+ * @brief Converts to any field type, used to count the fields of an
+ * aggregate by probing brace initialisation
+ * */
+template <std::size_t>
+struct any_field {
+  template <typename T>
+  constexpr operator T() const;  // NOLINT(google-explicit-constructor)
+};
+
+inline constexpr std::size_t max_fields = 12;
+
+template <typename T, std::size_t... I>
+constexpr bool brace_constructible(std::index_sequence<I...> /*unused*/) {
+  return requires { T{any_field<I>{}...}; };
+}
+
+template <typename T, std::size_t N = 0>
+constexpr std::size_t field_count() {
+  if constexpr (N < max_fields &&
+                brace_constructible<T>(std::make_index_sequence<N + 1>{})) {
+    return field_count<T, N + 1>();
+  } else {
+    return N;
+  }
+}
+
+/**
+ * @brief Tie the fields of an aggregate, the "reflection" half of the format
+ * */
+template <typename T>
+constexpr auto tie_fields(T& value) {
+  constexpr auto count = field_count<std::remove_const_t<T>>();
+  static_assert(count > 0, "wire structs need at least one field");
+  if constexpr (count == 1) {
+    auto& [f0] = value;
+    return std::tie(f0);
+  } else if constexpr (count == 2) {
+    auto& [f0, f1] = value;
+    return std::tie(f0, f1);
+  } else if constexpr (count == 3) {
+    auto& [f0, f1, f2] = value;
+    return std::tie(f0, f1, f2);
+  } else if constexpr (count == 4) {
+    auto& [f0, f1, f2, f3] = value;
+    return std::tie(f0, f1, f2, f3);
+  } else if constexpr (count == 5) {
+    auto& [f0, f1, f2, f3, f4] = value;
+    return std::tie(f0, f1, f2, f3, f4);
+  } else if constexpr (count == 6) {
+    auto& [f0, f1, f2, f3, f4, f5] = value;
+    return std::tie(f0, f1, f2, f3, f4, f5);
+  } else if constexpr (count == 7) {
+    auto& [f0, f1, f2, f3, f4, f5, f6] = value;
+    return std::tie(f0, f1, f2, f3, f4, f5, f6);
+  } else if constexpr (count == 8) {
+    auto& [f0, f1, f2, f3, f4, f5, f6, f7] = value;
+    return std::tie(f0, f1, f2, f3, f4, f5, f6, f7);
+  } else if constexpr (count == 9) {
+    auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8] = value;
+    return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8);
+  } else if constexpr (count == 10) {
+    auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9] = value;
+    return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9);
+  } else if constexpr (count == 11) {
+    auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10] = value;
+    return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10);
+  } else {
+    auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11] = value;
+    return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11);
+  }
+}
+
+template <typename Tuple>
+struct decay_tuple;
+
+template <typename... F>
+struct decay_tuple<std::tuple<F...>> {
+  using type = std::tuple<std::remove_cvref_t<F>...>;
+};
+
+template <typename T>
+using field_types =
+    typename decay_tuple<decltype(tie_fields(std::declval<T&>()))>::type;
+
+template <typename T, std::size_t I>
+using field_type = std::tuple_element_t<I, field_types<T>>;
+
+template <typename T>
+struct is_vector : std::false_type {};
+
+template <typename E, typename A>
+struct is_vector<std::vector<E, A>> : std::true_type {};
+
+template <typename T>
+concept scalar_field = (std::is_arithmetic_v<T> || std::is_enum_v<T>) &&
+                       sizeof(T) <= sizeof(std::uint64_t);
+
+template <typename T>
+concept string_field = std::is_same_v<T, std::string>;
+
+template <typename T>
+concept vector_field = is_vector<T>::value;
+
+template <typename T>
+concept table_field = std::is_aggregate_v<T> && std::is_class_v<T> &&
+                      !vector_field<T>;
+
+template <typename T>
+concept wire_field =
+    scalar_field<T> || string_field<T> || vector_field<T> || table_field<T>;
+
+template <typename T>
+inline constexpr offset_type slot_size =
+    scalar_field<T> ? static_cast<offset_type>(sizeof(T))
+                    : static_cast<offset_type>(sizeof(offset_type));
+
+inline constexpr offset_type header_size = sizeof(offset_type);
+inline constexpr offset_type table_align = alignof(std::uint64_t);
+inline constexpr unsigned max_depth = 64;
+
+/**
+ * @brief Absent vectors point here, so reads never see a null block
+ * */
+inline constexpr std::array<std::byte, header_size> empty_block{};
+
+constexpr std::size_t align_up(std::size_t value, std::size_t align) {
+  return (value + align - 1) & ~(align - 1);
+}
+
+template <std::size_t Size>
+struct uint_of;
+template <>
+struct uint_of<1> {
+  using type = std::uint8_t;
+};
+template <>
+struct uint_of<2> {
+  using type = std::uint16_t;
+};
+template <>
+struct uint_of<4> {
+  using type = std::uint32_t;
+};
+template <>
+struct uint_of<8> {
+  using type = std::uint64_t;
+};
+
+template <std::unsigned_integral U>
+constexpr U byteswap(U value) {
+  U swapped = 0;
+  for (std::size_t i = 0; i < sizeof(U); ++i) {
+    swapped = static_cast<U>((swapped << 8U) | (value & 0xFFU));
+    value = static_cast<U>(value >> 8U);
+  }
+  return swapped;
+}
+
+template <scalar_field T>
+T load(const std::byte* at) {
+  if constexpr (std::is_same_v<T, bool>) {
+    return *at != std::byte{0};
+  } else {
+    typename uint_of<sizeof(T)>::type raw;
+    std::memcpy(&raw, at, sizeof raw);
+    if constexpr (std::endian::native == std::endian::big) {
+      raw = byteswap(raw);
+    }
+    return std::bit_cast<T>(raw);
+  }
+}
+
+template <scalar_field T>
+void store(std::byte* at, T value) {
+  if constexpr (std::is_same_v<T, bool>) {
+    *at = value ? std::byte{1} : std::byte{0};
+  } else {
+    auto raw = std::bit_cast<typename uint_of<sizeof(T)>::type>(value);
+    if constexpr (std::endian::native == std::endian::big) {
+      raw = byteswap(raw);
+    }
+    std::memcpy(at, &raw, sizeof raw);
+  }
+}
+
+/**
+ * @brief Resolve the offset stored in a slot, nullptr when absent
+ * */
+inline const std::byte* follow(const std::byte* slot) {
+  const auto offset = load<offset_type>(slot);
+  return offset == 0 ? nullptr : slot + offset;
+}
+
+/**
+ * @brief Field placement of a table, computed at compile time
+ * */
+template <typename T>
+struct table_layout {
+  using fields = field_types<T>;
+  static constexpr std::size_t count = std::tuple_size_v<fields>;
+
+  template <typename Tuple>
+  struct all_wire_fields;
+
+  template <typename... F>
+  struct all_wire_fields<std::tuple<F...>>
+      : std::bool_constant<(wire_field<F> && ...)> {};
+
+  static_assert(all_wire_fields<fields>::value,
+                "wire fields must be scalars, std::string, std::vector or "
+                "nested aggregates");
+
+  template <std::size_t... I>
+  static constexpr auto compute(std::index_sequence<I...> /*unused*/) {
+    std::array<offset_type, count + 1> offsets{};
+    std::size_t position = header_size;
+    ((position = align_up(position, slot_size<std::tuple_element_t<I, fields>>),
+      offsets[I] = static_cast<offset_type>(position),
+      position += slot_size<std::tuple_element_t<I, fields>>),
+     ...);
+    offsets[count] = static_cast<offset_type>(position);
+    return offsets;
+  }
+
+  static constexpr auto offsets = compute(std::make_index_sequence<count>{});
+  static constexpr offset_type size = offsets[count];
+};
+
+/**
+ * @brief Maps a schema field type onto the type handed out by accessors
+ * */
+template <typename F>
+struct accessor;
+
+template <scalar_field F>
+struct accessor<F> {
+  using type = F;
+  static type absent() { return F{}; }
+  static type read(const std::byte* slot) { return load<F>(slot); }
+};
+
+template <string_field F>
+struct accessor<F> {
+  using type = std::string_view;
+  static type absent() { return {}; }
+  static type read(const std::byte* slot) {
+    const auto* target = follow(slot);
+    if (target == nullptr) {
+      return {};
+    }
+    return {reinterpret_cast<const char*>(target + header_size),
+            load<offset_type>(target)};
+  }
+};
+
+template <vector_field F>
+struct accessor<F> {
+  using type = vector_view<typename F::value_type>;
+  static type absent() { return type{}; }
+  static type read(const std::byte* slot) { return type{follow(slot)}; }
+};
+
+template <table_field F>
+struct accessor<F> {
+  using type = view<F>;
+  static type absent() { return type{}; }
+  static type read(const std::byte* slot) { return type{follow(slot)}; }
+};
+
+template <typename F>
+F to_value(const typename accessor<F>::type& in) {
+  if constexpr (scalar_field<F>) {
+    return in;
+  } else if constexpr (string_field<F>) {
+    return F{in};
+  } else if constexpr (vector_field<F>) {
+    F out;
+    out.reserve(in.size());
+    for (std::size_t i = 0; i < in.size(); ++i) {
+      out.push_back(to_value<typename F::value_type>(in[i]));
+    }
+    return out;
+  } else {
+    return in.materialize();
+  }
+}
+
+/**
+ * @brief Bounds checks every offset reachable from the root, run once per
+ * received message so the accessors can stay unchecked
+ * */
+class verifier {
+ public:
+  explicit verifier(std::span<const std::byte> message)
+      : message_(message), budget_(message.size()) {}
+
+  template <typename F>
+  bool slot(std::size_t position, unsigned depth) {
+    if (!fits(position, header_size)) {
+      return false;
+    }
+    const auto offset = load<offset_type>(message_.data() + position);
+    return offset == 0 || value<F>(position + offset, depth);
+  }
+
+ private:
+  [[nodiscard]] bool fits(std::size_t position, std::size_t length) const {
+    return position <= message_.size() &&
+           length <= message_.size() - position;
+  }
+
+  template <typename F>
+  bool value(std::size_t position, unsigned depth) {
+    if (budget_ == 0 || depth > max_depth ||
+        !fits(position, header_size)) {
+      return false;
+    }
+    --budget_;
+    const auto length = load<offset_type>(message_.data() + position);
+    const auto body = position + header_size;
+
+    if constexpr (string_field<F>) {
+      return fits(body, length);
+    } else if constexpr (vector_field<F>) {
+      using element = typename F::value_type;
+      if (!fits(body, std::size_t{length} * slot_size<element>)) {
+        return false;
+      }
+      if constexpr (!scalar_field<element>) {
+        for (std::size_t i = 0; i < length; ++i) {
+          if (!slot<element>(body + i * header_size, depth + 1)) {
+            return false;
+          }
+        }
+      }
+      return true;
+    } else {
+      if (length < header_size || !fits(position, length)) {
+        return false;
+      }
+      return table<F>(position, length, depth,
+                      std::make_index_sequence<table_layout<F>::count>{});
+    }
+  }
+
+  template <typename T, std::size_t... I>
+  bool table(std::size_t position, offset_type length, unsigned depth,
+             std::index_sequence<I...> /*unused*/) {
+    return (field<field_type<T, I>>(position, table_layout<T>::offsets[I],
+                                    length, depth) &&
+            ...);
+  }
+
+  template <typename F>
+  bool field(std::size_t table, offset_type offset, offset_type length,
+             unsigned depth) {
+    if constexpr (scalar_field<F>) {
+      return true;
+    } else {
+      if (offset + slot_size<F> > length) {
+        return true;
+      }
+      return slot<F>(table + offset, depth + 1);
+    }
+  }
+
+  std::span<const std::byte> message_;
+  std::size_t budget_;
+};
+}  // namespace detail
+
+/**
+ * @brief In-place accessor over an encoded vector
+ * */
+template <typename E>
+class vector_view {
+  using accessor = detail::accessor<E>;
+
+ public:
+  using value_type = typename accessor::type;
+
+  /**
+   * @brief Index based iterator, elements are decoded on dereference
+   * */
+  class iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = typename accessor::type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = value_type;
+
+    iterator() = default;
+    iterator(const vector_view* owner, std::size_t index)
+        : owner_(owner), index_(index) {}
+
+    reference operator*() const { return (*owner_)[index_]; }
+    iterator& operator++() {
+      ++index_;
+      return *this;
+    }
+    iterator operator++(int) {
+      auto copy = *this;
+      ++index_;
+      return copy;
+    }
+    bool operator==(const iterator& other) const {
+      return index_ == other.index_;
+    }
+
+   private:
+    const vector_view* owner_{nullptr};
+    std::size_t index_{0};
+  };
+
+  vector_view() = default;
+  explicit vector_view(const std::byte* block)
+      : block_(block == nullptr ? detail::empty_block.data() : block) {}
+
+  [[nodiscard]] std::size_t size() const {
+    return detail::load<offset_type>(block_);
+  }
+
+  [[nodiscard]] bool empty() const { return size() == 0; }
+
+  value_type operator[](std::size_t index) const {
+    return accessor::read(block_ + detail::header_size +
+                          index * detail::slot_size<E>);
+  }
+
+  [[nodiscard]] iterator begin() const { return iterator{this, 0}; }
+  [[nodiscard]] iterator end() const { return iterator{this, size()}; }
+
+ private:
+  const std::byte* block_{detail::empty_block.data()};
+};
+
+/**
+ * @brief In-place accessor over an encoded struct, fields are read straight
+ * out of the buffer with `get<I>()`
+ *
+ * A default constructed view is an absent struct, every field reads as its
+ * default value.
+ * */
+template <typename T>
+class view {
+  using layout = detail::table_layout<T>;
+
+ public:
+  using value_type = T;
+
+  view() = default;
+  explicit view(const std::byte* table) : table_(table) {}
+
+  /**
+   * @brief Verify a received message and view its root, throws
+   * garak::wire::format_error on malformed input
+   *
+   * Lets a view be used directly as a garak::dispatcher message type.
+   * */
+  static view decode(std::span<const std::byte> message);
+
+  /**
+   * @brief Read field I, scalars by value, strings as std::string_view,
+   * vectors as vector_view and nested structs as view
+   * */
+  template <std::size_t I>
+  [[nodiscard]] auto get() const ->
+      typename detail::accessor<detail::field_type<T, I>>::type {
+    using field = detail::field_type<T, I>;
+    constexpr auto offset = layout::offsets[I];
+    if (table_ == nullptr ||
+        offset + detail::slot_size<field> >
+            detail::load<offset_type>(table_)) {
+      return detail::accessor<field>::absent();
+    }
+    return detail::accessor<field>::read(table_ + offset);
+  }
+
+  [[nodiscard]] bool empty() const { return table_ == nullptr; }
+
+  /**
+   * @brief Copy the message out into the schema struct
+   * */
+  [[nodiscard]] T materialize() const {
+    T out{};
+    auto fields = detail::tie_fields(out);
+    [&]<std::size_t... I>(std::index_sequence<I...>) {
+      ((std::get<I>(fields) =
+            detail::to_value<detail::field_type<T, I>>(get<I>())),
+       ...);
+    }
+    (std::make_index_sequence<layout::count>{});
+    return out;
+  }
+
+ private:
+  const std::byte* table_{nullptr};
+};
+
+/**
+ * @brief Check that every offset in message stays inside it
+ * */
+template <typename T>
+[[nodiscard]] bool verify(std::span<const std::byte> message) {
+  return detail::verifier{message}.template slot<T>(0, 0);
+}
+
+/**
+ * @brief View the root of a message without verifying it, only for buffers
+ * that came from a trusted builder
+ * */
+template <typename T>
+[[nodiscard]] view<T> root_unchecked(std::span<const std::byte> message) {
+  return view<T>{detail::follow(message.data())};
+}
+
+/**
+ * @brief Verify message and view its root struct
+ * */
+template <typename T>
+[[nodiscard]] std::optional<view<T>> root(std::span<const std::byte> message) {
+  if (!verify<T>(message)) {
+    return std::nullopt;
+  }
+  return root_unchecked<T>(message);
+}
+
+template <typename T>
+view<T> view<T>::decode(std::span<const std::byte> message) {
+  if (!verify<T>(message)) {
+    throw format_error("garak::wire: malformed message");
+  }
+  return root_unchecked<T>(message);
+}
+
+/**
+ * @brief Fills in the fields of one table in place, for building messages
+ * from data that does not live in a schema struct
+ * */
+template <typename T>
+class table_writer {
+ public:
+  /**
+   * @brief Write field I, strings take anything convertible to
+   * std::string_view, vectors take any sized range of elements
+   * */
+  template <std::size_t I, typename V>
+  table_writer& set(const V& value);
+
+  /**
+   * @brief Start the nested struct stored in field I
+   * */
+  template <std::size_t I>
+  table_writer<detail::field_type<T, I>> start_table();
+
+ private:
+  friend class builder;
+
+  template <typename U>
+  friend class table_writer;
+
+  table_writer(builder& owner, std::size_t table)
+      : builder_(owner), table_(table) {}
+
+  builder& builder_;
+  std::size_t table_;
+};
+
+/**
+ * @brief Builds a message straight into the tail of a byte buffer, usually
+ * the send buffer, without an intermediate copy
+ * */
+class builder {
+ public:
+  explicit builder(std::vector<std::byte>& out)
+      : out_(out), start_(out.size()) {
+    allocate(detail::header_size, detail::header_size);
+  }
+
+  /**
+   * @brief Encode a whole schema struct as the root of the message
+   * @returns the encoded message
+   * */
+  template <typename T>
+  std::span<const std::byte> encode(const T& value) {
+    patch_offset(0, write_table(value));
+    return message();
+  }
+
+  /**
+   * @brief Start the root struct, to be filled in field by field
+   * */
+  template <typename T>
+  table_writer<T> start_root() {
+    const auto table = allocate_table<T>();
+    patch_offset(0, table);
+    return table_writer<T>{*this, table};
+  }
+
+  /**
+   * @brief The message built so far
+   * */
+  [[nodiscard]] std::span<const std::byte> message() const {
+    return {out_.data() + start_, out_.size() - start_};
+  }
+
+ private:
+  template <typename T>
+  friend class table_writer;
+
+  std::byte* at(std::size_t position) { return out_.data() + start_ + position; }
+
+  std::size_t allocate(std::size_t length, std::size_t align) {
+    const auto position = detail::align_up(out_.size() - start_, align);
+    if (position + length > std::numeric_limits<offset_type>::max()) {
+      throw std::length_error("garak::wire: message exceeds 4GiB");
+    }
+    out_.resize(start_ + position + length, std::byte{0});
+    return position;
+  }
+
+  void patch_offset(std::size_t slot, std::size_t target) {
+    detail::store(at(slot), static_cast<offset_type>(target - slot));
+  }
+
+  template <typename T>
+  std::size_t allocate_table() {
+    using layout = detail::table_layout<T>;
+    const auto table = allocate(layout::size, detail::table_align);
+    detail::store(at(table), layout::size);
+    return table;
+  }
+
+  template <typename F, typename V>
+  void write_field(std::size_t slot, const V& value) {
+    if constexpr (detail::scalar_field<F>) {
+      detail::store(at(slot), static_cast<F>(value));
+    } else if constexpr (detail::string_field<F>) {
+      patch_offset(slot, write_string(std::string_view{value}));
+    } else if constexpr (detail::vector_field<F>) {
+      patch_offset(slot, write_vector<typename F::value_type>(value));
+    } else {
+      patch_offset(slot, write_table(static_cast<const F&>(value)));
+    }
+  }
+
+  std::size_t write_string(std::string_view text) {
+    const auto block =
+        allocate(detail::header_size + text.size() + 1, detail::header_size);
+    detail::store(at(block), static_cast<offset_type>(text.size()));
+    std::memcpy(at(block + detail::header_size), text.data(), text.size());
+    return block;
+  }
+
+  template <typename E, typename Range>
+  std::size_t write_vector(const Range& elements) {
+    constexpr auto element_size = detail::slot_size<E>;
+    const auto count = static_cast<std::size_t>(std::size(elements));
+    // Pad in front of the count so the elements land on their alignment
+    const auto align = std::max<std::size_t>(element_size, detail::header_size);
+    const auto body = detail::align_up(
+        out_.size() - start_ + detail::header_size, align);
+    allocate(body + count * element_size - (out_.size() - start_), 1);
+    const auto block = body - detail::header_size;
+    detail::store(at(block), static_cast<offset_type>(count));
+
+    std::size_t slot = body;
+    for (const auto& element : elements) {
+      write_field<E>(slot, element);
+      slot += element_size;
+    }
+    return block;
+  }
+
+  template <typename T>
+  std::size_t write_table(const T& value) {
+    using layout = detail::table_layout<T>;
+    const auto table = allocate_table<T>();
+    const auto fields = detail::tie_fields(value);
+    [&]<std::size_t... I>(std::index_sequence<I...>) {
+      (write_field<detail::field_type<T, I>>(table + layout::offsets[I],
+                                             std::get<I>(fields)),
+       ...);
+    }
+    (std::make_index_sequence<layout::count>{});
+    return table;
+  }
+
+  std::vector<std::byte>& out_;
+  std::size_t start_;
+};
+
+template <typename T>
+template <std::size_t I, typename V>
+table_writer<T>& table_writer<T>::set(const V& value) {
+  builder_.template write_field<detail::field_type<T, I>>(
+      table_ + detail::table_layout<T>::offsets[I], value);
+  return *this;
+}
+
+template <typename T>
+template <std::size_t I>
+table_writer<detail::field_type<T, I>> table_writer<T>::start_table() {
+  using field = detail::field_type<T, I>;
+  static_assert(detail::table_field<field>, "field I is not a struct");
+  const auto slot = table_ + detail::table_layout<T>::offsets[I];
+  const auto table = builder_.template allocate_table<field>();
+  builder_.patch_offset(slot, table);
+  return table_writer<field>{builder_, table};
+}
+}  // namespace garak::wire
+
+#endif
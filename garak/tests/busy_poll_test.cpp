@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+
+#include <asio/ip/tcp.hpp>
+#include <asio/post.hpp>
+#include <asio/read.hpp>
+#include <asio/write.hpp>
+#include <array>
+#include <functional>
+#include <garak/busy_poll.hpp>
+#include <thread>
+
+#include "loopback.hpp"
+
+namespace {
+using namespace std::chrono_literals;
+}  // namespace
+
+/**
+ * @brief Frequent events grow the budget, sparse ones shrink it back
+ * */
+TEST(BusyPollTest, BudgetAdapts) {
+  garak::spin_budget budget{{.min_spin = 1us, .max_spin = 100us}};
+  EXPECT_EQ(1us, budget.current());
+
+  for (int i = 0; i < 64; ++i) {
+    budget.record_gap(20us);
+  }
+  EXPECT_GT(budget.current(), 35us);
+  EXPECT_LE(budget.current(), 40us);
+
+  for (int i = 0; i < 64; ++i) {
+    budget.record_gap(10ms);
+  }
+  EXPECT_EQ(1us, budget.current());
+}
+
+/**
+ * @brief Handlers posted from another thread are picked up while spinning,
+ * and run() returns once the work runs out
+ * */
+TEST(BusyPollTest, RunsUntilOutOfWork) {
+  asio::io_context ctx;
+  auto work = asio::make_work_guard(ctx);
+  constexpr int events = 200;
+  int handled = 0;
+
+  std::thread producer{[&] {
+    for (int i = 0; i < events; ++i) {
+      asio::post(ctx, [&] { ++handled; });
+      std::this_thread::sleep_for(20us);
+    }
+    asio::post(ctx, [&] { work.reset(); });
+  }};
+
+  garak::busy_poll_runner runner{{.max_spin = 10ms}};
+  const auto ran = runner.run(ctx);
+  producer.join();
+
+  EXPECT_EQ(events, handled);
+  EXPECT_EQ(static_cast<std::size_t>(events) + 1, ran);
+  EXPECT_TRUE(ctx.stopped());
+  EXPECT_GT(runner.stats().spin_hits, 0U);
+}
+
+/**
+ * @brief A ping-pong over loopback completes under the runner
+ * */
+TEST(BusyPollTest, PingPong) {
+  asio::io_context ctx;
+  auto [client, server] = garak::test::connected_pair(ctx);
+  asio::error_code ignored;
+  client.set_option(garak::busy_poll{50}, ignored);
+
+  constexpr int rounds = 100;
+  int completed = 0;
+  std::array<char, 1> ping{'p'};
+  std::array<char, 1> echo{};
+  std::array<char, 1> reply{};
+
+  std::function<void()> serve = [&] {
+    asio::async_read(server, asio::buffer(echo),
+                     [&](asio::error_code ec, std::size_t) {
+                       if (ec) {
+                         return;
+                       }
+                       asio::write(server, asio::buffer(echo));
+                       serve();
+                     });
+  };
+  std::function<void()> round = [&] {
+    asio::write(client, asio::buffer(ping));
+    asio::async_read(client, asio::buffer(reply),
+                     [&](asio::error_code ec, std::size_t) {
+                       ASSERT_FALSE(ec);
+                       if (++completed < rounds) {
+                         round();
+                       } else {
+                         client.close();
+                         server.close();
+                       }
+                     });
+  };
+  serve();
+  round();
+
+  garak::run_busy_poll(ctx);
+  EXPECT_EQ(rounds, completed);
+}
+
+/**
+ * @brief SO_BUSY_POLL round trips when the kernel lets us set it
+ * */
+TEST(BusyPollTest, SocketOption) {
+  asio::io_context ctx;
+  auto [client, server] = garak::test::connected_pair(ctx);
+  asio::error_code ec;
+  client.set_option(garak::busy_poll{25}, ec);
+  if (ec) {
+    GTEST_SKIP() << "SO_BUSY_POLL not permitted: " << ec.message();
+  }
+  garak::busy_poll value;
+  client.get_option(value);
+  EXPECT_EQ(25, value.value());
+}
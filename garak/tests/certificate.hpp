@@ -0,0 +1,47 @@
+#ifndef GARAK_TESTS_CERTIFICATE_HPP
+#define GARAK_TESTS_CERTIFICATE_HPP
+
+/**
+ * @file certificate.hpp
+ * @brief A throwaway self-signed certificate for TLS tests
+ */
+
+#include <openssl/evp.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+
+#include <asio/ssl/context.hpp>
+#include <memory>
+#include <stdexcept>
+
+namespace garak::test {
+/**
+ * @brief Load a freshly generated P-256 key and a self-signed certificate
+ * for "localhost" into ctx
+ * */
+inline void use_self_signed(asio::ssl::context& ctx) {
+  std::unique_ptr<EVP_PKEY, decltype(&EVP_PKEY_free)> key{EVP_EC_gen("P-256"),
+                                                          &EVP_PKEY_free};
+  std::unique_ptr<X509, decltype(&X509_free)> cert{X509_new(), &X509_free};
+  if (!key || !cert) {
+    throw std::runtime_error("failed to allocate test certificate");
+  }
+  X509_set_version(cert.get(), 2);
+  ASN1_INTEGER_set(X509_get_serialNumber(cert.get()), 1);
+  X509_gmtime_adj(X509_getm_notBefore(cert.get()), 0);
+  X509_gmtime_adj(X509_getm_notAfter(cert.get()), 60L * 60L * 24L);
+  X509_set_pubkey(cert.get(), key.get());
+  X509_NAME* name = X509_get_subject_name(cert.get());
+  X509_NAME_add_entry_by_txt(
+      name, "CN", MBSTRING_ASC,
+      reinterpret_cast<const unsigned char*>("localhost"), -1, -1, 0);
+  X509_set_issuer_name(cert.get(), name);
+  if (X509_sign(cert.get(), key.get(), EVP_sha256()) == 0 ||
+      SSL_CTX_use_certificate(ctx.native_handle(), cert.get()) != 1 ||
+      SSL_CTX_use_PrivateKey(ctx.native_handle(), key.get()) != 1) {
+    throw std::runtime_error("failed to install test certificate");
+  }
+}
+}  // namespace garak::test
+
+#endif
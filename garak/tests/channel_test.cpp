@@ -0,0 +1,195 @@
+#include <gtest/gtest.h>
+
+#include <array>
+#include <asio/as_tuple.hpp>
+#include <asio/co_spawn.hpp>
+#include <asio/detached.hpp>
+#include <asio/experimental/channel_error.hpp>
+#include <asio/io_context.hpp>
+#include <asio/use_awaitable.hpp>
+#include <chrono>
+#include <cstddef>
+#include <garak/channel.hpp>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "loopback.hpp"
+
+namespace {
+/**
+ * @brief A value that says who sent it and in which order
+ * */
+struct message {
+  std::size_t producer{0};
+  std::size_t sequence{0};
+};
+
+/**
+ * @brief Run `producers` threads, each with its own io_context, sending
+ * `count` messages into channel through a small ring, and receive them in
+ * batches on ctx; checks that every producer's messages arrive in order
+ * */
+template <typename Channel>
+void pump(asio::io_context& ctx, Channel& channel, std::size_t producers,
+          std::size_t count) {
+  std::vector<std::thread> threads;
+  for (std::size_t p = 0; p < producers; ++p) {
+    threads.emplace_back([&channel, p, count] {
+      asio::io_context producer_ctx;
+      asio::co_spawn(
+          producer_ctx,
+          [&channel, p, count]() -> asio::awaitable<void> {
+            for (std::size_t i = 0; i < count; ++i) {
+              co_await channel.async_send(message{p, i}, asio::use_awaitable);
+            }
+          },
+          asio::detached);
+      producer_ctx.run();
+    });
+  }
+
+  std::vector<std::size_t> next(producers, 0);
+  std::size_t received = 0;
+  bool in_order = true;
+  asio::co_spawn(
+      ctx,
+      [&]() -> asio::awaitable<void> {
+        std::array<message, 32> batch;
+        while (received < producers * count) {
+          const auto n =
+              co_await channel.async_receive_some(batch, asio::use_awaitable);
+          EXPECT_GT(n, 0U);
+          for (std::size_t i = 0; i < n; ++i) {
+            in_order &= batch[i].sequence == next[batch[i].producer]++;
+          }
+          received += n;
+        }
+      },
+      asio::detached);
+  EXPECT_TRUE(garak::test::run_until(
+      ctx, [&] { return received == producers * count; },
+      std::chrono::seconds(30)));
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_TRUE(in_order);
+}
+}  // namespace
+
+/**
+ * @brief One producer thread, one consumer, far more messages than fit
+ * */
+TEST(ChannelTest, SpscAcrossThreads) {
+  asio::io_context ctx;
+  garak::spsc_channel<message> channel{ctx.get_executor(), 64};
+  pump(ctx, channel, 1, 200000);
+}
+
+/**
+ * @brief Four producer threads into one consumer
+ * */
+TEST(ChannelTest, MpscAcrossThreads) {
+  asio::io_context ctx;
+  garak::mpsc_channel<message> channel{ctx.get_executor(), 64};
+  pump(ctx, channel, 4, 50000);
+}
+
+/**
+ * @brief try_send refuses a full channel without consuming the value, and
+ * try_receive gets the values back in order
+ * */
+TEST(ChannelTest, TrySendReceive) {
+  asio::io_context ctx;
+  garak::mpsc_channel<std::string> channel{ctx.get_executor(), 3};
+  EXPECT_EQ(4U, channel.capacity());
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_TRUE(channel.try_send(std::to_string(i)));
+  }
+  std::string refused = "refused";
+  EXPECT_FALSE(channel.try_send(std::move(refused)));
+  EXPECT_EQ("refused", refused);
+
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_EQ(std::to_string(i), channel.try_receive());
+  }
+  EXPECT_FALSE(channel.try_receive());
+}
+
+/**
+ * @brief A receive waits for a send, and a send waits for room
+ * */
+TEST(ChannelTest, Waits) {
+  asio::io_context ctx;
+  garak::spsc_channel<std::string> channel{ctx.get_executor(), 2};
+
+  std::optional<std::string> value;
+  channel.async_receive([&](asio::error_code ec, std::string v) {
+    EXPECT_FALSE(ec);
+    value = std::move(v);
+  });
+  ctx.poll();
+  EXPECT_FALSE(value);
+  EXPECT_TRUE(channel.try_send("hello"));
+  ASSERT_TRUE(garak::test::run_until(ctx, [&] { return value.has_value(); }));
+  EXPECT_EQ("hello", *value);
+
+  EXPECT_TRUE(channel.try_send("a"));
+  EXPECT_TRUE(channel.try_send("b"));
+  bool sent = false;
+  channel.async_send("c", [&](asio::error_code ec) {
+    EXPECT_FALSE(ec);
+    sent = true;
+  });
+  ctx.restart();
+  ctx.poll();
+  EXPECT_FALSE(sent);
+  EXPECT_EQ("a", channel.try_receive());
+  ASSERT_TRUE(garak::test::run_until(ctx, [&] { return sent; }));
+  EXPECT_EQ("b", channel.try_receive());
+  EXPECT_EQ("c", channel.try_receive());
+}
+
+/**
+ * @brief Closing refuses new values, wakes a waiting receiver once what
+ * was queued is drained, and fails a waiting sender
+ * */
+TEST(ChannelTest, Close) {
+  asio::io_context ctx;
+  garak::mpsc_channel<int> channel{ctx.get_executor(), 2};
+  EXPECT_TRUE(channel.try_send(1));
+  EXPECT_TRUE(channel.try_send(2));
+  std::optional<asio::error_code> blocked;
+  channel.async_send(3, [&](asio::error_code ec) { blocked = ec; });
+  ctx.poll();
+  EXPECT_FALSE(blocked);
+
+  channel.close();
+  EXPECT_FALSE(channel.is_open());
+  EXPECT_FALSE(channel.try_send(4));
+  ASSERT_TRUE(garak::test::run_until(ctx, [&] { return blocked.has_value(); }));
+  EXPECT_EQ(asio::experimental::error::channel_closed, *blocked);
+
+  std::vector<int> values;
+  std::optional<asio::error_code> end;
+  asio::co_spawn(
+      ctx,
+      [&]() -> asio::awaitable<void> {
+        std::array<int, 8> batch{};
+        for (;;) {
+          auto [ec, n] = co_await channel.async_receive_some(
+              batch, asio::as_tuple(asio::use_awaitable));
+          if (ec) {
+            end = ec;
+            co_return;
+          }
+          values.insert(values.end(), batch.begin(), batch.begin() + n);
+        }
+      },
+      asio::detached);
+  ASSERT_TRUE(garak::test::run_until(ctx, [&] { return end.has_value(); }));
+  EXPECT_EQ((std::vector<int>{1, 2}), values);
+  EXPECT_EQ(asio::experimental::error::channel_closed, *end);
+}
@@ -0,0 +1,170 @@
+#include <gtest/gtest.h>
+
+#include <asio/bind_cancellation_slot.hpp>
+#include <asio/ip/tcp.hpp>
+#include <chrono>
+#include <garak/connect.hpp>
+#include <vector>
+
+#include "loopback.hpp"
+
+namespace {
+using namespace std::chrono_literals;
+using tcp = asio::ip::tcp;
+
+/**
+ * @brief A loopback listener that never accepts and whose backlog is
+ * already full, so further SYNs are dropped and connects hang like they do
+ * against a blackholed address
+ * */
+struct blackhole {
+  explicit blackhole(asio::io_context& ctx) : acceptor(ctx), filler(ctx) {
+    acceptor.open(tcp::v4());
+    acceptor.bind({asio::ip::address_v4::loopback(), 0});
+    acceptor.listen(0);
+    filler.connect(acceptor.local_endpoint());
+  }
+
+  tcp::endpoint endpoint() const { return acceptor.local_endpoint(); }
+
+  tcp::acceptor acceptor;
+  tcp::socket filler;
+};
+
+struct result {
+  asio::error_code ec;
+  tcp::endpoint endpoint;
+  bool done{false};
+};
+
+auto record(result& out) {
+  return [&out](asio::error_code ec, tcp::endpoint endpoint) {
+    out = {ec, endpoint, true};
+  };
+}
+}  // namespace
+
+/**
+ * @brief Families alternate, starting with the first endpoint's family
+ * */
+TEST(ConnectTest, InterleaveFamilies) {
+  const auto v6 = [](int port) {
+    return tcp::endpoint{asio::ip::address_v6::loopback(),
+                         static_cast<unsigned short>(port)};
+  };
+  const auto v4 = [](int port) {
+    return tcp::endpoint{asio::ip::address_v4::loopback(),
+                         static_cast<unsigned short>(port)};
+  };
+  const std::vector<tcp::endpoint> ordered = garak::detail::interleave_families(
+      std::vector{v6(1), v6(2), v6(3), v4(4), v4(5)});
+  EXPECT_EQ((std::vector{v6(1), v4(4), v6(2), v4(5), v6(3)}), ordered);
+
+  const std::vector<tcp::endpoint> v4_first =
+      garak::detail::interleave_families(std::vector{v4(1), v6(2), v6(3)});
+  EXPECT_EQ((std::vector{v4(1), v6(2), v6(3)}), v4_first);
+}
+
+/**
+ * @brief An address that never answers only delays the connection by the
+ * attempt delay
+ * */
+TEST(ConnectTest, RacesPastBlackhole) {
+  asio::io_context ctx;
+  blackhole hole{ctx};
+  tcp::acceptor listener{ctx, {asio::ip::address_v4::loopback(), 0}};
+
+  tcp::socket socket{ctx};
+  result out;
+  const auto start = std::chrono::steady_clock::now();
+  garak::async_connect_racing(
+      socket, std::vector{hole.endpoint(), listener.local_endpoint()}, 20ms,
+      record(out));
+  ASSERT_TRUE(garak::test::run_until(ctx, [&] { return out.done; }));
+  EXPECT_FALSE(out.ec);
+  EXPECT_EQ(listener.local_endpoint(), out.endpoint);
+  EXPECT_EQ(listener.local_endpoint(), socket.remote_endpoint());
+  EXPECT_LT(std::chrono::steady_clock::now() - start, 1s);
+}
+
+/**
+ * @brief A refused attempt starts the next one without waiting out the
+ * delay, and an IPv6 listener is reachable as well
+ * */
+TEST(ConnectTest, FailureStartsNextAttempt) {
+  asio::io_context ctx;
+  tcp::endpoint refused;
+  {
+    tcp::acceptor closed{ctx, {asio::ip::address_v4::loopback(), 0}};
+    refused = closed.local_endpoint();
+  }
+
+  tcp::acceptor listener{ctx};
+  asio::error_code ec;
+  listener.open(tcp::v6(), ec);
+  if (!ec) {
+    listener.bind({asio::ip::address_v6::loopback(), 0}, ec);
+  }
+  if (ec) {
+    listener = tcp::acceptor{ctx, {asio::ip::address_v4::loopback(), 0}};
+  } else {
+    listener.listen();
+  }
+
+  tcp::socket socket{ctx};
+  result out;
+  garak::async_connect_racing(
+      socket, std::vector{refused, listener.local_endpoint()}, 10s,
+      record(out));
+  ASSERT_TRUE(garak::test::run_until(ctx, [&] { return out.done; }, 2s));
+  EXPECT_FALSE(out.ec);
+  EXPECT_EQ(listener.local_endpoint(), out.endpoint);
+}
+
+/**
+ * @brief With nothing reachable the last error is reported
+ * */
+TEST(ConnectTest, AllFail) {
+  asio::io_context ctx;
+  std::vector<tcp::endpoint> refused;
+  for (int i = 0; i < 3; ++i) {
+    tcp::acceptor closed{ctx, {asio::ip::address_v4::loopback(), 0}};
+    refused.push_back(closed.local_endpoint());
+  }
+
+  tcp::socket socket{ctx};
+  result out;
+  garak::async_connect_racing(socket, refused, record(out));
+  ASSERT_TRUE(garak::test::run_until(ctx, [&] { return out.done; }));
+  EXPECT_EQ(asio::error::connection_refused, out.ec);
+  EXPECT_FALSE(socket.is_open());
+
+  result empty;
+  garak::async_connect_racing(socket, std::vector<tcp::endpoint>{},
+                              record(empty));
+  EXPECT_FALSE(empty.done);
+  ASSERT_TRUE(garak::test::run_until(ctx, [&] { return empty.done; }));
+  EXPECT_EQ(asio::error::not_found, empty.ec);
+}
+
+/**
+ * @brief Cancelling abandons every attempt in flight
+ * */
+TEST(ConnectTest, Cancellation) {
+  asio::io_context ctx;
+  blackhole hole{ctx};
+
+  tcp::socket socket{ctx};
+  result out;
+  asio::cancellation_signal signal;
+  garak::async_connect_racing(
+      socket, std::vector{hole.endpoint(), hole.endpoint()}, 10ms,
+      asio::bind_cancellation_slot(signal.slot(), record(out)));
+  asio::steady_timer timer{ctx, 50ms};
+  timer.async_wait([&](asio::error_code) {
+    signal.emit(asio::cancellation_type::terminal);
+  });
+  ASSERT_TRUE(garak::test::run_until(ctx, [&] { return out.done; }));
+  EXPECT_EQ(asio::error::operation_aborted, out.ec);
+  EXPECT_FALSE(socket.is_open());
+}
@@ -0,0 +1,214 @@
+#include <gtest/gtest.h>
+
+#include <asio/co_spawn.hpp>
+#include <asio/detached.hpp>
+#include <asio/ip/tcp.hpp>
+#include <asio/use_awaitable.hpp>
+#include <garak/connection_pool.hpp>
+#include <optional>
+#include <vector>
+
+#include "loopback.hpp"
+
+namespace {
+using namespace std::chrono_literals;
+using tcp = asio::ip::tcp;
+using tcp_pool = garak::connection_pool<tcp>;
+
+/**
+ * @brief Accepts and holds on to every connection made to it
+ * */
+struct listener {
+  explicit listener(asio::io_context& ctx)
+      : acceptor(ctx, tcp::endpoint{asio::ip::address_v4::loopback(), 0}) {
+    accept();
+  }
+
+  void accept() {
+    acceptor.async_accept([this](asio::error_code ec, tcp::socket socket) {
+      if (!ec) {
+        accepted.push_back(std::move(socket));
+        accept();
+      }
+    });
+  }
+
+  std::vector<tcp::endpoint> endpoints() const {
+    return {acceptor.local_endpoint()};
+  }
+
+  tcp::acceptor acceptor;
+  std::vector<tcp::socket> accepted;
+};
+
+/**
+ * @brief Run acquire() to completion, keeping the lease or the error
+ * */
+struct acquisition {
+  std::optional<tcp_pool::lease> lease;
+  asio::error_code error;
+  bool done{false};
+};
+
+void acquire(asio::io_context& ctx, tcp_pool& pool, acquisition& result) {
+  asio::co_spawn(
+      ctx,
+      [&]() -> asio::awaitable<void> {
+        try {
+          result.lease.emplace(co_await pool.acquire());
+        } catch (const std::system_error& e) {
+          result.error = e.code();
+        }
+        result.done = true;
+      },
+      asio::detached);
+}
+}  // namespace
+
+/**
+ * @brief start() opens min_size connections before anyone asks
+ * */
+TEST(ConnectionPoolTest, Warmup) {
+  asio::io_context ctx;
+  listener server{ctx};
+  tcp_pool pool{ctx.get_executor(), server.endpoints(), {.min_size = 3}};
+  pool.start();
+
+  ASSERT_TRUE(garak::test::run_until(ctx, [&] { return pool.idle() == 3; }));
+  EXPECT_EQ(3U, pool.size());
+
+  acquisition first;
+  acquire(ctx, pool, first);
+  ASSERT_TRUE(garak::test::run_until(ctx, [&] { return first.done; }));
+  ASSERT_TRUE(first.lease);
+  EXPECT_EQ(2U, pool.idle());
+  EXPECT_TRUE(garak::test::run_until(
+      ctx, [&] { return server.accepted.size() == 3; }));
+}
+
+/**
+ * @brief A returned connection is handed out again instead of reconnecting
+ * */
+TEST(ConnectionPoolTest, Reuse) {
+  asio::io_context ctx;
+  listener server{ctx};
+  tcp_pool pool{ctx.get_executor(), server.endpoints()};
+
+  acquisition first;
+  acquire(ctx, pool, first);
+  ASSERT_TRUE(garak::test::run_until(ctx, [&] { return first.done; }));
+  ASSERT_TRUE(first.lease);
+  const auto local = (*first.lease)->local_endpoint();
+  first.lease.reset();
+  EXPECT_EQ(1U, pool.idle());
+
+  acquisition second;
+  acquire(ctx, pool, second);
+  ASSERT_TRUE(garak::test::run_until(ctx, [&] { return second.done; }));
+  ASSERT_TRUE(second.lease);
+  EXPECT_EQ(local, (*second.lease)->local_endpoint());
+  EXPECT_EQ(1U, pool.size());
+}
+
+/**
+ * @brief Past max_size, acquire() waits for a lease to come back
+ * */
+TEST(ConnectionPoolTest, Bounded) {
+  asio::io_context ctx;
+  listener server{ctx};
+  tcp_pool pool{ctx.get_executor(), server.endpoints(), {.max_size = 1}};
+
+  acquisition first;
+  acquisition second;
+  acquire(ctx, pool, first);
+  ASSERT_TRUE(garak::test::run_until(ctx, [&] { return first.done; }));
+  acquire(ctx, pool, second);
+  ASSERT_TRUE(garak::test::run_until(ctx, [&] { return pool.waiting() == 1; }));
+  EXPECT_FALSE(second.done);
+
+  first.lease.reset();
+  ASSERT_TRUE(garak::test::run_until(ctx, [&] { return second.done; }));
+  EXPECT_TRUE(second.lease);
+  EXPECT_EQ(1U, pool.size());
+
+  // A discarded lease frees its slot for a fresh connection
+  acquisition third;
+  acquire(ctx, pool, third);
+  ASSERT_TRUE(garak::test::run_until(ctx, [&] { return pool.waiting() == 1; }));
+  second.lease->discard();
+  second.lease.reset();
+  ASSERT_TRUE(garak::test::run_until(ctx, [&] { return third.done; }));
+  EXPECT_TRUE(third.lease);
+  EXPECT_TRUE(garak::test::run_until(
+      ctx, [&] { return server.accepted.size() == 2; }));
+}
+
+/**
+ * @brief Idle connections the peer dropped, or that sat unused too long,
+ * are closed by the health check
+ * */
+TEST(ConnectionPoolTest, Eviction) {
+  asio::io_context ctx;
+  listener server{ctx};
+  tcp_pool pool{ctx.get_executor(),
+                server.endpoints(),
+                {.min_size = 1,
+                 .idle_timeout = 30ms,
+                 .health_check_interval = 10ms}};
+  pool.start();
+  ASSERT_TRUE(garak::test::run_until(ctx, [&] { return pool.idle() == 1; }));
+
+  // Grow past min_size, the surplus ages out
+  acquisition first;
+  acquisition second;
+  acquire(ctx, pool, first);
+  acquire(ctx, pool, second);
+  ASSERT_TRUE(garak::test::run_until(
+      ctx, [&] { return first.done && second.done; }));
+  first.lease.reset();
+  second.lease.reset();
+  EXPECT_EQ(2U, pool.idle());
+  ASSERT_TRUE(garak::test::run_until(ctx, [&] { return pool.size() == 1; }));
+
+  // The peer hangs up, the pool notices and reconnects to min_size
+  ASSERT_TRUE(garak::test::run_until(
+      ctx, [&] { return server.accepted.size() == 2; }));
+  for (auto& socket : server.accepted) {
+    socket.close();
+  }
+  ASSERT_TRUE(garak::test::run_until(
+      ctx, [&] { return server.accepted.size() == 3 && pool.idle() == 1; }));
+  EXPECT_EQ(1U, pool.size());
+}
+
+/**
+ * @brief Connect failures and closing the pool surface from acquire()
+ * */
+TEST(ConnectionPoolTest, Errors) {
+  asio::io_context ctx;
+  std::vector<tcp::endpoint> nowhere;
+  {
+    listener server{ctx};
+    nowhere = server.endpoints();
+  }
+  tcp_pool refused{ctx.get_executor(), nowhere};
+  acquisition failed;
+  acquire(ctx, refused, failed);
+  ASSERT_TRUE(garak::test::run_until(ctx, [&] { return failed.done; }));
+  EXPECT_EQ(asio::error::connection_refused, failed.error);
+  EXPECT_EQ(0U, refused.size());
+
+  listener server{ctx};
+  tcp_pool pool{ctx.get_executor(), server.endpoints(), {.max_size = 1}};
+  acquisition held;
+  acquisition waiting;
+  acquire(ctx, pool, held);
+  ASSERT_TRUE(garak::test::run_until(ctx, [&] { return held.done; }));
+  acquire(ctx, pool, waiting);
+  ASSERT_TRUE(garak::test::run_until(ctx, [&] { return pool.waiting() == 1; }));
+  pool.close();
+  ASSERT_TRUE(garak::test::run_until(ctx, [&] { return waiting.done; }));
+  EXPECT_EQ(asio::error::operation_aborted, waiting.error);
+  held.lease.reset();
+  EXPECT_EQ(0U, pool.size());
+}
@@ -0,0 +1,141 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <garak/dispatcher.hpp>
+#include <string>
+#include <vector>
+
+namespace {
+struct ping {
+  std::uint32_t sequence{0};
+
+  static ping decode(std::span<const std::byte> payload) {
+    ping msg;
+    std::memcpy(&msg.sequence, payload.data(),
+                std::min(payload.size(), sizeof msg.sequence));
+    return msg;
+  }
+};
+
+struct log_line {
+  std::string text;
+};
+
+struct journal {
+  std::vector<std::string> entries;
+};
+}  // namespace
+
+template <>
+struct garak::message_traits<log_line> {
+  static log_line decode(std::span<const std::byte> payload) {
+    return log_line{std::string(reinterpret_cast<const char*>(payload.data()),
+                                payload.size())};
+  }
+};
+
+namespace {
+template <garak::message_id Id>
+struct ping_handler {
+  static constexpr garak::message_id id = Id;
+  using message_type = ping;
+
+  void operator()(ping msg, journal& out) const {
+    out.entries.push_back(std::to_string(Id) + ":" +
+                          std::to_string(msg.sequence));
+  }
+};
+
+struct log_handler {
+  static constexpr garak::message_id id = 3;
+  using message_type = log_line;
+
+  void operator()(const log_line& msg, journal& out) const {
+    out.entries.push_back(msg.text);
+  }
+};
+
+template <garak::message_id Id>
+struct counting_handler {
+  static constexpr garak::message_id id = Id;
+  using message_type = std::span<const std::byte>;
+
+  void operator()(std::span<const std::byte> payload) {
+    bytes += payload.size();
+  }
+
+  std::size_t bytes{0};
+};
+
+std::vector<std::byte> encode(std::uint32_t value) {
+  std::vector<std::byte> out(sizeof value);
+  std::memcpy(out.data(), &value, sizeof value);
+  return out;
+}
+
+std::vector<std::byte> encode(std::string_view text) {
+  std::vector<std::byte> out(text.size());
+  std::memcpy(out.data(), text.data(), text.size());
+  return out;
+}
+}  // namespace
+
+/**
+ * @brief Contiguous ids index straight into the table
+ * */
+TEST(DispatcherTest, DenseIds) {
+  using dense =
+      garak::dispatcher<ping_handler<1>, ping_handler<2>, log_handler>;
+  static_assert(!dense::is_hashed());
+  static_assert(dense::contains(2) && !dense::contains(4));
+
+  dense dispatch;
+  journal out;
+  EXPECT_TRUE(dispatch.dispatch(2, encode(7U), out));
+  EXPECT_TRUE(dispatch.dispatch(3, encode("hello"), out));
+  EXPECT_TRUE(dispatch.dispatch(1, encode(9U), out));
+  EXPECT_FALSE(dispatch.dispatch(0, encode(1U), out));
+  EXPECT_FALSE(dispatch.dispatch(4, encode(1U), out));
+
+  const std::vector<std::string> expected{"2:7", "hello", "1:9"};
+  EXPECT_EQ(expected, out.entries);
+}
+
+/**
+ * @brief Sparse ids go through the perfect hash, and unknown ids that land
+ * on an occupied slot are still rejected
+ * */
+TEST(DispatcherTest, SparseIds) {
+  using sparse = garak::dispatcher<ping_handler<7>, ping_handler<1000>,
+                                   ping_handler<42>, ping_handler<123456>>;
+  static_assert(sparse::is_hashed());
+
+  sparse dispatch;
+  journal out;
+  EXPECT_TRUE(dispatch.dispatch(123456, encode(1U), out));
+  EXPECT_TRUE(dispatch.dispatch(42, encode(2U), out));
+  EXPECT_TRUE(dispatch.dispatch(1000, encode(3U), out));
+  EXPECT_TRUE(dispatch.dispatch(7, encode(4U), out));
+
+  for (garak::message_id id = 0; id < 2000; ++id) {
+    if (!sparse::contains(id)) {
+      EXPECT_FALSE(dispatch.dispatch(id, encode(0U), out));
+    }
+  }
+
+  const std::vector<std::string> expected{"123456:1", "42:2", "1000:3",
+                                          "7:4"};
+  EXPECT_EQ(expected, out.entries);
+}
+
+/**
+ * @brief Handlers may keep state, and may take the raw payload
+ * */
+TEST(DispatcherTest, StatefulHandler) {
+  garak::dispatcher<counting_handler<1>, counting_handler<65000>> dispatch;
+  EXPECT_TRUE(dispatch.dispatch(65000, encode("abcd")));
+  EXPECT_TRUE(dispatch.dispatch(65000, encode("ef")));
+  EXPECT_TRUE(dispatch.dispatch(1, encode("g")));
+  EXPECT_EQ(6U, dispatch.get<counting_handler<65000>>().bytes);
+  EXPECT_EQ(1U, dispatch.get<counting_handler<1>>().bytes);
+}
@@ -0,0 +1,125 @@
+#include <gtest/gtest.h>
+
+#include <array>
+#include <asio/write.hpp>
+#include <functional>
+#include <garak/frame.hpp>
+#include <string>
+#include <vector>
+
+#include "loopback.hpp"
+
+namespace {
+using tcp_frames = garak::framed_stream<asio::ip::tcp::socket>;
+
+std::string to_string(std::span<const std::byte> frame) {
+  return {reinterpret_cast<const char*>(frame.data()), frame.size()};
+}
+}  // namespace
+
+/**
+ * @brief Frames written back to back arrive whole and in order
+ * */
+TEST(FrameTest, Pipelined) {
+  asio::io_context ctx;
+  auto [a, b] = garak::test::connected_pair(ctx);
+  tcp_frames writer{std::move(a)};
+  tcp_frames reader{std::move(b)};
+
+  const std::vector<std::string> sent{"one", "", std::string(100000, 'x'),
+                                      "four"};
+  std::vector<std::string> received;
+
+  std::size_t next = 0;
+  std::function<void()> write_next = [&] {
+    if (next == sent.size()) {
+      return;
+    }
+    writer.async_write_frame(
+        asio::buffer(sent[next]), [&](asio::error_code ec, std::size_t n) {
+          ASSERT_FALSE(ec);
+          EXPECT_EQ(sent[next].size(), n);
+          ++next;
+          write_next();
+        });
+  };
+
+  std::function<void()> read_next = [&] {
+    reader.async_read_frame(
+        [&](asio::error_code ec, std::span<const std::byte> frame) {
+          ASSERT_FALSE(ec);
+          received.push_back(to_string(frame));
+          if (received.size() < sent.size()) {
+            read_next();
+          }
+        });
+  };
+
+  write_next();
+  read_next();
+  ctx.run();
+  EXPECT_EQ(sent, received);
+}
+
+/**
+ * @brief A header announcing an oversized frame fails the read
+ * */
+TEST(FrameTest, MaxFrameSize) {
+  asio::io_context ctx;
+  auto [a, b] = garak::test::connected_pair(ctx);
+  tcp_frames reader{std::move(b)};
+  reader.max_frame_size(16);
+
+  const std::string payload(17, 'y');
+  std::array<std::byte, tcp_frames::header_size> header{};
+  tcp_frames::encode_header(header, payload.size());
+  asio::write(a, asio::buffer(header));
+  asio::write(a, asio::buffer(payload));
+
+  asio::error_code result;
+  reader.async_read_frame(
+      [&](asio::error_code ec, std::span<const std::byte>) { result = ec; });
+  ctx.run();
+  EXPECT_EQ(asio::error::message_size, result);
+}
+
+/**
+ * @brief With draining on, frames already queued on the socket are picked
+ * up in the same read, whole and in order
+ * */
+TEST(FrameTest, Drain) {
+  asio::io_context ctx;
+  auto [a, b] = garak::test::connected_pair(ctx);
+  tcp_frames reader{std::move(b)};
+  reader.drain(1024);
+
+  std::string burst;
+  std::vector<std::string> sent;
+  for (int i = 0; i < 500; ++i) {
+    sent.push_back(std::to_string(i));
+    std::array<std::byte, tcp_frames::header_size> header{};
+    tcp_frames::encode_header(header, sent.back().size());
+    burst.append(reinterpret_cast<const char*>(header.data()), header.size());
+    burst += sent.back();
+  }
+  asio::write(a, asio::buffer(burst));
+  a.close();
+
+  std::vector<std::string> received;
+  asio::error_code last;
+  std::function<void()> read_next = [&] {
+    reader.async_read_frame(
+        [&](asio::error_code ec, std::span<const std::byte> frame) {
+          if (ec) {
+            last = ec;
+            return;
+          }
+          received.push_back(to_string(frame));
+          read_next();
+        });
+  };
+  read_next();
+  ctx.run();
+  EXPECT_EQ(sent, received);
+  EXPECT_EQ(asio::error::eof, last);
+}
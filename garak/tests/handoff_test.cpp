@@ -0,0 +1,211 @@
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+#include <array>
+#include <asio/io_context.hpp>
+#include <asio/ip/tcp.hpp>
+#include <asio/local/connect_pair.hpp>
+#include <asio/local/stream_protocol.hpp>
+#include <asio/write.hpp>
+#include <cstddef>
+#include <garak/fd_passing.hpp>
+#include <garak/frame.hpp>
+#include <garak/handoff.hpp>
+#include <optional>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "loopback.hpp"
+
+namespace {
+using unix_socket = asio::local::stream_protocol::socket;
+using tcp = asio::ip::tcp;
+
+std::string text(std::span<const std::byte> frame) {
+  return {reinterpret_cast<const char*>(frame.data()), frame.size()};
+}
+
+/**
+ * @brief Frames laid out as framed_stream writes them, in one buffer
+ * */
+std::vector<std::byte> frames(const std::vector<std::string>& payloads) {
+  using stream = garak::framed_stream<tcp::socket>;
+  std::vector<std::byte> out;
+  for (const auto& payload : payloads) {
+    std::array<std::byte, stream::header_size> header{};
+    stream::encode_header(header, payload.size());
+    out.insert(out.end(), header.begin(), header.end());
+    const auto* data = reinterpret_cast<const std::byte*>(payload.data());
+    out.insert(out.end(), data, data + payload.size());
+  }
+  return out;
+}
+}  // namespace
+
+/**
+ * @brief Both ends of a pipe cross a unix socket and still work
+ * */
+TEST(FdPassingTest, Pipe) {
+  asio::io_context ctx;
+  unix_socket a{ctx};
+  unix_socket b{ctx};
+  asio::local::connect_pair(a, b);
+  std::array<int, 2> pipe{};
+  ASSERT_EQ(0, ::pipe(pipe.data()));
+  garak::unique_fd read_end{pipe[0]};
+  garak::unique_fd write_end{pipe[1]};
+
+  const std::string header = "pipe";
+  std::optional<asio::error_code> sent;
+  garak::async_send_fds(a, asio::buffer(header), pipe,
+                        [&](asio::error_code ec, std::size_t n) {
+                          EXPECT_EQ(header.size(), n);
+                          sent = ec;
+                        });
+  std::array<char, 4> received_header{};
+  std::vector<garak::unique_fd> received;
+  garak::async_receive_fds(b, asio::buffer(received_header),
+                           [&](asio::error_code ec, std::size_t n,
+                               std::vector<garak::unique_fd> fds) {
+                             EXPECT_FALSE(ec) << ec.message();
+                             EXPECT_EQ(header.size(), n);
+                             received = std::move(fds);
+                           });
+  ASSERT_TRUE(garak::test::run_until(
+      ctx, [&] { return sent.has_value() && !received.empty(); }));
+  EXPECT_FALSE(*sent);
+  ASSERT_EQ(2U, received.size());
+  EXPECT_NE(pipe[0], received[0].get());
+
+  // Write through the received write end, read through the original
+  const std::string message = "through the pipe";
+  ASSERT_EQ(static_cast<ssize_t>(message.size()),
+            ::write(received[1].get(), message.data(), message.size()));
+  std::string out(message.size(), '\0');
+  ASSERT_EQ(static_cast<ssize_t>(message.size()),
+            ::read(read_end.get(), out.data(), out.size()));
+  EXPECT_EQ(message, out);
+}
+
+/**
+ * @brief Descriptors without data are refused, a stream socket would drop
+ * them
+ * */
+TEST(FdPassingTest, NoData) {
+  asio::io_context ctx;
+  unix_socket a{ctx};
+  unix_socket b{ctx};
+  asio::local::connect_pair(a, b);
+  const std::array<int, 1> fds{0};
+  std::optional<asio::error_code> sent;
+  garak::async_send_fds(a, asio::const_buffer{}, fds,
+                        [&](asio::error_code ec, std::size_t) { sent = ec; });
+  ASSERT_TRUE(garak::test::run_until(ctx, [&] { return sent.has_value(); }));
+  EXPECT_EQ(asio::error::invalid_argument, *sent);
+}
+
+/**
+ * @brief A listener and a live connection move to a new owner: the client
+ * keeps its connection and sees no gap in the frames it sends, and new
+ * clients are accepted by the new owner
+ * */
+TEST(HandoffTest, ListenerAndConnection) {
+  asio::io_context ctx;
+  tcp::acceptor old_acceptor{
+      ctx, tcp::endpoint{asio::ip::address_v4::loopback(), 0}};
+  const auto endpoint = old_acceptor.local_endpoint();
+  tcp::socket client{ctx};
+  client.connect(endpoint);
+  garak::framed_stream<tcp::socket> old_stream{old_acceptor.accept()};
+
+  // The old owner reads both frames in one go but handles only the first
+  asio::write(client, asio::buffer(frames({"first", "second"})));
+  std::optional<std::string> first;
+  old_stream.async_read_frame(
+      [&](asio::error_code ec, std::span<const std::byte> frame) {
+        EXPECT_FALSE(ec);
+        first = text(frame);
+      });
+  ASSERT_TRUE(garak::test::run_until(ctx, [&] { return first.has_value(); }));
+  EXPECT_EQ("first", *first);
+  ASSERT_EQ(10U, old_stream.buffered().size());
+
+  unix_socket a{ctx};
+  unix_socket b{ctx};
+  asio::local::connect_pair(a, b);
+  garak::handoff_bundle bundle;
+  bundle.add_listener("public", old_acceptor);
+  bundle.add_connection("client", old_stream.next_layer(),
+                        old_stream.buffered());
+  std::optional<asio::error_code> sent;
+  garak::async_send_handoff(a, std::move(bundle),
+                            [&](asio::error_code ec) { sent = ec; });
+  std::optional<garak::handoff_bundle> received;
+  garak::async_receive_handoff(
+      b, [&](asio::error_code ec, garak::handoff_bundle handed) {
+        EXPECT_FALSE(ec) << ec.message();
+        received.emplace(std::move(handed));
+      });
+  ASSERT_TRUE(garak::test::run_until(
+      ctx, [&] { return sent.has_value() && received.has_value(); }));
+  EXPECT_FALSE(*sent);
+  ASSERT_EQ(2U, received->items().size());
+
+  // The old owner lets go, without shutting anything down
+  old_stream.next_layer().close();
+  old_acceptor.close();
+
+  asio::error_code ec;
+  tcp::acceptor new_acceptor{ctx};
+  ASSERT_TRUE(received->take_listener("public", new_acceptor, ec))
+      << ec.message();
+  EXPECT_EQ(endpoint, new_acceptor.local_endpoint());
+  tcp::socket socket{ctx};
+  std::vector<std::byte> unread;
+  ASSERT_TRUE(received->take_connection("client", socket, unread, ec))
+      << ec.message();
+  EXPECT_FALSE(received->take_connection("client", socket, unread, ec));
+  EXPECT_EQ(asio::error::not_found, ec);
+
+  garak::framed_stream<tcp::socket> new_stream{std::move(socket)};
+  new_stream.unread(unread);
+  asio::write(client, asio::buffer(frames({"third"})));
+  std::vector<std::string> seen;
+  new_stream.async_read_frame(
+      [&](asio::error_code e, std::span<const std::byte> frame) {
+        EXPECT_FALSE(e);
+        seen.push_back(text(frame));
+        new_stream.async_read_frame(
+            [&](asio::error_code e2, std::span<const std::byte> frame2) {
+              EXPECT_FALSE(e2);
+              seen.push_back(text(frame2));
+            });
+      });
+  ASSERT_TRUE(garak::test::run_until(ctx, [&] { return seen.size() == 2; }));
+  EXPECT_EQ((std::vector<std::string>{"second", "third"}), seen);
+
+  tcp::socket late{ctx};
+  late.connect(endpoint);
+  auto accepted = new_acceptor.accept();
+  EXPECT_EQ(late.local_endpoint(), accepted.remote_endpoint());
+}
+
+/**
+ * @brief Garbage instead of a bundle is refused
+ * */
+TEST(HandoffTest, Garbage) {
+  asio::io_context ctx;
+  unix_socket a{ctx};
+  unix_socket b{ctx};
+  asio::local::connect_pair(a, b);
+  std::optional<asio::error_code> result;
+  garak::async_receive_handoff(
+      b, [&](asio::error_code ec, garak::handoff_bundle) { result = ec; });
+  const std::array<char, 16> garbage{};
+  asio::write(a, asio::buffer(garbage));
+  ASSERT_TRUE(garak::test::run_until(ctx, [&] { return result.has_value(); }));
+  EXPECT_EQ(asio::error::invalid_argument, *result);
+}
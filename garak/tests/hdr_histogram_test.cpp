@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <garak/hdr_histogram.hpp>
+#include <stdexcept>
+
+/**
+ * @brief Small values are exact, large ones within the configured precision
+ * */
+TEST(HdrHistogramTest, Precision) {
+  garak::hdr_histogram h{3'600'000'000, 3};
+  for (std::int64_t v = 1; v < 2048; ++v) {
+    EXPECT_EQ(v, h.lowest_equivalent(v));
+    EXPECT_EQ(v, h.highest_equivalent(v));
+  }
+  for (const std::int64_t v :
+       {std::int64_t{10'007}, std::int64_t{1'234'567},
+        std::int64_t{3'000'000'000}}) {
+    EXPECT_LE(h.lowest_equivalent(v), v);
+    EXPECT_GE(h.highest_equivalent(v), v);
+    // Three significant digits
+    EXPECT_LT(h.highest_equivalent(v) - h.lowest_equivalent(v), v / 1000);
+  }
+}
+
+/**
+ * @brief Percentiles, min, max and mean over a uniform distribution
+ * */
+TEST(HdrHistogramTest, Percentiles) {
+  garak::hdr_histogram h{1'000'000, 3};
+  EXPECT_EQ(0, h.value_at_percentile(50));
+  for (std::int64_t v = 1; v <= 10'000; ++v) {
+    h.record(v);
+  }
+  EXPECT_EQ(10'000, h.total_count());
+  EXPECT_EQ(1, h.min());
+  EXPECT_EQ(10'000, h.max());
+  EXPECT_NEAR(5'000, static_cast<double>(h.value_at_percentile(50)), 5);
+  EXPECT_NEAR(9'900, static_cast<double>(h.value_at_percentile(99)), 10);
+  EXPECT_EQ(10'000, h.value_at_percentile(100));
+  EXPECT_NEAR(5'000.5, h.mean(), 5);
+
+  std::int64_t last = 0;
+  h.for_each_value([&](std::int64_t value, double percentile,
+                       std::int64_t seen) {
+    EXPECT_GT(value, 0);
+    EXPECT_LE(percentile, 100.0);
+    last = seen;
+  });
+  EXPECT_EQ(10'000, last);
+}
+
+/**
+ * @brief Coordinated omission correction fills in the samples a stalled
+ * client missed
+ * */
+TEST(HdrHistogramTest, CorrectedRecording) {
+  garak::hdr_histogram h{1'000'000, 3};
+  h.record_corrected(1'000, 100);
+  // 1000 plus the 900, 800 ... 100 it hid
+  EXPECT_EQ(10, h.total_count());
+  EXPECT_EQ(100, h.min());
+  h.record_corrected(50, 100);
+  EXPECT_EQ(11, h.total_count());
+}
+
+/**
+ * @brief Merging adds counts, clamping keeps out of range values
+ * */
+TEST(HdrHistogramTest, MergeAndClamp) {
+  garak::hdr_histogram a{1'000, 2};
+  garak::hdr_histogram b{1'000, 2};
+  a.record(10, 3);
+  b.record(5'000);
+  EXPECT_EQ(1'000, b.max());
+  a.merge(b);
+  EXPECT_EQ(4, a.total_count());
+  EXPECT_EQ(10, a.min());
+  EXPECT_EQ(10, a.value_at_percentile(75));
+  EXPECT_GE(a.value_at_percentile(100), 990);
+
+  garak::hdr_histogram other{1'000'000, 2};
+  EXPECT_THROW(a.merge(other), std::invalid_argument);
+  a.reset();
+  EXPECT_EQ(0, a.total_count());
+  EXPECT_THROW((garak::hdr_histogram{1, 3}), std::invalid_argument);
+}
@@ -0,0 +1,49 @@
+#ifndef GARAK_TESTS_LOOPBACK_HPP
+#define GARAK_TESTS_LOOPBACK_HPP
+
+/**
+ * @file loopback.hpp
+ * @brief Shared helpers for tests that need real sockets
+ */
+
+#include <asio/io_context.hpp>
+#include <asio/ip/tcp.hpp>
+#include <chrono>
+#include <utility>
+
+namespace garak::test {
+/**
+ * @brief A connected pair of tcp sockets over 127.0.0.1
+ * */
+inline std::pair<asio::ip::tcp::socket, asio::ip::tcp::socket>
+connected_pair(asio::io_context& ctx) {
+  asio::ip::tcp::acceptor acceptor{
+      ctx, asio::ip::tcp::endpoint{asio::ip::address_v4::loopback(), 0}};
+  asio::ip::tcp::socket client{ctx};
+  client.connect(acceptor.local_endpoint());
+  auto server = acceptor.accept();
+  client.set_option(asio::ip::tcp::no_delay{true});
+  server.set_option(asio::ip::tcp::no_delay{true});
+  return {std::move(client), std::move(server)};
+}
+
+/**
+ * @brief Run handlers until done() holds or timeout passes
+ *
+ * @returns the final value of done()
+ * */
+template <typename Predicate>
+bool run_until(asio::io_context& ctx, Predicate done,
+               std::chrono::steady_clock::duration timeout =
+                   std::chrono::seconds(5)) {
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  // Running out of work on an earlier call leaves ctx stopped
+  ctx.restart();
+  while (!done() && std::chrono::steady_clock::now() < deadline) {
+    ctx.run_one_until(deadline);
+  }
+  return done();
+}
+}  // namespace garak::test
+
+#endif
@@ -0,0 +1,163 @@
+#include <gtest/gtest.h>
+
+#include <array>
+#include <asio/io_context.hpp>
+#include <asio/post.hpp>
+#include <asio/steady_timer.hpp>
+#include <asio/write.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <garak/metrics.hpp>
+#include <thread>
+
+#include "loopback.hpp"
+
+using namespace std::chrono_literals;
+
+/**
+ * @brief Buckets hold values to within an eighth
+ * */
+TEST(MetricsTest, HistogramBuckets) {
+  using garak::detail::atomic_histogram;
+  for (std::uint64_t v = 0; v < 8; ++v) {
+    EXPECT_EQ(v, atomic_histogram::middle_of(atomic_histogram::index_of(v)));
+  }
+  for (std::uint64_t v = 8; v < (std::uint64_t{1} << 39); v = v * 3 + 1) {
+    const auto index = atomic_histogram::index_of(v);
+    ASSERT_LT(index, atomic_histogram::bucket_count);
+    const auto middle = atomic_histogram::middle_of(index);
+    EXPECT_LE(middle > v ? middle - v : v - middle, v / 8) << v;
+  }
+  EXPECT_EQ(atomic_histogram::bucket_count - 1,
+            atomic_histogram::index_of(UINT64_MAX));
+}
+
+/**
+ * @brief Posted handlers are counted and timed, and the queue drains
+ * */
+TEST(MetricsTest, CountsHandlers) {
+  asio::io_context ctx{1};
+  auto& metrics = garak::enable_metrics(ctx);
+  EXPECT_EQ(&metrics, &garak::enable_metrics(ctx));
+
+  for (int i = 0; i < 100; ++i) {
+    asio::post(ctx, [] {});
+  }
+  auto before = metrics.stats();
+  EXPECT_EQ(100U, before.handlers_ready);
+  EXPECT_EQ(100, before.queue_depth);
+  EXPECT_EQ(100, before.outstanding_work);
+
+  ctx.run();
+  const auto after = metrics.stats();
+  EXPECT_EQ(100U, after.handlers_run);
+  EXPECT_EQ(0, after.queue_depth);
+  EXPECT_EQ(0, after.outstanding_work);
+  EXPECT_EQ(100, after.handler_time.total_count());
+  EXPECT_EQ(100, after.queue_delay.total_count());
+  EXPECT_GT(after.handlers_per_second(before), 0.0);
+}
+
+/**
+ * @brief A blocking handler shows in handler time, and delays the handler
+ * queued behind it
+ * */
+TEST(MetricsTest, BlockingHandler) {
+  asio::io_context ctx{1};
+  auto& metrics = garak::enable_metrics(ctx);
+  asio::post(ctx, [] { std::this_thread::sleep_for(20ms); });
+  asio::post(ctx, [] {});
+  ctx.run();
+
+  const auto stats = metrics.stats();
+  constexpr std::int64_t blocked = std::chrono::nanoseconds(18ms).count();
+  EXPECT_GE(stats.handler_time.max(), blocked);
+  EXPECT_LT(stats.handler_time.min(), blocked);
+  EXPECT_GE(stats.queue_delay.max(), blocked);
+  EXPECT_GE(stats.busy, 18ms);
+  EXPECT_GT(stats.utilization({}), 0.5);
+}
+
+/**
+ * @brief Time blocked in the reactor counts as waiting, and pending timers
+ * as outstanding work
+ * */
+TEST(MetricsTest, Waiting) {
+  asio::io_context ctx{1};
+  auto& metrics = garak::enable_metrics(ctx);
+  asio::steady_timer timer{ctx, 50ms};
+  bool fired = false;
+  timer.async_wait([&](const asio::error_code&) { fired = true; });
+  EXPECT_EQ(1, metrics.stats().outstanding_work);
+
+  // A loaded machine may get here late, so only the rest of the timer's
+  // wait is expected
+  const auto remaining = timer.expiry() - std::chrono::steady_clock::now();
+  ctx.run();
+  EXPECT_TRUE(fired);
+  const auto stats = metrics.stats();
+  EXPECT_GE(stats.waiting, remaining / 2);
+  EXPECT_LT(stats.busy, stats.waiting);
+  EXPECT_GE(stats.handlers_run, 1U);
+  EXPECT_EQ(0, stats.queue_depth);
+}
+
+/**
+ * @brief Handlers posted from other threads onto a multi-threaded context
+ * are all accounted for
+ * */
+TEST(MetricsTest, Threads) {
+  asio::io_context ctx{2};
+  auto& metrics = garak::enable_metrics(ctx);
+  auto guard = asio::make_work_guard(ctx);
+  std::thread a{[&] { ctx.run(); }};
+  std::thread b{[&] { ctx.run(); }};
+  std::thread poster{[&] {
+    for (int i = 0; i < 1000; ++i) {
+      asio::post(ctx, [] {});
+    }
+  }};
+  poster.join();
+  guard.reset();
+  a.join();
+  b.join();
+
+  const auto stats = metrics.stats();
+  EXPECT_EQ(1000U, stats.handlers_run);
+  EXPECT_EQ(0, stats.queue_depth);
+}
+
+/**
+ * @brief Reads completed by the reactor are counted once each, and a
+ * recycled descriptor state doesn't carry an old ready time into the
+ * queue delay
+ * */
+TEST(MetricsTest, SocketReads) {
+  asio::io_context ctx{1};
+  auto& metrics = garak::enable_metrics(ctx);
+  auto [client, server] = garak::test::connected_pair(ctx);
+  const auto read_one = [&] {
+    std::array<char, 1> byte{};
+    bool read = false;
+    server.async_read_some(asio::buffer(byte),
+                           [&](asio::error_code ec, std::size_t) {
+                             EXPECT_FALSE(ec);
+                             read = true;
+                           });
+    asio::write(client, asio::buffer(byte));
+    ASSERT_TRUE(garak::test::run_until(ctx, [&] { return read; }));
+  };
+
+  read_one();
+  std::this_thread::sleep_for(50ms);
+  for (int i = 0; i < 200; ++i) {
+    read_one();
+  }
+  const auto stats = metrics.stats();
+  EXPECT_GE(stats.handlers_run, 201U);
+  EXPECT_EQ(stats.handlers_ready, stats.handlers_run);
+  EXPECT_EQ(0, stats.queue_depth);
+  EXPECT_LT(stats.queue_delay.max(),
+            std::chrono::nanoseconds(50ms).count());
+}
@@ -0,0 +1,136 @@
+#include <gtest/gtest.h>
+
+#include <asio/bind_executor.hpp>
+#include <asio/io_context.hpp>
+#include <asio/post.hpp>
+#include <asio/steady_timer.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <garak/priority_lanes.hpp>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+static_assert(
+    asio::execution::is_executor_v<garak::priority_lanes::executor_type>);
+
+/**
+ * @brief A control handler posted behind a bulk backlog runs first
+ * */
+TEST(PriorityLanesTest, ControlOvertakesBulk) {
+  asio::io_context ctx;
+  auto& lanes = garak::enable_priority_lanes(ctx);
+  std::vector<std::string> order;
+  for (int i = 0; i < 100; ++i) {
+    asio::post(lanes.get_executor(1), [&] { order.emplace_back("bulk"); });
+  }
+  asio::post(lanes.get_executor(0), [&] { order.emplace_back("control"); });
+  EXPECT_EQ(101U, lanes.pending(0) + lanes.pending(1));
+  ctx.run();
+  ASSERT_EQ(101U, order.size());
+  EXPECT_EQ("control", order.front());
+  EXPECT_EQ(0U, lanes.pending(1));
+}
+
+/**
+ * @brief A waiting lower lane gets every starvation_limit'th turn
+ * */
+TEST(PriorityLanesTest, StarvationLimit) {
+  asio::io_context ctx;
+  garak::priority_options options;
+  options.starvation_limit = 4;
+  auto& lanes = garak::enable_priority_lanes(ctx, options);
+  std::string order;
+  for (int i = 0; i < 3; ++i) {
+    asio::post(lanes.get_executor(1), [&] { order += 'b'; });
+  }
+  for (int i = 0; i < 10; ++i) {
+    asio::post(lanes.get_executor(0), [&] { order += 'c'; });
+  }
+  ctx.run();
+  EXPECT_EQ("cccbcccbcccbc", order);
+}
+
+/**
+ * @brief Three lanes drain in order, and asking for a fourth throws
+ * */
+TEST(PriorityLanesTest, ManyLanes) {
+  asio::io_context ctx;
+  garak::priority_options options;
+  options.lanes = 3;
+  auto& lanes = garak::enable_priority_lanes(ctx, options);
+  EXPECT_EQ(3U, lanes.lanes());
+  EXPECT_THROW(static_cast<void>(lanes.get_executor(3)), std::out_of_range);
+  std::string order;
+  for (const auto lane : {2, 1, 0, 2, 1, 0}) {
+    asio::post(lanes.get_executor(static_cast<std::size_t>(lane)),
+               [&order, lane] { order += std::to_string(lane); });
+  }
+  ctx.run();
+  EXPECT_EQ("001122", order);
+}
+
+/**
+ * @brief A completion handler bound to a lane runs through it, and the
+ * executor reports its io_context and that it never blocks
+ * */
+TEST(PriorityLanesTest, BindExecutor) {
+  asio::io_context ctx;
+  auto& lanes = garak::enable_priority_lanes(ctx);
+  const auto control = lanes.get_executor(0);
+  EXPECT_EQ(&ctx, &asio::query(control, asio::execution::context));
+  EXPECT_EQ(asio::execution::blocking.never,
+            asio::query(control, asio::execution::blocking));
+  EXPECT_EQ(control, lanes.get_executor(0));
+  EXPECT_NE(control, lanes.get_executor(1));
+
+  asio::steady_timer timer{ctx, std::chrono::milliseconds(1)};
+  bool fired = false;
+  timer.async_wait(asio::bind_executor(control, [&](asio::error_code ec) {
+    EXPECT_FALSE(ec);
+    fired = true;
+  }));
+  ctx.run();
+  EXPECT_TRUE(fired);
+}
+
+/**
+ * @brief Lane handlers run on every thread running the io_context, each
+ * exactly once
+ * */
+TEST(PriorityLanesTest, ManyThreads) {
+  asio::io_context ctx;
+  auto& lanes = garak::enable_priority_lanes(ctx);
+  std::atomic<int> ran{0};
+  for (int i = 0; i < 20000; ++i) {
+    asio::post(lanes.get_executor(static_cast<std::size_t>(i % 2)),
+               [&ran] { ++ran; });
+  }
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&ctx] { ctx.run(); });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(20000, ran.load());
+}
+
+/**
+ * @brief Handlers still queued when the io_context goes are destroyed
+ * without running
+ * */
+TEST(PriorityLanesTest, DestroyedUnrun) {
+  auto resource = std::make_shared<int>(0);
+  {
+    asio::io_context ctx;
+    auto& lanes = garak::enable_priority_lanes(ctx);
+    asio::post(lanes.get_executor(1), [resource] { ++*resource; });
+    EXPECT_EQ(2, resource.use_count());
+  }
+  EXPECT_EQ(1, resource.use_count());
+  EXPECT_EQ(0, *resource);
+}
@@ -0,0 +1,182 @@
+#include <gtest/gtest.h>
+
+#include <array>
+#include <asio/io_context.hpp>
+#include <asio/ip/tcp.hpp>
+#include <chrono>
+#include <cstdint>
+#include <garak/rate_limiter.hpp>
+#include <optional>
+#include <vector>
+
+#include "loopback.hpp"
+
+using namespace std::chrono_literals;
+
+namespace {
+using clock_type = garak::token_bucket::clock;
+
+/**
+ * @brief Accept one connection through admission into accepted
+ * */
+void accept_one(garak::admission_control& admission,
+                asio::ip::tcp::acceptor& acceptor,
+                std::vector<asio::ip::tcp::socket>& accepted,
+                std::optional<asio::error_code>& result) {
+  admission.async_accept(
+      acceptor, [&](asio::error_code ec, asio::ip::tcp::socket socket) {
+        result = ec;
+        if (!ec) {
+          accepted.push_back(std::move(socket));
+        }
+      });
+}
+}  // namespace
+
+/**
+ * @brief A bucket starts full, refills at its rate and caps at its burst
+ * */
+TEST(RateLimiterTest, TokenBucket) {
+  const auto t0 = clock_type::now();
+  garak::token_bucket bucket{{.per_second = 10, .burst = 5}, t0};
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_TRUE(bucket.try_take(1, t0));
+  }
+  EXPECT_FALSE(bucket.try_take(1, t0));
+  EXPECT_EQ(clock_type::duration{100ms}, bucket.time_until(1, t0));
+  EXPECT_TRUE(bucket.try_take(1, t0 + 100ms));
+  EXPECT_FALSE(bucket.try_take(1, t0 + 100ms));
+  EXPECT_DOUBLE_EQ(5, bucket.tokens(t0 + 10s));
+  EXPECT_TRUE(bucket.full(t0 + 10s));
+}
+
+/**
+ * @brief A zero rate grants the burst and then never refills, without
+ * dividing by zero on the way
+ * */
+TEST(RateLimiterTest, ZeroRate) {
+  const auto t0 = clock_type::now();
+  garak::token_bucket bucket{{.per_second = 0, .burst = 2}, t0};
+  EXPECT_TRUE(bucket.try_take(2, t0));
+  EXPECT_FALSE(bucket.try_take(1, t0 + 1h));
+  EXPECT_EQ(clock_type::duration::max(), bucket.time_until(1, t0 + 1h));
+
+  garak::session_rate_limiter limiter{{.per_second = 0, .burst = 1}, 1, 1};
+  EXPECT_TRUE(limiter.try_acquire(1, 1, t0));
+  EXPECT_TRUE(limiter.try_acquire(2, 1, t0));
+  EXPECT_FALSE(limiter.try_acquire(3, 1, t0 + 1h));
+  EXPECT_EQ(1U, limiter.stats().keys);
+}
+
+/**
+ * @brief Keys have buckets of their own
+ * */
+TEST(RateLimiterTest, PerKey) {
+  const auto t0 = clock_type::now();
+  garak::session_rate_limiter limiter{{.per_second = 1, .burst = 2}};
+  EXPECT_TRUE(limiter.try_acquire(1, 1, t0));
+  EXPECT_TRUE(limiter.try_acquire(1, 1, t0));
+  EXPECT_FALSE(limiter.try_acquire(1, 1, t0));
+  EXPECT_TRUE(limiter.try_acquire(2, 2, t0));
+  EXPECT_TRUE(limiter.try_acquire(1, 1, t0 + 1s));
+
+  const auto stats = limiter.stats();
+  EXPECT_EQ(4U, stats.admitted);
+  EXPECT_EQ(1U, stats.refused);
+  EXPECT_EQ(2U, stats.keys);
+  limiter.sweep(t0 + 10s);
+  EXPECT_EQ(0U, limiter.stats().keys);
+}
+
+/**
+ * @brief Keys that don't fit share the overflow bucket until refilled
+ * buckets can be forgotten
+ * */
+TEST(RateLimiterTest, Overflow) {
+  const auto t0 = clock_type::now();
+  garak::session_rate_limiter limiter{{.per_second = 1, .burst = 1}, 1, 2};
+  EXPECT_TRUE(limiter.try_acquire(1, 1, t0));
+  EXPECT_TRUE(limiter.try_acquire(2, 1, t0));
+  EXPECT_TRUE(limiter.try_acquire(3, 1, t0));
+  EXPECT_FALSE(limiter.try_acquire(4, 1, t0));
+  EXPECT_EQ(2U, limiter.stats().overflowed);
+  EXPECT_EQ(2U, limiter.stats().keys);
+
+  // 1 and 2 have refilled, so 5 takes a bucket of its own
+  EXPECT_TRUE(limiter.try_acquire(5, 1, t0 + 2s));
+  EXPECT_FALSE(limiter.try_acquire(5, 1, t0 + 2s));
+  EXPECT_EQ(2U, limiter.stats().overflowed);
+  EXPECT_EQ(1U, limiter.stats().keys);
+}
+
+/**
+ * @brief A client over its rate is reset at accept, and the next accept
+ * waits for it without completing
+ * */
+TEST(RateLimiterTest, RefusesClientOverRate) {
+  asio::io_context ctx;
+  asio::ip::tcp::acceptor acceptor{
+      ctx, asio::ip::tcp::endpoint{asio::ip::address_v4::loopback(), 0}};
+  garak::rate_limiter per_client{{.per_second = 0.001, .burst = 2}};
+  garak::admission_control admission{per_client,
+                                     {.per_second = 1000, .burst = 1000}};
+
+  std::vector<asio::ip::tcp::socket> clients;
+  for (int i = 0; i < 3; ++i) {
+    clients.emplace_back(ctx).connect(acceptor.local_endpoint());
+  }
+  std::vector<asio::ip::tcp::socket> accepted;
+  for (int i = 0; i < 2; ++i) {
+    std::optional<asio::error_code> result;
+    accept_one(admission, acceptor, accepted, result);
+    ASSERT_TRUE(
+        garak::test::run_until(ctx, [&] { return result.has_value(); }));
+    EXPECT_FALSE(*result);
+  }
+
+  std::optional<asio::error_code> result;
+  accept_one(admission, acceptor, accepted, result);
+  ASSERT_TRUE(garak::test::run_until(
+      ctx, [&] { return admission.stats().refused == 1; }));
+  EXPECT_FALSE(result.has_value());
+  acceptor.cancel();
+  ASSERT_TRUE(
+      garak::test::run_until(ctx, [&] { return result.has_value(); }));
+  EXPECT_EQ(asio::error::operation_aborted, *result);
+  EXPECT_EQ(2U, accepted.size());
+  EXPECT_EQ(2U, admission.stats().accepted);
+
+  std::array<char, 1> byte{};
+  asio::error_code ec;
+  clients[2].read_some(asio::buffer(byte), ec);
+  EXPECT_EQ(asio::error::connection_reset, ec);
+}
+
+/**
+ * @brief Over the listener's accept rate, accepting pauses
+ * */
+TEST(RateLimiterTest, PausesOverAcceptRate) {
+  asio::io_context ctx;
+  asio::ip::tcp::acceptor acceptor{
+      ctx, asio::ip::tcp::endpoint{asio::ip::address_v4::loopback(), 0}};
+  garak::rate_limiter per_client{{.per_second = 1000, .burst = 1000}};
+  garak::admission_control admission{per_client,
+                                     {.per_second = 20, .burst = 1}};
+
+  std::vector<asio::ip::tcp::socket> clients;
+  for (int i = 0; i < 2; ++i) {
+    clients.emplace_back(ctx).connect(acceptor.local_endpoint());
+  }
+  const auto start = clock_type::now();
+  std::vector<asio::ip::tcp::socket> accepted;
+  for (int i = 0; i < 2; ++i) {
+    std::optional<asio::error_code> result;
+    accept_one(admission, acceptor, accepted, result);
+    ASSERT_TRUE(
+        garak::test::run_until(ctx, [&] { return result.has_value(); }));
+    EXPECT_FALSE(*result);
+  }
+  EXPECT_GE(clock_type::now() - start, 40ms);
+  EXPECT_EQ(2U, admission.stats().accepted);
+  EXPECT_EQ(1U, admission.stats().paused);
+}
@@ -0,0 +1,58 @@
+#include <gtest/gtest.h>
+
+#include <asio/read.hpp>
+#include <asio/write.hpp>
+#include <garak/reactor.hpp>
+#include <vector>
+
+#include "loopback.hpp"
+
+namespace {
+/**
+ * @brief Make many connections readable at once and count the reads that
+ * complete
+ * */
+std::size_t run_burst(asio::io_context& ctx) {
+  constexpr int connections = 64;
+  std::vector<asio::ip::tcp::socket> readers;
+  std::vector<asio::ip::tcp::socket> writers;
+  for (int i = 0; i < connections; ++i) {
+    auto [a, b] = garak::test::connected_pair(ctx);
+    writers.push_back(std::move(a));
+    readers.push_back(std::move(b));
+  }
+
+  std::size_t completed = 0;
+  std::vector<char> bytes(readers.size());
+  for (std::size_t i = 0; i < readers.size(); ++i) {
+    asio::async_read(readers[i], asio::buffer(&bytes[i], 1),
+                     [&](asio::error_code ec, std::size_t) {
+                       EXPECT_FALSE(ec);
+                       ++completed;
+                     });
+  }
+  for (auto& writer : writers) {
+    asio::write(writer, asio::buffer("x", 1));
+  }
+  ctx.run();
+  return completed;
+}
+}  // namespace
+
+/**
+ * @brief The batch size is per io_context and every event is still
+ * delivered when a wakeup returns fewer than are ready
+ * */
+TEST(ReactorTest, EventBatchSize) {
+  asio::io_context small;
+  asio::io_context large;
+  garak::set_event_batch_size(small, 1);
+  garak::set_event_batch_size(large, 4096);
+#if defined(ASIO_HAS_EPOLL)
+  EXPECT_EQ(1U, garak::event_batch_size(small));
+  EXPECT_EQ(4096U, garak::event_batch_size(large));
+#endif
+
+  EXPECT_EQ(64U, run_burst(small));
+  EXPECT_EQ(64U, run_burst(large));
+}
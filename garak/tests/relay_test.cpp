@@ -0,0 +1,163 @@
+#include <gtest/gtest.h>
+
+#include <asio/bind_cancellation_slot.hpp>
+#include <asio/io_context.hpp>
+#include <asio/read.hpp>
+#include <asio/write.hpp>
+#include <cstddef>
+#include <garak/relay.hpp>
+#include <optional>
+#include <string>
+
+#include "loopback.hpp"
+
+namespace {
+using tcp = asio::ip::tcp;
+
+struct relayed {
+  std::optional<asio::error_code> ec;
+  garak::relay_stats stats;
+};
+
+auto record(relayed& out) {
+  return [&out](asio::error_code ec, garak::relay_stats stats) {
+    out.ec = ec;
+    out.stats = stats;
+  };
+}
+
+std::string pattern(std::size_t size, char first) {
+  std::string s(size, '\0');
+  for (std::size_t i = 0; i < size; ++i) {
+    s[i] = static_cast<char>(first + static_cast<char>(i % 23));
+  }
+  return s;
+}
+
+/**
+ * @brief Write message then shut down sending, and read from the same
+ * socket until the far end shuts down
+ * */
+void send_and_drain(tcp::socket& socket, const std::string& message,
+                    std::string& received, bool& finished) {
+  asio::async_write(socket, asio::buffer(message),
+                    [&socket](asio::error_code ec, std::size_t) {
+                      EXPECT_FALSE(ec) << ec.message();
+                      socket.shutdown(tcp::socket::shutdown_send, ec);
+                    });
+  asio::async_read(socket, asio::dynamic_buffer(received),
+                   [&finished](asio::error_code ec, std::size_t) {
+                     EXPECT_EQ(asio::error::eof, ec);
+                     finished = true;
+                   });
+}
+
+/**
+ * @brief Relay a large message each way between two clients, each then
+ * ending its side
+ * */
+void exchange(garak::relay_mode mode) {
+  asio::io_context ctx;
+  auto [left, a] = garak::test::connected_pair(ctx);
+  auto [b, right] = garak::test::connected_pair(ctx);
+  relayed r;
+  garak::async_relay(a, b, mode, record(r));
+
+  const auto to_right = pattern(3 * 1024 * 1024 + 7, 'a');
+  const auto to_left = pattern(300 * 1024, 'A');
+  std::string at_left;
+  std::string at_right;
+  bool left_done = false;
+  bool right_done = false;
+  send_and_drain(left, to_right, at_left, left_done);
+  send_and_drain(right, to_left, at_right, right_done);
+
+  ASSERT_TRUE(garak::test::run_until(
+      ctx, [&] { return r.ec.has_value() && left_done && right_done; }));
+  EXPECT_FALSE(*r.ec) << r.ec->message();
+  EXPECT_EQ(to_right.size(), r.stats.a_to_b);
+  EXPECT_EQ(to_left.size(), r.stats.b_to_a);
+  EXPECT_TRUE(at_right == to_right);
+  EXPECT_TRUE(at_left == to_left);
+}
+}  // namespace
+
+/**
+ * @brief Socket to socket, the bytes go through splice
+ * */
+TEST(RelayTest, Splice) { exchange(garak::relay_mode::automatic); }
+
+/**
+ * @brief The same through the copy loop
+ * */
+TEST(RelayTest, Copy) { exchange(garak::relay_mode::copy); }
+
+/**
+ * @brief One side ending passes the end on, while the other direction
+ * keeps flowing until it ends too
+ * */
+TEST(RelayTest, HalfClose) {
+  asio::io_context ctx;
+  auto [left, a] = garak::test::connected_pair(ctx);
+  auto [b, right] = garak::test::connected_pair(ctx);
+  relayed r;
+  garak::async_relay(a, b, record(r));
+
+  left.shutdown(tcp::socket::shutdown_send);
+  std::string at_right;
+  std::optional<asio::error_code> right_read;
+  asio::async_read(right, asio::dynamic_buffer(at_right),
+                   [&](asio::error_code ec, std::size_t) { right_read = ec; });
+  ASSERT_TRUE(
+      garak::test::run_until(ctx, [&] { return right_read.has_value(); }));
+  EXPECT_EQ(asio::error::eof, *right_read);
+  EXPECT_FALSE(r.ec);
+
+  const std::string late = "still talking";
+  asio::write(right, asio::buffer(late));
+  right.shutdown(tcp::socket::shutdown_send);
+  std::string at_left;
+  std::optional<asio::error_code> left_read;
+  asio::async_read(left, asio::dynamic_buffer(at_left),
+                   [&](asio::error_code ec, std::size_t) { left_read = ec; });
+  ASSERT_TRUE(garak::test::run_until(
+      ctx, [&] { return left_read.has_value() && r.ec.has_value(); }));
+  EXPECT_EQ(late, at_left);
+  EXPECT_FALSE(*r.ec);
+  EXPECT_EQ(0U, r.stats.a_to_b);
+  EXPECT_EQ(late.size(), r.stats.b_to_a);
+}
+
+/**
+ * @brief A reset on one side stops both directions with its error
+ * */
+TEST(RelayTest, Reset) {
+  asio::io_context ctx;
+  auto [left, a] = garak::test::connected_pair(ctx);
+  auto [b, right] = garak::test::connected_pair(ctx);
+  relayed r;
+  garak::async_relay(a, b, record(r));
+
+  right.set_option(asio::socket_base::linger{true, 0});
+  right.close();
+  ASSERT_TRUE(garak::test::run_until(ctx, [&] { return r.ec.has_value(); }));
+  EXPECT_EQ(asio::error::connection_reset, *r.ec);
+}
+
+/**
+ * @brief Cancellation stops an idle relay
+ * */
+TEST(RelayTest, Cancel) {
+  asio::io_context ctx;
+  auto [left, a] = garak::test::connected_pair(ctx);
+  auto [b, right] = garak::test::connected_pair(ctx);
+  relayed r;
+  asio::cancellation_signal signal;
+  garak::async_relay(a, b,
+                     asio::bind_cancellation_slot(signal.slot(), record(r)));
+
+  ctx.poll();
+  signal.emit(asio::cancellation_type::terminal);
+  ASSERT_TRUE(garak::test::run_until(ctx, [&] { return r.ec.has_value(); }));
+  EXPECT_EQ(asio::error::operation_aborted, *r.ec);
+}
@@ -0,0 +1,376 @@
+#include <gtest/gtest.h>
+
+#include <array>
+#include <asio/io_context.hpp>
+#include <asio/ip/tcp.hpp>
+#include <asio/ip/udp.hpp>
+#include <chrono>
+#include <cstdint>
+#include <garak/resolver.hpp>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+using asio::ip::tcp;
+using asio::ip::udp;
+
+namespace {
+/**
+ * @brief Answers A queries with 10.0.0.1 and AAAA with fd00::1, except for
+ * names starting "missing", which don't exist
+ * */
+class stub_dns {
+ public:
+  explicit stub_dns(asio::io_context& ctx)
+      : socket_(ctx, udp::endpoint(asio::ip::address_v4::loopback(), 0)) {
+    receive();
+  }
+
+  udp::endpoint endpoint() const { return socket_.local_endpoint(); }
+
+  std::map<std::string, int> queries;
+  std::uint32_t ttl{300};
+
+ private:
+  void receive() {
+    socket_.async_receive_from(
+        asio::buffer(buffer_), sender_,
+        [this](asio::error_code ec, std::size_t n) {
+          if (ec) {
+            return;
+          }
+          answer(n);
+          receive();
+        });
+  }
+
+  void answer(std::size_t n) {
+    // The question's name, as dot separated labels
+    std::string name;
+    std::size_t at = 12;
+    while (at < n && buffer_[at] != 0) {
+      if (!name.empty()) {
+        name += '.';
+      }
+      name.append(reinterpret_cast<const char*>(&buffer_[at + 1]),
+                  std::size_t{buffer_[at]});
+      at += std::size_t{1} + buffer_[at];
+    }
+    const std::size_t question_end = at + 5;
+    const auto type = buffer_[at + 2];
+    ++queries[name];
+
+    std::vector<std::uint8_t> reply(buffer_.begin(),
+                                    buffer_.begin() + question_end);
+    auto put16 = [&reply](std::uint16_t value) {
+      reply.push_back(static_cast<std::uint8_t>(value >> 8));
+      reply.push_back(static_cast<std::uint8_t>(value));
+    };
+    auto put32 = [&](std::uint32_t value) {
+      put16(static_cast<std::uint16_t>(value >> 16));
+      put16(static_cast<std::uint16_t>(value));
+    };
+    const bool missing = name.rfind("missing", 0) == 0;
+    reply[2] = 0x81;
+    reply[3] = missing ? 0x83 : 0x80;
+    if (missing) {
+      // SOA: TTL 60, minimum 2
+      reply[9] = 1;
+      put16(0xC00C);
+      put16(6);
+      put16(1);
+      put32(60);
+      put16(22);
+      reply.push_back(0);
+      reply.push_back(0);
+      for (std::uint32_t field : {1U, 2U, 3U, 4U, 2U}) {
+        put32(field);
+      }
+    } else {
+      reply[7] = 1;
+      put16(0xC00C);
+      put16(type);
+      put16(1);
+      put32(ttl);
+      if (type == 1) {
+        put16(4);
+        reply.insert(reply.end(), {10, 0, 0, 1});
+      } else {
+        put16(16);
+        const auto bytes =
+            asio::ip::make_address_v6("fd00::1").to_bytes();
+        reply.insert(reply.end(), bytes.begin(), bytes.end());
+      }
+    }
+    socket_.send_to(asio::buffer(reply), sender_);
+  }
+
+  udp::socket socket_;
+  udp::endpoint sender_;
+  std::array<std::uint8_t, 512> buffer_{};
+};
+
+garak::resolver_options stub_options(const stub_dns& stub) {
+  garak::resolver_options options;
+  options.nameservers = {stub.endpoint()};
+  options.query_timeout = 200ms;
+  options.attempts = 1;
+  return options;
+}
+
+template <typename Predicate>
+void run_until(asio::io_context& ctx, Predicate done) {
+  const auto deadline = std::chrono::steady_clock::now() + 5s;
+  while (!done() && std::chrono::steady_clock::now() < deadline) {
+    if (ctx.stopped()) {
+      ctx.restart();
+    }
+    ctx.run_one_for(10ms);
+  }
+}
+
+struct outcome {
+  asio::error_code ec;
+  std::vector<tcp::endpoint> endpoints;
+};
+
+template <typename Resolver>
+std::optional<outcome> resolve(asio::io_context& ctx, Resolver& resolver,
+                               const std::string& host,
+                               const std::string& service) {
+  std::optional<outcome> result;
+  resolver.async_resolve(host, service,
+                         [&](asio::error_code ec, const auto& results) {
+                           result.emplace();
+                           result->ec = ec;
+                           for (const auto& entry : results) {
+                             result->endpoints.push_back(entry.endpoint());
+                           }
+                         });
+  run_until(ctx, [&] { return result.has_value(); });
+  return result;
+}
+}  // namespace
+
+/**
+ * @brief Queries encode as expected, and replies are matched to them and
+ * decoded through compression pointers
+ * */
+TEST(ResolverTest, DnsMessages) {
+  using garak::detail::dns_type;
+  const auto query =
+      garak::detail::encode_dns_query(0x1234, "Www.Example.", dns_type::a);
+  const std::vector<std::uint8_t> expected{
+      0x12, 0x34, 0x01, 0x00, 0, 1, 0, 0, 0, 0, 0, 0, 3, 'W', 'w', 'w',
+      7,    'E',  'x',  'a',  'm', 'p', 'l', 'e', 0, 0, 1, 0, 1};
+  EXPECT_EQ(expected, query);
+  EXPECT_TRUE(garak::detail::encode_dns_query(1, "a..b", dns_type::a).empty());
+  EXPECT_TRUE(garak::detail::encode_dns_query(1, "", dns_type::a).empty());
+
+  // A CNAME to cdn.example, then its A record, named by pointers
+  auto reply = query;
+  reply[2] = 0x81;
+  reply[3] = 0x80;
+  reply[7] = 2;
+  const std::vector<std::uint8_t> answers{
+      0xC0, 0x0C, 0, 5, 0, 1, 0, 0, 0, 100, 0, 6, 3, 'c', 'd', 'n', 0xC0, 0x10,
+      0xC0, 0x29, 0, 1, 0, 1, 0, 0, 0, 30,  0, 4, 192, 0, 2, 7};
+  reply.insert(reply.end(), answers.begin(), answers.end());
+  const auto parsed =
+      garak::detail::parse_dns_response(reply, 0x1234, "www.example",
+                                        dns_type::a);
+  ASSERT_TRUE(parsed);
+  EXPECT_EQ(0, parsed->rcode);
+  ASSERT_EQ(1U, parsed->addresses.size());
+  EXPECT_EQ(asio::ip::make_address("192.0.2.7"), parsed->addresses[0]);
+  EXPECT_EQ(30U, parsed->ttl);
+
+  EXPECT_FALSE(garak::detail::parse_dns_response(reply, 0x4321, "www.example",
+                                                 dns_type::a));
+  EXPECT_FALSE(garak::detail::parse_dns_response(reply, 0x1234, "www.example",
+                                                 dns_type::aaaa));
+  // A pointer to itself
+  reply[reply.size() - 16] = 0xC0;
+  reply[reply.size() - 15] =
+      static_cast<std::uint8_t>(reply.size() - 16);
+  EXPECT_FALSE(garak::detail::parse_dns_response(reply, 0x1234, "www.example",
+                                                 dns_type::a));
+}
+
+/**
+ * @brief Concurrent resolves of one name share a single lookup, and later
+ * ones are answered from the cache
+ * */
+TEST(ResolverTest, CachesAndCoalesces) {
+  asio::io_context ctx;
+  stub_dns stub{ctx};
+  garak::caching_resolver resolver{ctx.get_executor(), stub_options(stub)};
+
+  std::vector<outcome> outcomes;
+  for (int i = 0; i < 10; ++i) {
+    resolver.async_resolve(
+        "Service.Test.", "8080",
+        [&](asio::error_code ec, const garak::caching_resolver::results_type&
+                                     results) {
+          auto& o = outcomes.emplace_back();
+          o.ec = ec;
+          for (const auto& entry : results) {
+            o.endpoints.push_back(entry.endpoint());
+          }
+        });
+  }
+  run_until(ctx, [&] { return outcomes.size() == 10; });
+  ASSERT_EQ(10U, outcomes.size());
+  const std::vector<tcp::endpoint> expected{
+      {asio::ip::make_address("fd00::1"), 8080},
+      {asio::ip::make_address("10.0.0.1"), 8080}};
+  for (const auto& o : outcomes) {
+    EXPECT_FALSE(o.ec);
+    EXPECT_EQ(expected, o.endpoints);
+  }
+  // One A and one AAAA query
+  EXPECT_EQ(2, stub.queries["service.test"]);
+
+  const auto again = resolve(ctx, resolver, "service.test", "http");
+  ASSERT_TRUE(again);
+  EXPECT_FALSE(again->ec);
+  EXPECT_EQ(80, again->endpoints.at(0).port());
+  EXPECT_EQ(2, stub.queries["service.test"]);
+
+  const auto stats = resolver.stats();
+  EXPECT_EQ(1U, stats.misses);
+  EXPECT_EQ(9U, stats.coalesced);
+  EXPECT_EQ(1U, stats.hits);
+  EXPECT_EQ(1U, stats.entries);
+}
+
+/**
+ * @brief Answers are looked up again once their TTL, as clamped, runs out
+ * */
+TEST(ResolverTest, Expiry) {
+  asio::io_context ctx;
+  stub_dns stub{ctx};
+  auto options = stub_options(stub);
+  options.max_ttl = 50ms;
+  garak::caching_resolver resolver{ctx.get_executor(), options};
+
+  ASSERT_FALSE(resolve(ctx, resolver, "short.test", "1")->ec);
+  ASSERT_FALSE(resolve(ctx, resolver, "short.test", "1")->ec);
+  EXPECT_EQ(2, stub.queries["short.test"]);
+  std::this_thread::sleep_for(60ms);
+  ASSERT_FALSE(resolve(ctx, resolver, "short.test", "1")->ec);
+  EXPECT_EQ(4, stub.queries["short.test"]);
+}
+
+/**
+ * @brief A name that doesn't exist fails, and so does asking again for a
+ * while, without a second lookup
+ * */
+TEST(ResolverTest, NegativeCaching) {
+  asio::io_context ctx;
+  stub_dns stub{ctx};
+  garak::caching_resolver resolver{ctx.get_executor(), stub_options(stub)};
+
+  for (int i = 0; i < 2; ++i) {
+    const auto result = resolve(ctx, resolver, "missing.test", "1");
+    ASSERT_TRUE(result);
+    EXPECT_EQ(asio::error::host_not_found, result->ec);
+  }
+  EXPECT_EQ(2, stub.queries["missing.test"]);
+  EXPECT_EQ(1U, resolver.stats().hits);
+}
+
+/**
+ * @brief Only addresses of the asked for family are returned
+ * */
+TEST(ResolverTest, Family) {
+  asio::io_context ctx;
+  stub_dns stub{ctx};
+  garak::caching_resolver resolver{ctx.get_executor(), stub_options(stub)};
+
+  std::optional<std::vector<tcp::endpoint>> endpoints;
+  resolver.async_resolve(
+      tcp::v4(), "family.test", "1",
+      [&](asio::error_code ec,
+          const garak::caching_resolver::results_type& results) {
+        EXPECT_FALSE(ec);
+        endpoints.emplace();
+        for (const auto& entry : results) {
+          endpoints->push_back(entry.endpoint());
+        }
+      });
+  run_until(ctx, [&] { return endpoints.has_value(); });
+  ASSERT_TRUE(endpoints);
+  ASSERT_EQ(1U, endpoints->size());
+  EXPECT_TRUE(endpoints->front().address().is_v4());
+}
+
+/**
+ * @brief A server that never answers times out, and destroying the
+ * resolver aborts resolves still waiting
+ * */
+TEST(ResolverTest, SilentServer) {
+  asio::io_context ctx;
+  udp::socket silent{ctx, udp::endpoint(asio::ip::address_v4::loopback(), 0)};
+  garak::resolver_options options;
+  options.nameservers = {silent.local_endpoint()};
+  options.query_timeout = 50ms;
+  options.attempts = 1;
+
+  {
+    garak::caching_resolver resolver{ctx.get_executor(), options};
+    const auto result = resolve(ctx, resolver, "slow.test", "1");
+    ASSERT_TRUE(result);
+    EXPECT_EQ(asio::error::host_not_found_try_again, result->ec);
+  }
+
+  std::optional<asio::error_code> aborted;
+  {
+    garak::caching_resolver resolver{ctx.get_executor(), options};
+    resolver.async_resolve(
+        "other.test", "1",
+        [&](asio::error_code ec, const auto&) { aborted = ec; });
+  }
+  run_until(ctx, [&] { return aborted.has_value(); });
+  EXPECT_EQ(asio::error::operation_aborted, aborted);
+}
+
+/**
+ * @brief Without nameservers lookups go through getaddrinfo, and address
+ * literals and bad services never reach it
+ * */
+TEST(ResolverTest, GetAddrInfo) {
+  asio::io_context ctx;
+  garak::resolver_options options;
+  options.threads = 2;
+  garak::caching_resolver resolver{ctx.get_executor(), options};
+
+  const auto literal = resolve(ctx, resolver, "::1", "443");
+  ASSERT_TRUE(literal);
+  EXPECT_FALSE(literal->ec);
+  ASSERT_EQ(1U, literal->endpoints.size());
+  EXPECT_EQ(tcp::endpoint(asio::ip::address_v6::loopback(), 443),
+            literal->endpoints[0]);
+
+  const auto bad = resolve(ctx, resolver, "localhost", "no-such-service");
+  ASSERT_TRUE(bad);
+  EXPECT_EQ(asio::error::service_not_found, bad->ec);
+  EXPECT_EQ(0U, resolver.stats().misses);
+
+  for (int i = 0; i < 2; ++i) {
+    const auto local = resolve(ctx, resolver, "localhost", "80");
+    ASSERT_TRUE(local);
+    ASSERT_FALSE(local->ec) << local->ec.message();
+    ASSERT_FALSE(local->endpoints.empty());
+    for (const auto& endpoint : local->endpoints) {
+      EXPECT_TRUE(endpoint.address().is_loopback());
+      EXPECT_EQ(80, endpoint.port());
+    }
+  }
+  EXPECT_EQ(1U, resolver.stats().misses);
+  EXPECT_EQ(1U, resolver.stats().hits);
+}
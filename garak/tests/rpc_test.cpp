@@ -0,0 +1,220 @@
+#include <gtest/gtest.h>
+
+#include <asio/as_tuple.hpp>
+#include <asio/bind_cancellation_slot.hpp>
+#include <asio/steady_timer.hpp>
+#include <garak/frame.hpp>
+#include <garak/rpc.hpp>
+#include <string>
+#include <vector>
+
+#include "loopback.hpp"
+
+namespace {
+using namespace std::chrono_literals;
+using tcp_frames = garak::framed_stream<asio::ip::tcp::socket>;
+
+constexpr garak::rpc_method echo = 1;
+constexpr garak::rpc_method delayed_echo = 2;
+constexpr garak::rpc_method stall = 3;
+
+std::vector<std::byte> bytes(std::string_view text) {
+  const auto* data = reinterpret_cast<const std::byte*>(text.data());
+  return {data, data + text.size()};
+}
+
+std::string text(const std::vector<std::byte>& body) {
+  return {reinterpret_cast<const char*>(body.data()), body.size()};
+}
+
+/**
+ * @brief Echoes, optionally after the number of milliseconds in the body
+ * */
+struct test_handler {
+  bool* stall_cancelled;
+
+  asio::awaitable<std::vector<std::byte>> operator()(
+      garak::rpc_method method, std::vector<std::byte> request) const {
+    auto executor = co_await asio::this_coro::executor;
+    if (method == delayed_echo) {
+      const auto delay = std::chrono::milliseconds(std::stoi(text(request)));
+      asio::steady_timer timer{executor, delay};
+      co_await timer.async_wait(asio::use_awaitable);
+      co_return request;
+    }
+    if (method == stall) {
+      asio::steady_timer timer{executor, 10s};
+      auto [ec] =
+          co_await timer.async_wait(asio::as_tuple(asio::use_awaitable));
+      *stall_cancelled = ec == asio::error::operation_aborted;
+      co_return request;
+    }
+    if (method == echo) {
+      co_return request;
+    }
+    throw std::system_error(garak::rpc_errc::unknown_method);
+  }
+};
+
+struct rpc_fixture {
+  explicit rpc_fixture(asio::io_context& ctx)
+      : rpc_fixture(garak::test::connected_pair(ctx)) {}
+
+  explicit rpc_fixture(
+      std::pair<asio::ip::tcp::socket, asio::ip::tcp::socket> sockets)
+      : client(tcp_frames{std::move(sockets.first)}),
+        server(tcp_frames{std::move(sockets.second)},
+               test_handler{&stall_cancelled}) {
+    client.start();
+    server.start();
+  }
+
+  bool stall_cancelled{false};
+  garak::rpc_client<tcp_frames> client;
+  garak::rpc_server<tcp_frames, test_handler> server;
+};
+}  // namespace
+
+/**
+ * @brief Many calls share one connection, and slow requests do not hold up
+ * fast ones behind them
+ * */
+TEST(RpcTest, OutOfOrderResponses) {
+  asio::io_context ctx;
+  rpc_fixture rpc{ctx};
+
+  std::vector<std::string> completed;
+  auto call = [&](std::string delay) {
+    rpc.client.async_call(
+        delayed_echo, bytes(delay),
+        [&completed, delay](asio::error_code ec, std::vector<std::byte> body) {
+          EXPECT_FALSE(ec);
+          EXPECT_EQ(delay, text(body));
+          completed.push_back(delay);
+        });
+  };
+  call("60");
+  call("30");
+  call("0");
+  EXPECT_EQ(0U, rpc.client.outstanding());
+
+  asio::co_spawn(
+      ctx,
+      [&]() -> asio::awaitable<void> {
+        for (int i = 0; i < 100; ++i) {
+          auto body = co_await rpc.client.async_call(
+              echo, bytes(std::to_string(i)), asio::use_awaitable);
+          EXPECT_EQ(std::to_string(i), text(body));
+        }
+        completed.emplace_back("loop");
+      },
+      asio::detached);
+
+  ASSERT_TRUE(garak::test::run_until(
+      ctx, [&] { return completed.size() == 4; }));
+  EXPECT_EQ("30", completed[completed.size() - 2]);
+  EXPECT_EQ("60", completed.back());
+}
+
+/**
+ * @brief Errors thrown by the handler are reported to the caller
+ * */
+TEST(RpcTest, RemoteErrors) {
+  asio::io_context ctx;
+  rpc_fixture rpc{ctx};
+
+  asio::error_code result;
+  rpc.client.async_call(42, {},
+                        [&](asio::error_code ec, std::vector<std::byte>) {
+                          result = ec;
+                        });
+  ASSERT_TRUE(garak::test::run_until(ctx, [&] { return !!result; }));
+  EXPECT_EQ(garak::rpc_errc::unknown_method, result);
+}
+
+/**
+ * @brief A call past its deadline fails, and the server handler is told to
+ * give up
+ * */
+TEST(RpcTest, Deadline) {
+  asio::io_context ctx;
+  rpc_fixture rpc{ctx};
+
+  asio::error_code result;
+  rpc.client.async_call(
+      stall, {}, 20ms,
+      [&](asio::error_code ec, std::vector<std::byte>) { result = ec; });
+  ASSERT_TRUE(garak::test::run_until(
+      ctx, [&] { return result && rpc.stall_cancelled; }));
+  EXPECT_EQ(asio::error::timed_out, result);
+  EXPECT_EQ(0U, rpc.server.in_flight());
+}
+
+/**
+ * @brief Calls honour the cancellation slot bound to their token
+ * */
+TEST(RpcTest, Cancellation) {
+  asio::io_context ctx;
+  rpc_fixture rpc{ctx};
+
+  asio::cancellation_signal signal;
+  asio::error_code result;
+  rpc.client.async_call(
+      stall, {},
+      asio::bind_cancellation_slot(
+          signal.slot(),
+          [&](asio::error_code ec, std::vector<std::byte>) { result = ec; }));
+
+  asio::steady_timer timer{ctx, 20ms};
+  timer.async_wait([&](asio::error_code) {
+    EXPECT_EQ(1U, rpc.client.outstanding());
+    signal.emit(asio::cancellation_type::terminal);
+  });
+  ASSERT_TRUE(garak::test::run_until(
+      ctx, [&] { return result && rpc.stall_cancelled; }));
+  EXPECT_EQ(asio::error::operation_aborted, result);
+  EXPECT_EQ(0U, rpc.client.outstanding());
+}
+
+/**
+ * @brief Losing the connection fails everything still outstanding
+ * */
+TEST(RpcTest, ConnectionLoss) {
+  asio::io_context ctx;
+  rpc_fixture rpc{ctx};
+
+  asio::error_code result;
+  rpc.client.async_call(stall, {},
+                        [&](asio::error_code ec, std::vector<std::byte>) {
+                          result = ec;
+                        });
+  asio::steady_timer timer{ctx, 20ms};
+  timer.async_wait([&](asio::error_code) { rpc.server.close(); });
+  ASSERT_TRUE(garak::test::run_until(ctx, [&] { return !!result; }));
+  EXPECT_NE(asio::error::timed_out, result);
+}
+
+/**
+ * @brief Closing while a request is being written fails the call, and the
+ * write completing afterwards finds nothing left to send
+ * */
+TEST(RpcTest, CloseWhileWriting) {
+  asio::io_context ctx;
+  rpc_fixture rpc{ctx};
+
+  std::vector<asio::error_code> results;
+  for (int i = 0; i < 3; ++i) {
+    rpc.client.async_call(echo, bytes("hello"),
+                          [&](asio::error_code ec, std::vector<std::byte>) {
+                            results.push_back(ec);
+                          });
+  }
+  rpc.client.close();
+  ASSERT_TRUE(
+      garak::test::run_until(ctx, [&] { return results.size() == 3; }));
+  for (const auto& ec : results) {
+    EXPECT_EQ(asio::error::operation_aborted, ec);
+  }
+  ctx.poll();
+  EXPECT_EQ(0U, rpc.client.outstanding());
+}
@@ -0,0 +1,168 @@
+#include <gtest/gtest.h>
+
+#include <array>
+#include <asio/io_context.hpp>
+#include <asio/read.hpp>
+#include <cstddef>
+#include <cstdio>
+#include <garak/send_file.hpp>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <unistd.h>
+#include <vector>
+
+#include "loopback.hpp"
+
+namespace {
+using file_ptr = std::unique_ptr<std::FILE, decltype(&std::fclose)>;
+
+/**
+ * @brief A temporary file of size bytes counting up from 0, wrapping
+ * */
+file_ptr counting_file(std::size_t size) {
+  file_ptr file{std::tmpfile(), &std::fclose};
+  std::vector<unsigned char> bytes(size);
+  std::iota(bytes.begin(), bytes.end(), 0);
+  std::fwrite(bytes.data(), 1, bytes.size(), file.get());
+  std::fflush(file.get());
+  return file;
+}
+
+struct received {
+  std::optional<std::size_t> sent;
+  std::vector<unsigned char> bytes;
+};
+
+/**
+ * @brief Send from file with async_send_file and read what arrives,
+ * stopping once sending is done and expected bytes are in
+ * */
+template <typename File>
+received send_and_read(asio::io_context& ctx, File& file, off_t offset,
+                       std::size_t length, std::size_t expected) {
+  auto [client, server] = garak::test::connected_pair(ctx);
+  received r;
+  r.bytes.resize(expected);
+  std::optional<std::size_t> read;
+  garak::async_send_file(client, file, offset, length,
+                         [&](asio::error_code ec, std::size_t n) {
+                           EXPECT_FALSE(ec) << ec.message();
+                           r.sent = n;
+                         });
+  asio::async_read(server, asio::buffer(r.bytes),
+                   [&](asio::error_code ec, std::size_t n) {
+                     EXPECT_FALSE(ec) << ec.message();
+                     read = n;
+                   });
+  EXPECT_TRUE(garak::test::run_until(
+      ctx, [&] { return r.sent.has_value() && read.has_value(); }));
+  return r;
+}
+
+bool counts_from(const std::vector<unsigned char>& bytes, std::size_t start) {
+  for (std::size_t i = 0; i < bytes.size(); ++i) {
+    if (bytes[i] != static_cast<unsigned char>(start + i)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+struct descriptor_file {
+  int fd;
+  int native_handle() const { return fd; }
+};
+}  // namespace
+
+/**
+ * @brief A file larger than the socket buffers goes out in several
+ * writability rounds and arrives intact
+ * */
+TEST(SendFileTest, LargeFile) {
+  asio::io_context ctx;
+  constexpr std::size_t size = 16 * 1024 * 1024;
+  const auto file = counting_file(size);
+  const int fd = fileno(file.get());
+  const auto r = send_and_read(ctx, fd, 0, size, size);
+  ASSERT_TRUE(r.sent);
+  EXPECT_EQ(size, *r.sent);
+  EXPECT_TRUE(counts_from(r.bytes, 0));
+}
+
+/**
+ * @brief Sending from an offset past which the file is shorter than asked
+ * sends what there is, and leaves the file position alone
+ * */
+TEST(SendFileTest, OffsetAndShortFile) {
+  asio::io_context ctx;
+  const auto file = counting_file(1000);
+  descriptor_file handle{fileno(file.get())};
+  ASSERT_EQ(0, ::lseek(handle.fd, 0, SEEK_SET));
+  const auto r = send_and_read(ctx, handle, 100, 5000, 900);
+  ASSERT_TRUE(r.sent);
+  EXPECT_EQ(900U, *r.sent);
+  EXPECT_TRUE(counts_from(r.bytes, 100));
+  EXPECT_EQ(0, ::lseek(handle.fd, 0, SEEK_CUR));
+
+  const auto past = send_and_read(ctx, handle, 1000, 10, 0);
+  ASSERT_TRUE(past.sent);
+  EXPECT_EQ(0U, *past.sent);
+}
+
+/**
+ * @brief A pipe, which sendfile can't read, is spliced instead
+ * */
+TEST(SendFileTest, FromPipe) {
+  asio::io_context ctx;
+  std::array<int, 2> ends{};
+  ASSERT_EQ(0, ::pipe(ends.data()));
+  std::vector<unsigned char> bytes(40000);
+  std::iota(bytes.begin(), bytes.end(), 0);
+  ASSERT_EQ(static_cast<ssize_t>(bytes.size()),
+            ::write(ends[1], bytes.data(), bytes.size()));
+  ::close(ends[1]);
+
+  const auto r = send_and_read(ctx, ends[0], 0, 100000, bytes.size());
+  ::close(ends[0]);
+  ASSERT_TRUE(r.sent);
+  EXPECT_EQ(bytes.size(), *r.sent);
+  EXPECT_EQ(bytes, r.bytes);
+}
+
+/**
+ * @brief Sending from a pipe the writer hasn't filled yet waits for the
+ * data rather than failing
+ * */
+TEST(SendFileTest, FromPipeBeforeData) {
+  asio::io_context ctx;
+  std::array<int, 2> ends{};
+  ASSERT_EQ(0, ::pipe(ends.data()));
+  auto [client, server] = garak::test::connected_pair(ctx);
+  std::vector<unsigned char> bytes(3000);
+  std::iota(bytes.begin(), bytes.end(), 0);
+
+  std::optional<asio::error_code> result;
+  std::size_t sent = 0;
+  garak::async_send_file(client, ends[0], 0, bytes.size(),
+                         [&](asio::error_code ec, std::size_t n) {
+                           result = ec;
+                           sent = n;
+                         });
+  ctx.poll();
+  EXPECT_FALSE(result.has_value());
+  for (std::size_t half = 0; half < 2; ++half) {
+    ASSERT_EQ(1500, ::write(ends[1], bytes.data() + half * 1500, 1500));
+    ctx.poll();
+  }
+  ASSERT_TRUE(
+      garak::test::run_until(ctx, [&] { return result.has_value(); }));
+  ASSERT_FALSE(*result) << result->message();
+  EXPECT_EQ(bytes.size(), sent);
+
+  std::vector<unsigned char> arrived(bytes.size());
+  asio::read(server, asio::buffer(arrived));
+  EXPECT_EQ(bytes, arrived);
+  ::close(ends[0]);
+  ::close(ends[1]);
+}
@@ -0,0 +1,407 @@
+#include <gtest/gtest.h>
+
+#include <array>
+#include <asio/co_spawn.hpp>
+#include <asio/detached.hpp>
+#include <asio/io_context.hpp>
+#include <asio/local/connect_pair.hpp>
+#include <asio/use_awaitable.hpp>
+#include <asio/write.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <garak/rpc.hpp>
+#include <garak/shm.hpp>
+#include <optional>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "loopback.hpp"
+
+namespace {
+using unix_socket = asio::local::stream_protocol::socket;
+
+/**
+ * @brief Both ends of a negotiated shm_session pair
+ * */
+struct shm_pair {
+  std::optional<garak::shm_session> client;
+  std::optional<garak::shm_session> server;
+  // The client's unix socket, still open underneath its session
+  int client_socket{-1};
+};
+
+shm_pair negotiate(asio::io_context& ctx, std::size_t ring_size) {
+  unix_socket a{ctx};
+  unix_socket b{ctx};
+  asio::local::connect_pair(a, b);
+  shm_pair pair;
+  pair.client_socket = a.native_handle();
+  garak::shm_options options;
+  options.ring_size = ring_size;
+  garak::async_shm_connect(std::move(a), options,
+                           [&](asio::error_code ec, garak::shm_session s) {
+                             EXPECT_FALSE(ec) << ec.message();
+                             pair.client.emplace(std::move(s));
+                           });
+  garak::async_shm_accept(std::move(b),
+                          [&](asio::error_code ec, garak::shm_session s) {
+                            EXPECT_FALSE(ec) << ec.message();
+                            pair.server.emplace(std::move(s));
+                          });
+  EXPECT_TRUE(garak::test::run_until(
+      ctx, [&] { return pair.client && pair.server; }));
+  return pair;
+}
+
+/**
+ * @brief Play a connecting side by hand: send an offer of 4096 byte rings
+ * over socket, sealed or not, and map the memory it offered
+ * */
+std::byte* forge_offer(unix_socket& socket, bool sealed) {
+  using channel = garak::detail::shm_channel;
+  const auto size = channel::mapping_size(4096);
+  std::array<garak::unique_fd, channel::descriptor_count> owned;
+  owned[0] = garak::unique_fd{::memfd_create("forged", MFD_ALLOW_SEALING)};
+  EXPECT_EQ(0, ::ftruncate(owned[0].get(), static_cast<off_t>(size)));
+  if (sealed) {
+    EXPECT_EQ(0, ::fcntl(owned[0].get(), F_ADD_SEALS, channel::required_seals));
+  }
+  std::array<int, channel::descriptor_count> fds{owned[0].get()};
+  for (std::size_t i = 1; i < fds.size(); ++i) {
+    owned[i] = garak::unique_fd{::eventfd(0, EFD_NONBLOCK)};
+    fds[i] = owned[i].get();
+  }
+  garak::detail::shm_offer offer;
+  offer.ring_size = 4096;
+  const iovec data{&offer, sizeof(offer)};
+  asio::error_code ec;
+  garak::detail::send_with_fds(socket.native_handle(), {&data, 1}, fds, ec);
+  EXPECT_FALSE(ec);
+  void* memory = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                        owned[0].get(), 0);
+  EXPECT_NE(MAP_FAILED, memory);
+  return static_cast<std::byte*>(memory);
+}
+
+std::string payload(std::size_t i) {
+  return std::string(i * 37 % 1500, static_cast<char>('a' + i % 26));
+}
+
+std::string text(std::span<const std::byte> frame) {
+  return {reinterpret_cast<const char*>(frame.data()), frame.size()};
+}
+
+constexpr garak::rpc_method echo = 1;
+
+struct echo_handler {
+  asio::awaitable<std::vector<std::byte>> operator()(
+      garak::rpc_method /*method*/, std::vector<std::byte> request) const {
+    co_return request;
+  }
+};
+}  // namespace
+
+/**
+ * @brief Frames go both ways, with gathered payloads and empty frames
+ * */
+TEST(ShmTest, RoundTrip) {
+  asio::io_context ctx;
+  auto pair = negotiate(ctx, 64 * 1024);
+  ASSERT_TRUE(pair.client && pair.server);
+
+  const std::string head = "hello, ";
+  const std::string tail = "shared memory";
+  const std::array<asio::const_buffer, 2> gathered{asio::buffer(head),
+                                                   asio::buffer(tail)};
+  std::vector<std::string> at_server;
+  std::vector<std::string> at_client;
+  pair.client->async_write_frame(gathered,
+                                 [](asio::error_code ec, std::size_t n) {
+                                   EXPECT_FALSE(ec);
+                                   EXPECT_EQ(20U, n);
+                                 });
+  pair.server->async_read_frame(
+      [&](asio::error_code ec, std::span<const std::byte> frame) {
+        EXPECT_FALSE(ec);
+        at_server.push_back(text(frame));
+        pair.server->async_write_frame(
+            asio::const_buffer{},
+            [](asio::error_code e, std::size_t) { EXPECT_FALSE(e); });
+      });
+  pair.client->async_read_frame(
+      [&](asio::error_code ec, std::span<const std::byte> frame) {
+        EXPECT_FALSE(ec);
+        at_client.push_back(text(frame));
+      });
+  ASSERT_TRUE(garak::test::run_until(
+      ctx, [&] { return at_server.size() == 1 && at_client.size() == 1; }));
+  EXPECT_EQ("hello, shared memory", at_server.front());
+  EXPECT_EQ("", at_client.front());
+}
+
+/**
+ * @brief Far more data than the ring holds, so the writer waits for room
+ * and records wrap around the end, arrives whole and in order
+ * */
+TEST(ShmTest, Backpressure) {
+  asio::io_context ctx;
+  auto pair = negotiate(ctx, 4096);
+  ASSERT_TRUE(pair.client && pair.server);
+  constexpr std::size_t frames = 2000;
+
+  bool written = false;
+  std::size_t read = 0;
+  asio::co_spawn(
+      ctx,
+      [&]() -> asio::awaitable<void> {
+        for (std::size_t i = 0; i < frames; ++i) {
+          const auto message = payload(i);
+          co_await pair.client->async_write_frame(asio::buffer(message),
+                                                  asio::use_awaitable);
+        }
+        written = true;
+      },
+      asio::detached);
+  asio::co_spawn(
+      ctx,
+      [&]() -> asio::awaitable<void> {
+        for (std::size_t i = 0; i < frames; ++i) {
+          const auto frame =
+              co_await pair.server->async_read_frame(asio::use_awaitable);
+          EXPECT_EQ(payload(i), text(frame));
+          ++read;
+        }
+      },
+      asio::detached);
+  ASSERT_TRUE(garak::test::run_until(
+      ctx, [&] { return written && read == frames; }));
+}
+
+/**
+ * @brief A frame bigger than half the ring is refused
+ * */
+TEST(ShmTest, MessageSize) {
+  asio::io_context ctx;
+  auto pair = negotiate(ctx, 4096);
+  ASSERT_TRUE(pair.client && pair.server);
+  EXPECT_EQ(2040U, pair.client->max_frame_size());
+
+  const std::string big(4096, 'x');
+  std::optional<asio::error_code> result;
+  pair.client->async_write_frame(
+      asio::buffer(big),
+      [&](asio::error_code ec, std::size_t) { result = ec; });
+  ASSERT_TRUE(garak::test::run_until(ctx, [&] { return result.has_value(); }));
+  EXPECT_EQ(asio::error::message_size, *result);
+}
+
+/**
+ * @brief After a close the peer still reads what was sent, then the end,
+ * and its writes fail
+ * */
+TEST(ShmTest, Close) {
+  asio::io_context ctx;
+  auto pair = negotiate(ctx, 64 * 1024);
+  ASSERT_TRUE(pair.client && pair.server);
+
+  const std::string last = "last words";
+  bool sent = false;
+  pair.client->async_write_frame(asio::buffer(last),
+                                 [&](asio::error_code ec, std::size_t) {
+                                   EXPECT_FALSE(ec);
+                                   sent = true;
+                                 });
+  ASSERT_TRUE(garak::test::run_until(ctx, [&] { return sent; }));
+  pair.client->close();
+
+  std::vector<std::string> frames;
+  std::optional<asio::error_code> end;
+  std::optional<asio::error_code> write;
+  pair.server->async_read_frame(
+      [&](asio::error_code ec, std::span<const std::byte> frame) {
+        EXPECT_FALSE(ec);
+        frames.push_back(text(frame));
+        pair.server->async_read_frame(
+            [&](asio::error_code e, std::span<const std::byte>) { end = e; });
+      });
+  pair.server->async_write_frame(
+      asio::buffer(last),
+      [&](asio::error_code ec, std::size_t) { write = ec; });
+  ASSERT_TRUE(garak::test::run_until(
+      ctx, [&] { return end.has_value() && write.has_value(); }));
+  ASSERT_EQ(1U, frames.size());
+  EXPECT_EQ(last, frames.front());
+  EXPECT_EQ(asio::error::eof, *end);
+  EXPECT_EQ(asio::error::broken_pipe, *write);
+}
+
+/**
+ * @brief A session destroyed while its read waits ends the read, which
+ * keeps the rings alive until it has
+ * */
+TEST(ShmTest, DestroyedWhileReading) {
+  asio::io_context ctx;
+  auto pair = negotiate(ctx, 4096);
+  ASSERT_TRUE(pair.client && pair.server);
+
+  std::optional<asio::error_code> end;
+  pair.server->async_read_frame(
+      [&](asio::error_code e, std::span<const std::byte>) { end = e; });
+  ctx.poll();
+  pair.server.reset();
+  ASSERT_TRUE(garak::test::run_until(ctx, [&] { return end.has_value(); }));
+  EXPECT_EQ(asio::error::operation_aborted, *end);
+}
+
+/**
+ * @brief A peer that drops the unix socket without closing the rings, as
+ * a crashed process would, ends a waiting read
+ * */
+TEST(ShmTest, PeerGone) {
+  asio::io_context ctx;
+  auto pair = negotiate(ctx, 4096);
+  ASSERT_TRUE(pair.client && pair.server);
+  ::shutdown(pair.client_socket, SHUT_RDWR);
+
+  std::optional<asio::error_code> end;
+  pair.server->async_read_frame(
+      [&](asio::error_code e, std::span<const std::byte>) { end = e; });
+  ASSERT_TRUE(garak::test::run_until(ctx, [&] { return end.has_value(); }));
+  EXPECT_EQ(asio::error::eof, *end);
+}
+
+/**
+ * @brief Garbage instead of an offer is refused
+ * */
+TEST(ShmTest, BadOffer) {
+  asio::io_context ctx;
+  unix_socket a{ctx};
+  unix_socket b{ctx};
+  asio::local::connect_pair(a, b);
+  std::optional<asio::error_code> result;
+  garak::async_shm_accept(
+      std::move(b),
+      [&](asio::error_code ec, garak::shm_session) { result = ec; });
+  const std::array<char, 16> garbage{};
+  asio::write(a, asio::buffer(garbage));
+  ASSERT_TRUE(garak::test::run_until(ctx, [&] { return result.has_value(); }));
+  EXPECT_EQ(asio::error::invalid_argument, *result);
+
+  // Garbage already waiting fails the accept through the executor too
+  unix_socket c{ctx};
+  unix_socket d{ctx};
+  asio::local::connect_pair(c, d);
+  asio::write(c, asio::buffer(garbage));
+  result.reset();
+  garak::async_shm_accept(
+      std::move(d),
+      [&](asio::error_code ec, garak::shm_session) { result = ec; });
+  EXPECT_FALSE(result.has_value());
+  ASSERT_TRUE(garak::test::run_until(ctx, [&] { return result.has_value(); }));
+  EXPECT_EQ(asio::error::invalid_argument, *result);
+}
+
+/**
+ * @brief Connecting to a peer that has already gone fails through the
+ * executor, not from inside the call
+ * */
+TEST(ShmTest, ConnectToClosedPeer) {
+  asio::io_context ctx;
+  unix_socket a{ctx};
+  unix_socket b{ctx};
+  asio::local::connect_pair(a, b);
+  b.close();
+  std::optional<asio::error_code> result;
+  garak::async_shm_connect(
+      std::move(a), garak::shm_options{},
+      [&](asio::error_code ec, garak::shm_session) { result = ec; });
+  EXPECT_FALSE(result.has_value());
+  ASSERT_TRUE(garak::test::run_until(ctx, [&] { return result.has_value(); }));
+  EXPECT_EQ(asio::error::broken_pipe, *result);
+}
+
+/**
+ * @brief Memory that could be truncated under the mapping is refused
+ * */
+TEST(ShmTest, UnsealedMemory) {
+  asio::io_context ctx;
+  unix_socket a{ctx};
+  unix_socket b{ctx};
+  asio::local::connect_pair(a, b);
+  std::optional<asio::error_code> result;
+  garak::async_shm_accept(
+      std::move(b),
+      [&](asio::error_code ec, garak::shm_session) { result = ec; });
+  auto* memory = forge_offer(a, false);
+  ASSERT_TRUE(garak::test::run_until(ctx, [&] { return result.has_value(); }));
+  EXPECT_EQ(asio::error::invalid_argument, *result);
+  ::munmap(memory, garak::detail::shm_channel::mapping_size(4096));
+}
+
+/**
+ * @brief A record the peer claims runs past what it published is refused
+ * rather than read
+ * */
+TEST(ShmTest, RecordPastTail) {
+  asio::io_context ctx;
+  unix_socket a{ctx};
+  unix_socket b{ctx};
+  asio::local::connect_pair(a, b);
+  std::optional<garak::shm_session> server;
+  garak::async_shm_accept(std::move(b),
+                          [&](asio::error_code ec, garak::shm_session s) {
+                            EXPECT_FALSE(ec) << ec.message();
+                            server.emplace(std::move(s));
+                          });
+  auto* memory = forge_offer(a, true);
+  ASSERT_TRUE(garak::test::run_until(ctx, [&] { return server.has_value(); }));
+
+  using channel = garak::detail::shm_channel;
+  const std::uint32_t length = 1000;
+  std::memcpy(memory + 2 * channel::header_stride, &length, sizeof(length));
+  reinterpret_cast<garak::detail::shm_ring_header*>(memory)->tail.store(
+      channel::record_alignment);
+  std::optional<asio::error_code> result;
+  server->async_read_frame(
+      [&](asio::error_code ec, std::span<const std::byte>) { result = ec; });
+  ASSERT_TRUE(garak::test::run_until(ctx, [&] { return result.has_value(); }));
+  EXPECT_EQ(asio::error::invalid_argument, *result);
+  ::munmap(memory, channel::mapping_size(4096));
+}
+
+/**
+ * @brief rpc_client and rpc_server run over shared memory unchanged
+ * */
+TEST(ShmTest, Rpc) {
+  asio::io_context ctx;
+  auto pair = negotiate(ctx, 64 * 1024);
+  ASSERT_TRUE(pair.client && pair.server);
+  garak::rpc_client<garak::shm_session> client{std::move(*pair.client)};
+  garak::rpc_server<garak::shm_session, echo_handler> server{
+      std::move(*pair.server), echo_handler{}};
+  client.start();
+  server.start();
+
+  std::size_t answered = 0;
+  asio::co_spawn(
+      ctx,
+      [&]() -> asio::awaitable<void> {
+        for (std::size_t i = 0; i < 100; ++i) {
+          const auto message = payload(i);
+          const auto* data = reinterpret_cast<const std::byte*>(message.data());
+          auto body = co_await client.async_call(
+              echo, std::vector<std::byte>(data, data + message.size()),
+              asio::use_awaitable);
+          EXPECT_EQ(message, text(body));
+          ++answered;
+        }
+      },
+      asio::detached);
+  ASSERT_TRUE(
+      garak::test::run_until(ctx, [&] { return answered == 100; }));
+}
@@ -0,0 +1,164 @@
+#include <gtest/gtest.h>
+
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <asio/post.hpp>
+#include <atomic>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <garak/threads.hpp>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace {
+/**
+ * @brief A scratch /sys/devices/system describing a machine with two
+ * packages on two nodes, each with one core of two SMT siblings
+ * */
+class fake_sysfs {
+ public:
+  fake_sysfs()
+      : root_(std::filesystem::temp_directory_path() /
+              ("garak_sysfs_" + std::to_string(::getpid()))) {
+    write("cpu/online", "0-3\n");
+    for (int cpu = 0; cpu < 4; ++cpu) {
+      const auto dir = "cpu/cpu" + std::to_string(cpu) + "/topology/";
+      write(dir + "physical_package_id", std::to_string(cpu / 2));
+      write(dir + "core_id", "0");
+    }
+    write("node/online", "0-1\n");
+    write("node/node0/cpulist", "0-1\n");
+    write("node/node1/cpulist", "2-3\n");
+  }
+
+  ~fake_sysfs() { std::filesystem::remove_all(root_); }
+
+  fake_sysfs(const fake_sysfs&) = delete;
+  fake_sysfs& operator=(const fake_sysfs&) = delete;
+
+  [[nodiscard]] const std::filesystem::path& root() const { return root_; }
+
+ private:
+  void write(const std::string& file, const std::string& text) {
+    const auto path = root_ / file;
+    std::filesystem::create_directories(path.parent_path());
+    std::ofstream{path} << text;
+  }
+
+  std::filesystem::path root_;
+};
+
+std::string thread_name() {
+  std::array<char, 16> name{};
+  ::pthread_getname_np(::pthread_self(), name.data(), name.size());
+  return name.data();
+}
+}  // namespace
+
+TEST(ThreadsTest, ParseCpuList) {
+  EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 8, 10, 11}),
+            garak::parse_cpu_list("0-3,8,10-11\n"));
+  EXPECT_TRUE(garak::parse_cpu_list("").empty());
+  EXPECT_THROW(garak::parse_cpu_list("3-1"), std::invalid_argument);
+  EXPECT_THROW(garak::parse_cpu_list("x"), std::invalid_argument);
+}
+
+/**
+ * @brief Cores, packages and nodes read from sysfs
+ * */
+TEST(ThreadsTest, Topology) {
+  const fake_sysfs sysfs;
+  const auto topology = garak::cpu_topology::read(sysfs.root());
+  ASSERT_EQ(4U, topology.cpus().size());
+  EXPECT_EQ(2U, topology.nodes());
+  EXPECT_EQ(1, topology.node_of(3));
+  EXPECT_EQ(-1, topology.node_of(7));
+  EXPECT_EQ((std::vector<int>{0, 2}), topology.physical_cores());
+}
+
+/**
+ * @brief Threads go one per physical core, wrapping round, each with its
+ * core's node and a name the kernel accepts
+ * */
+TEST(ThreadsTest, Plan) {
+  const fake_sysfs sysfs;
+  const auto topology = garak::cpu_topology::read(sysfs.root());
+  garak::thread_options options;
+  options.threads = 3;
+  options.name = "a-rather-long-name";
+  options.placement = garak::cpu_placement::physical_cores;
+  const auto slots = garak::plan_threads(options, topology);
+  ASSERT_EQ(3U, slots.size());
+  EXPECT_EQ(0, slots[0].cpu);
+  EXPECT_EQ(2, slots[1].cpu);
+  EXPECT_EQ(0, slots[2].cpu);
+  EXPECT_EQ(0, slots[0].node);
+  EXPECT_EQ(1, slots[1].node);
+  EXPECT_EQ("a-rather-long-n", slots[1].name);
+
+  options.threads = 0;
+  options.placement = garak::cpu_placement::every_cpu;
+  EXPECT_EQ(4U, garak::plan_threads(options, topology).size());
+
+  options.cpus = {9};
+  EXPECT_THROW(garak::plan_threads(options, topology), std::invalid_argument);
+}
+
+/**
+ * @brief Each pool thread runs its own context, pinned and named
+ * */
+TEST(ThreadsTest, IoContextPool) {
+  garak::thread_options options;
+  options.threads = 2;
+  options.name = "io";
+  options.placement = garak::cpu_placement::every_cpu;
+  garak::io_context_pool pool{options};
+  pool.start();
+  ASSERT_EQ(2U, pool.size());
+
+  std::mutex mutex;
+  std::vector<std::string> names;
+  std::atomic<int> pinned{0};
+  for (std::size_t i = 0; i < pool.size(); ++i) {
+    asio::post(pool.context(i), [&, i] {
+      const std::lock_guard lock{mutex};
+      names.push_back(thread_name());
+      if (::sched_getcpu() == pool.slot(i).cpu) {
+        ++pinned;
+      }
+    });
+  }
+  pool.release();
+  pool.join();
+  std::sort(names.begin(), names.end());
+  EXPECT_EQ((std::vector<std::string>{"io-0", "io-1"}), names);
+  EXPECT_EQ(2, pinned.load());
+}
+
+/**
+ * @brief A thread that can't be placed fails the launch, and none of the
+ * others run
+ * */
+TEST(ThreadsTest, LaunchFailure) {
+  garak::thread_slot good;
+  good.name = "good";
+  garak::thread_slot bad;
+  bad.index = 1;
+  bad.name = "bad";
+  bad.cpu = CPU_SETSIZE - 1;
+  std::atomic<int> ran{0};
+  garak::thread_group group;
+  EXPECT_THROW(
+      group.launch({good, bad}, [&](const garak::thread_slot&) { ++ran; }),
+      std::system_error);
+  EXPECT_EQ(0, ran.load());
+  EXPECT_EQ(0U, group.size());
+}
@@ -0,0 +1,382 @@
+#include <gtest/gtest.h>
+
+#include <asio/as_tuple.hpp>
+#include <asio/co_spawn.hpp>
+#include <asio/read.hpp>
+#include <asio/thread_pool.hpp>
+#include <asio/ssl/stream.hpp>
+#include <asio/use_awaitable.hpp>
+#include <asio/write.hpp>
+#include <garak/tls_stream.hpp>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <numeric>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "certificate.hpp"
+#include "loopback.hpp"
+
+namespace {
+using tcp = asio::ip::tcp;
+using tls_socket = garak::tls_stream<tcp::socket>;
+
+struct tls_contexts {
+  tls_contexts() {
+    garak::test::use_self_signed(server);
+    client.set_verify_mode(asio::ssl::verify_none);
+  }
+
+  asio::ssl::context server{asio::ssl::context::tls_server};
+  asio::ssl::context client{asio::ssl::context::tls_client};
+};
+
+/**
+ * @brief Run op on ctx until it finishes, rethrowing what it throws
+ * */
+void run(asio::io_context& ctx, asio::awaitable<void> op) {
+  bool done = false;
+  asio::co_spawn(ctx, std::move(op), [&](const std::exception_ptr& error) {
+    done = true;
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  });
+  ASSERT_TRUE(garak::test::run_until(ctx, [&] { return done; }));
+}
+
+/**
+ * @brief Handshake both ends of a connected pair
+ * */
+template <typename Server, typename Client>
+void handshake(asio::io_context& ctx, Server& server, Client& client) {
+  int done = 0;
+  auto count = [&](const asio::error_code& ec) {
+    EXPECT_FALSE(ec) << ec.message();
+    ++done;
+  };
+  server.async_handshake(asio::ssl::stream_base::server, count);
+  client.async_handshake(asio::ssl::stream_base::client, count);
+  ASSERT_TRUE(garak::test::run_until(ctx, [&] { return done == 2; }));
+}
+}  // namespace
+
+/**
+ * @brief Bulk data crosses intact, with the socket's send buffer filling up
+ * along the way, and a shutdown reads as end of stream
+ * */
+TEST(TlsStreamTest, RoundTrip) {
+  asio::io_context ctx;
+  tls_contexts tls;
+  auto [a, b] = garak::test::connected_pair(ctx);
+  tls_socket server{std::move(a), tls.server};
+  tls_socket client{std::move(b), tls.client};
+  handshake(ctx, server, client);
+
+  std::vector<unsigned char> sent(4 << 20);
+  std::iota(sent.begin(), sent.end(), 0);
+  std::vector<unsigned char> received(sent.size());
+  std::optional<asio::error_code> shutdown;
+  asio::async_write(client, asio::buffer(sent),
+                    [&](asio::error_code ec, std::size_t n) {
+                      EXPECT_FALSE(ec);
+                      EXPECT_EQ(sent.size(), n);
+                      client.async_shutdown(
+                          [&](asio::error_code e) { shutdown = e; });
+                    });
+  run(ctx, [&]() -> asio::awaitable<void> {
+    co_await asio::async_read(server, asio::buffer(received),
+                              asio::use_awaitable);
+    std::array<char, 1> more{};
+    auto [ec, n] = co_await server.async_read_some(
+        asio::buffer(more), asio::as_tuple(asio::use_awaitable));
+    EXPECT_EQ(asio::error::eof, ec);
+    EXPECT_EQ(0U, n);
+    co_await server.async_shutdown(asio::use_awaitable);
+  }());
+  EXPECT_EQ(sent, received);
+  ASSERT_TRUE(
+      garak::test::run_until(ctx, [&] { return shutdown.has_value(); }));
+  EXPECT_FALSE(*shutdown);
+}
+
+/**
+ * @brief Interoperates with asio::ssl::stream in both roles
+ * */
+TEST(TlsStreamTest, AsioPeer) {
+  asio::io_context ctx;
+  tls_contexts tls;
+  auto [a, b] = garak::test::connected_pair(ctx);
+  asio::ssl::stream<tcp::socket> server{std::move(a), tls.server};
+  tls_socket client{std::move(b), tls.client};
+  handshake(ctx, server, client);
+
+  run(ctx, [&]() -> asio::awaitable<void> {
+    co_await asio::async_write(client, asio::buffer("ping", 4),
+                               asio::use_awaitable);
+    std::array<char, 4> request{};
+    co_await asio::async_read(server, asio::buffer(request),
+                              asio::use_awaitable);
+    EXPECT_EQ(0, std::memcmp(request.data(), "ping", 4));
+    co_await asio::async_write(server, asio::buffer("pong", 4),
+                               asio::use_awaitable);
+    std::array<char, 4> reply{};
+    co_await asio::async_read(client, asio::buffer(reply),
+                              asio::use_awaitable);
+    EXPECT_EQ(0, std::memcmp(reply.data(), "pong", 4));
+  }());
+}
+
+/**
+ * @brief The synchronous calls finish what is ready and report would_block
+ * for the rest when non-blocking
+ * */
+TEST(TlsStreamTest, NonBlocking) {
+  asio::io_context ctx;
+  tls_contexts tls;
+  auto [a, b] = garak::test::connected_pair(ctx);
+  tls_socket server{std::move(a), tls.server};
+  tls_socket client{std::move(b), tls.client};
+  handshake(ctx, server, client);
+
+  asio::error_code ec;
+  client.non_blocking(true, ec);
+  ASSERT_FALSE(ec);
+  std::array<char, 8> buffer{};
+  // TLS 1.3 session tickets are the only thing waiting
+  EXPECT_EQ(0U, client.read_some(asio::buffer(buffer), ec));
+  EXPECT_EQ(asio::error::would_block, ec);
+
+  EXPECT_EQ(2U, server.write_some(asio::buffer("hi", 2), ec));
+  ASSERT_FALSE(ec);
+  ec = asio::error::would_block;
+  std::size_t n = 0;
+  while (n == 0 && ec == asio::error::would_block) {
+    client.lowest_layer().wait(tcp::socket::wait_read);
+    n = client.read_some(asio::buffer(buffer), ec);
+  }
+  EXPECT_FALSE(ec);
+  EXPECT_EQ(2U, n);
+  EXPECT_EQ(0, std::memcmp(buffer.data(), "hi", 2));
+}
+
+/**
+ * @brief A peer that drops the connection without close_notify truncates
+ * the stream rather than ending it
+ * */
+TEST(TlsStreamTest, Truncated) {
+  asio::io_context ctx;
+  tls_contexts tls;
+  auto [a, b] = garak::test::connected_pair(ctx);
+  tls_socket server{std::move(a), tls.server};
+  tls_socket client{std::move(b), tls.client};
+  handshake(ctx, server, client);
+  server.lowest_layer().close();
+
+  std::optional<asio::error_code> result;
+  std::array<char, 8> buffer{};
+  client.async_read_some(asio::buffer(buffer),
+                         [&](asio::error_code ec, std::size_t) {
+                           result = ec;
+                         });
+  ASSERT_TRUE(
+      garak::test::run_until(ctx, [&] { return result.has_value(); }));
+  EXPECT_EQ(asio::ssl::error::stream_truncated, *result);
+}
+
+namespace {
+// Threads the server's handshake steps ran on, written from OpenSSL's
+// info callback
+std::mutex handshake_threads_mutex;
+std::set<std::thread::id> handshake_threads;
+
+void note_handshake_thread(const SSL* /*ssl*/, int where, int /*ret*/) {
+  if ((where & SSL_CB_LOOP) != 0) {
+    const std::scoped_lock lock{handshake_threads_mutex};
+    handshake_threads.insert(std::this_thread::get_id());
+  }
+}
+}  // namespace
+
+/**
+ * @brief Offloaded handshake steps run on the pool, the completion and
+ * later reads and writes on the stream's own executor
+ * */
+TEST(TlsStreamTest, OffloadedHandshake) {
+  asio::io_context ctx;
+  asio::thread_pool pool{1};
+  tls_contexts tls;
+  SSL_CTX_set_info_callback(tls.server.native_handle(),
+                            &note_handshake_thread);
+  handshake_threads.clear();
+  auto [a, b] = garak::test::connected_pair(ctx);
+  tls_socket server{std::move(a), tls.server};
+  tls_socket client{std::move(b), tls.client};
+  server.offload_handshake(pool.get_executor());
+
+  const auto io_thread = std::this_thread::get_id();
+  int done = 0;
+  auto on_io_thread = [&](const asio::error_code& ec) {
+    EXPECT_FALSE(ec) << ec.message();
+    EXPECT_EQ(io_thread, std::this_thread::get_id());
+    ++done;
+  };
+  server.async_handshake(asio::ssl::stream_base::server, on_io_thread);
+  client.async_handshake(asio::ssl::stream_base::client, on_io_thread);
+  ASSERT_TRUE(garak::test::run_until(ctx, [&] { return done == 2; }));
+  {
+    const std::scoped_lock lock{handshake_threads_mutex};
+    EXPECT_EQ(1U, handshake_threads.size());
+    EXPECT_EQ(0U, handshake_threads.count(io_thread));
+  }
+
+  run(ctx, [&]() -> asio::awaitable<void> {
+    co_await asio::async_write(client, asio::buffer("ping", 4),
+                               asio::use_awaitable);
+    std::array<char, 4> request{};
+    co_await asio::async_read(server, asio::buffer(request),
+                              asio::use_awaitable);
+    EXPECT_EQ(0, std::memcmp(request.data(), "ping", 4));
+  }());
+  pool.join();
+}
+
+namespace {
+/**
+ * @brief An unlinked temporary file holding size counting bytes
+ * */
+std::unique_ptr<std::FILE, decltype(&std::fclose)> counting_file(
+    std::size_t size) {
+  std::unique_ptr<std::FILE, decltype(&std::fclose)> file{std::tmpfile(),
+                                                          &std::fclose};
+  std::vector<unsigned char> bytes(size);
+  std::iota(bytes.begin(), bytes.end(), 0);
+  std::fwrite(bytes.data(), 1, bytes.size(), file.get());
+  std::fflush(file.get());
+  return file;
+}
+
+/**
+ * @brief Send 64 KB of a file from client to server with async_sendfile
+ * and check what arrives
+ * */
+void sendfile_round_trip(asio::io_context& ctx, tls_socket& server,
+                         tls_socket& client) {
+  const auto file = counting_file(100000);
+  std::optional<std::size_t> sent;
+  client.async_sendfile(fileno(file.get()), 1000, 65536,
+                        [&](asio::error_code ec, std::size_t n) {
+                          EXPECT_FALSE(ec) << ec.message();
+                          sent = n;
+                        });
+  std::vector<unsigned char> received(65536);
+  run(ctx, [&]() -> asio::awaitable<void> {
+    co_await asio::async_read(server, asio::buffer(received),
+                              asio::use_awaitable);
+  }());
+  ASSERT_TRUE(garak::test::run_until(ctx, [&] { return sent.has_value(); }));
+  EXPECT_EQ(65536U, *sent);
+  for (std::size_t i = 0; i < received.size(); ++i) {
+    ASSERT_EQ(static_cast<unsigned char>(i + 1000), received[i]) << i;
+  }
+}
+}  // namespace
+
+/**
+ * @brief Without kTLS files go through OpenSSL in chunks
+ * */
+TEST(TlsStreamTest, Sendfile) {
+  asio::io_context ctx;
+  tls_contexts tls;
+  auto [a, b] = garak::test::connected_pair(ctx);
+  tls_socket server{std::move(a), tls.server};
+  tls_socket client{std::move(b), tls.client};
+  handshake(ctx, server, client);
+  EXPECT_FALSE(client.ktls_send());
+
+  sendfile_round_trip(ctx, server, client);
+
+  // Past the end of the file there is nothing to send
+  const auto file = counting_file(10);
+  std::optional<std::size_t> sent;
+  client.async_sendfile(fileno(file.get()), 10, 100,
+                        [&](asio::error_code ec, std::size_t n) {
+                          EXPECT_FALSE(ec);
+                          sent = n;
+                        });
+  ASSERT_TRUE(garak::test::run_until(ctx, [&] { return sent.has_value(); }));
+  EXPECT_EQ(0U, *sent);
+
+  // Nor for a zero length, which still completes through the executor
+  sent.reset();
+  client.async_sendfile(fileno(file.get()), 0, 0,
+                        [&](asio::error_code ec, std::size_t n) {
+                          EXPECT_FALSE(ec);
+                          sent = n;
+                        });
+  EXPECT_FALSE(sent.has_value());
+  ASSERT_TRUE(garak::test::run_until(ctx, [&] { return sent.has_value(); }));
+  EXPECT_EQ(0U, *sent);
+}
+
+#if defined(GARAK_HAS_KTLS)
+/**
+ * @brief With kTLS asked for, streams work the same whether or not the
+ * kernel takes over
+ * */
+TEST(TlsStreamTest, KtlsOrFallback) {
+  asio::io_context ctx;
+  tls_contexts tls;
+  auto [a, b] = garak::test::connected_pair(ctx);
+  tls_socket server{std::move(a), tls.server};
+  tls_socket client{std::move(b), tls.client};
+  server.enable_ktls();
+  client.enable_ktls();
+  handshake(ctx, server, client);
+
+  run(ctx, [&]() -> asio::awaitable<void> {
+    co_await asio::async_write(client, asio::buffer("ping", 4),
+                               asio::use_awaitable);
+    std::array<char, 4> request{};
+    co_await asio::async_read(server, asio::buffer(request),
+                              asio::use_awaitable);
+    EXPECT_EQ(0, std::memcmp(request.data(), "ping", 4));
+    co_await asio::async_write(server, asio::buffer("pong", 4),
+                               asio::use_awaitable);
+    std::array<char, 4> reply{};
+    co_await asio::async_read(client, asio::buffer(reply),
+                              asio::use_awaitable);
+    EXPECT_EQ(0, std::memcmp(reply.data(), "pong", 4));
+  }());
+  sendfile_round_trip(ctx, server, client);
+}
+
+/**
+ * @brief The kernel takes over where its tls module is loaded
+ * */
+TEST(TlsStreamTest, KtlsActive) {
+  if (!std::filesystem::exists("/sys/module/tls")) {
+    GTEST_SKIP() << "kernel tls module not loaded";
+  }
+  asio::io_context ctx;
+  tls_contexts tls;
+  auto [a, b] = garak::test::connected_pair(ctx);
+  tls_socket server{std::move(a), tls.server};
+  tls_socket client{std::move(b), tls.client};
+  server.enable_ktls();
+  client.enable_ktls();
+  handshake(ctx, server, client);
+  if (!client.ktls_send()) {
+    GTEST_SKIP() << "OpenSSL built without kTLS or cipher not offloadable";
+  }
+
+  EXPECT_TRUE(server.ktls_send());
+  sendfile_round_trip(ctx, server, client);
+}
+#endif
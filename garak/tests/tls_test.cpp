@@ -0,0 +1,202 @@
+#include <gtest/gtest.h>
+
+#include <asio/co_spawn.hpp>
+#include <asio/detached.hpp>
+#include <asio/read.hpp>
+#include <asio/write.hpp>
+#include <garak/tls.hpp>
+#include <optional>
+#include <vector>
+
+#include "certificate.hpp"
+#include "loopback.hpp"
+
+namespace {
+using tcp = asio::ip::tcp;
+using tls_pool = garak::connection_pool<tcp, garak::tls_connector<tcp>>;
+
+/**
+ * @brief Accepts TLS connections, greets each with one byte and then waits
+ * for the client to go away
+ * */
+struct tls_listener {
+  tls_listener(asio::io_context& ctx, garak::tls_server_context& server)
+      : tls(server),
+        acceptor(ctx, tcp::endpoint{asio::ip::address_v4::loopback(), 0}) {
+    asio::co_spawn(ctx, accept_loop(), asio::detached);
+  }
+
+  asio::awaitable<void> accept_loop() {
+    for (;;) {
+      auto socket = co_await acceptor.async_accept(asio::use_awaitable);
+      asio::co_spawn(acceptor.get_executor(), serve(std::move(socket)),
+                     asio::detached);
+    }
+  }
+
+  asio::awaitable<void> serve(tcp::socket socket) {
+    asio::ssl::stream<tcp::socket> stream{std::move(socket), tls.context()};
+    auto [ec] = co_await stream.async_handshake(
+        asio::ssl::stream_base::server, asio::as_tuple(asio::use_awaitable));
+    if (ec) {
+      co_return;
+    }
+    co_await asio::async_write(stream, asio::buffer("h", 1),
+                               asio::as_tuple(asio::use_awaitable));
+    // Sending close_notify keeps the session resumable however the client
+    // goes away
+    co_await stream.async_shutdown(asio::as_tuple(asio::use_awaitable));
+  }
+
+  std::vector<tcp::endpoint> endpoints() const {
+    return {acceptor.local_endpoint()};
+  }
+
+  garak::tls_server_context& tls;
+  tcp::acceptor acceptor;
+};
+
+/**
+ * @brief A client context that trusts anyone, the certificate is throwaway
+ * */
+asio::ssl::context client_context() {
+  asio::ssl::context ctx{asio::ssl::context::tls_client};
+  ctx.set_verify_mode(asio::ssl::verify_none);
+  return ctx;
+}
+
+/**
+ * @brief Open a fresh pooled connection, read the greeting and close it
+ *
+ * @returns whether the handshake resumed a session
+ * */
+template <typename Pool>
+std::optional<bool> connect_once(asio::io_context& ctx, Pool& pool) {
+  std::optional<bool> resumed;
+  asio::co_spawn(
+      ctx,
+      [&]() -> asio::awaitable<void> {
+        auto lease = co_await pool.acquire();
+        std::array<char, 1> greeting{};
+        co_await asio::async_read(*lease, asio::buffer(greeting),
+                                  asio::use_awaitable);
+        resumed = SSL_session_reused(lease->native_handle()) != 0;
+        lease.discard();
+      },
+      [](const std::exception_ptr& error) {
+        if (error) {
+          std::rethrow_exception(error);
+        }
+      });
+  garak::test::run_until(ctx, [&] { return resumed.has_value(); });
+  return resumed;
+}
+
+struct tls_fixture {
+  explicit tls_fixture(const garak::tls_server_options& options)
+      : server(options),
+        client(client_context()),
+        listener(ctx, server),
+        pool(ctx.get_executor(), listener.endpoints(), {},
+             garak::tls_connector<tcp>{client, "localhost", sessions}) {
+    garak::test::use_self_signed(server.context());
+  }
+
+  asio::io_context ctx;
+  garak::tls_server_context server;
+  asio::ssl::context client;
+  std::shared_ptr<garak::tls_client_sessions> sessions{
+      std::make_shared<garak::tls_client_sessions>()};
+  tls_listener listener;
+  tls_pool pool;
+};
+}  // namespace
+
+/**
+ * @brief Reconnecting clients resume from stateless session tickets
+ * */
+TEST(TlsTest, ResumesWithTickets) {
+  tls_fixture tls{{}};
+
+  EXPECT_EQ(false, connect_once(tls.ctx, tls.pool));
+  EXPECT_EQ(true, connect_once(tls.ctx, tls.pool));
+  EXPECT_EQ(true, connect_once(tls.ctx, tls.pool));
+
+  const auto stats = tls.server.stats();
+  EXPECT_EQ(1U, stats.full_handshakes);
+  EXPECT_EQ(2U, stats.resumed_handshakes);
+  EXPECT_DOUBLE_EQ(2.0 / 3.0, stats.resumption_rate());
+  EXPECT_EQ(2U, tls.sessions->offered());
+  EXPECT_EQ(2U, tls.sessions->resumed());
+}
+
+/**
+ * @brief Connectors of different stream types sharing a client context
+ * each keep their own connections' tickets
+ * */
+TEST(TlsTest, ConnectorsShareContext) {
+  tls_fixture tls{{}};
+  using asio_stream = asio::ssl::stream<tcp::socket>;
+  auto sessions = std::make_shared<garak::tls_client_sessions>();
+  garak::connection_pool<tcp, garak::tls_connector<tcp, asio_stream>> other{
+      tls.ctx.get_executor(), tls.listener.endpoints(), {},
+      garak::tls_connector<tcp, asio_stream>{tls.client, "localhost",
+                                             sessions}};
+
+  EXPECT_EQ(false, connect_once(tls.ctx, tls.pool));
+  EXPECT_EQ(true, connect_once(tls.ctx, tls.pool));
+  EXPECT_EQ(false, connect_once(tls.ctx, other));
+  EXPECT_EQ(true, connect_once(tls.ctx, other));
+  EXPECT_EQ(1U, tls.sessions->resumed());
+  EXPECT_EQ(1U, sessions->resumed());
+}
+
+/**
+ * @brief With tickets off, sessions resume from the server's sharded cache
+ * */
+TEST(TlsTest, ResumesFromCache) {
+  tls_fixture tls{{.session_tickets = false}};
+
+  EXPECT_EQ(false, connect_once(tls.ctx, tls.pool));
+  EXPECT_GT(tls.server.cached_sessions(), 0U);
+  EXPECT_EQ(true, connect_once(tls.ctx, tls.pool));
+  EXPECT_EQ(true, connect_once(tls.ctx, tls.pool));
+
+  const auto stats = tls.server.stats();
+  EXPECT_EQ(1U, stats.full_handshakes);
+  EXPECT_EQ(2U, stats.resumed_handshakes);
+  EXPECT_EQ(2U, stats.cache_hits);
+}
+
+/**
+ * @brief Tickets survive a key rotation while their key is kept, and are
+ * reissued under the current key
+ * */
+TEST(TlsTest, TicketKeyRotation) {
+  tls_fixture tls{{.ticket_keys_kept = 2}};
+
+  EXPECT_EQ(false, connect_once(tls.ctx, tls.pool));
+  tls.server.rotate_ticket_keys();
+  EXPECT_EQ(true, connect_once(tls.ctx, tls.pool));
+  EXPECT_EQ(1U, tls.server.stats().ticket_renewals);
+
+  tls.server.rotate_ticket_keys();
+  tls.server.rotate_ticket_keys();
+  EXPECT_EQ(false, connect_once(tls.ctx, tls.pool));
+  EXPECT_EQ(2U, tls.server.stats().full_handshakes);
+}
+
+/**
+ * @brief Each shard evicts its oldest session when full
+ * */
+TEST(TlsTest, SessionCacheEviction) {
+  garak::detail::tls_session_cache cache{1, 2};
+  cache.store("a", {1});
+  cache.store("b", {2});
+  cache.store("c", {3});
+  EXPECT_FALSE(cache.find("a"));
+  EXPECT_EQ(std::vector<unsigned char>{2}, cache.find("b"));
+  cache.erase("b");
+  EXPECT_FALSE(cache.find("b"));
+  EXPECT_EQ(1U, cache.size());
+}
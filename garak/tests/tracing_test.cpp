@@ -0,0 +1,143 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <asio/io_context.hpp>
+#include <asio/post.hpp>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <garak/tracing.hpp>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+using garak::tracing::event;
+using garak::tracing::event_kind;
+
+std::vector<event> with_id(const garak::tracing::trace& t, std::uint64_t id) {
+  std::vector<event> found;
+  std::copy_if(t.events.begin(), t.events.end(), std::back_inserter(found),
+               [id](const event& e) { return e.id == id; });
+  return found;
+}
+}  // namespace
+
+/**
+ * @brief Events recorded on two threads come back in order, with names and
+ * a working clock conversion, through a serialize round trip
+ * */
+TEST(TracingTest, RecordAndSnapshot) {
+  const auto id = garak::tracing::next_id();
+  garak::tracing::record(event_kind::creation, id, 0, 7, "socket",
+                         "async_receive", "my_function");
+  std::uint64_t other = 0;
+  std::thread{[&] {
+    other = garak::tracing::next_id();
+    garak::tracing::record(event_kind::invocation_begin, other, 104, 12);
+    garak::tracing::record(event_kind::invocation_end, other);
+  }}.join();
+  EXPECT_NE(id, other);
+
+  const auto t = garak::tracing::deserialize(
+      garak::tracing::serialize(garak::tracing::snapshot()));
+  const auto mine = with_id(t, id);
+  ASSERT_EQ(1U, mine.size());
+  EXPECT_EQ("socket", t.name(mine[0].object));
+  EXPECT_EQ("async_receive", t.name(mine[0].op));
+  EXPECT_EQ("my_function", t.name(mine[0].location));
+  EXPECT_EQ(7U, mine[0].extra);
+
+  const auto theirs = with_id(t, other);
+  ASSERT_EQ(2U, theirs.size());
+  EXPECT_EQ(event_kind::invocation_begin, theirs[0].kind);
+  EXPECT_EQ(104U, theirs[0].arg);
+  EXPECT_EQ(event_kind::invocation_end, theirs[1].kind);
+  EXPECT_NE(mine[0].thread, theirs[0].thread);
+  EXPECT_LE(t.to_ns(theirs[0].tsc), t.to_ns(theirs[1].tsc));
+  EXPECT_GE(t.threads.size(), 2U);
+
+  EXPECT_THROW(garak::tracing::deserialize("nonsense"), std::runtime_error);
+}
+
+/**
+ * @brief A full ring keeps the latest events, less the oldest slot which a
+ * writer may be reusing
+ * */
+TEST(TracingTest, RingOverwrites) {
+  garak::tracing::set_ring_capacity(8);
+  std::vector<std::uint64_t> ids;
+  std::thread{[&] {
+    for (int i = 0; i < 20; ++i) {
+      ids.push_back(garak::tracing::next_id());
+      garak::tracing::record(event_kind::operation, ids.back());
+    }
+  }}.join();
+  garak::tracing::set_ring_capacity(std::size_t{1} << 15);
+
+  const auto t = garak::tracing::snapshot();
+  for (std::size_t i = 0; i < ids.size(); ++i) {
+    EXPECT_EQ(i < 13 ? 0U : 1U, with_id(t, ids[i]).size()) << i;
+  }
+}
+
+/**
+ * @brief A signal writes a dump that loads back
+ * */
+TEST(TracingTest, DumpOnSignal) {
+  const auto path =
+      (std::filesystem::temp_directory_path() / "garak_tracing_test.bin")
+          .string();
+  std::filesystem::remove(path);
+  const auto id = garak::tracing::next_id();
+  garak::tracing::record(event_kind::abandoned, id);
+
+  garak::tracing::dump_on_signal(SIGUSR2, path);
+  std::raise(SIGUSR2);
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (!std::filesystem::exists(path) &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  ASSERT_TRUE(std::filesystem::exists(path));
+  EXPECT_EQ(1U, with_id(garak::tracing::load(path), id).size());
+  std::filesystem::remove(path);
+  std::signal(SIGUSR2, SIG_DFL);
+}
+
+/**
+ * @brief With the asio hooks built in, a handler posted from another
+ * handler is traced as its child
+ * */
+TEST(TracingTest, AsioHandlers) {
+#if defined(ASIO_CUSTOM_HANDLER_TRACKING)
+  asio::io_context ctx{1};
+  asio::post(ctx, [&ctx] { asio::post(ctx, [] {}); });
+  ctx.run();
+
+  const auto t = garak::tracing::snapshot();
+  // The last two creations on this thread are ours
+  std::vector<event> created;
+  for (const auto& e : t.events) {
+    if (e.kind == event_kind::creation) {
+      created.push_back(e);
+    }
+  }
+  ASSERT_GE(created.size(), 2U);
+  const auto& parent = created[created.size() - 2];
+  const auto& child = created.back();
+  EXPECT_EQ(parent.id, child.arg);
+  for (const auto& e : {parent, child}) {
+    const auto events = with_id(t, e.id);
+    ASSERT_EQ(3U, events.size());
+    EXPECT_EQ(event_kind::invocation_begin, events[1].kind);
+    EXPECT_EQ(event_kind::invocation_end, events[2].kind);
+  }
+#else
+  GTEST_SKIP() << "configure with -DGARAK_ENABLE_TRACING=ON";
+#endif
+}
@@ -0,0 +1,170 @@
+#include <gtest/gtest.h>
+
+#include <pthread.h>
+
+#include <algorithm>
+#include <array>
+#include <asio/post.hpp>
+#include <asio/steady_timer.hpp>
+#include <asio/write.hpp>
+#include <chrono>
+#include <cstddef>
+#include <garak/watchdog.hpp>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "loopback.hpp"
+
+/**
+ * @brief Sleeps through the watchdog's threshold; a named type, so the
+ * completion function running it is exported and carries its name
+ * */
+struct blocking_handler {
+  std::chrono::milliseconds duration;
+
+  void operator()() const { std::this_thread::sleep_for(duration); }
+};
+
+/**
+ * @brief The same for a socket read, which the reactor completes from
+ * inside its own operation
+ * */
+struct blocking_read_handler {
+  std::chrono::milliseconds duration;
+
+  void operator()(asio::error_code /*ec*/, std::size_t /*n*/) const {
+    std::this_thread::sleep_for(duration);
+  }
+};
+
+namespace {
+/**
+ * @brief Collects the watchdog's reports
+ * */
+class stall_log {
+ public:
+  garak::watchdog_options options(std::chrono::milliseconds threshold) {
+    garak::watchdog_options o;
+    o.threshold = threshold;
+    o.on_stall = [this](const garak::stall_report& report) {
+      const std::lock_guard lock{mutex_};
+      reports_.push_back(report);
+    };
+    return o;
+  }
+
+  std::vector<garak::stall_report> reports() {
+    const std::lock_guard lock{mutex_};
+    return reports_;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::vector<garak::stall_report> reports_;
+};
+
+bool contains(const std::vector<std::string>& lines, const std::string& s) {
+  return std::any_of(lines.begin(), lines.end(), [&](const std::string& l) {
+    return l.find(s) != std::string::npos;
+  });
+}
+}  // namespace
+
+/**
+ * @brief A handler sleeping on a named io thread is reported once, with
+ * its type and a stack through the sleep
+ * */
+TEST(WatchdogTest, ReportsBlockingHandler) {
+  stall_log log;
+  asio::io_context ctx;
+  garak::watchdog watchdog{log.options(std::chrono::milliseconds(20))};
+  watchdog.watch(ctx);
+  asio::post(ctx, blocking_handler{std::chrono::milliseconds(300)});
+  std::thread io{[&ctx] {
+    ::pthread_setname_np(::pthread_self(), "stalled-io");
+    ctx.run();
+  }};
+  io.join();
+
+  const auto reports = log.reports();
+  ASSERT_EQ(1U, reports.size());
+  EXPECT_EQ(1U, watchdog.stalls());
+  EXPECT_EQ("stalled-io", reports[0].thread);
+  EXPECT_GT(reports[0].tid, 0);
+  EXPECT_GE(reports[0].blocked, std::chrono::milliseconds(20));
+  EXPECT_NE(std::string::npos, reports[0].handler.find("blocking_handler"))
+      << reports[0].handler;
+  ASSERT_FALSE(reports[0].stack.empty());
+  EXPECT_TRUE(contains(reports[0].stack, "nanosleep"));
+}
+
+/**
+ * @brief A socket completion handler is reported under its own type, not
+ * the reactor's
+ * */
+TEST(WatchdogTest, ReportsBlockingReadHandler) {
+  stall_log log;
+  asio::io_context ctx;
+  garak::watchdog watchdog{log.options(std::chrono::milliseconds(20))};
+  watchdog.watch(ctx);
+  auto [client, server] = garak::test::connected_pair(ctx);
+  std::array<char, 1> byte{};
+  server.async_read_some(asio::buffer(byte),
+                         blocking_read_handler{std::chrono::milliseconds(300)});
+  std::thread io{[&ctx] { ctx.run(); }};
+  asio::write(client, asio::buffer(byte));
+  io.join();
+
+  const auto reports = log.reports();
+  ASSERT_EQ(1U, reports.size());
+  EXPECT_NE(std::string::npos,
+            reports[0].handler.find("blocking_read_handler"))
+      << reports[0].handler;
+}
+
+/**
+ * @brief Many short handlers, and a thread idle in the reactor, are not
+ * stalls
+ * */
+TEST(WatchdogTest, IgnoresQuickHandlersAndIdleThreads) {
+  stall_log log;
+  asio::io_context ctx;
+  garak::watchdog watchdog{log.options(std::chrono::milliseconds(20))};
+  watchdog.watch(ctx);
+  asio::steady_timer idle{ctx, std::chrono::milliseconds(200)};
+  idle.async_wait([](asio::error_code) {});
+  for (int i = 0; i < 20; ++i) {
+    asio::post(ctx, blocking_handler{std::chrono::milliseconds(2)});
+  }
+  ctx.run();
+  EXPECT_TRUE(log.reports().empty());
+  EXPECT_EQ(0U, watchdog.stalls());
+}
+
+/**
+ * @brief The io_context can go before the watchdog, and the watchdog
+ * before the io_context
+ * */
+TEST(WatchdogTest, EitherGoesFirst) {
+  stall_log log;
+  {
+    garak::watchdog watchdog{log.options(std::chrono::milliseconds(20))};
+    {
+      asio::io_context ctx;
+      watchdog.watch(ctx);
+      asio::post(ctx, blocking_handler{std::chrono::milliseconds(1)});
+      ctx.run();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+  }
+  asio::io_context ctx;
+  {
+    garak::watchdog watchdog{log.options(std::chrono::milliseconds(20))};
+    watchdog.watch(ctx);
+  }
+  asio::post(ctx, blocking_handler{std::chrono::milliseconds(1)});
+  EXPECT_EQ(1U, ctx.run());
+  EXPECT_TRUE(log.reports().empty());
+}
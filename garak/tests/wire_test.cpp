@@ -0,0 +1,208 @@
+#include <gtest/gtest.h>
+
+#include <garak/dispatcher.hpp>
+#include <garak/wire.hpp>
+#include <string>
+#include <vector>
+
+namespace {
+enum class side : std::uint8_t { buy = 1, sell = 2 };
+
+struct price {
+  std::int64_t mantissa;
+  std::int8_t exponent;
+};
+
+struct fill {
+  std::uint32_t quantity;
+  price at;
+};
+
+struct order {
+  std::uint64_t id;
+  side direction;
+  bool urgent;
+  double weight;
+  std::string symbol;
+  std::vector<std::int32_t> tags;
+  std::vector<std::string> venues;
+  std::vector<fill> fills;
+  price limit;
+};
+
+struct order_v0 {
+  std::uint64_t id;
+  side direction;
+};
+
+bool operator==(const price& lhs, const price& rhs) {
+  return lhs.mantissa == rhs.mantissa && lhs.exponent == rhs.exponent;
+}
+
+bool operator==(const fill& lhs, const fill& rhs) {
+  return lhs.quantity == rhs.quantity && lhs.at == rhs.at;
+}
+
+order sample_order() {
+  return order{42,
+               side::sell,
+               true,
+               0.25,
+               "GRK",
+               {-1, 7, 1 << 20},
+               {"XNAS", "XLON"},
+               {{100, {12345, -2}}, {5, {99, 0}}},
+               {12000, -2}};
+}
+}  // namespace
+
+/**
+ * @brief Every field kind survives a round trip, read in place
+ * */
+TEST(WireTest, RoundTrip) {
+  std::vector<std::byte> buffer;
+  garak::wire::builder builder{buffer};
+  const auto message = builder.encode(sample_order());
+
+  auto view = garak::wire::root<order>(message);
+  ASSERT_TRUE(view.has_value());
+  EXPECT_EQ(42U, view->get<0>());
+  EXPECT_EQ(side::sell, view->get<1>());
+  EXPECT_TRUE(view->get<2>());
+  EXPECT_DOUBLE_EQ(0.25, view->get<3>());
+  EXPECT_EQ("GRK", view->get<4>());
+
+  const auto tags = view->get<5>();
+  ASSERT_EQ(3U, tags.size());
+  EXPECT_EQ(-1, tags[0]);
+  EXPECT_EQ(1 << 20, tags[2]);
+
+  std::vector<std::string_view> venues(view->get<6>().begin(),
+                                       view->get<6>().end());
+  EXPECT_EQ((std::vector<std::string_view>{"XNAS", "XLON"}), venues);
+
+  const auto fills = view->get<7>();
+  ASSERT_EQ(2U, fills.size());
+  EXPECT_EQ(100U, fills[0].get<0>());
+  EXPECT_EQ(12345, fills[0].get<1>().get<0>());
+  EXPECT_EQ(-2, fills[0].get<1>().get<1>());
+  EXPECT_EQ(-2, view->get<8>().get<1>());
+
+  const auto copy = view->materialize();
+  EXPECT_EQ(sample_order().fills, copy.fills);
+  EXPECT_EQ(sample_order().venues, copy.venues);
+  EXPECT_EQ(sample_order().limit, copy.limit);
+}
+
+/**
+ * @brief Scalars sit on their natural alignment, and string bytes are
+ * referenced rather than copied
+ * */
+TEST(WireTest, InPlaceAccess) {
+  std::vector<std::byte> buffer;
+  garak::wire::builder builder{buffer};
+  builder.encode(sample_order());
+
+  auto view = garak::wire::root_unchecked<order>(buffer);
+  const auto symbol = view.get<4>();
+  EXPECT_GE(symbol.data(), reinterpret_cast<const char*>(buffer.data()));
+  EXPECT_LT(symbol.data(),
+            reinterpret_cast<const char*>(buffer.data() + buffer.size()));
+  EXPECT_EQ(0U, garak::wire::detail::table_layout<order>::offsets[3] % 8);
+  EXPECT_EQ('\0', symbol.data()[symbol.size()]);
+}
+
+/**
+ * @brief Messages can be appended behind a header already in the send
+ * buffer, and built field by field
+ * */
+TEST(WireTest, TableWriter) {
+  std::vector<std::byte> buffer(3, std::byte{0xFF});
+  garak::wire::builder builder{buffer};
+  auto root = builder.start_root<order>();
+  const std::vector<std::string_view> venues{"XPAR"};
+  root.set<0>(7U).set<4>("ABC").set<6>(venues);
+  root.start_table<8>().set<0>(5).set<1>(1);
+
+  auto view = garak::wire::root<order>(builder.message());
+  ASSERT_TRUE(view.has_value());
+  EXPECT_EQ(std::byte{0xFF}, buffer[2]);
+  EXPECT_EQ(7U, view->get<0>());
+  EXPECT_EQ("ABC", view->get<4>());
+  ASSERT_EQ(1U, view->get<6>().size());
+  EXPECT_EQ("XPAR", view->get<6>()[0]);
+  EXPECT_EQ(5, view->get<8>().get<0>());
+  EXPECT_TRUE(view->get<5>().empty());
+  EXPECT_TRUE(view->get<7>().empty());
+}
+
+/**
+ * @brief Old readers ignore new fields, new readers default missing ones
+ * */
+TEST(WireTest, SchemaEvolution) {
+  std::vector<std::byte> new_buffer;
+  garak::wire::builder{new_buffer}.encode(sample_order());
+  auto old_view = garak::wire::root<order_v0>(new_buffer);
+  ASSERT_TRUE(old_view.has_value());
+  EXPECT_EQ(42U, old_view->get<0>());
+
+  std::vector<std::byte> old_buffer;
+  garak::wire::builder{old_buffer}.encode(order_v0{9, side::buy});
+  auto new_view = garak::wire::root<order>(old_buffer);
+  ASSERT_TRUE(new_view.has_value());
+  EXPECT_EQ(9U, new_view->get<0>());
+  EXPECT_EQ("", new_view->get<4>());
+  EXPECT_EQ(0U, new_view->get<7>().size());
+  EXPECT_EQ(0, new_view->get<8>().get<0>());
+}
+
+/**
+ * @brief Truncated or corrupted messages are rejected before any accessor
+ * can read out of bounds
+ * */
+TEST(WireTest, Verification) {
+  std::vector<std::byte> buffer;
+  garak::wire::builder{buffer}.encode(sample_order());
+
+  for (std::size_t size = 0; size < buffer.size(); ++size) {
+    EXPECT_FALSE(garak::wire::verify<order>(
+        std::span<const std::byte>{buffer.data(), size}));
+  }
+
+  for (std::size_t i = 0; i < buffer.size(); ++i) {
+    auto corrupt = buffer;
+    corrupt[i] = std::byte{0xFF};
+    if (garak::wire::verify<order>(corrupt)) {
+      EXPECT_NO_THROW(
+          garak::wire::root_unchecked<order>(corrupt).materialize());
+    }
+  }
+
+  EXPECT_THROW(garak::wire::view<order>::decode(
+                   std::span<const std::byte>{buffer.data(), 5}),
+               garak::wire::format_error);
+}
+
+namespace {
+struct order_handler {
+  static constexpr garak::message_id id = 10;
+  using message_type = garak::wire::view<order>;
+
+  void operator()(message_type msg, std::string& out) const {
+    out = msg.get<4>();
+  }
+};
+}  // namespace
+
+/**
+ * @brief Views decode straight from the dispatcher without a copy
+ * */
+TEST(WireTest, DispatchView) {
+  std::vector<std::byte> buffer;
+  garak::wire::builder{buffer}.encode(sample_order());
+
+  garak::dispatcher<order_handler> dispatch;
+  std::string symbol;
+  EXPECT_TRUE(dispatch.dispatch(10, buffer, symbol));
+  EXPECT_EQ("GRK", symbol);
+}
@@ -0,0 +1,430 @@
+#include <algorithm>
+#include <array>
+#include <asio.hpp>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <garak/frame.hpp>
+#include <garak/hdr_histogram.hpp>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace {
+using tcp = asio::ip::tcp;
+using clock_type = std::chrono::steady_clock;
+
+constexpr auto usage = R"(usage: garak_loadgen [options] host port
+
+  -c, --connections N   connections to open (16)
+  -t, --threads N       threads driving them (1)
+  -d, --duration S      seconds to run (10)
+  -r, --rate R          requests per second across all connections, open
+                        loop; 0 runs closed loop, as fast as replies come (0)
+  -p, --protocol P      echo, http or frame (echo)
+  -s, --size B          request payload bytes for echo and frame (64)
+  -u, --path PATH       request path for http (/)
+  -l, --latency         print the full latency distribution
+)";
+
+enum class protocol { echo, http, frame };
+
+struct options {
+  std::string host;
+  std::string port;
+  std::size_t connections{16};
+  std::size_t threads{1};
+  std::chrono::seconds duration{10};
+  double rate{0};
+  protocol proto{protocol::echo};
+  std::size_t size{64};
+  std::string path{"/"};
+  bool distribution{false};
+};
+
+template <typename T>
+T parse_number(std::string_view text) {
+  T value{};
+  const auto [end, ec] =
+      std::from_chars(text.data(), text.data() + text.size(), value);
+  if (ec != std::errc{} || end != text.data() + text.size()) {
+    throw std::invalid_argument("not a number: " + std::string{text});
+  }
+  return value;
+}
+
+options parse(int argc, char** argv) {
+  options o;
+  std::vector<std::string_view> positional;
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg{argv[i]};
+    auto value = [&]() -> std::string_view {
+      if (i + 1 >= argc) {
+        throw std::invalid_argument("missing value for " + std::string{arg});
+      }
+      return argv[++i];
+    };
+    if (arg == "-c" || arg == "--connections") {
+      o.connections = parse_number<std::size_t>(value());
+    } else if (arg == "-t" || arg == "--threads") {
+      o.threads = parse_number<std::size_t>(value());
+    } else if (arg == "-d" || arg == "--duration") {
+      o.duration = std::chrono::seconds{parse_number<int>(value())};
+    } else if (arg == "-r" || arg == "--rate") {
+      o.rate = parse_number<double>(value());
+    } else if (arg == "-p" || arg == "--protocol") {
+      const auto name = value();
+      if (name == "echo") {
+        o.proto = protocol::echo;
+      } else if (name == "http") {
+        o.proto = protocol::http;
+      } else if (name == "frame") {
+        o.proto = protocol::frame;
+      } else {
+        throw std::invalid_argument("unknown protocol " + std::string{name});
+      }
+    } else if (arg == "-s" || arg == "--size") {
+      o.size = parse_number<std::size_t>(value());
+    } else if (arg == "-u" || arg == "--path") {
+      o.path = value();
+    } else if (arg == "-l" || arg == "--latency") {
+      o.distribution = true;
+    } else if (arg.starts_with("-")) {
+      throw std::invalid_argument("unknown option " + std::string{arg});
+    } else {
+      positional.push_back(arg);
+    }
+  }
+  if (positional.size() != 2 || o.connections == 0 || o.threads == 0) {
+    throw std::invalid_argument("expected host and port");
+  }
+  o.host = positional[0];
+  o.port = positional[1];
+  o.threads = std::min(o.threads, o.connections);
+  return o;
+}
+
+/**
+ * @brief One thread's share of the connections and what they measured
+ * */
+struct worker {
+  asio::io_context ctx{1};
+  // Microseconds, up to a minute at 3 significant digits
+  garak::hdr_histogram latency{60'000'000, 3};
+  std::uint64_t requests{0};
+  std::uint64_t errors{0};
+  std::uint64_t bytes_in{0};
+  std::size_t active{0};
+  asio::steady_timer guard{ctx};
+};
+
+using connection = garak::framed_stream<tcp::socket>;
+
+/**
+ * @brief Send payload and read the same number of bytes back
+ * */
+asio::awaitable<std::size_t> echo_exchange(connection& c,
+                                           const std::vector<char>& payload,
+                                           std::vector<char>& reply) {
+  co_await asio::async_write(c.next_layer(), asio::buffer(payload),
+                             asio::use_awaitable);
+  co_return co_await asio::async_read(c.next_layer(), asio::buffer(reply),
+                                      asio::use_awaitable);
+}
+
+/**
+ * @brief Send one length-prefixed frame and read one back
+ * */
+asio::awaitable<std::size_t> frame_exchange(connection& c,
+                                            const std::vector<char>& payload) {
+  co_await c.async_write_frame(asio::buffer(payload), asio::use_awaitable);
+  const auto frame = co_await c.async_read_frame(asio::use_awaitable);
+  co_return frame.size() + connection::header_size;
+}
+
+// Case-insensitive search for a header's value in a response head
+std::string_view header_value(std::string_view head, std::string_view name) {
+  auto lower = [](char ch) {
+    return ch >= 'A' && ch <= 'Z' ? static_cast<char>(ch - 'A' + 'a') : ch;
+  };
+  std::size_t line = head.find("\r\n");
+  while (line != std::string_view::npos && line + 2 < head.size()) {
+    const auto start = line + 2;
+    const auto end = head.find("\r\n", start);
+    const auto field = head.substr(start, end - start);
+    if (field.size() > name.size() && field[name.size()] == ':' &&
+        std::equal(name.begin(), name.end(), field.begin(),
+                   [&](char a, char b) { return lower(a) == lower(b); })) {
+      auto value = field.substr(name.size() + 1);
+      while (!value.empty() && value.front() == ' ') {
+        value.remove_prefix(1);
+      }
+      return value;
+    }
+    line = end;
+  }
+  return {};
+}
+
+/**
+ * @brief Send a keep-alive GET and read the response, with a
+ * Content-Length or chunked body
+ *
+ * @returns bytes received, throws on malformed responses and counts non-2xx
+ * statuses as errors
+ * */
+asio::awaitable<std::size_t> http_exchange(connection& c,
+                                           const std::string& request,
+                                           std::string& buffer) {
+  auto& socket = c.next_layer();
+  co_await asio::async_write(socket, asio::buffer(request),
+                             asio::use_awaitable);
+  auto dynamic = asio::dynamic_buffer(buffer);
+  const std::size_t head_size = co_await asio::async_read_until(
+      socket, dynamic, "\r\n\r\n", asio::use_awaitable);
+  const std::string_view head{buffer.data(), head_size};
+  if (!head.starts_with("HTTP/1.") || head.size() < 12) {
+    throw std::runtime_error("malformed response");
+  }
+  const bool success = head[9] == '2';
+  std::size_t total = head_size;
+  dynamic.consume(head_size);
+
+  // Ensure n bytes are buffered
+  auto fill = [&](std::size_t n) -> asio::awaitable<void> {
+    if (buffer.size() < n) {
+      co_await asio::async_read(socket, dynamic,
+                                asio::transfer_exactly(n - buffer.size()),
+                                asio::use_awaitable);
+    }
+  };
+
+  if (header_value(head, "transfer-encoding") == "chunked") {
+    for (;;) {
+      const std::size_t line = co_await asio::async_read_until(
+          socket, dynamic, "\r\n", asio::use_awaitable);
+      std::size_t chunk = 0;
+      std::from_chars(buffer.data(), buffer.data() + line, chunk, 16);
+      total += line + chunk + 2;
+      dynamic.consume(line);
+      co_await fill(chunk + 2);
+      dynamic.consume(chunk + 2);
+      if (chunk == 0) {
+        break;
+      }
+    }
+  } else {
+    const auto length = header_value(head, "content-length");
+    const auto body = length.empty()
+                          ? 0
+                          : parse_number<std::size_t>(
+                                length.substr(0, length.find("\r\n")));
+    co_await fill(body);
+    dynamic.consume(body);
+    total += body;
+  }
+  if (!success) {
+    throw std::runtime_error("non-2xx status");
+  }
+  co_return total;
+}
+
+/**
+ * @brief Drive one connection until the deadline
+ *
+ * Open loop requests are scheduled every interval from start; latency is
+ * measured from the scheduled time rather than the send time, so a slow
+ * reply also charges the requests it delayed (no coordinated omission).
+ * */
+asio::awaitable<void> drive(worker& w, const options& o,
+                            tcp::resolver::results_type endpoints,
+                            clock_type::time_point start,
+                            clock_type::duration interval,
+                            clock_type::time_point deadline) {
+  const std::vector<char> payload(o.size, 'x');
+  std::vector<char> reply(o.size);
+  const std::string request = "GET " + o.path + " HTTP/1.1\r\nHost: " +
+                              o.host + "\r\nConnection: keep-alive\r\n\r\n";
+  std::string http_buffer;
+  asio::steady_timer pacer{w.ctx};
+  std::unique_ptr<connection> c;
+  auto next = start;
+  bool failed = false;
+
+  while (clock_type::now() < deadline) {
+    auto intended = clock_type::now();
+    if (interval > clock_type::duration::zero()) {
+      intended = next;
+      next += interval;
+      if (intended >= deadline) {
+        break;
+      }
+      if (intended > clock_type::now()) {
+        pacer.expires_at(intended);
+        co_await pacer.async_wait(asio::use_awaitable);
+      }
+    }
+    try {
+      if (!c) {
+        c = std::make_unique<connection>(w.ctx.get_executor());
+        co_await asio::async_connect(c->next_layer(), endpoints,
+                                     asio::use_awaitable);
+        c->next_layer().set_option(tcp::no_delay{true});
+        http_buffer.clear();
+      }
+      std::size_t received = 0;
+      switch (o.proto) {
+        case protocol::echo:
+          received = co_await echo_exchange(*c, payload, reply);
+          break;
+        case protocol::frame:
+          received = co_await frame_exchange(*c, payload);
+          break;
+        case protocol::http:
+          received = co_await http_exchange(*c, request, http_buffer);
+          break;
+      }
+      const auto elapsed =
+          std::chrono::duration_cast<std::chrono::microseconds>(
+              clock_type::now() - intended);
+      w.latency.record(elapsed.count());
+      ++w.requests;
+      w.bytes_in += received;
+    } catch (const std::exception&) {
+      ++w.errors;
+      c.reset();
+      failed = true;
+    }
+    if (failed) {
+      // Back off before reconnecting rather than spin on a refused port
+      failed = false;
+      pacer.expires_after(std::chrono::milliseconds(10));
+      co_await pacer.async_wait(asio::use_awaitable);
+    }
+  }
+  if (--w.active == 0) {
+    w.guard.cancel();
+  }
+}
+
+std::string rate_text(double per_second) {
+  std::array<char, 32> text{};
+  std::snprintf(text.data(), text.size(), "%.1f", per_second);
+  return text.data();
+}
+}  // namespace
+
+/**
+ * @brief A closed or open loop load generator for echo, HTTP/1.1 and
+ * length-prefixed frame servers, reporting throughput and HDR latency
+ * percentiles
+ * */
+int main(int argc, char** argv) {
+  options o;
+  try {
+    o = parse(argc, argv);
+  } catch (const std::exception& error) {
+    std::cerr << error.what() << "\n\n" << usage;
+    return 2;
+  }
+
+  asio::io_context resolve_ctx;
+  tcp::resolver resolver{resolve_ctx};
+  tcp::resolver::results_type endpoints;
+  try {
+    endpoints = resolver.resolve(o.host, o.port);
+  } catch (const std::exception& error) {
+    std::cerr << o.host << ':' << o.port << ": " << error.what() << '\n';
+    return 1;
+  }
+
+  std::deque<worker> workers(o.threads);
+  const auto interval =
+      o.rate > 0
+          ? std::chrono::duration_cast<clock_type::duration>(
+                std::chrono::duration<double>(
+                    static_cast<double>(o.connections) / o.rate))
+          : clock_type::duration::zero();
+  const auto start = clock_type::now() + std::chrono::milliseconds(100);
+  const auto deadline = start + o.duration;
+  for (std::size_t i = 0; i < o.connections; ++i) {
+    auto& w = workers[i % workers.size()];
+    ++w.active;
+    // Stagger open loop connections across one interval
+    const auto offset = interval * static_cast<long>(i) /
+                        static_cast<long>(o.connections);
+    asio::co_spawn(w.ctx,
+                   drive(w, o, endpoints, start + offset, interval, deadline),
+                   asio::detached);
+  }
+  for (auto& w : workers) {
+    // Give replies in flight a second past the deadline, then give up
+    w.guard.expires_at(deadline + std::chrono::seconds(1));
+    w.guard.async_wait([&w](const asio::error_code& ec) {
+      if (!ec) {
+        w.ctx.stop();
+      }
+    });
+  }
+
+  std::vector<std::thread> threads;
+  for (auto& w : workers) {
+    threads.emplace_back([&w] { w.ctx.run(); });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  garak::hdr_histogram latency{60'000'000, 3};
+  std::uint64_t requests = 0;
+  std::uint64_t errors = 0;
+  std::uint64_t bytes_in = 0;
+  for (const auto& w : workers) {
+    latency.merge(w.latency);
+    requests += w.requests;
+    errors += w.errors;
+    bytes_in += w.bytes_in;
+  }
+  const double seconds = static_cast<double>(o.duration.count());
+  const char* names[] = {"echo", "http", "frame"};
+
+  std::cout << "garak_loadgen " << o.host << ':' << o.port << ", "
+            << names[static_cast<int>(o.proto)] << ", " << o.connections
+            << " connections, " << o.threads << " threads, "
+            << o.duration.count() << "s, "
+            << (o.rate > 0 ? "open loop at " + rate_text(o.rate) + " req/s"
+                           : std::string{"closed loop"})
+            << '\n';
+  std::cout << "  requests    " << requests << " ("
+            << rate_text(static_cast<double>(requests) / seconds)
+            << "/s), errors " << errors << '\n';
+  std::cout << "  received    " << bytes_in << " B ("
+            << rate_text(static_cast<double>(bytes_in) / seconds / 1e6)
+            << " MB/s)\n";
+  std::cout << "  latency us  min " << latency.min();
+  for (const double p : {50.0, 90.0, 99.0, 99.9, 99.99}) {
+    std::cout << "  p" << p << ' ' << latency.value_at_percentile(p);
+  }
+  std::cout << "  max " << latency.max() << "  mean "
+            << rate_text(latency.mean()) << '\n';
+
+  if (o.distribution) {
+    std::cout << "\n       Value   Percentile   TotalCount\n";
+    latency.for_each_value(
+        [](std::int64_t value, double percentile, std::int64_t count) {
+          std::array<char, 64> line{};
+          std::snprintf(line.data(), line.size(), "%12lld %12.6f %12lld\n",
+                        static_cast<long long>(value), percentile / 100.0,
+                        static_cast<long long>(count));
+          std::cout << line.data();
+        });
+  }
+  return errors == 0 ? 0 : 1;
+}
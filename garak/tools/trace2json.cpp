@@ -0,0 +1,216 @@
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <garak/tracing.hpp>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace {
+using garak::tracing::event;
+using garak::tracing::event_kind;
+using garak::tracing::trace;
+
+constexpr auto usage = R"(usage: garak_trace2json trace.bin [trace.json]
+
+Converts a garak::tracing dump to Chrome trace JSON, open it in
+https://ui.perfetto.dev or chrome://tracing. Writes to stdout without an
+output path.
+)";
+
+/**
+ * @brief Writes a JSON string literal, escaping as needed
+ * */
+void quote(std::ostream& out, std::string_view text) {
+  out << '"';
+  for (const char ch : text) {
+    switch (ch) {
+      case '"':
+        out << "\\\"";
+        break;
+      case '\\':
+        out << "\\\\";
+        break;
+      default:
+        if (static_cast<unsigned char>(ch) < 0x20) {
+          std::array<char, 8> escaped{};
+          std::snprintf(escaped.data(), escaped.size(), "\\u%04x",
+                        static_cast<unsigned>(ch));
+          out << escaped.data();
+        } else {
+          out << ch;
+        }
+    }
+  }
+  out << '"';
+}
+
+/**
+ * @brief Streams trace events one per line
+ * */
+class writer {
+ public:
+  writer(std::ostream& out, const trace& t) : out_(out), trace_(t) {
+    out_ << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+  }
+
+  ~writer() { out_ << "\n]}\n"; }
+
+  writer(const writer&) = delete;
+  writer& operator=(const writer&) = delete;
+
+  /**
+   * @brief Starts an event object, the caller adds any trailing fields and
+   * closes it
+   * */
+  std::ostream& begin(std::string_view phase, std::string_view name,
+                      std::uint32_t thread, std::uint64_t tsc) {
+    out_ << (first_ ? "" : ",\n") << "{\"ph\":\"" << phase << "\",\"name\":";
+    first_ = false;
+    quote(out_, name);
+    std::array<char, 32> ts{};
+    std::snprintf(ts.data(), ts.size(), "%.3f", trace_.to_ns(tsc) / 1000.0);
+    out_ << ",\"pid\":1,\"tid\":" << thread << ",\"ts\":" << ts.data();
+    return out_;
+  }
+
+  void thread_name(std::uint32_t thread, std::string_view name) {
+    out_ << (first_ ? "" : ",\n")
+         << R"({"ph":"M","name":"thread_name","pid":1,"tid":)" << thread
+         << R"(,"args":{"name":)";
+    first_ = false;
+    quote(out_, name);
+    out_ << "}}";
+  }
+
+ private:
+  std::ostream& out_;
+  const trace& trace_;
+  bool first_{true};
+};
+
+/**
+ * @brief "socket.async_receive", the name a handler is shown under
+ * */
+std::string handler_name(const trace& t, const event& created) {
+  std::string name = t.name(created.object);
+  if (!name.empty()) {
+    name += '.';
+  }
+  name += t.name(created.op);
+  return name.empty() ? "handler" : name;
+}
+
+void convert(const trace& t, std::ostream& out) {
+  std::unordered_map<std::uint64_t, std::size_t> created;
+  for (std::size_t i = 0; i < t.events.size(); ++i) {
+    if (t.events[i].kind == event_kind::creation) {
+      created.emplace(t.events[i].id, i);
+    }
+  }
+  auto name_of = [&](std::uint64_t id) -> std::string {
+    const auto it = created.find(id);
+    return it == created.end() ? "handler " + std::to_string(id)
+                               : handler_name(t, t.events[it->second]);
+  };
+
+  writer w{out, t};
+  for (const auto& th : t.threads) {
+    w.thread_name(th.index, th.name.empty()
+                                ? "thread " + std::to_string(th.index)
+                                : th.name);
+  }
+  for (const auto& e : t.events) {
+    switch (e.kind) {
+      case event_kind::creation: {
+        const auto name = handler_name(t, e);
+        w.begin("i", "create " + name, e.thread, e.tsc)
+            << R"(,"s":"t","cat":"create","args":{"id":)" << e.id
+            << ",\"parent\":" << e.arg << ",\"handle\":" << e.extra
+            << ",\"location\":";
+        quote(out, t.name(e.location));
+        out << "}}";
+        // Arrow from the creating slice to the handler's invocation
+        w.begin("s", "flow", e.thread, e.tsc)
+            << R"(,"cat":"flow","id":)" << e.id << '}';
+        break;
+      }
+      case event_kind::invocation_begin:
+        w.begin("f", "flow", e.thread, e.tsc)
+            << R"(,"cat":"flow","bp":"e","id":)" << e.id << '}';
+        w.begin("B", name_of(e.id), e.thread, e.tsc)
+            << R"(,"cat":"handler","args":{"id":)" << e.id
+            << ",\"ec\":" << e.arg << ",\"arg\":" << e.extra << "}}";
+        break;
+      case event_kind::invocation_end:
+        w.begin("E", name_of(e.id), e.thread, e.tsc) << '}';
+        break;
+      case event_kind::abandoned:
+        w.begin("i", "abandon " + name_of(e.id), e.thread, e.tsc)
+            << R"(,"s":"t","cat":"abandon","args":{"id":)" << e.id << "}}";
+        break;
+      case event_kind::operation: {
+        std::string name = t.name(e.object);
+        name += '.';
+        name += t.name(e.op);
+        w.begin("i", name, e.thread, e.tsc)
+            << R"(,"s":"t","cat":"operation","args":{"handle":)" << e.extra
+            << "}}";
+        break;
+      }
+      case event_kind::reactor_registration:
+      case event_kind::reactor_deregistration:
+        w.begin("i",
+                e.kind == event_kind::reactor_registration
+                    ? "reactor register"
+                    : "reactor deregister",
+                e.thread, e.tsc)
+            << R"(,"s":"t","cat":"reactor","args":{"descriptor":)" << e.extra
+            << "}}";
+        break;
+      case event_kind::reactor_events:
+        w.begin("i", "reactor events", e.thread, e.tsc)
+            << R"(,"s":"t","cat":"reactor","args":{"events":)" << e.extra
+            << "}}";
+        break;
+      case event_kind::reactor_operation:
+        w.begin("i", t.name(e.op), e.thread, e.tsc)
+            << R"(,"s":"t","cat":"reactor","args":{"id":)" << e.id
+            << ",\"ec\":" << e.arg << ",\"bytes\":" << e.extra << "}}";
+        break;
+    }
+  }
+}
+}  // namespace
+
+/**
+ * @brief Convert a binary garak::tracing dump to Chrome trace / Perfetto
+ * JSON
+ * */
+int main(int argc, char** argv) {
+  if (argc < 2 || argc > 3) {
+    std::cerr << usage;
+    return 2;
+  }
+  try {
+    const auto t = garak::tracing::load(argv[1]);
+    if (argc == 3) {
+      std::ofstream out{argv[2]};
+      if (!out) {
+        std::cerr << "can't write " << argv[2] << '\n';
+        return 1;
+      }
+      convert(t, out);
+    } else {
+      convert(t, std::cout);
+    }
+    std::cerr << t.events.size() << " events from " << t.threads.size()
+              << " threads\n";
+  } catch (const std::exception& error) {
+    std::cerr << error.what() << '\n';
+    return 1;
+  }
+  return 0;
+}